@@ -0,0 +1,49 @@
+#include "epoch_rcu.h"
+#include <atomic>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+using RouteTable = std::map<std::string, std::string>;
+
+int main() {
+    concurrent::rcu_ptr<RouteTable> routes(
+        std::make_unique<RouteTable>(RouteTable{{"10.0.0.0/8", "eth0"}}));
+
+    std::atomic<bool> stop{false};
+    std::atomic<long> total_reads{0};
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; ++t) {
+        readers.emplace_back([&] {
+            auto reader = routes.register_reader();
+            long reads = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                auto snapshot = routes.read(reader);
+                reads += static_cast<long>(snapshot->size());
+            }
+            total_reads += reads;
+        });
+    }
+
+    for (int i = 0; i < 10; ++i) {
+        routes.update([i](const RouteTable* current) {
+            auto next = std::make_unique<RouteTable>(*current);
+            (*next)["192.168." + std::to_string(i) + ".0/24"] = "eth1";
+            return next;
+        });
+    }
+    stop = true;
+    for (auto& t : readers) t.join();
+
+    auto reader = routes.register_reader();
+    auto snapshot = routes.read(reader);
+    std::cout << "Generations published: " << routes.generation() << "\n";
+    std::cout << "Routes in final table: " << snapshot->size() << "\n";
+    for (const auto& [prefix, dev] : *snapshot) {
+        std::cout << "  " << prefix << " -> " << dev << "\n";
+    }
+    std::cout << "Reader iterations (sum of table sizes seen): " << total_reads.load() << "\n";
+    return 0;
+}
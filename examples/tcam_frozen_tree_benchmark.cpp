@@ -0,0 +1,106 @@
+// Benchmark: pointer-based decision tree vs. the flattened tree used in frozen mode
+#include "tcam.h"
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace {
+
+std::vector<uint8_t> make_packet(uint32_t src_ip, uint32_t dst_ip, uint16_t src_port, uint16_t dst_port,
+                                 uint8_t proto, uint16_t eth_type) {
+    std::vector<uint8_t> p(15);
+    p[0] = (src_ip >> 24) & 0xFF; p[1] = (src_ip >> 16) & 0xFF; p[2] = (src_ip >> 8) & 0xFF; p[3] = src_ip & 0xFF;
+    p[4] = (dst_ip >> 24) & 0xFF; p[5] = (dst_ip >> 16) & 0xFF; p[6] = (dst_ip >> 8) & 0xFF; p[7] = dst_ip & 0xFF;
+    p[8] = (src_port >> 8) & 0xFF; p[9] = src_port & 0xFF;
+    p[10] = (dst_port >> 8) & 0xFF; p[11] = dst_port & 0xFF;
+    p[12] = proto;
+    p[13] = (eth_type >> 8) & 0xFF; p[14] = eth_type & 0xFF;
+    return p;
+}
+
+// Host ACL-style rules: exact source hosts spread over a few subnets, a mix of
+// exact and wildcard destinations, TCP/UDP, plus a handful of catch-all rules.
+OptimizedTCAM::RuleUpdateBatch make_rules(size_t count, std::mt19937& rng) {
+    std::uniform_int_distribution<int> subnet(0, 15);
+    std::uniform_int_distribution<int> host(0, 255);
+    std::uniform_int_distribution<int> coin(0, 3);
+    OptimizedTCAM::RuleUpdateBatch batch;
+    batch.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        OptimizedTCAM::WildcardFields f{};
+        f.src_ip = 0x0A000000u | (static_cast<uint32_t>(subnet(rng)) << 8) | static_cast<uint32_t>(host(rng));
+        f.src_ip_mask = (i % 64 == 0) ? 0xFFFF0000u : 0xFFFFFFFFu;
+        f.dst_ip = 0xC0A80000u | static_cast<uint32_t>(subnet(rng));
+        f.dst_ip_mask = coin(rng) == 0 ? 0x00000000u : 0xFFFFFFFFu;
+        f.src_port_min = 0; f.src_port_max = 0xFFFF;
+        f.dst_port_min = 0; f.dst_port_max = 0xFFFF;
+        f.protocol = coin(rng) == 0 ? 17 : 6;
+        f.protocol_mask = 0xFF;
+        f.eth_type = 0x0800; f.eth_type_mask = 0xFFFF;
+        batch.push_back(OptimizedTCAM::RuleOperation::AddRule(f, coin(rng) * 10, static_cast<int>(i)));
+    }
+    return batch;
+}
+
+std::vector<std::vector<uint8_t>> make_packets(size_t count, std::mt19937& rng) {
+    std::uniform_int_distribution<int> subnet(0, 15);
+    std::uniform_int_distribution<int> host(0, 255);
+    std::uniform_int_distribution<int> coin(0, 3);
+    std::vector<std::vector<uint8_t>> packets;
+    packets.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        packets.push_back(make_packet(0x0A000000u | (static_cast<uint32_t>(subnet(rng)) << 8) | static_cast<uint32_t>(host(rng)),
+                                      0xC0A80000u | static_cast<uint32_t>(subnet(rng)),
+                                      40000, 443, coin(rng) == 0 ? 17 : 6, 0x0800));
+    }
+    return packets;
+}
+
+template <typename Lookup>
+double ns_per_lookup(const std::vector<std::vector<uint8_t>>& packets, int rounds, Lookup&& lookup, long long& checksum) {
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        for (const auto& p : packets) checksum += lookup(p);
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+    return static_cast<double>(elapsed.count()) / (static_cast<double>(packets.size()) * rounds);
+}
+
+void performance_benchmark(size_t rule_count) {
+    std::cout << "=== Decision tree layout benchmark (" << rule_count << " rules) ===\n";
+    std::mt19937 rng(2024);
+    OptimizedTCAM tcam;
+    if (!tcam.update_rules_atomic(make_rules(rule_count, rng))) {
+        std::cerr << "failed to load rules\n";
+        return;
+    }
+    const auto packets = make_packets(20000, rng);
+    constexpr int rounds = 5;
+
+    long long pointer_sum = 0;
+    const double pointer_ns = ns_per_lookup(packets, rounds,
+        [&](const std::vector<uint8_t>& p) { return tcam.lookup_decision_tree_idx(p); }, pointer_sum);
+
+    tcam.freeze();
+    long long frozen_sum = 0;
+    const double frozen_ns = ns_per_lookup(packets, rounds,
+        [&](const std::vector<uint8_t>& p) { return tcam.lookup_frozen_idx(p); }, frozen_sum);
+
+    const auto mem = tcam.get_memory_usage_stats();
+    std::cout << std::fixed << std::setprecision(1)
+              << "  pointer tree : " << pointer_ns << " ns/lookup (" << mem.decision_tree_nodes_count << " nodes)\n"
+              << "  frozen tree  : " << frozen_ns << " ns/lookup (" << mem.frozen_tree_bytes << " bytes)\n"
+              << "  speedup      : " << std::setprecision(2) << pointer_ns / frozen_ns << "x\n"
+              << "  results match: " << (pointer_sum == frozen_sum ? "yes" : "NO") << "\n\n";
+}
+
+} // namespace
+
+int main() {
+    performance_benchmark(10000);
+    performance_benchmark(50000);
+    return 0;
+}
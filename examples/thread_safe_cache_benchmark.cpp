@@ -0,0 +1,115 @@
+// Benchmark: hit rate and lookup cost of each ThreadSafeCache eviction policy on
+// a Zipf-distributed read workload that is periodically interrupted by scans of
+// keys that are read once and never again
+#include "thread_safe_cache.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using cpp_collections::EvictionPolicy;
+
+// Keys drawn from a Zipf(s) distribution over [0, universe) via an inverse CDF table
+std::vector<uint64_t> make_zipf_keys(size_t count, size_t universe, double s, std::mt19937_64& rng) {
+    std::vector<double> cdf(universe);
+    double sum = 0;
+    for (size_t i = 0; i < universe; ++i) {
+        sum += 1.0 / std::pow(static_cast<double>(i + 1), s);
+        cdf[i] = sum;
+    }
+    std::uniform_real_distribution<double> uniform(0.0, sum);
+    std::vector<uint64_t> keys;
+    keys.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        keys.push_back(static_cast<uint64_t>(std::lower_bound(cdf.begin(), cdf.end(), uniform(rng)) - cdf.begin()));
+    }
+    return keys;
+}
+
+// Every `scan_every` point lookups, splice in `scan_length` never-repeated keys
+std::vector<uint64_t> make_trace(size_t lookups, size_t universe, size_t scan_every, size_t scan_length) {
+    std::mt19937_64 rng(42);
+    const std::vector<uint64_t> points = make_zipf_keys(lookups, universe, 0.9, rng);
+    std::vector<uint64_t> trace;
+    trace.reserve(lookups + (scan_every != 0 ? lookups / scan_every * scan_length : 0));
+    uint64_t next_scan_key = uint64_t{1} << 40; // Disjoint from the Zipf keys
+    for (size_t i = 0; i < points.size(); ++i) {
+        trace.push_back(points[i]);
+        if (scan_every != 0 && (i + 1) % scan_every == 0) {
+            for (size_t j = 0; j < scan_length; ++j) {
+                trace.push_back(next_scan_key++);
+            }
+        }
+    }
+    return trace;
+}
+
+struct Result {
+    double hit_rate;   // Percent of requests
+    double ns_per_op;
+};
+
+Result run(EvictionPolicy policy, size_t capacity, const std::vector<uint64_t>& trace) {
+    cpp_collections::ThreadSafeCache<uint64_t, uint64_t> cache(capacity, policy);
+    size_t hits = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (uint64_t key : trace) {
+        if (cache.get(key)) {
+            ++hits;
+        } else {
+            cache.put(key, key); // Load on miss
+        }
+    }
+    const auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    const double requests = static_cast<double>(trace.size());
+    return {100.0 * static_cast<double>(hits) / requests, elapsed / requests};
+}
+
+} // namespace
+
+int main() {
+    const size_t universe = 100000;
+    const size_t capacity = 2000;
+    const std::vector<std::pair<const char*, EvictionPolicy>> policies = {
+        {"LRU", EvictionPolicy::LRU},           {"LFU", EvictionPolicy::LFU},
+        {"FIFO", EvictionPolicy::FIFO},         {"WTinyLFU", EvictionPolicy::WTinyLFU},
+        {"ARC", EvictionPolicy::ARC},
+    };
+
+    struct Workload {
+        const char* name;
+        size_t scan_every;
+        size_t scan_length;
+    };
+    for (const Workload& workload : {Workload{"Zipf(0.9) point lookups", 0, 0},
+                                     Workload{"Zipf(0.9) + a 5000-key scan every 20000 lookups", 20000, 5000}}) {
+        const std::vector<uint64_t> trace = make_trace(1000000, universe, workload.scan_every, workload.scan_length);
+        std::cout << workload.name << ", capacity " << capacity << ", " << trace.size() << " requests\n";
+        std::vector<Result> results;
+        for (const auto& entry : policies) {
+            results.push_back(run(entry.second, capacity, trace));
+        }
+        // The scan-resistant policies are compared against LFU, the strongest of the classic ones here
+        const Result& lfu = results[1];
+        std::cout << std::left << std::setw(10) << "policy" << std::right << std::setw(11) << "hit rate"
+                  << std::setw(11) << "vs LFU" << std::setw(16) << "time" << std::setw(11) << "vs LRU" << '\n';
+        for (size_t i = 0; i < policies.size(); ++i) {
+            const Result& r = results[i];
+            std::cout << std::left << std::setw(10) << policies[i].first << std::right << std::fixed
+                      << std::setprecision(2) << std::setw(9) << r.hit_rate << " %" << std::showpos
+                      << std::setw(9) << r.hit_rate - lfu.hit_rate << " pt" << std::noshowpos
+                      << std::setprecision(1) << std::setw(10) << r.ns_per_op << " ns/op"
+                      << std::setprecision(2) << std::setw(10) << r.ns_per_op / results[0].ns_per_op << "x\n";
+        }
+        std::cout << '\n';
+    }
+    return 0;
+}
@@ -0,0 +1,192 @@
+#ifndef AGING_SCHEDULER_HPP
+#define AGING_SCHEDULER_HPP
+
+#include "timer_wheel.h"
+
+#include <any>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace cpp_utils {
+
+// Per-entry bookkeeping for AgingScheduler. Embed one in each cache entry;
+// a default-constructed handle is "not armed".
+struct AgingHandle {
+    uint32_t timer = UINT32_MAX; // The scheduler's record of the wheel timer, or UINT32_MAX when not on the wheel
+    uint32_t ticket = 0; // Identifies the current arming; 0 = not armed
+    std::chrono::steady_clock::time_point deadline{};
+};
+
+// Drives per-entry deadlines of a cache (neighbor aging, expiry, ...) from a
+// TimerWheel, so that periodic aging visits only entries that are due instead
+// of scanning the whole table.
+//
+// Arming is lazy: schedule() with a deadline no earlier than the one already
+// armed is a no-op, so hot paths that merely push a deadline back (refreshing
+// a timestamp) never touch the wheel. The owner re-checks the entry when it is
+// visited and re-arms it if it is not actually due yet.
+//
+// advance(now) ticks the wheel up to `now` and hands back every (key, ticket)
+// whose timer fired, plus entries armed with a deadline the wheel had already
+// passed. Entries may be visited up to one resolution early; they are never
+// visited late. Stale visits (the entry was re-armed or removed since) are
+// filtered by claim().
+template <typename Key>
+class AgingScheduler {
+public:
+    using clock = std::chrono::steady_clock;
+
+    explicit AgingScheduler(std::chrono::milliseconds resolution = std::chrono::milliseconds(100),
+                            size_t wheel_slots = 4096, clock::time_point start = clock::now())
+        : resolution_(resolution),
+          wheel_slots_(wheel_slots),
+          wheel_(std::make_unique<TimerWheel>(static_cast<size_t>(resolution.count()), wheel_slots)),
+          wheel_now_(start) {}
+
+    AgingScheduler(const AgingScheduler&) = delete;
+    AgingScheduler& operator=(const AgingScheduler&) = delete;
+
+    // Arms `handle` so that `key` is visited no later than `deadline`.
+    void schedule(const Key& key, AgingHandle& handle, clock::time_point deadline) {
+        if (handle.ticket != 0 && deadline >= handle.deadline) {
+            return;
+        }
+        cancel(handle);
+        handle.deadline = deadline;
+        handle.ticket = nextTicket();
+        if (deadline <= wheel_now_) {
+            overdue_.push_back({key, handle.ticket});
+            return;
+        }
+        auto delay = std::chrono::ceil<std::chrono::milliseconds>(deadline - wheel_now_);
+        const uint32_t record = allocateRecord();
+        const TimerWheel::TimerId timer_id = wheel_->addTimer(
+            static_cast<uint64_t>(delay.count()),
+            [this, record](std::any cookie) {
+                releaseRecord(record);
+                fired_.push_back(std::any_cast<Ref>(std::move(cookie)));
+            },
+            Ref{key, handle.ticket});
+        timers_[record] = {timer_id, handle.ticket};
+        handle.timer = record;
+    }
+
+    // Disarms `handle` (e.g. before the entry is erased).
+    void cancel(AgingHandle& handle) {
+        // A record whose timer fired may already serve a newer arming; the ticket tells.
+        if (handle.timer != NO_RECORD && timers_[handle.timer].ticket == handle.ticket) {
+            wheel_->cancelTimer(timers_[handle.timer].timer_id);
+            releaseRecord(handle.timer);
+        }
+        handle = AgingHandle{};
+    }
+
+    // Called from the advance() visitor: returns true if `ticket` is the
+    // handle's current arming, and disarms it so the visitor can re-arm.
+    bool claim(AgingHandle& handle, uint32_t ticket) {
+        if (handle.ticket != ticket) {
+            return false;
+        }
+        handle = AgingHandle{};
+        return true;
+    }
+
+    // Ticks the wheel up to `now` and calls visit(key, ticket) for each due
+    // arming. Returns false without visiting anything if the gap since the
+    // last advance exceeds one wheel revolution or invalidate() was called;
+    // the owner should then scan every entry and call reset().
+    template <typename Visit>
+    bool advance(clock::time_point now, Visit&& visit) {
+        if (dirty_ || now - wheel_now_ > resolution_ * static_cast<int64_t>(wheel_slots_)) {
+            return false;
+        }
+        if (wheel_now_ < now) {
+            const auto ticks = (now - wheel_now_ + resolution_ - clock::duration(1)) / resolution_;
+            wheel_->advance(static_cast<uint64_t>(ticks));
+            wheel_now_ += resolution_ * ticks;
+        }
+        // Re-arms made by the visitor land in fresh lists and wait for the next advance.
+        std::vector<Ref> batch;
+        batch.swap(fired_);
+        batch.insert(batch.end(), overdue_.begin(), overdue_.end());
+        overdue_.clear();
+        for (const Ref& ref : batch) {
+            visit(ref.key, ref.ticket);
+        }
+        return true;
+    }
+
+    // Drops every arming and restarts the wheel at `now`. Handles still held by
+    // entries become stale; reset each one to AgingHandle{} before re-arming.
+    void reset(clock::time_point now) {
+        wheel_ = std::make_unique<TimerWheel>(static_cast<size_t>(resolution_.count()), wheel_slots_);
+        wheel_now_ = now;
+        timers_.clear();
+        free_record_ = NO_RECORD;
+        fired_.clear();
+        overdue_.clear();
+        dirty_ = false;
+    }
+
+    // Forces the next advance() to fail, e.g. after the owner changed the
+    // timeouts that deadlines were computed from.
+    void invalidate() { dirty_ = true; }
+
+    // The time the wheel has been advanced to.
+    clock::time_point now() const { return wheel_now_; }
+
+private:
+    struct Ref {
+        Key key;
+        uint32_t ticket;
+    };
+
+    // The wheel timer behind an arming. A record is freed as soon as its timer
+    // fires, so cancel() never hands the wheel a dead id, which the wheel may
+    // have given to a newer timer once the node's generation wrapped.
+    struct TimerRecord {
+        TimerWheel::TimerId timer_id = -1;
+        uint32_t ticket = 0; // 0 while free; free records are chained through `next_free`
+        uint32_t next_free = NO_RECORD;
+    };
+
+    static constexpr uint32_t NO_RECORD = UINT32_MAX;
+
+    uint32_t allocateRecord() {
+        if (free_record_ == NO_RECORD) {
+            timers_.emplace_back();
+            return static_cast<uint32_t>(timers_.size() - 1);
+        }
+        const uint32_t record = free_record_;
+        free_record_ = timers_[record].next_free;
+        return record;
+    }
+
+    void releaseRecord(uint32_t record) {
+        timers_[record] = TimerRecord{-1, 0, free_record_};
+        free_record_ = record;
+    }
+
+    uint32_t nextTicket() {
+        if (++next_ticket_ == 0) ++next_ticket_;
+        return next_ticket_;
+    }
+
+    std::chrono::milliseconds resolution_;
+    size_t wheel_slots_;
+    std::unique_ptr<TimerWheel> wheel_;
+    clock::time_point wheel_now_;
+    std::vector<TimerRecord> timers_;
+    uint32_t free_record_ = NO_RECORD;
+    std::vector<Ref> fired_;
+    std::vector<Ref> overdue_;
+    uint32_t next_ticket_ = 0;
+    bool dirty_ = false;
+};
+
+} // namespace cpp_utils
+
+#endif // AGING_SCHEDULER_HPP
@@ -2,13 +2,22 @@
 
 #include <algorithm> // For std::find
 #include <array>
+#include <atomic>
 #include <chrono>
+#include <cstdint>
 #include <cstdio> // For fprintf, stderr
-#include <list> // Required for std::list
-#include <queue>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <span>
+#include <stdexcept>
 #include <unordered_map>
 #include <vector>
 
+#include "aging_scheduler.h"
+#include "epoch_rcu.h"
+#include "packet_buffer_pool.h"
+
 // Type alias for MAC addresses
 using mac_addr_t = std::array<uint8_t, 6>;
 
@@ -46,13 +55,23 @@ enum class ARPPacketType {
  *
  * Manages mappings from IP addresses to MAC addresses, including features like
  * gratuitous ARP detection, proxy ARP, and fast failover with backup MACs.
+ *
+ * Entries live in an open-addressing table of cache-line-sized slots holding
+ * only the hot fields (IP, MAC, state, timestamps, probe counters); backup
+ * MACs, pending packets and flap history are kept in a side pool and only
+ * allocated for entries that use them.
+ *
+ * All mutating operations (including lookup()) belong to a single owner thread.
+ * Other threads may resolve addresses through lookup_concurrent(), which reads
+ * the same table under a per-slot seqlock without taking locks or changing
+ * entry state.
  */
 class ARPCache {
 public: // ARPState made public for test access
     /**
      * @brief Defines the state of an ARP cache entry.
      */
-    enum class ARPState {
+    enum class ARPState : uint8_t {
         INCOMPLETE, /**< Address resolution is in progress; an ARP request has been sent. */
         REACHABLE,  /**< The MAC address has been recently confirmed as reachable. */
         STALE,      /**< Reachability is unknown (exceeded REACHABLE_TIME); will verify on next send. */
@@ -60,23 +79,26 @@ public: // ARPState made public for test access
         DELAY,       /**< A short period after STALE before sending the first probe. */
         FAILED      // New state
     };
-    
+
+    /**
+     * @brief A snapshot of one cache entry, as returned by get_entry() and for_each_entry().
+     * The cache itself stores entries in the compact layout described at EntrySlot.
+     */
     struct ARPEntry {
         mac_addr_t mac; /**< Primary MAC address. */
         ARPState state; /**< Current state of the ARP entry. */
         std::chrono::steady_clock::time_point timestamp; /**< Last time the entry was updated or confirmed. */
         int probe_count; /**< Number of probes sent for INCOMPLETE or PROBE states. */
-        std::queue<std::vector<uint8_t>> pending_packets; /**< Queue of packets waiting for this ARP resolution. */
+        size_t pending_packets; /**< Number of packets waiting for this ARP resolution. */
         std::vector<mac_addr_t> backup_macs; /**< List of backup MAC addresses for failover. */
         int backoff_exponent;
         uint8_t flap_count;
         std::chrono::steady_clock::time_point last_mac_update_time;
     };
-    
+
     mac_addr_t device_mac_; /**< MAC address of this device (used for Proxy ARP). */
 
-protected: // cache_ made protected for test access via MockARPCache
-    std::unordered_map<uint32_t, ARPEntry> cache_; /**< The ARP cache, mapping IP to ARPEntry. */
+protected:
     struct ProxySubnet {
         uint32_t prefix;
         uint32_t mask;
@@ -92,8 +114,6 @@ protected: // cache_ made protected for test access via MockARPCache
     std::chrono::seconds flap_detection_window_sec_;
     int max_flaps_allowed_;
     size_t max_cache_size_;
-    std::list<uint32_t> lru_tracker_;
-    std::unordered_map<uint32_t, std::list<uint32_t>::iterator> ip_to_lru_iterator_;
 
     // Policies
     ConflictPolicy conflict_policy_;
@@ -107,50 +127,542 @@ protected: // cache_ made protected for test access via MockARPCache
     std::unordered_map<uint32_t, bool> interface_proxy_arp_enabled_;
     std::unordered_map<uint32_t, mac_addr_t> interface_macs_;
 
-protected: // promoteToMRU made protected for test access via MockARPCache
-    void promoteToMRU(uint32_t ip) {
-        if (ip_to_lru_iterator_.count(ip)) {
-            lru_tracker_.erase(ip_to_lru_iterator_[ip]);
+    /**
+     * @brief Rarely used per-entry state, kept out of the entry table.
+     * A record is taken from the cold pool the first time an entry needs one
+     * and returned once it is empty again; most neighbors never have one.
+     * A missing record means no pending packets, no backups and no flap history.
+     */
+    struct ColdState {
+        cpp_utils::PacketQueue pending_packets; /**< Packets waiting for this ARP resolution. */
+        std::vector<mac_addr_t> backup_macs;              /**< Backup MAC addresses for failover. */
+        uint8_t flap_count = 0;
+        std::chrono::steady_clock::time_point last_mac_update_time{};
+
+        bool empty() const { return pending_packets.empty() && backup_macs.empty() && flap_count == 0; }
+    };
+
+    static constexpr uint32_t NO_COLD = UINT32_MAX;
+
+    /**
+     * @brief One cache entry: the hot fields of a neighbor packed into a single cache line.
+     *
+     * The table is open-addressed, so an entry is stored inline with no per-node
+     * allocation. `key` (state and IP) and `published_mac` are what
+     * lookup_concurrent() reads; the owner thread rewrites them inside a seqlock
+     * section (`seq` odd while the slot is being rewritten) and readers retry until
+     * they see the same even sequence before and after copying them. `referenced`
+     * is the CLOCK bit and is set by readers, so it lives outside the seqlock
+     * section. Every other field belongs to the owner thread.
+     */
+    struct alignas(64) EntrySlot {
+        std::atomic<uint32_t> seq{0};
+        mutable std::atomic<uint8_t> referenced{0};
+        ARPState state = ARPState::INCOMPLETE;
+        uint8_t probe_count = 0; /**< Number of probes sent for INCOMPLETE or PROBE states. */
+        uint8_t backoff_exponent = 0;
+        uint32_t clock_ticket = 0;    /**< Matches the slot to its CLOCK queue entry. */
+        uint32_t cold = NO_COLD;      /**< Index into cold_pool_, or NO_COLD. */
+        std::atomic<uint64_t> key{0}; /**< SLOT_LIVE/SLOT_TOMBSTONE | state << 32 | ip; 0 = never used. */
+        std::atomic<uint64_t> published_mac{0}; /**< MAC address packed into the low 48 bits. */
+        std::chrono::steady_clock::time_point timestamp{}; /**< Last time the entry was updated or confirmed. */
+        cpp_utils::AgingHandle aging{}; /**< When age_entries() next needs to look at this entry. */
+        mac_addr_t mac{};               /**< Primary MAC address. */
+    };
+    static_assert(sizeof(EntrySlot) == 64, "EntrySlot should fill exactly one cache line");
+
+    struct EntryTable {
+        explicit EntryTable(size_t capacity)
+            : slots(std::make_unique<EntrySlot[]>(capacity)), mask(capacity - 1) {}
+        std::unique_ptr<EntrySlot[]> slots;
+        size_t mask;
+        size_t live = 0;       /**< Owner thread only. */
+        size_t tombstones = 0; /**< Owner thread only. */
+    };
+
+    /** @brief An entry in the CLOCK queue; stale once the slot's ticket moves on. */
+    struct ClockRef {
+        uint32_t ip;
+        uint32_t ticket;
+    };
+
+    static constexpr uint64_t SLOT_LIVE = uint64_t{1} << 63;
+    static constexpr uint64_t SLOT_TOMBSTONE = uint64_t{1} << 62;
+    static constexpr size_t MIN_TABLE_CAPACITY = 64;
+
+    std::unique_ptr<EntryTable> table_;              /**< The cache; owned by the owner thread. */
+    std::atomic<const EntryTable*> published_table_; /**< The table readers probe. */
+    concurrent::epoch_domain read_domain_{MAX_CONCURRENT_READERS}; /**< Grace periods for replaced tables. */
+    std::shared_ptr<cpp_utils::PacketBufferPool> packet_pool_; /**< Buffers for pending packets; may be shared. */
+    std::vector<ColdState> cold_pool_;               /**< Cold records, indexed by EntrySlot::cold. */
+    std::vector<uint32_t> cold_free_;                /**< Unused cold_pool_ indices. */
+    std::deque<ClockRef> clock_queue_;               /**< Insertion-ordered CLOCK hand. */
+    uint32_t next_clock_ticket_ = 0;
+    cpp_utils::AgingScheduler<uint32_t> aging_;      /**< Per-entry aging deadlines on a timer wheel. */
+
+    static size_t slotIndex(uint32_t ip, size_t mask) {
+        return static_cast<size_t>((ip * 0x9E3779B1u) ^ (ip >> 16)) & mask;
+    }
+
+    static uint64_t slotKey(uint32_t ip, ARPState state) {
+        return SLOT_LIVE | (static_cast<uint64_t>(state) << 32) | ip;
+    }
+
+    static uint32_t slotIp(const EntrySlot& slot) {
+        return static_cast<uint32_t>(slot.key.load(std::memory_order_relaxed));
+    }
+
+    static uint64_t packMac(const mac_addr_t& mac) {
+        uint64_t packed = 0;
+        for (uint8_t byte : mac) packed = (packed << 8) | byte;
+        return packed;
+    }
+
+    static mac_addr_t unpackMac(uint64_t packed) {
+        mac_addr_t mac;
+        for (int i = 5; i >= 0; --i) {
+            mac[static_cast<size_t>(i)] = static_cast<uint8_t>(packed);
+            packed >>= 8;
+        }
+        return mac;
+    }
+
+    static void writeSlot(EntrySlot& slot, uint64_t key, uint64_t mac) {
+        const uint32_t seq = slot.seq.load(std::memory_order_relaxed);
+        slot.seq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.key.store(key, std::memory_order_relaxed);
+        slot.published_mac.store(mac, std::memory_order_relaxed);
+        slot.seq.store(seq + 2, std::memory_order_release);
+    }
+
+    /** @brief Returns the live entry for `ip` or nullptr. Owner thread only. */
+    EntrySlot* findEntry(uint32_t ip) const {
+        EntryTable& table = *table_;
+        for (size_t i = slotIndex(ip, table.mask);; i = (i + 1) & table.mask) {
+            EntrySlot& slot = table.slots[i];
+            const uint64_t key = slot.key.load(std::memory_order_relaxed);
+            if (key == 0) return nullptr;
+            if ((key & SLOT_LIVE) && static_cast<uint32_t>(key) == ip) return &slot;
+        }
+    }
+
+    /** @brief Calls fn(slot) for every live entry. fn must not insert entries; it may erase them. */
+    template <typename Fn>
+    void forEachSlot(Fn&& fn) const {
+        const EntryTable& table = *table_;
+        for (size_t i = 0; i <= table.mask; ++i) {
+            EntrySlot& slot = table.slots[i];
+            if (slot.key.load(std::memory_order_relaxed) & SLOT_LIVE) fn(slot);
+        }
+    }
+
+    /**
+     * @brief Publishes `next` as the table readers probe and frees the previous
+     * one once no reader can still be inside it.
+     */
+    void replaceTable(std::unique_ptr<EntryTable> next) {
+        published_table_.store(next.get(), std::memory_order_release);
+        std::unique_ptr<EntryTable> previous = std::move(table_);
+        table_ = std::move(next);
+        if (previous) {
+            read_domain_.synchronize();
+        }
+    }
+
+    /**
+     * @brief Rehashes live entries into a table sized for `min_live` entries,
+     * dropping tombstones. Moves every entry, so EntrySlot references do not survive it.
+     */
+    void rebuildTable(size_t min_live) {
+        size_t capacity = MIN_TABLE_CAPACITY;
+        while (capacity < min_live * 2) capacity <<= 1;
+        auto next = std::make_unique<EntryTable>(capacity);
+        forEachSlot([&](const EntrySlot& from) {
+            const uint64_t key = from.key.load(std::memory_order_relaxed);
+            size_t j = slotIndex(static_cast<uint32_t>(key), next->mask);
+            while (next->slots[j].key.load(std::memory_order_relaxed) != 0) j = (j + 1) & next->mask;
+            EntrySlot& to = next->slots[j];
+            to.key.store(key, std::memory_order_relaxed);
+            to.published_mac.store(from.published_mac.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            to.referenced.store(from.referenced.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            to.state = from.state;
+            to.probe_count = from.probe_count;
+            to.backoff_exponent = from.backoff_exponent;
+            to.clock_ticket = from.clock_ticket;
+            to.cold = from.cold;
+            to.timestamp = from.timestamp;
+            to.aging = from.aging;
+            to.mac = from.mac;
+            ++next->live;
+        });
+        replaceTable(std::move(next));
+    }
+
+protected:
+    /**
+     * @brief Inserts a new entry for `ip`, which must not be cached yet, and
+     * appends it to the CLOCK queue. The entry is visible to lookup_concurrent()
+     * immediately but not armed for aging; follow up with syncEntry().
+     * May rebuild the table, invalidating other EntrySlot references.
+     */
+    EntrySlot& insertEntry(uint32_t ip, const mac_addr_t& mac, ARPState state, std::chrono::steady_clock::time_point timestamp) {
+        if ((table_->live + table_->tombstones + 1) * 4 > (table_->mask + 1) * 3) {
+            rebuildTable(table_->live + 1);
+        }
+        EntryTable& table = *table_;
+        size_t i = slotIndex(ip, table.mask);
+        while (table.slots[i].key.load(std::memory_order_relaxed) & SLOT_LIVE) i = (i + 1) & table.mask;
+        EntrySlot& slot = table.slots[i];
+        if (slot.key.load(std::memory_order_relaxed) & SLOT_TOMBSTONE) --table.tombstones;
+        ++table.live;
+        slot.state = state;
+        slot.probe_count = 0;
+        slot.backoff_exponent = 0;
+        slot.cold = NO_COLD;
+        slot.timestamp = timestamp;
+        slot.aging = cpp_utils::AgingHandle{};
+        slot.mac = mac;
+        slot.clock_ticket = ++next_clock_ticket_;
+        slot.referenced.store(0, std::memory_order_relaxed);
+        writeSlot(slot, slotKey(ip, state), packMac(mac));
+        clock_queue_.push_back({ip, slot.clock_ticket});
+        if (clock_queue_.size() > 2 * table.live + MIN_TABLE_CAPACITY) compactClockQueue();
+        return slot;
+    }
+
+    /** @brief Removes an entry from the table, the aging schedule, the cold pool and GARP tracking. */
+    void eraseEntry(EntrySlot& entry) {
+        gratuitous_arp_last_seen_.erase(slotIp(entry));
+        aging_.cancel(entry.aging);
+        releaseCold(entry);
+        writeSlot(entry, SLOT_TOMBSTONE, 0);
+        entry.referenced.store(0, std::memory_order_relaxed);
+        --table_->live;
+        ++table_->tombstones;
+    }
+
+    /**
+     * @brief Mirrors an entry's MAC and state into the words lookup_concurrent() reads.
+     * @param referenced Whether to set the entry's CLOCK bit.
+     */
+    void publishEntry(EntrySlot& entry, bool referenced) {
+        const uint64_t key = slotKey(slotIp(entry), entry.state);
+        const uint64_t mac = packMac(entry.mac);
+        if (entry.key.load(std::memory_order_relaxed) != key || entry.published_mac.load(std::memory_order_relaxed) != mac) {
+            writeSlot(entry, key, mac);
+        }
+        if (referenced) entry.referenced.store(1, std::memory_order_relaxed);
+    }
+
+    /** @brief Sets the CLOCK bit of an entry that was just used. */
+    static void markReferenced(EntrySlot& entry) {
+        entry.referenced.store(1, std::memory_order_relaxed);
+    }
+
+    /** @brief Drops CLOCK queue entries whose IP has been removed or re-added since. */
+    void compactClockQueue() {
+        std::deque<ClockRef> live;
+        for (const ClockRef& ref : clock_queue_) {
+            const EntrySlot* slot = findEntry(ref.ip);
+            if (slot && slot->clock_ticket == ref.ticket) live.push_back(ref);
+        }
+        clock_queue_.swap(live);
+    }
+
+    /** @brief The entry's cold record, or nullptr if it has none. */
+    ColdState* coldOf(const EntrySlot& entry) {
+        return entry.cold == NO_COLD ? nullptr : &cold_pool_[entry.cold];
+    }
+
+    const ColdState* coldOf(const EntrySlot& entry) const {
+        return entry.cold == NO_COLD ? nullptr : &cold_pool_[entry.cold];
+    }
+
+    /** @brief The entry's cold record, taken from the pool if it has none. Invalidates other ColdState pointers. */
+    ColdState& coldFor(EntrySlot& entry) {
+        if (entry.cold == NO_COLD) {
+            if (cold_free_.empty()) {
+                entry.cold = static_cast<uint32_t>(cold_pool_.size());
+                cold_pool_.emplace_back();
+            } else {
+                entry.cold = cold_free_.back();
+                cold_free_.pop_back();
+            }
+        }
+        return cold_pool_[entry.cold];
+    }
+
+    /** @brief Returns the entry's cold record to the pool. */
+    void releaseCold(EntrySlot& entry) {
+        if (entry.cold != NO_COLD) {
+            cold_pool_[entry.cold] = ColdState{};
+            cold_free_.push_back(entry.cold);
+            entry.cold = NO_COLD;
+        }
+    }
+
+    /** @brief Returns the entry's cold record to the pool if nothing in it is in use. */
+    void trimCold(EntrySlot& entry) {
+        if (const ColdState* cold = coldOf(entry); cold && cold->empty()) releaseCold(entry);
+    }
+
+    /** @brief Forgets an entry's MAC flap history. */
+    void resetFlapHistory(EntrySlot& entry) {
+        if (ColdState* cold = coldOf(entry)) {
+            cold->flap_count = 0;
+            cold->last_mac_update_time = std::chrono::steady_clock::time_point{};
+        }
+    }
+
+    /** @brief Drops the packets waiting for an entry, e.g. when its resolution failed. */
+    void discardPending(EntrySlot& entry) {
+        if (ColdState* cold = coldOf(entry)) cold->pending_packets.clear();
+    }
+
+    /**
+     * @brief Hands the packets waiting for a now-resolved entry to send_pending_packets().
+     * Call last: the hook runs after the entry is synced and the reference may not survive it.
+     */
+    void handOffPending(EntrySlot& entry) {
+        ColdState* cold = coldOf(entry);
+        if (!cold || cold->pending_packets.empty()) return;
+        cpp_utils::PacketQueue packets = std::move(cold->pending_packets);
+        trimCold(entry);
+        this->send_pending_packets(slotIp(entry), entry.mac, std::move(packets));
+    }
+
+    /** @brief Copies an entry out into the public ARPEntry form. */
+    ARPEntry snapshotOf(const EntrySlot& entry) const {
+        ARPEntry out{entry.mac, entry.state, entry.timestamp, entry.probe_count, 0, {}, entry.backoff_exponent, 0, {}};
+        if (const ColdState* cold = coldOf(entry)) {
+            out.pending_packets = cold->pending_packets.size();
+            out.backup_macs = cold->backup_macs;
+            out.flap_count = cold->flap_count;
+            out.last_mac_update_time = cold->last_mac_update_time;
+        }
+        return out;
+    }
+
+    /**
+     * @brief Publishes an entry changed outside age_entries() and re-arms its aging timer.
+     * @param referenced Whether to set the entry's CLOCK bit.
+     */
+    void syncEntry(EntrySlot& entry, bool referenced) {
+        publishEntry(entry, referenced);
+        trimCold(entry);
+        scheduleAging(entry);
+    }
+
+    /**
+     * @brief Puts an entry into `state` as of `timestamp`, resetting its probe
+     * counters; creates it with a zero MAC if it does not exist. For tests and
+     * diagnostics that need to stage a particular state.
+     */
+    void forceEntryState(uint32_t ip, ARPState state, std::chrono::steady_clock::time_point timestamp) {
+        EntrySlot* entry = findEntry(ip);
+        if (!entry) {
+            entry = &insertEntry(ip, mac_addr_t{}, state, timestamp);
+        } else {
+            entry->state = state;
+            entry->timestamp = timestamp;
+            entry->probe_count = 0;
+            entry->backoff_exponent = 0;
+        }
+        syncEntry(*entry, false);
+    }
+
+    /** @brief Age at which a REACHABLE entry is proactively re-probed. */
+    std::chrono::seconds refreshTriggerDuration() const {
+        constexpr double REFRESH_THRESHOLD_FACTOR = 0.9;
+        return std::chrono::seconds(static_cast<std::chrono::seconds::rep>(reachable_time_sec_.count() * REFRESH_THRESHOLD_FACTOR));
+    }
+
+    /** @brief Wait before the next probe of an INCOMPLETE/PROBE entry, with exponential backoff. */
+    std::chrono::seconds probeWaitInterval(const EntrySlot& entry) const {
+        long long interval_val_s = probe_retransmit_interval_sec_.count();
+        if (entry.backoff_exponent > 0) {
+            int current_exp = (entry.backoff_exponent > 30) ? 30 : entry.backoff_exponent;
+            interval_val_s *= (static_cast<long long>(1) << current_exp);
         }
-        lru_tracker_.push_front(ip);
-        ip_to_lru_iterator_[ip] = lru_tracker_.begin();
+        interval_val_s = std::min(interval_val_s, static_cast<long long>(max_probe_backoff_interval_sec_.count()));
+        return std::chrono::seconds(interval_val_s);
     }
 
-    void removeFromLRUTracking(uint32_t ip) {
-        if (ip_to_lru_iterator_.count(ip)) {
-            lru_tracker_.erase(ip_to_lru_iterator_[ip]);
-            ip_to_lru_iterator_.erase(ip);
+    /** @brief The earliest time at which ageEntry() can change this entry. */
+    std::chrono::steady_clock::time_point agingDeadline(const EntrySlot& entry) const {
+        switch (entry.state) {
+            case ARPState::REACHABLE: return entry.timestamp + refreshTriggerDuration();
+            case ARPState::STALE: return entry.timestamp + stale_time_sec_;
+            case ARPState::INCOMPLETE:
+            case ARPState::PROBE: return entry.timestamp + probeWaitInterval(entry);
+            case ARPState::DELAY: return entry.timestamp + delay_duration_sec_;
+            case ARPState::FAILED: return entry.timestamp + failed_entry_lifetime_sec_;
         }
+        return entry.timestamp;
     }
 
+    /** @brief Arms the entry's aging timer if its deadline moved earlier (or it has none). */
+    void scheduleAging(EntrySlot& entry) {
+        aging_.schedule(slotIp(entry), entry.aging, agingDeadline(entry));
+    }
+
+    /**
+     * @brief Runs one aging step for an entry and re-arms its aging timer.
+     * The step is a no-op if none of the entry's deadlines has passed yet.
+     * @param entry The entry to age; it may be erased.
+     * @param current_time The time point to consider as "now".
+     */
+    void ageEntry(EntrySlot& entry, std::chrono::steady_clock::time_point current_time) {
+        const uint32_t ip = slotIp(entry);
+        auto age_duration = std::chrono::duration_cast<std::chrono::seconds>(current_time - entry.timestamp);
+        const ARPState state_before = entry.state;
+        const mac_addr_t mac_before = entry.mac;
+        bool referenced = false; // Set when the entry becomes active again
+
+        switch (entry.state) {
+            case ARPState::REACHABLE: { // Add braces for scope
+                // auto age_duration = ... (already calculated before switch)
+                auto refresh_trigger_duration = refreshTriggerDuration();
+
+                if (age_duration >= refresh_trigger_duration && age_duration < reachable_time_sec_) {
+                    // Proactive refresh condition met
+                    entry.state = ARPState::PROBE;
+                    entry.timestamp = current_time;
+                    entry.probe_count = 0;
+                    entry.backoff_exponent = 0;
+                    referenced = true; // Mark as it becomes active for probing
+                    this->send_arp_request(ip);
+                    fprintf(stderr, "INFO: Proactive ARP refresh for IP %u.\n", ip);
+                } else if (age_duration >= reachable_time_sec_) {
+                    // Standard transition to STALE if refresh window was missed or this is later
+                    entry.state = ARPState::STALE;
+                    entry.timestamp = current_time;
+                    // No MRU promotion for STALE here, lookup would handle it if accessed.
+                    fprintf(stderr, "INFO: ARP entry for IP %u became STALE.\n", ip);
+                }
+                break;
+            } // Close scope for case REACHABLE
+            case ARPState::STALE:
+                if (age_duration >= stale_time_sec_) {
+                    entry.state = ARPState::PROBE;
+                    entry.timestamp = current_time;
+                    entry.probe_count = 0;
+                    entry.backoff_exponent = 0;
+                    resetFlapHistory(entry);
+                    referenced = true; // Mark as it becomes active for probing
+                    this->send_arp_request(ip);
+                }
+                break;
+            case ARPState::INCOMPLETE:
+                // [[fallthrough]]; // Optional C++17 attribute to denote intentional fallthrough
+            case ARPState::PROBE: { // Add braces for scope
+                std::chrono::seconds current_required_wait = probeWaitInterval(entry);
+
+                if (age_duration >= current_required_wait) {
+                    entry.probe_count++;
+                    if (entry.probe_count > MAX_PROBES) {
+                        ColdState* cold = coldOf(entry);
+                        if (cold && !cold->backup_macs.empty()) {
+                            // ... (failover to backup logic as before, including the CLOCK reference) ...
+                            entry.mac = cold->backup_macs.front();
+                            cold->backup_macs.erase(cold->backup_macs.begin());
+                            entry.state = ARPState::REACHABLE;
+                            entry.timestamp = current_time;
+                            entry.probe_count = 0;
+                            entry.backoff_exponent = 0;
+                            resetFlapHistory(entry); // Reset flap count on successful failover
+                            referenced = true; // Mark on becoming REACHABLE
+                            fprintf(stderr, "INFO: Primary MAC failed for IP %u. Switched to backup MAC: %02x:%02x:%02x:%02x:%02x:%02x\n",
+                                    ip, entry.mac[0], entry.mac[1], entry.mac[2], entry.mac[3], entry.mac[4], entry.mac[5]);
+                        } else {
+                            // ... (transition to FAILED logic as before) ...
+                            entry.state = ARPState::FAILED;
+                            entry.timestamp = current_time;
+                            entry.probe_count = 0;
+                            entry.backoff_exponent = 0;
+                            resetFlapHistory(entry); // Reset flap count when resolution fails
+                            discardPending(entry);
+                            // No MRU promotion for FAILED
+                            fprintf(stderr, "INFO: IP %u resolution failed, entry marked FAILED.\n", ip);
+                        }
+                    } else {
+                        // ... (send another probe logic as before) ...
+                        fprintf(stderr, "DEBUG_ARP_CACHE: age_entries: Attempting to send ARP request for IP: %u, State: %d, Probe Count: %d, Age Duration: %lds, Required Wait: %lds, Backoff Exp: %d\n",
+                                ip,
+                                static_cast<int>(entry.state),
+                                entry.probe_count, // This is after increment
+                                age_duration.count(),
+                                current_required_wait.count(),
+                                entry.backoff_exponent);
+                        this->send_arp_request(ip);
+                        entry.timestamp = current_time;
+                        if (entry.backoff_exponent < 30) {
+                             entry.backoff_exponent++;
+                        }
+                        // No MRU promotion just for re-probing, only when state definitively changes to active/reachable.
+                    }
+                }
+                break;
+            } // Close scope for case PROBE (and INCOMPLETE due to fallthrough)
+            case ARPState::DELAY:
+                // age_duration is calculated from entry.timestamp, which should be set when entry enters DELAY state.
+                if (age_duration >= delay_duration_sec_) {
+                    entry.state = ARPState::PROBE;
+                    entry.timestamp = current_time;     // Mark start of probing
+                    entry.probe_count = 0;              // Reset for this new probe cycle
+                    entry.backoff_exponent = 0;         // Reset backoff
+                    resetFlapHistory(entry);
+                    // Also mark as referenced as it's becoming active for probing
+                    referenced = true;
+                    this->send_arp_request(ip);
+                    fprintf(stderr, "INFO: ARP Entry for IP %u transitioning DELAY -> PROBE.\n", ip);
+                }
+                break;
+            case ARPState::FAILED:
+                if (age_duration >= failed_entry_lifetime_sec_) {
+                    eraseEntry(entry);
+                    fprintf(stderr, "INFO: Purged FAILED entry for IP %u after lifetime.\n", ip);
+                    return;
+                }
+                break;
+        }
+
+        if (referenced || entry.state != state_before || entry.mac != mac_before) {
+            publishEntry(entry, referenced);
+        }
+        trimCold(entry);
+        scheduleAging(entry);
+        if (entry.state == ARPState::REACHABLE && state_before != ARPState::REACHABLE) {
+            handOffPending(entry); // Failed over to a backup MAC
+        }
+    }
+
+    /**
+     * @brief Evicts entries until the cache fits max_cache_size_, using CLOCK
+     * (second chance): the hand walks entries in insertion order, clears set
+     * reference bits and evicts the first unreferenced entry. INCOMPLETE and
+     * PROBE entries are never evicted.
+     */
     void evictLRUEntries() {
         if (max_cache_size_ == 0) return;
-        while (cache_.size() > max_cache_size_) {
+        while (table_->live > max_cache_size_) {
             bool evicted_one_entry = false;
-            for (auto it_lru = lru_tracker_.rbegin(); it_lru != lru_tracker_.rend(); ++it_lru) {
-                uint32_t candidate_ip = *it_lru;
-                auto cache_it = cache_.find(candidate_ip);
-                if (cache_it != cache_.end()) {
-                    if (cache_it->second.state != ARPState::INCOMPLETE &&
-                        cache_it->second.state != ARPState::PROBE) {
-                        fprintf(stderr, "INFO: ARP Cache full. Evicting IP %u.\n", candidate_ip);
-                        cache_.erase(cache_it);
-                        if (gratuitous_arp_last_seen_.count(candidate_ip)) {
-                            gratuitous_arp_last_seen_.erase(candidate_ip);
-                        }
-                        removeFromLRUTracking(candidate_ip);
-                        evicted_one_entry = true;
-                        break;
-                    }
-                } else {
-                    // IP in LRU but not cache: inconsistency. Clean LRU.
-                    if (gratuitous_arp_last_seen_.count(candidate_ip)) { // Also try to clean from GARP tracking if present
-                        gratuitous_arp_last_seen_.erase(candidate_ip);
-                    }
-                    removeFromLRUTracking(candidate_ip);
-                    evicted_one_entry = true;
-                    break;
+            // Two laps: the first may only clear reference bits.
+            for (size_t budget = 2 * clock_queue_.size() + 1; budget > 0 && !clock_queue_.empty(); --budget) {
+                ClockRef ref = clock_queue_.front();
+                clock_queue_.pop_front();
+                EntrySlot* slot = findEntry(ref.ip);
+                if (!slot || slot->clock_ticket != ref.ticket) continue; // Removed or re-added since
+                if (slot->state == ARPState::INCOMPLETE || slot->state == ARPState::PROBE ||
+                    slot->referenced.exchange(0, std::memory_order_relaxed) != 0) {
+                    clock_queue_.push_back(ref);
+                    continue;
                 }
+                fprintf(stderr, "INFO: ARP Cache full. Evicting IP %u.\n", ref.ip);
+                eraseEntry(*slot);
+                evicted_one_entry = true;
+                break;
             }
             if (!evicted_one_entry) {
                 fprintf(stderr, "WARNING: ARP Cache over size, but no evictable entries.\n");
@@ -169,6 +681,21 @@ protected:
         // fprintf(stderr, "MockSend: ARP Request for IP %u\n", ip);
     }
 
+    /**
+     * @brief Receives the packets queued by queue_packet() once their IP resolves.
+     * Called with the new MAC when an entry becomes REACHABLE; `packets` owns the
+     * pooled buffers (drain() them to send). Must not modify the cache.
+     * Base implementation drops them, counting them as discarded.
+     * @param ip The resolved IP address.
+     * @param mac The MAC address it resolved to.
+     * @param packets The queued packets, oldest first.
+     */
+    virtual void send_pending_packets(uint32_t ip, const mac_addr_t& mac, cpp_utils::PacketQueue packets) {
+        (void)ip;
+        (void)mac;
+        (void)packets;
+    }
+
     /**
      * @brief Logs an IP conflict event.
      * Made virtual for test mocking. Base implementation logs to stderr.
@@ -228,6 +755,10 @@ protected:
 public:
     // Publicly accessible constants
     static constexpr int MAX_PROBES = 3; /**< Max number of ARP probes before considering a primary MAC failed. */
+    static constexpr size_t MAX_CONCURRENT_READERS = 64; /**< Reader threads that may be registered at once. */
+
+    /** @brief Per-thread handle required by lookup_concurrent(). */
+    using reader = concurrent::epoch_domain::reader;
 
     /**
      * @brief Constructs an ARPCache.
@@ -270,7 +801,10 @@ public:
           max_cache_size_(max_cache_size),
           conflict_policy_(conflict_pol),
           gratuitous_arp_policy_(garp_pol),
-          gratuitous_arp_min_interval_ms_(gratuitous_arp_min_interval) {}
+          gratuitous_arp_min_interval_ms_(gratuitous_arp_min_interval),
+          table_(std::make_unique<EntryTable>(MIN_TABLE_CAPACITY)),
+          published_table_(table_.get()),
+          packet_pool_(std::make_shared<cpp_utils::PacketBufferPool>()) {}
 
     /**
      * @brief Adds a subnet configuration for Proxy ARP.
@@ -289,10 +823,11 @@ public:
      * @param backup_mac The backup MAC address.
      */
     void add_backup_mac(uint32_t ip, const mac_addr_t& backup_mac) {
-        auto it = cache_.find(ip);
-        if (it != cache_.end()) {
-            if (std::find(it->second.backup_macs.begin(), it->second.backup_macs.end(), backup_mac) == it->second.backup_macs.end() && it->second.mac != backup_mac) {
-                it->second.backup_macs.push_back(backup_mac);
+        EntrySlot* entry = findEntry(ip);
+        if (entry && entry->mac != backup_mac) {
+            ColdState& cold = coldFor(*entry);
+            if (std::find(cold.backup_macs.begin(), cold.backup_macs.end(), backup_mac) == cold.backup_macs.end()) {
+                cold.backup_macs.push_back(backup_mac);
             }
         }
     }
@@ -305,50 +840,50 @@ public:
      */
     bool lookup(uint32_t ip, mac_addr_t& mac_out) {
         auto current_time = std::chrono::steady_clock::now();
-        auto it = cache_.find(ip);
-
-        if (it != cache_.end()) {
-            ARPEntry& entry = it->second;
+        EntrySlot* entry = findEntry(ip);
 
-            if (entry.state == ARPState::FAILED) { // Add this check first
+        if (entry) {
+            if (entry->state == ARPState::FAILED) { // Add this check first
                 return false;
             }
-            if (entry.state == ARPState::REACHABLE) {
-                promoteToMRU(ip);
-                mac_out = entry.mac;
+            if (entry->state == ARPState::REACHABLE) {
+                markReferenced(*entry);
+                mac_out = entry->mac;
                 return true;
             }
 
             // Handle STALE, PROBE, DELAY states, prioritizing backup MACs
-            if (entry.state == ARPState::STALE || entry.state == ARPState::PROBE || entry.state == ARPState::DELAY) {
-                if (!entry.backup_macs.empty()) {
+            if (entry->state == ARPState::STALE || entry->state == ARPState::PROBE || entry->state == ARPState::DELAY) {
+                ColdState* cold = coldOf(*entry);
+                if (cold && !cold->backup_macs.empty()) {
                     // Perform failover to backup MAC
-                    mac_addr_t old_primary_mac = entry.mac;
-                    entry.mac = entry.backup_macs.front();
-                    entry.backup_macs.erase(entry.backup_macs.begin());
+                    mac_addr_t old_primary_mac = entry->mac;
+                    entry->mac = cold->backup_macs.front();
+                    cold->backup_macs.erase(cold->backup_macs.begin());
                     bool old_mac_is_zero = true;
                     for(uint8_t val : old_primary_mac) if(val != 0) old_mac_is_zero = false;
-                    if (!old_mac_is_zero && std::find(entry.backup_macs.begin(), entry.backup_macs.end(), old_primary_mac) == entry.backup_macs.end()) {
-                        entry.backup_macs.push_back(old_primary_mac);
+                    if (!old_mac_is_zero && std::find(cold->backup_macs.begin(), cold->backup_macs.end(), old_primary_mac) == cold->backup_macs.end()) {
+                        cold->backup_macs.push_back(old_primary_mac);
                     }
-                    entry.state = ARPState::REACHABLE;
-                    entry.timestamp = current_time;
-                    entry.probe_count = 0;
-                    entry.backoff_exponent = 0;
-                    promoteToMRU(ip);
-                    mac_out = entry.mac;
+                    entry->state = ARPState::REACHABLE;
+                    entry->timestamp = current_time;
+                    entry->probe_count = 0;
+                    entry->backoff_exponent = 0;
+                    syncEntry(*entry, true);
+                    mac_out = entry->mac;
                     fprintf(stderr, "INFO: Failover for IP %u. New MAC: %02x:%02x:%02x:%02x:%02x:%02x\n",
-                            ip, entry.mac[0], entry.mac[1], entry.mac[2], entry.mac[3], entry.mac[4], entry.mac[5]);
+                            ip, entry->mac[0], entry->mac[1], entry->mac[2], entry->mac[3], entry->mac[4], entry->mac[5]);
+                    handOffPending(*entry);
                     return true;
                 } else {
                     // No backup MACs available
-                    if (entry.state == ARPState::STALE) {
+                    if (entry->state == ARPState::STALE) {
                         // For STALE, we return the MAC but don't necessarily promote it as aggressively
                         // as a confirmed REACHABLE entry. Promotion happens on active confirmation.
-                        mac_out = entry.mac; // Return the stale MAC address
+                        mac_out = entry->mac; // Return the stale MAC address
                         // Probing for this stale entry will be handled by age_entries if stale_time_sec_ expires
                         return true;
-                    } else { // entry.state is PROBE or DELAY
+                    } else { // entry->state is PROBE or DELAY
                         // In PROBE or DELAY without backup MACs, resolution is ongoing.
                         // No stable MAC to return.
                         return false;
@@ -359,36 +894,35 @@ public:
         }
 
         // Entry not found OR entry is INCOMPLETE
-        if (it == cache_.end() || (it != cache_.end() && it->second.state == ARPState::INCOMPLETE) ) {
+        if (!entry || entry->state == ARPState::INCOMPLETE) {
             // Proxy ARP check
             for (const auto& subnet : proxy_subnets_) {
                 if ((ip & subnet.mask) == subnet.prefix) {
                     mac_out = device_mac_;
-                    if (it == cache_.end()) { // New entry for proxy ARP
-                        cache_[ip] = {device_mac_, ARPState::REACHABLE, current_time, 0, {}, {}, 0, 0, current_time};
+                    if (!entry) { // New entry for proxy ARP
+                        entry = &insertEntry(ip, device_mac_, ARPState::REACHABLE, current_time);
                     } else { // Entry was INCOMPLETE, now resolved by proxy ARP
-                        it->second.mac = device_mac_;
-                        it->second.state = ARPState::REACHABLE;
-                        it->second.timestamp = current_time;
-                        it->second.probe_count = 0;
-                        it->second.backoff_exponent = 0;
-                        it->second.flap_count = 0;
-                        it->second.last_mac_update_time = current_time;
+                        entry->mac = device_mac_;
+                        entry->state = ARPState::REACHABLE;
+                        entry->timestamp = current_time;
+                        entry->probe_count = 0;
+                        entry->backoff_exponent = 0;
+                        resetFlapHistory(*entry);
                     }
-                    promoteToMRU(ip);
+                    syncEntry(*entry, true);
+                    handOffPending(*entry);
                     return true; // Proxy ARP success
                 }
             }
 
             // Not a proxy ARP case. Send ARP request for INCOMPLETE or new entry.
             this->send_arp_request(ip);
-            if (it == cache_.end()) { // Create new INCOMPLETE entry
-                cache_[ip] = {{}, ARPState::INCOMPLETE, current_time, 0, {}, {}, 0, 0, {}};
-                promoteToMRU(ip);
-            } else { // Entry was already INCOMPLETE (it->second.state == ARPState::INCOMPLETE)
-                it->second.timestamp = current_time; // Update timestamp for this new probe attempt initiated by lookup
-                // Promote INCOMPLETE as well, as it's actively being worked on
-                promoteToMRU(ip);
+            if (!entry) { // Create new INCOMPLETE entry
+                syncEntry(insertEntry(ip, mac_addr_t{}, ARPState::INCOMPLETE, current_time), true);
+            } else { // Entry was already INCOMPLETE
+                entry->timestamp = current_time; // Update timestamp for this new probe attempt initiated by lookup
+                // Mark INCOMPLETE as referenced as well, as it's actively being worked on
+                markReferenced(*entry);
             }
             return false; // Resolution started or ongoing for INCOMPLETE
         }
@@ -397,6 +931,97 @@ public:
         return false;
     }
 
+    /**
+     * @brief Holds a packet until `ip` resolves, after lookup() returned false.
+     *
+     * The packet is copied into a buffer of the packet pool and handed to
+     * send_pending_packets() when the entry becomes REACHABLE, or discarded if
+     * resolution fails or the entry is removed. Each entry queues at most the
+     * pool's per_queue_limit() packets; beyond that, or when the pool is out of
+     * buffers, the entry's oldest packet is dropped (see packet_pool()->stats()).
+     * @param ip An IP whose entry is INCOMPLETE, PROBE or DELAY.
+     * @param packet The packet bytes.
+     * @return False if the packet was not queued: no such unresolved entry, or the pool dropped it.
+     */
+    bool queue_packet(uint32_t ip, std::span<const uint8_t> packet) {
+        EntrySlot* entry = findEntry(ip);
+        if (!entry || (entry->state != ARPState::INCOMPLETE && entry->state != ARPState::PROBE &&
+                       entry->state != ARPState::DELAY)) {
+            return false;
+        }
+        ColdState& cold = coldFor(*entry);
+        const bool queued = packet_pool_->enqueue(cold.pending_packets, packet);
+        trimCold(*entry);
+        return queued;
+    }
+
+    /**
+     * @brief Replaces the buffer pool for pending packets, e.g. to share one with an NDCache.
+     * Packets queued in the previous pool are discarded.
+     * @throws std::invalid_argument if `pool` is null.
+     */
+    void set_packet_pool(std::shared_ptr<cpp_utils::PacketBufferPool> pool) {
+        if (!pool) throw std::invalid_argument("ARPCache packet pool must not be null");
+        forEachSlot([this](EntrySlot& entry) {
+            discardPending(entry);
+            trimCold(entry);
+        });
+        packet_pool_ = std::move(pool);
+    }
+
+    /** @brief The buffer pool holding pending packets, for its limits and drop counters. */
+    const std::shared_ptr<cpp_utils::PacketBufferPool>& packet_pool() const { return packet_pool_; }
+
+    /**
+     * @brief Registers the calling thread for lookup_concurrent().
+     * Each thread keeps its own reader; at most MAX_CONCURRENT_READERS may exist at once.
+     * @throws std::runtime_error if all reader slots are taken.
+     */
+    reader register_reader() { return read_domain_.register_reader(); }
+
+    /**
+     * @brief Read-only lookup that may run on any thread, concurrently with the owner thread.
+     *
+     * Probes the seqlock-protected read table without locks or allocation and
+     * only sets the entry's CLOCK reference bit. REACHABLE and STALE entries
+     * resolve; everything that needs a state change (starting resolution, backup
+     * failover, proxy ARP) is left to lookup() on the owner thread. An entry being
+     * rewritten at that instant may be missed, never returned torn.
+     *
+     * A thread holding an outer pin on `r` must not call owner-side operations,
+     * which may wait for readers when the table is resized.
+     * @param r The calling thread's reader from register_reader().
+     * @param ip The IP address to look up.
+     * @param mac_out Output parameter for the resolved MAC address.
+     * @return True if a usable MAC address was found.
+     */
+    bool lookup_concurrent(reader& r, uint32_t ip, mac_addr_t& mac_out) const {
+        concurrent::epoch_domain::reader::guard pin(r);
+        const EntryTable& table = *published_table_.load(std::memory_order_acquire);
+        for (size_t i = slotIndex(ip, table.mask);; i = (i + 1) & table.mask) {
+            const EntrySlot& slot = table.slots[i];
+            uint64_t key;
+            uint64_t mac;
+            while (true) {
+                const uint32_t seq = slot.seq.load(std::memory_order_acquire);
+                if (seq & 1) continue; // Owner is rewriting this slot
+                key = slot.key.load(std::memory_order_relaxed);
+                mac = slot.published_mac.load(std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (slot.seq.load(std::memory_order_relaxed) == seq) break;
+            }
+            if (key == 0) return false;
+            if (!(key & SLOT_LIVE) || static_cast<uint32_t>(key) != ip) continue;
+            const auto state = static_cast<ARPState>((key >> 32) & 0xFF);
+            if (state != ARPState::REACHABLE && state != ARPState::STALE) return false;
+            if (slot.referenced.load(std::memory_order_relaxed) == 0) {
+                slot.referenced.store(1, std::memory_order_relaxed);
+            }
+            mac_out = unpackMac(mac);
+            return true;
+        }
+    }
+
     // --- Configuration Setters ---
 
     /**
@@ -432,22 +1057,22 @@ public:
     }
 
     /** @brief Sets the time an entry remains REACHABLE before becoming STALE. */
-    void set_reachable_time(std::chrono::seconds time) { reachable_time_sec_ = time; }
+    void set_reachable_time(std::chrono::seconds time) { reachable_time_sec_ = time; aging_.invalidate(); }
 
     /** @brief Sets the time an entry remains STALE before transitioning to PROBE (or DELAY if configured). */
-    void set_stale_time(std::chrono::seconds time) { stale_time_sec_ = time; }
+    void set_stale_time(std::chrono::seconds time) { stale_time_sec_ = time; aging_.invalidate(); }
 
     /** @brief Sets the base interval for re-probing INCOMPLETE/PROBE entries. */
-    void set_probe_retransmit_interval(std::chrono::seconds interval) { probe_retransmit_interval_sec_ = interval; }
+    void set_probe_retransmit_interval(std::chrono::seconds interval) { probe_retransmit_interval_sec_ = interval; aging_.invalidate(); }
 
     /** @brief Sets the maximum interval for exponential backoff probing. */
-    void set_max_probe_backoff_interval(std::chrono::seconds interval) { max_probe_backoff_interval_sec_ = interval; }
+    void set_max_probe_backoff_interval(std::chrono::seconds interval) { max_probe_backoff_interval_sec_ = interval; aging_.invalidate(); }
 
     /** @brief Sets the lifetime for entries in the FAILED state before being purged. */
-    void set_failed_entry_lifetime(std::chrono::seconds lifetime) { failed_entry_lifetime_sec_ = lifetime; }
+    void set_failed_entry_lifetime(std::chrono::seconds lifetime) { failed_entry_lifetime_sec_ = lifetime; aging_.invalidate(); }
 
     /** @brief Sets the duration for the DELAY state before transitioning to PROBE. */
-    void set_delay_duration(std::chrono::seconds duration) { delay_duration_sec_ = duration; }
+    void set_delay_duration(std::chrono::seconds duration) { delay_duration_sec_ = duration; aging_.invalidate(); }
 
     /** @brief Sets the time window for detecting MAC flaps. */
     void set_flap_detection_window(std::chrono::seconds window) { flap_detection_window_sec_ = window; }
@@ -461,7 +1086,7 @@ public:
      */
     void set_max_cache_size(size_t size) {
         max_cache_size_ = size;
-        if (size > 0 && cache_.size() > max_cache_size_) {
+        if (size > 0 && table_->live > max_cache_size_) {
             evictLRUEntries();
         }
     }
@@ -560,16 +1185,16 @@ public:
         // 1. Handle GratuitousArpPolicy::DROP_IF_CONFLICT
         if (packet_type == ARPPacketType::GRATUITOUS_ANNOUNCEMENT &&
             this->gratuitous_arp_policy_ == GratuitousArpPolicy::DROP_IF_CONFLICT) {
-            auto it_check_conflict = cache_.find(ip);
-            if (it_check_conflict != cache_.end() && it_check_conflict->second.mac != new_mac) {
+            const EntrySlot* existing = findEntry(ip);
+            if (existing && existing->mac != new_mac) {
                 bool existing_mac_is_valid = false;
-                for(uint8_t val : it_check_conflict->second.mac) if(val != 0) existing_mac_is_valid = true;
+                for(uint8_t val : existing->mac) if(val != 0) existing_mac_is_valid = true;
 
                 if (existing_mac_is_valid) {
                      fprintf(stderr, "INFO: Gratuitous ARP Announcement for IP %u (MAC %02x:%02x:%02x:%02x:%02x:%02x) conflicts with existing MAC (%02x:%02x:%02x:%02x:%02x:%02x). Dropping due to DROP_IF_CONFLICT policy.\n",
                              ip, new_mac[0], new_mac[1], new_mac[2], new_mac[3], new_mac[4], new_mac[5],
-                             it_check_conflict->second.mac[0], it_check_conflict->second.mac[1], it_check_conflict->second.mac[2], it_check_conflict->second.mac[3], it_check_conflict->second.mac[4], it_check_conflict->second.mac[5]);
-                     this->log_ip_conflict(ip, it_check_conflict->second.mac, new_mac); // Log it formally as a conflict
+                             existing->mac[0], existing->mac[1], existing->mac[2], existing->mac[3], existing->mac[4], existing->mac[5]);
+                     this->log_ip_conflict(ip, existing->mac, new_mac); // Log it formally as a conflict
                      return; // Drop
                 }
             }
@@ -614,16 +1239,12 @@ public:
         // --- End DHCP Snooping Validation Hook ---
 
         // 4. Main add_entry logic (conflict detection, flap detection, etc.)
-        auto it = cache_.find(ip);
+        EntrySlot* entry = findEntry(ip);
         auto current_time = std::chrono::steady_clock::now(); // This is the main current_time for entry updates
-        std::vector<mac_addr_t> existing_backups; // Keep existing backups
-
-        if (it != cache_.end()) { // Entry exists
-            ARPEntry& entry = it->second;
-            existing_backups = entry.backup_macs; // Preserve backups
 
-            if (entry.mac != new_mac) { // MAC address has changed
-                this->log_ip_conflict(ip, entry.mac, new_mac); // Always log
+        if (entry) { // Entry exists
+            if (entry->mac != new_mac) { // MAC address has changed
+                this->log_ip_conflict(ip, entry->mac, new_mac); // Always log
 
                 mac_addr_t mac_to_potentially_update_to = new_mac;
                 bool should_update_mac = false;
@@ -634,7 +1255,7 @@ public:
                         should_update_mac = false;
                         break;
                     case ConflictPolicy::ALERT_SYSTEM:
-                        this->trigger_alert(ip, entry.mac, mac_to_potentially_update_to);
+                        this->trigger_alert(ip, entry->mac, mac_to_potentially_update_to);
                         // Defaulting to alert AND update.
                         should_update_mac = true;
                         break;
@@ -650,53 +1271,72 @@ public:
 
                 if (should_update_mac) {
                     // Flap detection logic
-                    if (current_time - entry.last_mac_update_time < flap_detection_window_sec_) {
-                        if (entry.flap_count < 255) {
-                            entry.flap_count++;
+                    ColdState& cold = coldFor(*entry);
+                    if (current_time - cold.last_mac_update_time < flap_detection_window_sec_) {
+                        if (cold.flap_count < 255) {
+                            cold.flap_count++;
                         }
                     } else {
-                        entry.flap_count = 1;
+                        cold.flap_count = 1;
                     }
-                    entry.last_mac_update_time = current_time;
+                    cold.last_mac_update_time = current_time;
 
-                    entry.mac = mac_to_potentially_update_to; // Update to the new MAC
-                    entry.timestamp = current_time;
-                    entry.probe_count = 0;
-                    entry.backoff_exponent = 0;
-                    while (!entry.pending_packets.empty()) entry.pending_packets.pop();
+                    entry->mac = mac_to_potentially_update_to; // Update to the new MAC
+                    entry->timestamp = current_time;
+                    entry->probe_count = 0;
+                    entry->backoff_exponent = 0;
 
-                    if (entry.flap_count >= max_flaps_allowed_) {
-                        entry.state = ARPState::STALE;
-                        fprintf(stderr, "INFO: Flapping detected for IP %u (count %u). Setting to STALE with new MAC to force re-verify under conflict policy UPDATE_EXISTING/ALERT_SYSTEM.\n", ip, entry.flap_count);
+                    if (cold.flap_count >= max_flaps_allowed_) {
+                        entry->state = ARPState::STALE;
+                        cold.pending_packets.clear(); // Not sent to a MAC that has to be re-verified
+                        fprintf(stderr, "INFO: Flapping detected for IP %u (count %u). Setting to STALE with new MAC to force re-verify under conflict policy UPDATE_EXISTING/ALERT_SYSTEM.\n", ip, cold.flap_count);
                     } else {
-                        entry.state = ARPState::REACHABLE;
+                        entry->state = ARPState::REACHABLE;
                     }
                 }
                 // If should_update_mac is false, the old MAC and its state are preserved.
                 // (e.g. for LOG_ONLY or DROP_NEW policies)
                 // The timestamp of the entry is not updated in this case, and flap count for the *existing* MAC is not affected by this specific event.
             } else { // MAC is the same, just refresh to REACHABLE
-                entry.state = ARPState::REACHABLE;
-                entry.timestamp = current_time;
-                entry.probe_count = 0; // Reset probe activity trackers
-                entry.backoff_exponent = 0;
+                entry->state = ARPState::REACHABLE;
+                entry->timestamp = current_time;
+                entry->probe_count = 0; // Reset probe activity trackers
+                entry->backoff_exponent = 0;
                 // For a non-changing MAC, it makes sense to reset flap_count to 0 as it's stable.
-                entry.flap_count = 0; // Explicitly reset on same MAC confirmation
-                entry.last_mac_update_time = current_time; // Also update time to solidify this state
+                resetFlapHistory(*entry); // Explicitly reset on same MAC confirmation
             }
-        } else { // New entry
-            // Initialize ARPEntry including new flap fields
-            // ARPEntry { mac, state, timestamp, probe_count, pending_packets_q, backup_macs_vec, backoff_exp, flap_cnt, last_mac_update_t }
-            std::queue<std::vector<uint8_t>> no_packets; // Define empty queue
-            // existing_backups is already empty if new entry
-            cache_[ip] = {new_mac, ARPState::REACHABLE, current_time, 0, no_packets, existing_backups, 0, 0, current_time};
-            // For a truly new entry, last_mac_update_time could be 'epoch' or current_time. Current_time is fine.
+        } else { // New entry: no backups or flap history yet, so nothing goes to the cold pool
+            entry = &insertEntry(ip, new_mac, ARPState::REACHABLE, current_time);
         }
 
-        promoteToMRU(ip);
+        syncEntry(*entry, true);
+        if (entry->state == ARPState::REACHABLE) {
+            handOffPending(*entry);
+        }
         evictLRUEntries();
     }
-    
+
+    /** @brief Number of entries in the cache. */
+    size_t size() const { return table_->live; }
+
+    /**
+     * @brief Returns a copy of the entry for `ip`, or std::nullopt if it is not cached.
+     * Does not count as a use of the entry.
+     */
+    std::optional<ARPEntry> get_entry(uint32_t ip) const {
+        if (const EntrySlot* entry = findEntry(ip)) return snapshotOf(*entry);
+        return std::nullopt;
+    }
+
+    /**
+     * @brief Calls fn(ip, entry) with a copy of every cached entry, in no particular order.
+     * fn must not modify the cache.
+     */
+    template <typename Fn>
+    void for_each_entry(Fn&& fn) const {
+        forEachSlot([&](const EntrySlot& entry) { fn(slotIp(entry), snapshotOf(entry)); });
+    }
+
     /**
      * @brief Ages ARP cache entries using the current system time.
      */
@@ -706,141 +1346,28 @@ public:
 
     /**
      * @brief Ages ARP cache entries using a specific time point.
+     *
+     * Each entry's next deadline is armed on a timer wheel, so a call only
+     * visits entries whose deadline has passed (plus a few within one wheel
+     * resolution of `current_time`). The first call after a gap longer than a
+     * wheel revolution, or after a timer setter, falls back to a full scan.
      * @param current_time The time point to consider as "now" for aging calculations.
      */
     void age_entries(std::chrono::steady_clock::time_point current_time) {
-        for (auto it = cache_.begin(); it != cache_.end();) {
-            ARPEntry& entry = it->second;
-            auto age_duration = std::chrono::duration_cast<std::chrono::seconds>(current_time - entry.timestamp);
-            
-            bool entry_erased = false;
-            switch (entry.state) {
-                case ARPState::REACHABLE: { // Add braces for scope
-                    // auto age_duration = ... (already calculated before switch)
-                    constexpr double REFRESH_THRESHOLD_FACTOR = 0.9; // Define inside the case block
-                    auto refresh_trigger_duration = std::chrono::seconds(static_cast<std::chrono::seconds::rep>(reachable_time_sec_.count() * REFRESH_THRESHOLD_FACTOR));
-
-                    if (age_duration >= refresh_trigger_duration && age_duration < reachable_time_sec_) {
-                        // Proactive refresh condition met
-                        entry.state = ARPState::PROBE;
-                        entry.timestamp = current_time;
-                        entry.probe_count = 0;
-                        entry.backoff_exponent = 0;
-                        promoteToMRU(it->first); // Promote as it becomes active for probing
-                        this->send_arp_request(it->first);
-                        fprintf(stderr, "INFO: Proactive ARP refresh for IP %u.\n", it->first);
-                    } else if (age_duration >= reachable_time_sec_) {
-                        // Standard transition to STALE if refresh window was missed or this is later
-                        entry.state = ARPState::STALE;
-                        entry.timestamp = current_time;
-                        // No MRU promotion for STALE here, lookup would handle it if accessed.
-                        fprintf(stderr, "INFO: ARP entry for IP %u became STALE.\n", it->first);
-                    }
-                    break;
-                } // Close scope for case REACHABLE
-                case ARPState::STALE:
-                    if (age_duration >= stale_time_sec_) {
-                        entry.state = ARPState::PROBE;
-                        entry.timestamp = current_time;
-                        entry.probe_count = 0;
-                        entry.backoff_exponent = 0;
-                        entry.flap_count = 0; // Reset flap count
-                        entry.last_mac_update_time = std::chrono::steady_clock::time_point{}; // Reset time
-                        promoteToMRU(it->first); // Promote as it becomes active for probing
-                        this->send_arp_request(it->first);
-                    }
-                    break;
-                case ARPState::INCOMPLETE:
-                    // [[fallthrough]]; // Optional C++17 attribute to denote intentional fallthrough
-                case ARPState::PROBE: { // Add braces for scope
-                    long long interval_val_s = probe_retransmit_interval_sec_.count();
-                    if (entry.backoff_exponent > 0) {
-                        int current_exp = (entry.backoff_exponent > 30) ? 30 : entry.backoff_exponent;
-                        interval_val_s *= (static_cast<long long>(1) << current_exp);
-                    }
-                    // Corrected std::min usage
-                    interval_val_s = std::min(interval_val_s, static_cast<long long>(max_probe_backoff_interval_sec_.count()));
-                    std::chrono::seconds current_required_wait(interval_val_s);
-
-                    if (age_duration >= current_required_wait) {
-                        entry.probe_count++;
-                        if (entry.probe_count > MAX_PROBES) {
-                            if (!entry.backup_macs.empty()) {
-                                // ... (failover to backup logic as before, including promoteToMRU) ...
-                                entry.mac = entry.backup_macs.front();
-                                entry.backup_macs.erase(entry.backup_macs.begin());
-                                entry.state = ARPState::REACHABLE;
-                                entry.timestamp = current_time;
-                                entry.probe_count = 0;
-                                entry.backoff_exponent = 0;
-                                entry.flap_count = 0; // Reset flap count on successful failover
-                                entry.last_mac_update_time = current_time; // Update time for new MAC
-                                promoteToMRU(it->first); // Promote on becoming REACHABLE
-                                fprintf(stderr, "INFO: Primary MAC failed for IP %u. Switched to backup MAC: %02x:%02x:%02x:%02x:%02x:%02x\n",
-                                        it->first, entry.mac[0], entry.mac[1], entry.mac[2], entry.mac[3], entry.mac[4], entry.mac[5]);
-                            } else {
-                                // ... (transition to FAILED logic as before) ...
-                                entry.state = ARPState::FAILED;
-                                entry.timestamp = current_time;
-                                entry.probe_count = 0;
-                                entry.backoff_exponent = 0;
-                                entry.flap_count = 0; // Reset flap count when resolution fails
-                                entry.last_mac_update_time = std::chrono::steady_clock::time_point{}; // Reset time
-                                // No MRU promotion for FAILED
-                                fprintf(stderr, "INFO: IP %u resolution failed, entry marked FAILED.\n", it->first);
-                            }
-                        } else {
-                            // ... (send another probe logic as before) ...
-                            fprintf(stderr, "DEBUG_ARP_CACHE: age_entries: Attempting to send ARP request for IP: %u, State: %d, Probe Count: %d, Age Duration: %lds, Required Wait: %lds, Backoff Exp: %d\n",
-                                    it->first,
-                                    static_cast<int>(entry.state),
-                                    entry.probe_count, // This is after increment
-                                    age_duration.count(),
-                                    current_required_wait.count(),
-                                    entry.backoff_exponent);
-                            this->send_arp_request(it->first);
-                            entry.timestamp = current_time;
-                            if (entry.backoff_exponent < 30) {
-                                 entry.backoff_exponent++;
-                            }
-                            // No MRU promotion just for re-probing, only when state definitively changes to active/reachable.
-                        }
-                    }
-                    break;
-                } // Close scope for case PROBE (and INCOMPLETE due to fallthrough)
-                case ARPState::DELAY:
-                    // age_duration is calculated from entry.timestamp, which should be set when entry enters DELAY state.
-                    if (age_duration >= delay_duration_sec_) {
-                        entry.state = ARPState::PROBE;
-                        entry.timestamp = current_time;     // Mark start of probing
-                        entry.probe_count = 0;              // Reset for this new probe cycle
-                        entry.backoff_exponent = 0;         // Reset backoff
-                        entry.flap_count = 0;               // Reset flap count
-                        entry.last_mac_update_time = std::chrono::steady_clock::time_point{}; // Reset time
-                        // Also promote to MRU as it's becoming active for probing
-                        promoteToMRU(it->first);
-                        this->send_arp_request(it->first);
-                        fprintf(stderr, "INFO: ARP Entry for IP %u transitioning DELAY -> PROBE.\n", it->first);
-                    }
-                    break;
-                case ARPState::FAILED:
-                    if (age_duration >= failed_entry_lifetime_sec_) {
-                        uint32_t purged_ip = it->first;
-                        it = cache_.erase(it);
-                        if (gratuitous_arp_last_seen_.count(purged_ip)) {
-                            gratuitous_arp_last_seen_.erase(purged_ip);
-                        }
-                        removeFromLRUTracking(purged_ip);
-                        entry_erased = true;
-                        fprintf(stderr, "INFO: Purged FAILED entry for IP %u after lifetime.\n", purged_ip);
-                    }
-                    break;
-            }
-
-            if (entry_erased) {
-                continue;
+        const bool advanced = aging_.advance(current_time, [&](uint32_t ip, uint32_t ticket) {
+            EntrySlot* entry = findEntry(ip);
+            if (entry && aging_.claim(entry->aging, ticket)) {
+                ageEntry(*entry, current_time);
             }
-            ++it;
+        });
+        if (!advanced) {
+            // Too long since the last call (or timers were reconfigured): scan
+            // everything once and rebuild the schedule from the new deadlines.
+            aging_.reset(current_time);
+            forEachSlot([&](EntrySlot& entry) {
+                entry.aging = cpp_utils::AgingHandle{};
+                ageEntry(entry, current_time);
+            });
         }
     }
 
@@ -848,10 +1375,12 @@ public:
      * @brief Handles a link-down event by purging all entries from the cache.
      */
     void handle_link_down() {
-        cache_.clear(); // Removes all entries from the unordered_map
-        lru_tracker_.clear();
-        ip_to_lru_iterator_.clear();
+        clock_queue_.clear();
+        cold_pool_.clear();
+        cold_free_.clear();
+        aging_.reset(aging_.now());
+        replaceTable(std::make_unique<EntryTable>(MIN_TABLE_CAPACITY)); // Drops every entry
         gratuitous_arp_last_seen_.clear(); // Clear GARP tracking on link down
-        fprintf(stderr, "INFO: ARP cache purged due to link-down event, including LRU tracking and GARP history.\n");
+        fprintf(stderr, "INFO: ARP cache purged due to link-down event, including CLOCK tracking and GARP history.\n");
     }
 };
@@ -8,9 +8,211 @@
 #include <memory>
 #include <mutex>
 #include <condition_variable>
+#include <vector>
 
 namespace util {
 
+/**
+ * TimerService - Process-wide timer thread shared by every DelayedCall
+ *
+ * Pending calls sit in an indexed binary min-heap ordered by deadline, so
+ * scheduling, cancelling and rescheduling cost O(log n) and never create a
+ * thread. A single worker thread sleeps until the earliest deadline and runs
+ * due calls one after another in deadline order; a call that blocks holds up
+ * the ones behind it, so long work should be handed to another thread.
+ *
+ * The shared instance is created on first use and held by a function-local
+ * static, so it is torn down at exit whatever the DelayedCalls do (or later,
+ * if one still holds it then). Its destructor joins the worker, unless the
+ * last reference is dropped by a call running on the worker itself; the
+ * worker is then detached and leaves without touching the destroyed service.
+ */
+class TimerService {
+public:
+    using Clock = std::chrono::steady_clock;
+    using TimePoint = Clock::time_point;
+
+    /**
+     * One scheduled call, shared between its owner and the service
+     */
+    struct Entry {
+        explicit Entry(std::function<void()> fn) : task(std::move(fn)) {}
+
+        std::function<void()> task;
+        std::atomic<bool> cancelled{false};
+        std::atomic<bool> fired{false};   // Set when the worker picks the call up
+        TimePoint deadline{};             // Guarded by the service mutex
+        size_t heap_index = NOT_QUEUED;   // Guarded by the service mutex
+    };
+
+    static std::shared_ptr<TimerService> instance() {
+        static const std::shared_ptr<TimerService> service = std::make_shared<TimerService>();
+        return service;
+    }
+
+    TimerService() : worker_([this]() { run(); }) {}
+
+    ~TimerService() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        wake_cv_.notify_all();
+        // The last owner may be a call running on the worker itself
+        if (worker_.get_id() == std::this_thread::get_id()) {
+            *destroyed_by_worker_ = true; // run() must not touch *this once the call returns
+            worker_.detach();
+        } else {
+            worker_.join();
+        }
+    }
+
+    TimerService(const TimerService&) = delete;
+    TimerService& operator=(const TimerService&) = delete;
+
+    /**
+     * Arm (or re-arm) a call for `deadline`, reviving it if it was cancelled
+     * @return false if the call has already fired
+     */
+    bool schedule(const std::shared_ptr<Entry>& entry, TimePoint deadline) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (entry->fired) {
+            return false;
+        }
+        remove_locked(*entry);
+        entry->deadline = deadline;
+        entry->cancelled = false;
+        entry->heap_index = heap_.size();
+        heap_.push_back(entry);
+        sift_up(entry->heap_index);
+        if (entry->heap_index == 0) {
+            wake_cv_.notify_one();
+        }
+        return true;
+    }
+
+    /**
+     * Cancel a call if it has not fired yet
+     * @param wait_if_running Also wait for the call to finish if it is running
+     *        right now (ignored on the worker thread itself)
+     */
+    void cancel(Entry& entry, bool wait_if_running) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        entry.cancelled = true;
+        remove_locked(entry);
+        if (wait_if_running && worker_.get_id() != std::this_thread::get_id()) {
+            done_cv_.wait(lock, [&]() { return running_ != &entry; });
+        }
+    }
+
+    /**
+     * Number of calls waiting for their deadline
+     */
+    size_t pending() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return heap_.size();
+    }
+
+private:
+    static constexpr size_t NOT_QUEUED = static_cast<size_t>(-1);
+
+    void run() {
+        bool destroyed = false; // Set by the destructor if a call drops the last owner
+        std::unique_lock<std::mutex> lock(mutex_);
+        destroyed_by_worker_ = &destroyed;
+        while (!stopping_) {
+            if (heap_.empty()) {
+                wake_cv_.wait(lock);
+                continue;
+            }
+            const TimePoint deadline = heap_.front()->deadline;
+            if (Clock::now() < deadline) {
+                wake_cv_.wait_until(lock, deadline);
+                continue;
+            }
+            std::shared_ptr<Entry> entry = heap_.front();
+            remove_locked(*entry);
+            entry->fired = true;
+            running_ = entry.get();
+            lock.unlock();
+            try {
+                entry->task();
+            } catch (...) {
+                // Swallow exceptions to keep the shared worker alive
+            }
+            // Drop our reference first: once running_ clears, the owner may destroy the call
+            entry.reset();
+            if (destroyed) {
+                return; // Members are gone; the unlocked lock is safe to drop
+            }
+            lock.lock();
+            running_ = nullptr;
+            done_cv_.notify_all();
+        }
+        destroyed_by_worker_ = nullptr; // `destroyed` dies with this frame
+    }
+
+    void remove_locked(Entry& entry) {
+        const size_t index = entry.heap_index;
+        if (index == NOT_QUEUED) {
+            return;
+        }
+        entry.heap_index = NOT_QUEUED;
+        const size_t last = heap_.size() - 1;
+        if (index != last) {
+            heap_[index] = std::move(heap_[last]);
+            heap_[index]->heap_index = index;
+        }
+        heap_.pop_back();
+        if (index < heap_.size()) {
+            sift_down(index);
+            sift_up(index);
+        }
+    }
+
+    void sift_up(size_t index) {
+        while (index > 0) {
+            const size_t parent = (index - 1) / 2;
+            if (!(heap_[index]->deadline < heap_[parent]->deadline)) {
+                break;
+            }
+            swap_nodes(index, parent);
+            index = parent;
+        }
+    }
+
+    void sift_down(size_t index) {
+        for (;;) {
+            size_t smallest = index;
+            for (size_t child = 2 * index + 1; child <= 2 * index + 2 && child < heap_.size(); ++child) {
+                if (heap_[child]->deadline < heap_[smallest]->deadline) {
+                    smallest = child;
+                }
+            }
+            if (smallest == index) {
+                return;
+            }
+            swap_nodes(index, smallest);
+            index = smallest;
+        }
+    }
+
+    void swap_nodes(size_t a, size_t b) {
+        std::swap(heap_[a], heap_[b]);
+        heap_[a]->heap_index = a;
+        heap_[b]->heap_index = b;
+    }
+
+    mutable std::mutex mutex_;
+    std::condition_variable wake_cv_;   // New earliest deadline, or shutdown
+    std::condition_variable done_cv_;   // A running call finished
+    std::vector<std::shared_ptr<Entry>> heap_;
+    const Entry* running_ = nullptr;
+    bool stopping_ = false;
+    bool* destroyed_by_worker_ = nullptr; // Only touched on the worker thread
+    std::thread worker_;                // Last: started once the rest is ready
+};
+
 /**
  * DelayedCall - Timer-based deferred execution utility for C++17
  * 
@@ -24,6 +226,9 @@ namespace util {
  * - Thread-safe operations
  * - Optional std::future support for result tracking
  * - Header-only implementation with STL dependencies only
+ *
+ * Calls run on the shared TimerService thread; creating one costs a heap
+ * insertion, not a thread.
  */
 class DelayedCall {
 public:
@@ -38,11 +243,9 @@ public:
      */
     template<typename Callable>
     DelayedCall(Callable&& task, Duration delay)
-        : task_fn_(std::forward<Callable>(task))
+        : service_(TimerService::instance())
+        , entry_(std::make_shared<TimerService::Entry>(std::function<void()>(std::forward<Callable>(task))))
         , delay_(delay)
-        , is_cancelled_(false)
-        , has_fired_(false)
-        , is_rescheduling_(false)
     {
         schedule_internal();
     }
@@ -58,90 +261,35 @@ public:
     }
     
     /**
-     * Destructor ensures clean shutdown
+     * Destructor cancels the call, and waits for it if it is running right now
      */
     ~DelayedCall() {
-        cancel();
-        if (timer_thread_.joinable()) {
-            timer_thread_.join();
-        }
+        release();
     }
     
     // Non-copyable but movable
     DelayedCall(const DelayedCall&) = delete;
     DelayedCall& operator=(const DelayedCall&) = delete;
     
-    DelayedCall(DelayedCall&& other) noexcept {
-        // Take properties from other
-        task_fn_ = std::move(other.task_fn_);
-        delay_ = other.delay_;
-
-        // Was the other task viable before we started messing with it?
-        bool other_was_pending = !other.has_fired_.load() && !other.is_cancelled_.load();
-
-        // Neutralize the other object.
-        // Signal its thread to stop (if running) and join it.
-        other.is_cancelled_ = true; // Signal cancellation to its thread
-        other.cv_.notify_all();     // Wake up its thread if it's waiting
-        if (other.timer_thread_.joinable()) {
-            other.timer_thread_.join();
-        }
-        other.has_fired_ = true; // Mark as effectively done/used up.
-
-        // Initialize this object's state
-        is_cancelled_ = false;
-        has_fired_ = false;
-        is_rescheduling_ = false; // Should not be rescheduling during a move construction
-
-        // If the other task was pending, schedule it anew for this object.
-        if (other_was_pending) {
-            // schedule_internal uses this->delay_ and this->task_fn_
-            // which are already set from other.
-            schedule_internal();
-        } else {
-            // If other was not pending (already fired or cancelled),
-            // this new object is also considered fired/cancelled to match.
-            // No new thread will be started.
-            is_cancelled_ = !other.has_fired_.load(); // if other was cancelled, this is cancelled
-            has_fired_ = other.has_fired_.load();    // if other was fired, this is fired
-        }
+    /**
+     * The pending call moves with its original deadline; the moved-from
+     * object is left expired
+     */
+    DelayedCall(DelayedCall&& other) noexcept
+        : service_(std::move(other.service_))
+        , entry_(std::move(other.entry_))
+        , delay_(other.delay_)
+        , scheduled_time_(other.scheduled_time_)
+    {
     }
     
     DelayedCall& operator=(DelayedCall&& other) noexcept {
         if (this != &other) {
-            // 1. Clean up current object's resources
-            cancel(); // Sets is_cancelled_ = true, notifies cv_
-            if (timer_thread_.joinable()) {
-                timer_thread_.join();
-            }
-            
-            // 2. Take properties from other
-            task_fn_ = std::move(other.task_fn_);
+            release();
+            service_ = std::move(other.service_);
+            entry_ = std::move(other.entry_);
             delay_ = other.delay_;
-
-            // Was the other task viable before we started messing with it?
-            bool other_was_pending = !other.has_fired_.load() && !other.is_cancelled_.load();
-
-            // 3. Neutralize the other object.
-            other.is_cancelled_ = true;
-            other.cv_.notify_all();
-            if (other.timer_thread_.joinable()) {
-                other.timer_thread_.join();
-            }
-            other.has_fired_ = true; // Mark as effectively done.
-
-            // 4. Initialize this object's state for the new task
-            is_cancelled_ = false;
-            has_fired_ = false;
-            is_rescheduling_ = false;
-
-            // 5. If the other task was pending, schedule it anew for this object.
-            if (other_was_pending) {
-                schedule_internal();
-            } else {
-                is_cancelled_ = !other.has_fired_.load();
-                has_fired_ = other.has_fired_.load();
-            }
+            scheduled_time_ = other.scheduled_time_;
         }
         return *this;
     }
@@ -151,8 +299,9 @@ public:
      * No-op if already executed or cancelled
      */
     void cancel() {
-        is_cancelled_ = true;
-        cv_.notify_all();
+        if (entry_) {
+            service_->cancel(*entry_, false);
+        }
     }
     
     /**
@@ -161,24 +310,10 @@ public:
      * @param new_delay New duration to wait
      */
     void reschedule(Duration new_delay) {
-        std::lock_guard<std::mutex> lock(reschedule_mutex_);
-        
-        if (has_fired_) {
+        if (!entry_ || entry_->fired) {
             return; // Already executed, can't reschedule
         }
-        
-        is_rescheduling_ = true;
-        is_cancelled_ = true;
-        cv_.notify_all();
-        
-        if (timer_thread_.joinable()) {
-            timer_thread_.join();
-        }
-        
         delay_ = new_delay;
-        is_cancelled_ = false;
-        is_rescheduling_ = false;
-        
         schedule_internal();
     }
     
@@ -194,14 +329,14 @@ public:
      * Check if the call has expired (executed or cancelled)
      */
     bool expired() const {
-        return has_fired_ || is_cancelled_;
+        return !entry_ || entry_->fired || entry_->cancelled;
     }
     
     /**
      * Check if the call is still valid (scheduled to run)
      */
     bool valid() const {
-        return !expired() && !is_rescheduling_;
+        return !expired();
     }
     
     /**
@@ -231,46 +366,20 @@ public:
 private:
     void schedule_internal() {
         scheduled_time_ = Clock::now() + delay_;
-        
-        timer_thread_ = std::thread([this]() {
-            std::unique_lock<std::mutex> lock(wait_mutex_);
-            
-            // Wait for the delay period or until cancelled
-            if (cv_.wait_until(lock, scheduled_time_, [this]() { 
-                return is_cancelled_.load(); 
-            })) {
-                // Was cancelled during wait
-                return;
-            }
-            
-            // Check again after wait to handle race conditions
-            if (is_cancelled_) {
-                return;
-            }
-            
-            // Execute the task
-            has_fired_ = true;
-            try {
-                task_fn_();
-            } catch (...) {
-                // Swallow exceptions to prevent thread termination
-                // In a production system, you might want to log this
-            }
-        });
+        service_->schedule(entry_, scheduled_time_);
+    }
+    
+    void release() {
+        if (entry_) {
+            service_->cancel(*entry_, true);
+            entry_.reset();
+        }
     }
     
-    std::function<void()> task_fn_;
+    std::shared_ptr<TimerService> service_;
+    std::shared_ptr<TimerService::Entry> entry_; // Null once moved from
     Duration delay_;
     TimePoint scheduled_time_;
-    
-    std::atomic<bool> is_cancelled_;
-    std::atomic<bool> has_fired_;
-    std::atomic<bool> is_rescheduling_;
-    
-    std::thread timer_thread_;
-    std::mutex wait_mutex_;
-    std::mutex reschedule_mutex_;
-    std::condition_variable cv_;
 };
 
 /**
@@ -0,0 +1,227 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+namespace concurrent {
+
+// Epoch-based read-copy-update (RCU).
+//
+// Readers register once per thread and then bracket each read-side critical
+// section with pin()/unpin (one relaxed load, one store and a fence: no locks,
+// no waiting, no shared cache line written by more than one thread). Writers
+// publish a new object and call synchronize(), which blocks the *writer* until
+// every reader that might still hold the previous object has unpinned; the
+// previous object can then be destroyed.
+//
+// A thread must not call synchronize() (or rcu_ptr::publish) while it holds a
+// pin on the same domain, or it will wait for itself forever.
+class epoch_domain {
+    struct alignas(64) reader_slot {
+        std::atomic<std::uint64_t> epoch{0}; // 0 = quiescent, otherwise the epoch pinned
+        std::atomic<bool> claimed{false};
+    };
+
+public:
+    static constexpr std::size_t default_max_readers = 256;
+
+    // Move-only handle to one reader slot. Owned and used by a single thread.
+    class reader {
+    public:
+        // RAII read-side critical section. Nested guards on the same reader are allowed.
+        class guard {
+        public:
+            explicit guard(reader& r) : reader_(&r) { reader_->lock(); }
+            guard(guard&& other) noexcept : reader_(std::exchange(other.reader_, nullptr)) {}
+            guard(const guard&) = delete;
+            guard& operator=(const guard&) = delete;
+            guard& operator=(guard&&) = delete;
+            ~guard() {
+                if (reader_) reader_->unlock();
+            }
+
+        private:
+            reader* reader_;
+        };
+
+        reader() = default;
+        reader(reader&& other) noexcept
+            : domain_(std::exchange(other.domain_, nullptr)),
+              slot_(std::exchange(other.slot_, nullptr)),
+              depth_(std::exchange(other.depth_, 0)) {}
+        reader& operator=(reader&& other) noexcept {
+            if (this != &other) {
+                release();
+                domain_ = std::exchange(other.domain_, nullptr);
+                slot_ = std::exchange(other.slot_, nullptr);
+                depth_ = std::exchange(other.depth_, 0);
+            }
+            return *this;
+        }
+        reader(const reader&) = delete;
+        reader& operator=(const reader&) = delete;
+        ~reader() { release(); }
+
+        bool valid() const noexcept { return slot_ != nullptr; }
+
+        void lock() noexcept {
+            if (depth_++ == 0) {
+                slot_->epoch.store(domain_->global_epoch_.load(std::memory_order_acquire),
+                                   std::memory_order_relaxed);
+                // Orders the slot store before any load of published data; pairs
+                // with the fence in synchronize().
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+            }
+        }
+
+        void unlock() noexcept {
+            if (--depth_ == 0) {
+                slot_->epoch.store(0, std::memory_order_release);
+            }
+        }
+
+        [[nodiscard]] guard pin() { return guard(*this); }
+
+    private:
+        friend class epoch_domain;
+        reader(epoch_domain* domain, reader_slot* slot) : domain_(domain), slot_(slot) {}
+
+        void release() noexcept {
+            if (slot_) {
+                slot_->epoch.store(0, std::memory_order_release);
+                slot_->claimed.store(false, std::memory_order_release);
+                slot_ = nullptr;
+                domain_ = nullptr;
+                depth_ = 0;
+            }
+        }
+
+        epoch_domain* domain_ = nullptr;
+        reader_slot* slot_ = nullptr;
+        std::uint32_t depth_ = 0;
+    };
+
+    explicit epoch_domain(std::size_t max_readers = default_max_readers)
+        : slots_(std::make_unique<reader_slot[]>(max_readers)), max_readers_(max_readers) {
+        if (max_readers == 0) {
+            throw std::invalid_argument("epoch_domain: max_readers must be positive");
+        }
+    }
+
+    epoch_domain(const epoch_domain&) = delete;
+    epoch_domain& operator=(const epoch_domain&) = delete;
+
+    // Claims a reader slot. Throws std::runtime_error if all slots are taken.
+    reader register_reader() {
+        for (std::size_t i = 0; i < max_readers_; ++i) {
+            bool expected = false;
+            if (slots_[i].claimed.compare_exchange_strong(expected, true, std::memory_order_acq_rel)) {
+                return reader(this, &slots_[i]);
+            }
+        }
+        throw std::runtime_error("epoch_domain: no free reader slots");
+    }
+
+    // Waits until every reader pinned before this call has unpinned. Readers
+    // that pin afterwards are not waited for.
+    void synchronize() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const std::uint64_t target = global_epoch_.fetch_add(1, std::memory_order_acq_rel) + 1;
+        for (std::size_t i = 0; i < max_readers_; ++i) {
+            while (true) {
+                const std::uint64_t pinned = slots_[i].epoch.load(std::memory_order_acquire);
+                if (pinned == 0 || pinned >= target) break;
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    std::uint64_t current_epoch() const noexcept { return global_epoch_.load(std::memory_order_acquire); }
+    std::size_t max_readers() const noexcept { return max_readers_; }
+
+private:
+    std::unique_ptr<reader_slot[]> slots_;
+    std::size_t max_readers_;
+    std::atomic<std::uint64_t> global_epoch_{1};
+};
+
+// A single RCU-published object. Readers get a const view that stays valid for
+// the lifetime of the returned read_guard; writers (serialized internally)
+// replace the object and the previous one is destroyed after a grace period.
+template <typename T>
+class rcu_ptr {
+public:
+    class read_guard {
+    public:
+        const T* get() const noexcept { return ptr_; }
+        const T* operator->() const noexcept { return ptr_; }
+        const T& operator*() const noexcept { return *ptr_; }
+        explicit operator bool() const noexcept { return ptr_ != nullptr; }
+
+    private:
+        friend class rcu_ptr;
+        read_guard(epoch_domain::reader& r, const std::atomic<T*>& src)
+            : pin_(r), ptr_(src.load(std::memory_order_acquire)) {}
+
+        epoch_domain::reader::guard pin_;
+        const T* ptr_;
+    };
+
+    explicit rcu_ptr(std::unique_ptr<T> initial = nullptr,
+                     std::size_t max_readers = epoch_domain::default_max_readers)
+        : domain_(max_readers), current_(initial.release()) {}
+
+    rcu_ptr(const rcu_ptr&) = delete;
+    rcu_ptr& operator=(const rcu_ptr&) = delete;
+
+    ~rcu_ptr() { delete current_.load(std::memory_order_acquire); }
+
+    epoch_domain::reader register_reader() { return domain_.register_reader(); }
+
+    [[nodiscard]] read_guard read(epoch_domain::reader& r) const { return read_guard(r, current_); }
+
+    // Swaps in `next`, waits for pre-existing readers to drain and destroys the
+    // previous object. Returns the number of the generation just published.
+    std::uint64_t publish(std::unique_ptr<T> next) {
+        std::lock_guard<std::mutex> lock(writer_mutex_);
+        return publish_locked(std::move(next));
+    }
+
+    // Builds the next object from the current one while holding the writer
+    // lock, so concurrent updaters cannot lose each other's changes. `make_next`
+    // receives the current object (or nullptr) and returns the replacement, or
+    // nullptr to leave the current object published. Returns true if published.
+    template <typename MakeNext>
+    bool update(MakeNext&& make_next) {
+        std::lock_guard<std::mutex> lock(writer_mutex_);
+        std::unique_ptr<T> next = make_next(static_cast<const T*>(current_.load(std::memory_order_acquire)));
+        if (!next) return false;
+        publish_locked(std::move(next));
+        return true;
+    }
+
+    std::uint64_t generation() const noexcept { return generation_.load(std::memory_order_acquire); }
+    epoch_domain& domain() noexcept { return domain_; }
+
+private:
+    std::uint64_t publish_locked(std::unique_ptr<T> next) {
+        T* previous = current_.exchange(next.release(), std::memory_order_seq_cst);
+        const std::uint64_t gen = generation_.fetch_add(1, std::memory_order_acq_rel) + 1;
+        domain_.synchronize();
+        delete previous;
+        return gen;
+    }
+
+    epoch_domain domain_;
+    std::atomic<T*> current_;
+    std::atomic<std::uint64_t> generation_{0};
+    std::mutex writer_mutex_;
+};
+
+} // namespace concurrent
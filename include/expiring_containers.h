@@ -2,6 +2,9 @@
 
 #include <chrono>
 #include <deque>
+#include <iterator>
+#include <list>
+#include <stdexcept>
 #include <unordered_map>
 #include <utility>
 
@@ -134,6 +137,13 @@ public:
 
 /**
  * @brief A key-value map where entries auto-expire based on insertion time
+ *
+ * Entries are kept in a list ordered by timestamp, which doubles as the expiry
+ * index: every entry shares one TTL, so the oldest timestamp always expires
+ * first. Purging pops expired entries off the front, at a cost proportional to
+ * the number removed. An optional max size bounds memory by evicting the least
+ * recently used entry when a new key would exceed it.
+ *
  * @tparam K Key type (must be hashable and equality-comparable)
  * @tparam V Value type
  */
@@ -146,15 +156,22 @@ public:
 
 private:
     struct TimedValue {
+        K key;
         V value;
         TimePoint timestamp;
-        
-        TimedValue(V val, TimePoint time) : value(std::move(val)), timestamp(time) {}
+        typename std::list<K>::iterator lru_pos; // Only valid when bounded
+
+        TimedValue(const K& k, V val, TimePoint time) : key(k), value(std::move(val)), timestamp(time) {}
     };
 
-    std::unordered_map<K, TimedValue> map_;
+    using EntryIter = typename std::list<TimedValue>::iterator;
+
+    std::list<TimedValue> entries_;  // Oldest timestamp first
+    std::unordered_map<K, EntryIter> map_;
+    std::list<K> lru_order_;         // Least recently used first; only kept when bounded
     Duration ttl_;
     bool access_renews_;
+    size_t max_size_;
 
     /**
      * @brief Check if a timed value has expired
@@ -165,14 +182,63 @@ private:
         return (Clock::now() - timed_val.timestamp) > ttl_;
     }
 
+    void touch(TimedValue& entry) {
+        if (max_size_ != 0) {
+            lru_order_.splice(lru_order_.end(), lru_order_, entry.lru_pos);
+        }
+    }
+
+    void renew(EntryIter entry, TimePoint now) {
+        entry->timestamp = now;
+        entries_.splice(entries_.end(), entries_, entry);
+    }
+
+    void remove(EntryIter entry) {
+        if (max_size_ != 0) {
+            lru_order_.erase(entry->lru_pos);
+        }
+        map_.erase(entry->key);
+        entries_.erase(entry);
+    }
+
+    template<typename Value>
+    void store(const K& key, Value&& value) {
+        const TimePoint now = Clock::now();
+        auto it = map_.find(key);
+        if (it != map_.end()) {
+            it->second->value = std::forward<Value>(value);
+            renew(it->second, now);
+            touch(*it->second);
+            return;
+        }
+        if (max_size_ != 0 && map_.size() >= max_size_) {
+            expire(); // Expired entries go first
+            if (map_.size() >= max_size_) {
+                remove(map_.find(lru_order_.front())->second);
+            }
+        }
+        entries_.emplace_back(key, std::forward<Value>(value), now);
+        EntryIter entry = std::prev(entries_.end());
+        map_.emplace(key, entry);
+        if (max_size_ != 0) {
+            entry->lru_pos = lru_order_.insert(lru_order_.end(), key);
+        }
+    }
+
 public:
     /**
      * @brief Construct a new ExpiringDict with specified TTL
      * @param ttl Time-to-live for entries
      * @param access_renews Whether accessing an entry renews its TTL
+     * @param max_size Maximum number of entries, evicting the least recently used beyond it (0 for unbounded)
      */
-    explicit ExpiringDict(Duration ttl, bool access_renews = false) 
-        : ttl_(ttl), access_renews_(access_renews) {}
+    explicit ExpiringDict(Duration ttl, bool access_renews = false, size_t max_size = 0)
+        : ttl_(ttl), access_renews_(access_renews), max_size_(max_size) {}
+
+    ExpiringDict(const ExpiringDict&) = delete;
+    ExpiringDict& operator=(const ExpiringDict&) = delete;
+    ExpiringDict(ExpiringDict&&) = default;
+    ExpiringDict& operator=(ExpiringDict&&) = default;
 
     /**
      * @brief Insert or overwrite a key-value pair with current timestamp
@@ -180,7 +246,7 @@ public:
      * @param value The value
      */
     void insert(const K& key, const V& value) {
-        map_.insert_or_assign(key, TimedValue(value, Clock::now()));
+        store(key, value);
     }
 
     /**
@@ -189,7 +255,7 @@ public:
      * @param value The value
      */
     void insert(const K& key, V&& value) {
-        map_.insert_or_assign(key, TimedValue(std::move(value), Clock::now()));
+        store(key, std::move(value));
     }
 
     /**
@@ -203,17 +269,19 @@ public:
             return nullptr;
         }
         
-        if (is_expired(it->second)) {
-            map_.erase(it);
+        if (is_expired(*it->second)) {
+            expire(); // Everything older is expired too
             return nullptr;
         }
         
         // Optionally renew TTL on access
+        EntryIter entry = it->second;
         if (access_renews_) {
-            it->second.timestamp = Clock::now();
+            renew(entry, Clock::now());
         }
+        touch(*entry);
         
-        return &(it->second.value);
+        return &(entry->value);
     }
 
     /**
@@ -227,12 +295,12 @@ public:
             return nullptr;
         }
         
-        if (is_expired(it->second)) {
+        if (is_expired(*it->second)) {
             // Note: We can't erase in const method, but we return nullptr
             return nullptr;
         }
         
-        return &(it->second.value);
+        return &(it->second->value);
     }
 
     /**
@@ -241,22 +309,7 @@ public:
      * @return true if key exists and is live, false otherwise
      */
     bool contains(const K& key) {
-        auto it = map_.find(key);
-        if (it == map_.end()) {
-            return false;
-        }
-        
-        if (is_expired(it->second)) {
-            map_.erase(it);
-            return false;
-        }
-        
-        // Optionally renew TTL on access
-        if (access_renews_) {
-            it->second.timestamp = Clock::now();
-        }
-        
-        return true;
+        return find(key) != nullptr;
     }
 
     /**
@@ -265,20 +318,21 @@ public:
      * @return true if key was found and removed, false otherwise
      */
     bool erase(const K& key) {
-        return map_.erase(key) > 0;
+        auto it = map_.find(key);
+        if (it == map_.end()) {
+            return false;
+        }
+        remove(it->second);
+        return true;
     }
 
     /**
-     * @brief Remove all expired entries
+     * @brief Remove all expired entries, oldest first, stopping at the first live one
      */
     void expire() {
-        auto it = map_.begin();
-        while (it != map_.end()) {
-            if (is_expired(it->second)) {
-                it = map_.erase(it);
-            } else {
-                ++it;
-            }
+        const TimePoint now = Clock::now();
+        while (!entries_.empty() && (now - entries_.front().timestamp) > ttl_) {
+            remove(entries_.begin());
         }
     }
 
@@ -305,6 +359,8 @@ public:
      */
     void clear() {
         map_.clear();
+        entries_.clear();
+        lru_order_.clear();
     }
 
     /**
@@ -331,6 +387,14 @@ public:
         return existed;
     }
 
+    /**
+     * @brief Get the maximum number of entries
+     * @return Maximum size, or 0 if unbounded
+     */
+    size_t get_max_size() const {
+        return max_size_;
+    }
+
     /**
      * @brief Change the TTL for future expiration checks
      * @param new_ttl New time-to-live duration
@@ -364,15 +428,15 @@ public:
     }
 
     /**
-     * @brief Visit all live entries with a function
+     * @brief Visit all live entries with a function, oldest timestamp first
      * @tparam Func Function type that accepts (const K&, const V&)
      * @param func The visitor function
      */
     template<typename Func>
     void for_each(Func&& func) {
         expire(); // Clean up first
-        for (const auto& pair : map_) {
-            func(pair.first, pair.second.value);
+        for (const auto& entry : entries_) {
+            func(entry.key, entry.value);
         }
     }
 };
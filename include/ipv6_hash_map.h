@@ -0,0 +1,312 @@
+#ifndef IPV6_HASH_MAP_HPP
+#define IPV6_HASH_MAP_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace cpp_utils {
+
+using ipv6_key_t = std::array<uint8_t, 16>;
+
+namespace ipv6_hash_detail {
+
+// 64x64 -> 128-bit multiply, folded (the wyhash/mum mixing step).
+inline uint64_t fold_mul(uint64_t a, uint64_t b) {
+#if defined(__SIZEOF_INT128__)
+    const unsigned __int128 r = static_cast<unsigned __int128>(a) * b;
+    return static_cast<uint64_t>(r) ^ static_cast<uint64_t>(r >> 64);
+#else
+    const uint64_t a_lo = a & 0xFFFFFFFFu, a_hi = a >> 32;
+    const uint64_t b_lo = b & 0xFFFFFFFFu, b_hi = b >> 32;
+    const uint64_t lo_lo = a_lo * b_lo, hi_lo = a_hi * b_lo, lo_hi = a_lo * b_hi, hi_hi = a_hi * b_hi;
+    const uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFFu) + lo_hi;
+    const uint64_t low = (cross << 32) | (lo_lo & 0xFFFFFFFFu);
+    const uint64_t high = (hi_lo >> 32) + (cross >> 32) + hi_hi;
+    return low ^ high;
+#endif
+}
+
+} // namespace ipv6_hash_detail
+
+// Hashes an IPv6 address as two 64-bit words with two multiply-fold rounds.
+// Every input bit reaches every output bit, so addresses that differ only in
+// the interface identifier (same /64) or only in the prefix spread equally well.
+inline uint64_t ipv6_hash(const ipv6_key_t& addr) {
+    uint64_t prefix;
+    uint64_t iid;
+    std::memcpy(&prefix, addr.data(), 8);
+    std::memcpy(&iid, addr.data() + 8, 8);
+    const uint64_t h = ipv6_hash_detail::fold_mul(prefix ^ 0xa0761d6478bd642full, iid ^ 0xe7037ed1a0b428dbull);
+    return ipv6_hash_detail::fold_mul(h ^ 0x8ebc6af09c88c6e3ull, 16 ^ 0x589965cc75374cc3ull);
+}
+
+// An open-addressing hash map keyed by IPv6 address, for tables with many
+// thousands of neighbors.
+//
+// Slots are grouped by sixteen. Each slot has a one-byte control tag (7 bits
+// of the hash, or EMPTY/DELETED) kept in a separate array, so a probe loads
+// sixteen tags and compares them with one SSE2 instruction; only slots whose
+// tag matches have their key compared, also as a single 128-bit compare.
+// Entries live inline in one array: no per-entry allocation.
+//
+// Erasing never moves other entries, so iterators and references stay valid
+// across erase(); insertion may rehash and invalidates both. The mapped type
+// must be default-constructible: free slots hold a default value, and erase()
+// resets the slot to one.
+template <typename V>
+class Ipv6HashMap {
+public:
+    using key_type = ipv6_key_t;
+    using mapped_type = V;
+    using value_type = std::pair<ipv6_key_t, V>;
+    using entry_type = value_type; // Lets the iterators re-export it as their own value_type
+
+    template <bool Const>
+    class basic_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = entry_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = std::conditional_t<Const, const entry_type*, entry_type*>;
+        using reference = std::conditional_t<Const, const entry_type&, entry_type&>;
+
+        basic_iterator() = default;
+        template <bool C = Const, typename = std::enable_if_t<C>>
+        basic_iterator(const basic_iterator<false>& other) : map_(other.map_), index_(other.index_) {}
+
+        reference operator*() const { return map_->slots_[index_]; }
+        pointer operator->() const { return &map_->slots_[index_]; }
+        basic_iterator& operator++() {
+            index_ = map_->nextFull(index_ + 1);
+            return *this;
+        }
+        basic_iterator operator++(int) {
+            basic_iterator copy = *this;
+            ++*this;
+            return copy;
+        }
+        friend bool operator==(const basic_iterator& a, const basic_iterator& b) { return a.index_ == b.index_; }
+        friend bool operator!=(const basic_iterator& a, const basic_iterator& b) { return a.index_ != b.index_; }
+
+    private:
+        friend class Ipv6HashMap;
+        template <bool> friend class basic_iterator;
+        using map_pointer = std::conditional_t<Const, const Ipv6HashMap*, Ipv6HashMap*>;
+        basic_iterator(map_pointer map, size_t index) : map_(map), index_(index) {}
+        map_pointer map_ = nullptr;
+        size_t index_ = 0;
+    };
+    using iterator = basic_iterator<false>;
+    using const_iterator = basic_iterator<true>;
+
+    Ipv6HashMap() { allocate(MIN_CAPACITY); }
+    Ipv6HashMap(const Ipv6HashMap&) = delete;
+    Ipv6HashMap& operator=(const Ipv6HashMap&) = delete;
+    // The moved-from map is left empty with no table; the next insert allocates one.
+    Ipv6HashMap(Ipv6HashMap&& other) noexcept
+        : ctrl_(std::move(other.ctrl_)),
+          slots_(std::move(other.slots_)),
+          capacity_(std::exchange(other.capacity_, 0)),
+          size_(std::exchange(other.size_, 0)),
+          deleted_(std::exchange(other.deleted_, 0)) {}
+    Ipv6HashMap& operator=(Ipv6HashMap&& other) noexcept {
+        if (this != &other) {
+            ctrl_ = std::move(other.ctrl_);
+            slots_ = std::move(other.slots_);
+            capacity_ = std::exchange(other.capacity_, 0);
+            size_ = std::exchange(other.size_, 0);
+            deleted_ = std::exchange(other.deleted_, 0);
+        }
+        return *this;
+    }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    size_t capacity() const { return capacity_; }
+
+    iterator begin() { return iterator(this, nextFull(0)); }
+    iterator end() { return iterator(this, capacity_); }
+    const_iterator begin() const { return const_iterator(this, nextFull(0)); }
+    const_iterator end() const { return const_iterator(this, capacity_); }
+
+    iterator find(const ipv6_key_t& key) { return iterator(this, findIndex(key)); }
+    const_iterator find(const ipv6_key_t& key) const { return const_iterator(this, findIndex(key)); }
+    size_t count(const ipv6_key_t& key) const { return findIndex(key) == capacity_ ? 0 : 1; }
+
+    // Inserts (key, V(args...)) unless the key is present. Returns the entry and whether it was inserted.
+    template <typename... Args>
+    std::pair<iterator, bool> emplace(const ipv6_key_t& key, Args&&... args) {
+        const uint64_t hash = ipv6_hash(key);
+        const size_t existing = findIndex(key, hash);
+        if (existing != capacity_) {
+            return {iterator(this, existing), false};
+        }
+        if ((size_ + deleted_ + 1) * 8 > capacity_ * 7) {
+            rehash(size_ + 1);
+        }
+        const size_t index = freeIndex(hash);
+        if (ctrl_[index] == DELETED) --deleted_;
+        ctrl_[index] = tagOf(hash);
+        slots_[index].first = key;
+        slots_[index].second = V(std::forward<Args>(args)...);
+        ++size_;
+        return {iterator(this, index), true};
+    }
+
+    V& operator[](const ipv6_key_t& key) { return emplace(key).first->second; }
+
+    void erase(iterator it) {
+        ctrl_[it.index_] = DELETED;
+        slots_[it.index_].second = V{};
+        --size_;
+        ++deleted_;
+    }
+
+    size_t erase(const ipv6_key_t& key) {
+        iterator it = find(key);
+        if (it == end()) return 0;
+        erase(it);
+        return 1;
+    }
+
+    void clear() {
+        Ipv6HashMap fresh;
+        *this = std::move(fresh);
+    }
+
+    // Grows the table so that `n` entries fit without rehashing.
+    void reserve(size_t n) {
+        if (n * 8 > capacity_ * 7) rehash(n);
+    }
+
+private:
+    static constexpr size_t GROUP = 16;
+    static constexpr size_t MIN_CAPACITY = GROUP;
+    static constexpr uint8_t EMPTY = 0x80;
+    static constexpr uint8_t DELETED = 0xFE;
+
+    static uint8_t tagOf(uint64_t hash) { return static_cast<uint8_t>(hash >> 57); } // Top 7 bits: FULL tags have bit 7 clear
+
+    static bool keysEqual(const ipv6_key_t& a, const ipv6_key_t& b) {
+#if defined(__SSE2__)
+        const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a.data()));
+        const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b.data()));
+        return _mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)) == 0xFFFF;
+#else
+        return std::memcmp(a.data(), b.data(), 16) == 0;
+#endif
+    }
+
+    // Bit i set when ctrl[i] == tag, for the sixteen tags starting at `ctrl`.
+    static uint32_t matchTag(const uint8_t* ctrl, uint8_t tag) {
+#if defined(__SSE2__)
+        const __m128i group = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl));
+        return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(static_cast<char>(tag)))));
+#else
+        uint32_t mask = 0;
+        for (size_t i = 0; i < GROUP; ++i) mask |= uint32_t{ctrl[i] == tag} << i;
+        return mask;
+#endif
+    }
+
+    // Bit i set when ctrl[i] is EMPTY or DELETED (the tags with bit 7 set).
+    static uint32_t matchFree(const uint8_t* ctrl) {
+#if defined(__SSE2__)
+        return static_cast<uint32_t>(_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl))));
+#else
+        uint32_t mask = 0;
+        for (size_t i = 0; i < GROUP; ++i) mask |= uint32_t{(ctrl[i] & 0x80) != 0} << i;
+        return mask;
+#endif
+    }
+
+    static uint32_t matchEmpty(const uint8_t* ctrl) { return matchTag(ctrl, EMPTY); }
+
+    static unsigned lowestBit(uint32_t mask) {
+#if defined(__GNUC__) || defined(__clang__)
+        return static_cast<unsigned>(__builtin_ctz(mask));
+#else
+        unsigned i = 0;
+        while (!(mask & 1u)) { mask >>= 1; ++i; }
+        return i;
+#endif
+    }
+
+    size_t findIndex(const ipv6_key_t& key) const { return findIndex(key, ipv6_hash(key)); }
+
+    // Probes group by group from the hash's home group; stops at a group with an EMPTY tag.
+    size_t findIndex(const ipv6_key_t& key, uint64_t hash) const {
+        if (capacity_ == 0) return capacity_; // Moved from: no table to probe
+        const uint8_t tag = tagOf(hash);
+        const size_t group_mask = capacity_ / GROUP - 1;
+        for (size_t g = hash & group_mask, probes = 0; probes <= group_mask; g = (g + 1) & group_mask, ++probes) {
+            const uint8_t* ctrl = &ctrl_[g * GROUP];
+            for (uint32_t m = matchTag(ctrl, tag); m != 0; m &= m - 1) {
+                const size_t index = g * GROUP + lowestBit(m);
+                if (keysEqual(slots_[index].first, key)) return index;
+            }
+            if (matchEmpty(ctrl) != 0) break;
+        }
+        return capacity_;
+    }
+
+    // First EMPTY or DELETED slot on the key's probe sequence. The load factor guarantees one exists.
+    size_t freeIndex(uint64_t hash) const {
+        const size_t group_mask = capacity_ / GROUP - 1;
+        for (size_t g = hash & group_mask;; g = (g + 1) & group_mask) {
+            if (const uint32_t m = matchFree(&ctrl_[g * GROUP])) return g * GROUP + lowestBit(m);
+        }
+    }
+
+    size_t nextFull(size_t index) const {
+        while (index < capacity_ && (ctrl_[index] & 0x80)) ++index;
+        return index;
+    }
+
+    void allocate(size_t capacity) {
+        capacity_ = capacity;
+        ctrl_ = std::make_unique<uint8_t[]>(capacity);
+        std::memset(ctrl_.get(), EMPTY, capacity);
+        slots_ = std::make_unique<value_type[]>(capacity);
+        size_ = 0;
+        deleted_ = 0;
+    }
+
+    // Moves every entry into a table sized for `min_size` entries at no more than 7/16 load.
+    void rehash(size_t min_size) {
+        size_t capacity = MIN_CAPACITY;
+        while (capacity * 7 < min_size * 16) capacity <<= 1;
+        std::unique_ptr<uint8_t[]> old_ctrl = std::move(ctrl_);
+        std::unique_ptr<value_type[]> old_slots = std::move(slots_);
+        const size_t old_capacity = capacity_;
+        allocate(capacity);
+        for (size_t i = 0; i < old_capacity; ++i) {
+            if (old_ctrl[i] & 0x80) continue;
+            const uint64_t hash = ipv6_hash(old_slots[i].first);
+            const size_t index = freeIndex(hash);
+            ctrl_[index] = tagOf(hash);
+            slots_[index] = std::move(old_slots[i]);
+            ++size_;
+        }
+    }
+
+    std::unique_ptr<uint8_t[]> ctrl_;
+    std::unique_ptr<value_type[]> slots_;
+    size_t capacity_ = 0;
+    size_t size_ = 0;
+    size_t deleted_ = 0;
+};
+
+} // namespace cpp_utils
+
+#endif // IPV6_HASH_MAP_HPP
@@ -0,0 +1,586 @@
+// local_id_allocator.hpp
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// In-process ID allocator with the same interface as RedisIDAllocator.
+//
+// Allocation state is an atomic bitmap (bit i is ID min_id + i) plus a per-ID
+// expiry time, so allocate/free/isAllocated are lock-free and never leave the
+// process. It can stand in for the Redis store in tests, back a single-process
+// deployment, or serve as the shared store behind IDLeaseCache.
+//
+// Expiry protocol: an allocated ID has a non-zero expiry. Whoever swaps that
+// expiry to zero (free, cleanup or clearAll) owns the release and is the only
+// one to clear the bit, so a concurrent free and cleanup can never release an
+// ID twice or release its next owner's allocation. Between claiming the bit
+// and publishing the expiry an ID is "being allocated": isAllocated() reports
+// it, but free() does not release it.
+class LocalIDAllocator {
+public:
+    struct Config {
+        int min_id;
+        int max_id;
+        int ttl_seconds = 3600;  // Default 1 hour TTL
+        int cleanup_interval = 300;  // Cleanup every 5 minutes
+        bool enable_auto_cleanup = true;
+    };
+
+    explicit LocalIDAllocator(const Config& config)
+        : m_config(config),
+          m_range(rangeOf(config)),
+          m_words((m_range + 63) / 64),
+          m_bits(std::make_unique<std::atomic<uint64_t>[]>(m_words)),
+          m_expiry(std::make_unique<std::atomic<int64_t>[]>(m_range)),
+          m_lastCleanup(nowSeconds())
+    {
+        // Bits past max_id stay set, so they are never handed out
+        if (m_range % 64 != 0) {
+            m_bits[m_words - 1].store(~uint64_t{0} << (m_range % 64), std::memory_order_relaxed);
+        }
+    }
+
+    LocalIDAllocator(const LocalIDAllocator&) = delete;
+    LocalIDAllocator& operator=(const LocalIDAllocator&) = delete;
+
+    // Allocate a single ID with optional TTL. Searches from where the last
+    // allocation succeeded (next fit), not always from min_id.
+    std::optional<int> allocate(int ttl_seconds = 0) {
+        maybeCleanupExpired();
+        const size_t start = m_hint.load(std::memory_order_relaxed);
+        for (size_t k = 0; k < m_words; ++k) {
+            const size_t w = (start + k) % m_words;
+            uint64_t word = m_bits[w].load(std::memory_order_relaxed);
+            while (~word != 0) {
+                const uint64_t mask = uint64_t{1} << std::countr_zero(~word);
+                word = m_bits[w].fetch_or(mask, std::memory_order_acq_rel);
+                if ((word & mask) == 0) {
+                    m_hint.store(w, std::memory_order_relaxed);
+                    const size_t index = w * 64 + static_cast<size_t>(std::countr_zero(mask));
+                    publish(index, expiryFor(ttl_seconds));
+                    return idOf(index);
+                }
+            }
+        }
+        return std::nullopt;
+    }
+
+    // Allocate a contiguous range of IDs (lowest fit); returns the first ID
+    std::optional<int> allocateRange(int count, int ttl_seconds = 0) {
+        if (count <= 0 || static_cast<size_t>(count) > m_range) {
+            return std::nullopt;
+        }
+        maybeCleanupExpired();
+        const auto n = static_cast<size_t>(count);
+        size_t first = 0;
+        while (first + n <= m_range) {
+            // Find a run of n clear bits, then claim it; a lost race resumes the search
+            size_t run = 0;
+            while (run < n && !testBit(first + run)) {
+                ++run;
+            }
+            if (run < n) {
+                first += run + 1;
+                continue;
+            }
+            if (claimBits(first, n)) {
+                const int64_t expiry = expiryFor(ttl_seconds);
+                for (size_t i = 0; i < n; ++i) {
+                    publish(first + i, expiry);
+                }
+                return idOf(first);
+            }
+        }
+        return std::nullopt;
+    }
+
+    // Reserve a specific ID
+    bool reserve(int id, int ttl_seconds = 0) {
+        return reserveRange(id, id, ttl_seconds);
+    }
+
+    // Reserve a range of specific IDs; all or nothing
+    bool reserveRange(int start, int end, int ttl_seconds = 0) {
+        if (start > end || !isValidId(start) || !isValidId(end)) {
+            return false;
+        }
+        maybeCleanupExpired();
+        const size_t first = indexOf(start);
+        const size_t n = static_cast<size_t>(end - start) + 1;
+        if (!claimBits(first, n)) {
+            return false;
+        }
+        const int64_t expiry = expiryFor(ttl_seconds);
+        for (size_t i = 0; i < n; ++i) {
+            publish(first + i, expiry);
+        }
+        return true;
+    }
+
+    // Free an ID
+    bool free(int id) {
+        if (!isValidId(id)) return false;
+        const size_t index = indexOf(id);
+        int64_t expiry = m_expiry[index].load(std::memory_order_acquire);
+        while (expiry != 0) {
+            if (m_expiry[index].compare_exchange_weak(expiry, 0, std::memory_order_acq_rel)) {
+                clearBit(index);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Free a range of IDs; true only if every ID in it was allocated
+    bool freeRange(int start, int end) {
+        if (start > end || !isValidId(start) || !isValidId(end)) {
+            return false;
+        }
+        int freed = 0;
+        for (int id = start; id <= end; ++id) {
+            freed += free(id) ? 1 : 0;
+        }
+        return freed == end - start + 1;
+    }
+
+    // Check if an ID is allocated
+    bool isAllocated(int id) const {
+        return isValidId(id) && testBit(indexOf(id));
+    }
+
+    // Extend TTL for an ID
+    bool extendTTL(int id, int additional_seconds) {
+        if (!isValidId(id)) return false;
+        const size_t index = indexOf(id);
+        int64_t expiry = m_expiry[index].load(std::memory_order_acquire);
+        while (expiry != 0) {
+            if (expiry == NEVER) {
+                return true;
+            }
+            const int64_t extended = std::max<int64_t>(expiry + additional_seconds, 1);
+            if (m_expiry[index].compare_exchange_weak(expiry, extended, std::memory_order_acq_rel)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Free every allocation whose TTL has passed; returns how many
+    int cleanupExpired() {
+        return releaseWhere([now = nowSeconds()](int64_t expiry) { return now > expiry; });
+    }
+
+    struct Stats {
+        int total_range;
+        int allocated_count;
+        int available_count;
+        int expired_count;
+        double utilization_percent;
+    };
+
+    Stats getStats() const {
+        Stats stats;
+        stats.total_range = static_cast<int>(m_range);
+        stats.allocated_count = 0;
+        for (size_t w = 0; w < m_words; ++w) {
+            stats.allocated_count += std::popcount(m_bits[w].load(std::memory_order_relaxed));
+        }
+        stats.allocated_count -= static_cast<int>(m_words * 64 - m_range); // Padding bits
+        stats.available_count = stats.total_range - stats.allocated_count;
+        stats.utilization_percent = (static_cast<double>(stats.allocated_count) / stats.total_range) * 100.0;
+        stats.expired_count = 0;
+        const int64_t now = nowSeconds();
+        for (size_t i = 0; i < m_range; ++i) {
+            const int64_t expiry = m_expiry[i].load(std::memory_order_relaxed);
+            stats.expired_count += (expiry != 0 && now > expiry) ? 1 : 0;
+        }
+        return stats;
+    }
+
+    // Get all allocated IDs
+    std::vector<int> getAllocatedIds() const {
+        std::vector<int> result;
+        for (size_t i = 0; i < m_range; ++i) {
+            if (testBit(i)) {
+                result.push_back(idOf(i));
+            }
+        }
+        return result;
+    }
+
+    // Free every allocation (IDs still being allocated are left alone)
+    bool clearAll() {
+        releaseWhere([](int64_t) { return true; });
+        return true;
+    }
+
+    int minId() const { return m_config.min_id; }
+    int maxId() const { return m_config.max_id; }
+
+private:
+    static constexpr int64_t NEVER = INT64_MAX;  // Expiry of an allocation without TTL
+
+    Config m_config;
+    size_t m_range;
+    size_t m_words;
+    std::unique_ptr<std::atomic<uint64_t>[]> m_bits;
+    std::unique_ptr<std::atomic<int64_t>[]> m_expiry;  // 0 while free or being allocated
+    std::atomic<size_t> m_hint{0};  // Word where the last single allocation succeeded
+    std::atomic<int64_t> m_lastCleanup;
+
+    static size_t rangeOf(const Config& config) {
+        if (config.min_id < 0 || config.max_id < config.min_id) {
+            throw std::invalid_argument("Invalid ID range: min=" +
+                std::to_string(config.min_id) + ", max=" + std::to_string(config.max_id));
+        }
+        return static_cast<size_t>(config.max_id - config.min_id) + 1;
+    }
+
+    bool isValidId(int id) const {
+        return id >= m_config.min_id && id <= m_config.max_id;
+    }
+
+    size_t indexOf(int id) const { return static_cast<size_t>(id - m_config.min_id); }
+    int idOf(size_t index) const { return m_config.min_id + static_cast<int>(index); }
+
+    bool testBit(size_t index) const {
+        return (m_bits[index / 64].load(std::memory_order_acquire) >> (index % 64)) & 1;
+    }
+
+    void clearBit(size_t index) {
+        m_bits[index / 64].fetch_and(~(uint64_t{1} << (index % 64)), std::memory_order_release);
+    }
+
+    // Sets bits [first, first + n) a word at a time. If any was already set,
+    // undoes only the bits this call set and returns false.
+    bool claimBits(size_t first, size_t n) {
+        size_t done = 0;
+        while (done < n) {
+            const size_t index = first + done;
+            const size_t offset = index % 64;
+            const size_t span = std::min<size_t>(64 - offset, n - done);
+            const uint64_t mask = (span == 64 ? ~uint64_t{0} : ((uint64_t{1} << span) - 1)) << offset;
+            const uint64_t old = m_bits[index / 64].fetch_or(mask, std::memory_order_acq_rel);
+            if ((old & mask) != 0) {
+                m_bits[index / 64].fetch_and(~(mask & ~old), std::memory_order_release);
+                releaseClaimed(first, done);
+                return false;
+            }
+            done += span;
+        }
+        return true;
+    }
+
+    // Clears bits this thread claimed but has not published yet
+    void releaseClaimed(size_t first, size_t n) {
+        for (size_t i = 0; i < n; ++i) {
+            clearBit(first + i);
+        }
+    }
+
+    void publish(size_t index, int64_t expiry) {
+        m_expiry[index].store(expiry, std::memory_order_release);
+    }
+
+    int64_t expiryFor(int ttl_seconds) const {
+        if (ttl_seconds == 0) ttl_seconds = m_config.ttl_seconds;
+        if (ttl_seconds == 0) return NEVER;
+        return std::max<int64_t>(nowSeconds() + ttl_seconds, 1);
+    }
+
+    template <typename Pred>
+    int releaseWhere(Pred pred) {
+        int released = 0;
+        for (size_t i = 0; i < m_range; ++i) {
+            int64_t expiry = m_expiry[i].load(std::memory_order_acquire);
+            while (expiry != 0 && pred(expiry)) {
+                if (m_expiry[i].compare_exchange_weak(expiry, 0, std::memory_order_acq_rel)) {
+                    clearBit(i);
+                    ++released;
+                    break;
+                }
+            }
+        }
+        return released;
+    }
+
+    void maybeCleanupExpired() {
+        if (!m_config.enable_auto_cleanup) {
+            return;
+        }
+        const int64_t now = nowSeconds();
+        int64_t last = m_lastCleanup.load(std::memory_order_relaxed);
+        // One caller per interval wins the swap and does the sweep
+        if (now - last >= m_config.cleanup_interval &&
+            m_lastCleanup.compare_exchange_strong(last, now, std::memory_order_relaxed)) {
+            cleanupExpired();
+        }
+    }
+
+    static int64_t nowSeconds() {
+        return std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+};
+
+// Client-side cache in front of a shared ID allocator backend.
+//
+// The backend is anything with RedisIDAllocator's allocation calls
+// (allocate, allocateRange, free, freeRange, isAllocated, extendTTL):
+// RedisIDAllocator itself, or LocalIDAllocator as an in-process stand-in.
+// The cache leases IDs from it in blocks of `block_size` and hands them out
+// locally, so most allocate()/free() calls never reach the backend. Freed IDs
+// go back into the local pool; once it holds more than `max_spare` IDs, the
+// surplus is returned to the backend in coalesced ranges.
+//
+// Leased IDs are allocated in the backend under `lease_ttl_seconds`, so the
+// leases of a client that dies without release() expire there like any other
+// allocation. The cache records when each lease ends: allocate() never hands
+// out a spare with less than half the TTL left (such spares are returned, or
+// forgotten once lapsed), and renewLeases() extends every lease held here.
+template <typename Backend>
+class IDLeaseCache {
+public:
+    struct Config {
+        int block_size = 64;
+        int max_spare = 128;  // Spare IDs kept before returning the surplus
+        int lease_ttl_seconds = 3600;  // Backend TTL of every lease taken here
+    };
+
+    struct Stats {
+        uint64_t local_allocations = 0;  // Served from the leased pool
+        uint64_t backend_calls = 0;
+        size_t leased = 0;  // IDs this cache holds in the backend
+        size_t spare = 0;   // Leased but not handed out
+        uint64_t stale_spares = 0;  // Spares dropped because their lease was running out
+    };
+
+    explicit IDLeaseCache(Backend& backend) : IDLeaseCache(backend, Config{}) {}
+
+    IDLeaseCache(Backend& backend, const Config& config) : m_backend(backend), m_config(config) {
+        if (m_config.block_size <= 0 || m_config.max_spare < 0 || m_config.lease_ttl_seconds <= 0) {
+            throw std::invalid_argument("Invalid lease block size, spare limit or TTL");
+        }
+    }
+
+    ~IDLeaseCache() {
+        release();
+    }
+
+    IDLeaseCache(const IDLeaseCache&) = delete;
+    IDLeaseCache& operator=(const IDLeaseCache&) = delete;
+
+    std::optional<int> allocate() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_spare.empty() && m_leaseEnd[m_spare.back()] < handOutCutoff()) {
+            dropStaleSpares();
+        }
+        if (m_spare.empty() && !refill()) {
+            return std::nullopt;
+        }
+        const int id = m_spare.back();
+        m_spare.pop_back();
+        m_spareSet.erase(id);
+        m_inUse.insert(id);
+        ++m_stats.local_allocations;
+        return id;
+    }
+
+    // Reserve a specific ID: taken from the spare pool if leased, otherwise from the backend
+    bool reserve(int id) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_spareSet.erase(id)) {
+            m_spare.erase(std::find(m_spare.begin(), m_spare.end(), id));
+            m_inUse.insert(id);
+            return true;
+        }
+        if (m_inUse.count(id)) {
+            return false;
+        }
+        ++m_stats.backend_calls;
+        const Clock::time_point leaseEnd = newLeaseEnd();
+        if (!m_backend.reserve(id, m_config.lease_ttl_seconds)) {
+            return false;
+        }
+        m_inUse.insert(id);
+        m_leaseEnd[id] = leaseEnd;
+        return true;
+    }
+
+    // Frees an ID handed out by this cache into the spare pool; other IDs go to the backend
+    bool free(int id) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_inUse.erase(id)) {
+            if (m_spareSet.count(id)) {
+                return false;  // Already free
+            }
+            ++m_stats.backend_calls;
+            return m_backend.free(id);
+        }
+        m_spare.push_back(id);
+        m_spareSet.insert(id);
+        if (m_spare.size() > static_cast<size_t>(m_config.max_spare)) {
+            // Keep the most recently freed IDs, return the rest
+            const size_t surplus = m_spare.size() - static_cast<size_t>(m_config.max_spare) / 2;
+            std::vector<int> returned(m_spare.begin(), m_spare.begin() + static_cast<std::ptrdiff_t>(surplus));
+            m_spare.erase(m_spare.begin(), m_spare.begin() + static_cast<std::ptrdiff_t>(surplus));
+            giveBack(returned);
+        }
+        return true;
+    }
+
+    // True if the ID is allocated to a user, here or through another client
+    bool isAllocated(int id) const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_inUse.count(id)) {
+            return true;
+        }
+        if (m_spareSet.count(id)) {
+            return false;
+        }
+        ++m_stats.backend_calls;
+        return m_backend.isAllocated(id);
+    }
+
+    // Extends the backend TTL of every ID this cache holds. IDs in use are
+    // only kept leased by calling this more often than half the TTL; spares
+    // whose lease already lapsed are forgotten.
+    int renewLeases(int additional_seconds) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        int renewed = 0;
+        auto renew = [&](int id) {
+            ++m_stats.backend_calls;
+            if (!m_backend.extendTTL(id, additional_seconds)) {
+                return false;
+            }
+            m_leaseEnd[id] += std::chrono::seconds(additional_seconds);
+            ++renewed;
+            return true;
+        };
+        std::vector<int> lapsed;
+        for (int id : m_spare) {
+            if (!renew(id)) lapsed.push_back(id);
+        }
+        for (int id : m_inUse) renew(id);
+        for (int id : lapsed) {
+            m_spare.erase(std::find(m_spare.begin(), m_spare.end(), id));
+            m_spareSet.erase(id);
+            m_leaseEnd.erase(id);
+        }
+        return renewed;
+    }
+
+    // Returns every spare ID to the backend; IDs in use stay allocated
+    void release() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::vector<int> returned;
+        returned.swap(m_spare);
+        giveBack(returned);
+    }
+
+    Stats getStats() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Stats stats = m_stats;
+        stats.spare = m_spare.size();
+        stats.leased = m_spare.size() + m_inUse.size();
+        return stats;
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    Backend& m_backend;
+    Config m_config;
+    mutable std::mutex m_mutex;
+    std::vector<int> m_spare;  // Popped from the back
+    std::unordered_set<int> m_spareSet;
+    std::unordered_set<int> m_inUse;
+    std::unordered_map<int, Clock::time_point> m_leaseEnd;  // Every ID held here, spare or in use
+    mutable Stats m_stats;
+
+    // Taken before the backend call, so it never runs past the backend's expiry
+    Clock::time_point newLeaseEnd() const {
+        return Clock::now() + std::chrono::seconds(m_config.lease_ttl_seconds);
+    }
+
+    // Spares whose lease ends before this are not handed out
+    Clock::time_point handOutCutoff() const {
+        return Clock::now() + std::chrono::seconds(m_config.lease_ttl_seconds) / 2;
+    }
+
+    // Leases a block, or a single ID when the backend has no free run that long
+    bool refill() {
+        ++m_stats.backend_calls;
+        const Clock::time_point leaseEnd = newLeaseEnd();
+        if (auto first = m_backend.allocateRange(m_config.block_size, m_config.lease_ttl_seconds)) {
+            for (int id = *first + m_config.block_size - 1; id >= *first; --id) {
+                m_spare.push_back(id);  // Lowest ID is handed out first
+                m_spareSet.insert(id);
+                m_leaseEnd[id] = leaseEnd;
+            }
+            return true;
+        }
+        ++m_stats.backend_calls;
+        if (auto id = m_backend.allocate(m_config.lease_ttl_seconds)) {
+            m_spare.push_back(*id);
+            m_spareSet.insert(*id);
+            m_leaseEnd[*id] = leaseEnd;
+            return true;
+        }
+        return false;
+    }
+
+    // Removes every spare with less than half its TTL left. Those still leased
+    // go back to the backend; lapsed ones are only forgotten, since the backend
+    // may already have handed them to another client.
+    void dropStaleSpares() {
+        const Clock::time_point now = Clock::now();
+        const Clock::time_point cutoff = handOutCutoff();
+        std::vector<int> returned;
+        auto stale = std::stable_partition(m_spare.begin(), m_spare.end(),
+                                           [&](int id) { return m_leaseEnd[id] >= cutoff; });
+        for (auto it = stale; it != m_spare.end(); ++it) {
+            ++m_stats.stale_spares;
+            if (m_leaseEnd[*it] > now) {
+                returned.push_back(*it);
+            } else {
+                m_spareSet.erase(*it);
+                m_leaseEnd.erase(*it);
+            }
+        }
+        m_spare.erase(stale, m_spare.end());
+        giveBack(returned);
+    }
+
+    void giveBack(std::vector<int>& ids) {
+        std::sort(ids.begin(), ids.end());
+        for (size_t i = 0; i < ids.size();) {
+            size_t j = i + 1;
+            while (j < ids.size() && ids[j] == ids[j - 1] + 1) {
+                ++j;
+            }
+            ++m_stats.backend_calls;
+            if (j - i == 1) {
+                m_backend.free(ids[i]);
+            } else {
+                m_backend.freeRange(ids[i], ids[j - 1]);
+            }
+            for (size_t k = i; k < j; ++k) {
+                m_spareSet.erase(ids[k]);
+                m_leaseEnd.erase(ids[k]);
+            }
+            i = j;
+        }
+    }
+};
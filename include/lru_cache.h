@@ -9,6 +9,14 @@
 #include <utility>
 #include <stdexcept>
 #include <shared_mutex>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <future>
+#include <memory>
+#include <vector>
 
 template <typename Key, typename Value>
 class LRUCache {
@@ -107,6 +115,16 @@ public:
         return cache_items_map_.find(key) != cache_items_map_.end();
     }
 
+    // Looks up a value without counting a hit or miss and without promoting it
+    std::optional<Value> peek(const Key& key) const {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        auto it = cache_items_map_.find(key);
+        if (it == cache_items_map_.end()) {
+            return std::nullopt;
+        }
+        return it->second->second;
+    }
+
     bool erase(const Key& key) {
         std::unique_lock<std::shared_mutex> lock(mutex_);
         auto it = cache_items_map_.find(key);
@@ -185,23 +203,449 @@ private:
     }
 };
 
-// Simple decorator-like function cache for single argument functions
+// Sharded LRU cache for read-heavy concurrent use.
+//
+// Keys are spread over independent shards by hash, each with its own lock, so
+// threads working on different shards never contend. Within a shard, a hit
+// takes only a shared lock and sets the entry's access bit instead of splicing
+// a recency list; eviction runs CLOCK (second chance) over the shard's slots,
+// which approximates LRU: an entry used since the hand last passed survives
+// one more sweep. Values are returned by copy, so Value must be copyable.
+//
+// Capacity is split evenly, so each shard holds ceil(max_size / shards)
+// entries and eviction is per shard. Statistics are kept per shard and summed
+// by get_stats().
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class ShardedLRUCache {
+public:
+    using EvictCallback = std::function<void(const Key&, const Value&)>;
+    using Stats = typename LRUCache<Key, Value>::Stats;
+
+    static constexpr size_t DEFAULT_SHARDS = 16;
+
+    explicit ShardedLRUCache(size_t max_size, size_t shard_count = DEFAULT_SHARDS,
+                             EvictCallback on_evict = nullptr)
+        : max_size_(max_size), on_evict_(std::move(on_evict)) {
+        if (max_size == 0) {
+            throw std::invalid_argument("ShardedLRUCache max_size must be greater than 0");
+        }
+        if (shard_count == 0) {
+            throw std::invalid_argument("ShardedLRUCache shard_count must be greater than 0");
+        }
+        shard_count = std::min(shard_count, max_size);
+        const size_t per_shard = (max_size + shard_count - 1) / shard_count;
+        shards_.reserve(shard_count);
+        for (size_t i = 0; i < shard_count; ++i) {
+            shards_.push_back(std::make_unique<Shard>(per_shard));
+        }
+    }
+
+    ShardedLRUCache(const ShardedLRUCache&) = delete;
+    ShardedLRUCache& operator=(const ShardedLRUCache&) = delete;
+
+    std::optional<Value> get(const Key& key) {
+        Shard& shard = shard_for(key);
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        auto it = shard.index.find(key);
+        if (it == shard.index.end()) {
+            shard.misses.fetch_add(1, std::memory_order_relaxed);
+            return std::nullopt;
+        }
+        Slot& slot = shard.slots[it->second];
+        // Test first: a hot entry's bit is already set, and skipping the store keeps its line shared
+        if (!slot.referenced.load(std::memory_order_relaxed)) {
+            slot.referenced.store(true, std::memory_order_relaxed);
+        }
+        shard.hits.fetch_add(1, std::memory_order_relaxed);
+        return slot.item->second;
+    }
+
+    template<typename K, typename V>
+    void put(K&& key, V&& value) {
+        Shard& shard = shard_for(key);
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        auto it = shard.index.find(key);
+        if (it != shard.index.end()) {
+            Slot& slot = shard.slots[it->second];
+            slot.item->second = std::forward<V>(value);
+            slot.referenced.store(true, std::memory_order_relaxed);
+            return;
+        }
+        const size_t index = shard.free_slots.empty() ? evict(shard) : pop_free(shard);
+        Slot& slot = shard.slots[index];
+        slot.item.emplace(std::forward<K>(key), std::forward<V>(value));
+        slot.referenced.store(false, std::memory_order_relaxed);
+        shard.index.emplace(slot.item->first, index);
+    }
+
+    void put(const Key& key, const Value& value) {
+        put<const Key&, const Value&>(key, value);
+    }
+
+    bool contains(const Key& key) const {
+        const Shard& shard = shard_for(key);
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        return shard.index.find(key) != shard.index.end();
+    }
+
+    bool erase(const Key& key) {
+        Shard& shard = shard_for(key);
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        auto it = shard.index.find(key);
+        if (it == shard.index.end()) {
+            return false;
+        }
+        const size_t index = it->second;
+        shard.index.erase(it);
+        shard.slots[index].item.reset();
+        shard.free_slots.push_back(index);
+        return true;
+    }
+
+    void clear() {
+        for (auto& shard : shards_) {
+            std::unique_lock<std::shared_mutex> lock(shard->mutex);
+            shard->index.clear();
+            shard->free_slots.clear();
+            for (size_t i = shard->capacity; i-- > 0;) {
+                shard->slots[i].item.reset();
+                shard->free_slots.push_back(i);
+            }
+            shard->hand = 0;
+        }
+    }
+
+    size_t size() const {
+        size_t total = 0;
+        for (const auto& shard : shards_) {
+            std::shared_lock<std::shared_mutex> lock(shard->mutex);
+            total += shard->index.size();
+        }
+        return total;
+    }
+
+    bool empty() const {
+        return size() == 0;
+    }
+
+    size_t max_size() const {
+        return max_size_;
+    }
+
+    size_t shard_count() const {
+        return shards_.size();
+    }
+
+    Stats get_stats() const {
+        Stats stats;
+        for (const auto& shard : shards_) {
+            stats.hits += shard->hits.load(std::memory_order_relaxed);
+            stats.misses += shard->misses.load(std::memory_order_relaxed);
+            stats.evictions += shard->evictions.load(std::memory_order_relaxed);
+        }
+        return stats;
+    }
+
+    void reset_stats() {
+        for (auto& shard : shards_) {
+            shard->hits.store(0, std::memory_order_relaxed);
+            shard->misses.store(0, std::memory_order_relaxed);
+            shard->evictions.store(0, std::memory_order_relaxed);
+        }
+    }
+
+private:
+    struct Slot {
+        std::optional<std::pair<Key, Value>> item;
+        std::atomic<bool> referenced{false};
+    };
+
+    // Aligned so that neighbouring shards' locks and counters do not share a cache line
+    struct alignas(64) Shard {
+        explicit Shard(size_t cap) : capacity(cap), slots(std::make_unique<Slot[]>(cap)) {
+            index.reserve(cap);
+            free_slots.reserve(cap);
+            for (size_t i = cap; i-- > 0;) {
+                free_slots.push_back(i); // Slot 0 is used first
+            }
+        }
+
+        mutable std::shared_mutex mutex;
+        size_t capacity;
+        std::unique_ptr<Slot[]> slots;
+        std::unordered_map<Key, size_t, Hash> index;
+        std::vector<size_t> free_slots;
+        size_t hand = 0; // CLOCK hand
+        std::atomic<size_t> hits{0};
+        std::atomic<size_t> misses{0};
+        std::atomic<size_t> evictions{0};
+    };
+
+    size_t max_size_;
+    EvictCallback on_evict_;
+    Hash hash_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+
+    template <typename K>
+    Shard& shard_for(const K& key) const {
+        // Fibonacci hashing on the high bits keeps the shard choice independent
+        // of the low bits the shard's own hash table uses
+        const uint64_t h = static_cast<uint64_t>(hash_(key)) * 0x9E3779B97F4A7C15ull;
+        return *shards_[static_cast<size_t>((h >> 32) % shards_.size())];
+    }
+
+    static size_t pop_free(Shard& shard) {
+        const size_t index = shard.free_slots.back();
+        shard.free_slots.pop_back();
+        return index;
+    }
+
+    // Advances the hand past referenced entries, clearing their bits, and
+    // evicts the first unreferenced one. Returns its now-empty slot.
+    size_t evict(Shard& shard) {
+        for (;;) {
+            const size_t index = shard.hand;
+            shard.hand = (shard.hand + 1) % shard.capacity;
+            Slot& slot = shard.slots[index];
+            if (!slot.item) {
+                continue;
+            }
+            if (slot.referenced.exchange(false, std::memory_order_relaxed)) {
+                continue;
+            }
+            if (on_evict_) {
+                on_evict_(slot.item->first, slot.item->second);
+            }
+            shard.index.erase(slot.item->first);
+            slot.item.reset();
+            shard.evictions.fetch_add(1, std::memory_order_relaxed);
+            return index;
+        }
+    }
+};
+
+// Simple decorator-like function cache for single argument functions.
+//
+// Loads are single-flight: the first caller to miss on a key runs the function
+// and the others that miss on it meanwhile wait for that result (or exception)
+// instead of calling the function again. Optionally, entries expire after a
+// while, and can be refreshed ahead of expiry: the first caller to see an entry
+// older than refresh_after reloads it while concurrent callers keep getting the
+// old value. get_all() loads all the misses of a batch with one bulk call.
 template<typename Key, typename Value>
 class CachedFunction {
+public:
+    using Clock = std::chrono::steady_clock;
+    using BulkLoader = std::function<std::unordered_map<Key, Value>(const std::vector<Key>&)>;
+
+    struct Config {
+        size_t max_size = 128;
+        Clock::duration expire_after = Clock::duration::zero();  // Zero: never expire
+        Clock::duration refresh_after = Clock::duration::zero(); // Zero: never refresh ahead
+        BulkLoader bulk_loader;  // Used by get_all(); keys it leaves out are loaded one by one
+    };
+
 private:
+    struct Entry {
+        Value value;
+        Clock::time_point loaded_at;
+    };
+
+    // Loads in progress, so later misses on the same key can wait on them
+    struct InFlight {
+        std::mutex mutex;
+        std::unordered_map<Key, std::shared_future<Value>> loads;
+    };
+
     std::function<Value(Key)> func_;
-    LRUCache<Key, Value> cache_;
+    Config config_;
+    LRUCache<Key, Entry> cache_;
+    std::unique_ptr<InFlight> in_flight_ = std::make_unique<InFlight>();
+
+    bool expired(const Entry& entry, Clock::time_point now) const {
+        return config_.expire_after != Clock::duration::zero() && now - entry.loaded_at >= config_.expire_after;
+    }
+
+    bool needs_refresh(const Entry& entry, Clock::time_point now) const {
+        return config_.refresh_after != Clock::duration::zero() && now - entry.loaded_at >= config_.refresh_after;
+    }
+
+    // Publishes a finished load: cached first, so a caller that no longer finds
+    // the in-flight entry is sure to find the value
+    void complete(const Key& key, std::promise<Value>& promise, const Value& value) {
+        cache_.put(key, Entry{value, Clock::now()});
+        {
+            std::lock_guard<std::mutex> lock(in_flight_->mutex);
+            in_flight_->loads.erase(key);
+        }
+        promise.set_value(value);
+    }
+
+    void fail(const Key& key, std::promise<Value>& promise, std::exception_ptr error) {
+        {
+            std::lock_guard<std::mutex> lock(in_flight_->mutex);
+            in_flight_->loads.erase(key);
+        }
+        promise.set_exception(error);
+    }
+
+    // Loads the key unless another caller already is. A stale entry (due for
+    // refresh but not expired) is returned as is while someone else reloads
+    // it, and also when our own reload throws.
+    Value load(const Key& key, const std::optional<Entry>& stale) {
+        std::promise<Value> promise;
+        std::unique_lock<std::mutex> lock(in_flight_->mutex);
+        if (auto it = in_flight_->loads.find(key); it != in_flight_->loads.end()) {
+            if (stale) {
+                return stale->value;
+            }
+            auto pending = it->second;
+            lock.unlock();
+            return pending.get();
+        }
+        // A load may have completed between the caller's miss and here
+        if (auto cached = cache_.peek(key)) {
+            const auto now = Clock::now();
+            if (!expired(*cached, now) && !needs_refresh(*cached, now)) {
+                return cached->value;
+            }
+        }
+        in_flight_->loads.emplace(key, promise.get_future().share());
+        lock.unlock();
+
+        try {
+            Value value = func_(key);
+            complete(key, promise, value);
+            return value;
+        } catch (...) {
+            fail(key, promise, std::current_exception());
+            if (stale) {
+                return stale->value;
+            }
+            throw;
+        }
+    }
 
 public:
     CachedFunction(std::function<Value(Key)> func, size_t max_size = 128)
-        : func_(std::move(func)), cache_(max_size) {}
+        : CachedFunction(std::move(func), Config{max_size, {}, {}, nullptr}) {}
+
+    CachedFunction(std::function<Value(Key)> func, Config config)
+        : func_(std::move(func)), config_(std::move(config)), cache_(config_.max_size) {}
 
     Value operator()(const Key& key) {
-        if (auto cached = cache_.get(key)) {
-            return *cached;
+        std::optional<Entry> cached = cache_.get(key);
+        if (cached) {
+            const auto now = Clock::now();
+            if (!expired(*cached, now)) {
+                if (!needs_refresh(*cached, now)) {
+                    return cached->value;
+                }
+                return load(key, cached);
+            }
+        }
+        return load(key, std::nullopt);
+    }
+
+    // Returns the values for keys, in order. Misses that no other caller is
+    // already loading, and entries due for refresh, go to the bulk loader in a
+    // single call (or to the function one by one if there is no bulk loader).
+    std::vector<Value> get_all(const std::vector<Key>& keys) {
+        std::vector<std::optional<Value>> values(keys.size());
+        std::vector<std::pair<size_t, std::shared_future<Value>>> waits;
+        std::vector<Key> to_load;
+        std::vector<std::promise<Value>> promises;
+        std::unordered_map<Key, size_t> claimed; // Key -> index into to_load
+        std::vector<std::pair<size_t, size_t>> claimed_slots; // values index -> to_load index
+        const auto now = Clock::now();
+
+        std::vector<std::optional<Entry>> cached(keys.size());
+        for (size_t i = 0; i < keys.size(); ++i) {
+            cached[i] = cache_.get(keys[i]);
+            if (cached[i] && expired(*cached[i], now)) {
+                cached[i].reset();
+            }
+            if (cached[i] && !needs_refresh(*cached[i], now)) {
+                values[i] = cached[i]->value;
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(in_flight_->mutex);
+            for (size_t i = 0; i < keys.size(); ++i) {
+                if (values[i]) {
+                    continue;
+                }
+                const Key& key = keys[i];
+                if (auto mine = claimed.find(key); mine != claimed.end()) {
+                    claimed_slots.emplace_back(i, mine->second);
+                    continue;
+                }
+                if (auto it = in_flight_->loads.find(key); it != in_flight_->loads.end()) {
+                    if (cached[i]) {
+                        values[i] = cached[i]->value;
+                    } else {
+                        waits.emplace_back(i, it->second);
+                    }
+                    continue;
+                }
+                claimed.emplace(key, to_load.size());
+                claimed_slots.emplace_back(i, to_load.size());
+                to_load.push_back(key);
+                promises.emplace_back();
+                in_flight_->loads.emplace(key, promises.back().get_future().share());
+            }
+        }
+
+        if (!to_load.empty()) {
+            std::vector<std::optional<Value>> loaded(to_load.size());
+            std::exception_ptr error;
+            size_t next = 0; // Loads are published in order, so on failure the rest are settled here
+            try {
+                if (config_.bulk_loader) {
+                    auto results = config_.bulk_loader(to_load);
+                    for (size_t j = 0; j < to_load.size(); ++j) {
+                        if (auto it = results.find(to_load[j]); it != results.end()) {
+                            loaded[j] = std::move(it->second);
+                        }
+                    }
+                }
+                for (; next < to_load.size(); ++next) {
+                    if (!loaded[next]) {
+                        loaded[next] = func_(to_load[next]);
+                    }
+                    complete(to_load[next], promises[next], *loaded[next]);
+                }
+            } catch (...) {
+                error = std::current_exception();
+                for (; next < to_load.size(); ++next) {
+                    if (loaded[next]) {
+                        complete(to_load[next], promises[next], *loaded[next]);
+                    } else {
+                        fail(to_load[next], promises[next], error);
+                    }
+                }
+            }
+            // As in load(), a failed refresh falls back to the stale value;
+            // only keys with nothing cached fail the batch
+            for (const auto& [i, j] : claimed_slots) {
+                if (loaded[j]) {
+                    values[i] = loaded[j];
+                } else if (cached[i]) {
+                    values[i] = cached[i]->value;
+                } else {
+                    std::rethrow_exception(error);
+                }
+            }
+        }
+        for (auto& [i, pending] : waits) {
+            values[i] = pending.get();
+        }
+
+        std::vector<Value> result;
+        result.reserve(keys.size());
+        for (auto& value : values) {
+            result.push_back(std::move(*value));
         }
-        Value result = func_(key);
-        cache_.put(key, result);
         return result;
     }
 
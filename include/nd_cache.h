@@ -5,9 +5,15 @@
 #include <chrono>
 #include <array>
 #include <cstdint> // For uintX_t types
-#include <queue>   // For pending packets, similar to ARPCache
+#include <memory>
+#include <span>
+#include <stdexcept>
 #include <algorithm> // For std::remove_if
 #include <functional> // For std::hash specialization
+#include <iterator>   // For std::next
+#include "aging_scheduler.h"
+#include "ipv6_hash_map.h"
+#include "packet_buffer_pool.h"
 
 using ipv6_addr_t = std::array<uint8_t, 16>;
 using mac_addr_t = std::array<uint8_t, 6>;
@@ -16,11 +22,7 @@ namespace std {
     template <>
     struct hash<ipv6_addr_t> {
         std::size_t operator()(const ipv6_addr_t& addr) const {
-            std::size_t h = 0;
-            for (uint8_t byte : addr) {
-                h ^= std::hash<uint8_t>{}(byte) + 0x9e3779b9 + (h << 6) + (h >> 2);
-            }
-            return h;
+            return static_cast<std::size_t>(cpp_utils::ipv6_hash(addr)); // Two 64-bit words, see ipv6_hash_map.h
         }
     };
 }
@@ -34,10 +36,11 @@ enum class NDCacheState { INCOMPLETE, REACHABLE, STALE, DELAY, PROBE, PERMANENT
 struct NDEntry {
     mac_addr_t mac; NDCacheState state; std::chrono::steady_clock::time_point timestamp;
     std::chrono::seconds reachable_time; int probe_count; bool is_router;
-    std::queue<std::vector<uint8_t>> pending_packets;
+    cpp_utils::PacketQueue pending_packets; // Packets waiting for resolution, in NDCache's packet pool
     ipv6_addr_t prefix; uint8_t prefix_length; std::chrono::seconds valid_lifetime;
     std::chrono::seconds preferred_lifetime; bool on_link; bool autonomous;
     std::vector<mac_addr_t> backup_macs;
+    cpp_utils::AgingHandle aging{}; // When age_entries() next needs to look at this entry
 };
 struct RouterEntry {
     ipv6_addr_t address; mac_addr_t mac; std::chrono::seconds lifetime;
@@ -57,7 +60,8 @@ private:
         std::chrono::steady_clock::time_point start_time; // When DAD for this address was initiated
     };
 
-    std::unordered_map<ipv6_addr_t, NDEntry> cache_;
+    std::shared_ptr<cpp_utils::PacketBufferPool> packet_pool_; // Declared before cache_: queues release into it
+    cpp_utils::Ipv6HashMap<NDEntry> cache_; // Flat, SSE2-probed; erase keeps other iterators valid
     std::vector<RouterEntry> default_routers_;
     std::vector<PrefixEntry> prefix_list_;
     mac_addr_t device_mac_;
@@ -65,12 +69,21 @@ private:
     ipv6_addr_t link_local_solicited_node_address_;
     bool link_local_dad_completed_ = false;
     std::vector<DadState> dad_in_progress_;
+    cpp_utils::AgingScheduler<ipv6_addr_t> aging_; // Neighbor deadlines on a timer wheel
 
     std::array<uint8_t, 8> generate_eui64_interface_id_bytes(const mac_addr_t& mac);
     void generate_link_local_address();
     void initiate_link_local_dad();
     ipv6_addr_t get_unspecified_address() const { ipv6_addr_t addr; addr.fill(0); return addr; }
 
+    // Neighbor aging: each entry's next deadline is armed on aging_, so
+    // age_entries() only steps entries that can actually change.
+    void schedule_aging(const ipv6_addr_t& ip, NDEntry& entry);
+    void age_entry(cpp_utils::Ipv6HashMap<NDEntry>::iterator it, std::chrono::steady_clock::time_point current_time);
+    void erase_entry(cpp_utils::Ipv6HashMap<NDEntry>::iterator it);
+    // Passes a resolved entry's queued packets to send_pending_packets(); call last.
+    void hand_off_pending(const ipv6_addr_t& ip, NDEntry& entry);
+
 public:
     // Debug members
     mutable int debug_dad_probes_sent_for_link_local = 0;
@@ -96,6 +109,9 @@ public:
     virtual void send_router_solicitation(const ipv6_addr_t& source_ip);
     virtual void send_neighbor_solicitation(const ipv6_addr_t& target_ip, const ipv6_addr_t& source_ip, const mac_addr_t* sllao, bool for_dad = false);
     virtual void send_neighbor_advertisement(const ipv6_addr_t& target_ip, const ipv6_addr_t& adv_source_ip, const mac_addr_t& tllao, bool is_router, bool solicited, bool override_flag);
+    // Receives the packets queued by queue_packet() once the neighbor resolves; drain() them to send.
+    // Must not modify the cache. The default drops them (counted as discarded).
+    virtual void send_pending_packets(const ipv6_addr_t& ip, const mac_addr_t& mac, cpp_utils::PacketQueue packets);
 
     struct RAInfo { ipv6_addr_t source_ip; mac_addr_t router_mac; std::chrono::seconds router_lifetime; std::vector<PrefixEntry> prefixes; };
     struct NSInfo { ipv6_addr_t source_ip; ipv6_addr_t target_ip; mac_addr_t sllao; bool is_dad_ns; };
@@ -110,6 +126,13 @@ public:
     void remove_entry(const ipv6_addr_t& ip);
     void add_backup_mac(const ipv6_addr_t& ipv6, const mac_addr_t& backup_mac);
 
+    // Holds a packet for an INCOMPLETE or PROBE neighbor until it resolves (see ARPCache::queue_packet).
+    // Returns false if there is no such entry or the packet pool dropped the packet.
+    bool queue_packet(const ipv6_addr_t& ip, std::span<const uint8_t> packet);
+    // Replaces the pending-packet pool, e.g. to share one with an ARPCache; queued packets are discarded.
+    void set_packet_pool(std::shared_ptr<cpp_utils::PacketBufferPool> pool);
+    const std::shared_ptr<cpp_utils::PacketBufferPool>& packet_pool() const { return packet_pool_; }
+
     void age_entries() { age_entries(std::chrono::steady_clock::now()); }
     void age_entries(std::chrono::steady_clock::time_point current_time);
 
@@ -125,7 +148,7 @@ public:
 };
 
 // Method Implementations
-NDCache::NDCache(const mac_addr_t& own_mac) : device_mac_(own_mac) {
+NDCache::NDCache(const mac_addr_t& own_mac) : packet_pool_(std::make_shared<cpp_utils::PacketBufferPool>()), device_mac_(own_mac) {
     // Initialize debug members
     debug_dad_probes_sent_for_link_local = 0;
     debug_dad_success_called_for_link_local = false;
@@ -157,6 +180,7 @@ ipv6_addr_t NDCache::solicited_node_multicast_address(const ipv6_addr_t& target_
 void NDCache::send_router_solicitation(const ipv6_addr_t& source_ip) { /* Placeholder */ }
 void NDCache::send_neighbor_solicitation(const ipv6_addr_t& target_ip, const ipv6_addr_t& source_ip, const mac_addr_t* sllao, bool for_dad) { /* Placeholder */ }
 void NDCache::send_neighbor_advertisement(const ipv6_addr_t& target_ip, const ipv6_addr_t& adv_source_ip, const mac_addr_t& tllao, bool is_router, bool solicited, bool override_flag) { /* Placeholder */ }
+void NDCache::send_pending_packets(const ipv6_addr_t& ip, const mac_addr_t& mac, cpp_utils::PacketQueue packets) { /* Placeholder: dropped */ }
 
 bool NDCache::lookup(const ipv6_addr_t& ip, mac_addr_t& mac_out) {
     // ... (Implementation from previous successful state) ...
@@ -165,6 +189,7 @@ bool NDCache::lookup(const ipv6_addr_t& ip, mac_addr_t& mac_out) {
         NDEntry& entry = it->second;
         switch (entry.state) {
             case NDCacheState::REACHABLE: case NDCacheState::PERMANENT:
+                // Only pushes the deadline back; the armed timer re-checks lazily.
                 mac_out = entry.mac; entry.timestamp = std::chrono::steady_clock::now(); return true;
             case NDCacheState::STALE: case NDCacheState::DELAY: case NDCacheState::PROBE:
                 if (!entry.backup_macs.empty()) {
@@ -175,11 +200,12 @@ bool NDCache::lookup(const ipv6_addr_t& ip, mac_addr_t& mac_out) {
                         entry.backup_macs.push_back(old_primary_mac);
                     }
                     entry.state = NDCacheState::REACHABLE; entry.timestamp = std::chrono::steady_clock::now();
-                    entry.probe_count = 0; mac_out = entry.mac; return true;
+                    entry.probe_count = 0; mac_out = entry.mac; schedule_aging(ip, entry); hand_off_pending(ip, entry); return true;
                 }
                 mac_out = entry.mac;
                 if (entry.state == NDCacheState::STALE) {
                     entry.state = NDCacheState::DELAY; entry.timestamp = std::chrono::steady_clock::now();
+                    schedule_aging(ip, entry);
                 }
                 return (entry.state == NDCacheState::DELAY);
             case NDCacheState::INCOMPLETE: return false;
@@ -201,13 +227,31 @@ void NDCache::add_entry(const ipv6_addr_t& ip, const mac_addr_t& mac, NDCacheSta
         it->second.timestamp = std::chrono::steady_clock::now();
         if (reachable_time != std::chrono::seconds(0)) { it->second.reachable_time = reachable_time; }
         it->second.is_router = is_router; it->second.probe_count = 0; it->second.backup_macs = backups;
-        if (state == NDCacheState::REACHABLE) { while(!it->second.pending_packets.empty()) { it->second.pending_packets.pop(); } }
     } else {
         NDEntry new_entry = { mac, state, std::chrono::steady_clock::now(), (reachable_time == std::chrono::seconds(0) ? DEFAULT_REACHABLE_TIME : reachable_time), 0, is_router, {}, {}, 0, {}, {}, false, false, backups };
-        cache_[ip] = new_entry;
+        it = cache_.emplace(ip, std::move(new_entry)).first;
     }
+    schedule_aging(ip, it->second);
+    if (it->second.state == NDCacheState::REACHABLE) { hand_off_pending(ip, it->second); }
+}
+void NDCache::remove_entry(const ipv6_addr_t& ip) {
+    auto it = cache_.find(ip);
+    if (it != cache_.end()) { erase_entry(it); }
+}
+bool NDCache::queue_packet(const ipv6_addr_t& ip, std::span<const uint8_t> packet) {
+    auto it = cache_.find(ip);
+    if (it == cache_.end() || (it->second.state != NDCacheState::INCOMPLETE && it->second.state != NDCacheState::PROBE)) { return false; }
+    return packet_pool_->enqueue(it->second.pending_packets, packet);
+}
+void NDCache::set_packet_pool(std::shared_ptr<cpp_utils::PacketBufferPool> pool) {
+    if (!pool) { throw std::invalid_argument("NDCache packet pool must not be null"); }
+    for (auto& [ip, entry] : cache_) { entry.pending_packets.clear(); }
+    packet_pool_ = std::move(pool);
+}
+void NDCache::hand_off_pending(const ipv6_addr_t& ip, NDEntry& entry) {
+    if (entry.pending_packets.empty()) { return; }
+    send_pending_packets(ip, entry.mac, std::move(entry.pending_packets));
 }
-void NDCache::remove_entry(const ipv6_addr_t& ip) { cache_.erase(ip); }
 void NDCache::add_backup_mac(const ipv6_addr_t& ipv6, const mac_addr_t& backup_mac) {
     // ... (Implementation from previous successful state) ...
     auto it = cache_.find(ipv6);
@@ -218,35 +262,62 @@ void NDCache::add_backup_mac(const ipv6_addr_t& ipv6, const mac_addr_t& backup_m
     }
 }
 
+void NDCache::schedule_aging(const ipv6_addr_t& ip, NDEntry& entry) {
+    switch (entry.state) {
+        case NDCacheState::INCOMPLETE: case NDCacheState::PROBE:
+            aging_.schedule(ip, entry.aging, entry.timestamp + std::chrono::seconds(RETRANS_TIMER / 1000)); break;
+        case NDCacheState::REACHABLE: aging_.schedule(ip, entry.aging, entry.timestamp + entry.reachable_time); break;
+        case NDCacheState::DELAY: aging_.schedule(ip, entry.aging, entry.timestamp + std::chrono::seconds(DELAY_FIRST_PROBE_TIME)); break;
+        case NDCacheState::STALE: case NDCacheState::PERMANENT: break; // No timed transition; a pending timer just finds nothing to do
+    }
+}
+void NDCache::erase_entry(cpp_utils::Ipv6HashMap<NDEntry>::iterator it) {
+    aging_.cancel(it->second.aging);
+    cache_.erase(it);
+}
+void NDCache::age_entry(cpp_utils::Ipv6HashMap<NDEntry>::iterator it, std::chrono::steady_clock::time_point current_time) {
+    NDEntry& entry = it->second;
+    auto time_since_last_update = std::chrono::duration_cast<std::chrono::seconds>(current_time - entry.timestamp);
+    switch (entry.state) {
+        case NDCacheState::INCOMPLETE:
+            if (time_since_last_update.count() >= (RETRANS_TIMER / 1000)) {
+                if (entry.probe_count >= MAX_MULTICAST_SOLICIT) {
+                    if (!entry.backup_macs.empty()) { entry.mac = entry.backup_macs.front(); entry.backup_macs.erase(entry.backup_macs.begin()); entry.state = NDCacheState::REACHABLE; entry.timestamp = current_time; entry.probe_count = 0;}
+                    else { entry.pending_packets.clear(); erase_entry(it); return; }
+                } else { send_neighbor_solicitation(it->first, link_local_address_, &device_mac_, false); entry.probe_count++; entry.timestamp = current_time; }
+            } break;
+        case NDCacheState::REACHABLE:
+            if (time_since_last_update >= entry.reachable_time) { entry.state = NDCacheState::STALE; entry.timestamp = current_time; } break;
+        case NDCacheState::STALE: break;
+        case NDCacheState::DELAY:
+            if (time_since_last_update.count() >= DELAY_FIRST_PROBE_TIME) { entry.state = NDCacheState::PROBE; entry.timestamp = current_time; entry.probe_count = 0; send_neighbor_solicitation(it->first, link_local_address_, &device_mac_, false); } break;
+        case NDCacheState::PROBE:
+            if (time_since_last_update.count() >= (RETRANS_TIMER / 1000)) {
+                if (entry.probe_count >= MAX_UNICAST_SOLICIT) {
+                    if (!entry.backup_macs.empty()) { mac_addr_t old_primary_mac = entry.mac; entry.mac = entry.backup_macs.front(); entry.backup_macs.erase(entry.backup_macs.begin()); bool old_mac_is_zero = true; for(uint8_t val : old_primary_mac) if(val != 0) old_mac_is_zero = false; if(!old_mac_is_zero && std::find(entry.backup_macs.begin(), entry.backup_macs.end(), old_primary_mac) == entry.backup_macs.end()){ entry.backup_macs.push_back(old_primary_mac); } entry.state = NDCacheState::REACHABLE; entry.timestamp = current_time; entry.probe_count = 0; }
+                    else { erase_entry(it); return; }
+                } else { send_neighbor_solicitation(it->first, link_local_address_, &device_mac_, false); entry.probe_count++; entry.timestamp = current_time; }
+            } break;
+        case NDCacheState::PERMANENT: break;
+    }
+    schedule_aging(it->first, entry);
+    if (entry.state == NDCacheState::REACHABLE) { hand_off_pending(it->first, entry); } // Failed over to a backup MAC
+}
+
 void NDCache::age_entries(std::chrono::steady_clock::time_point current_time) {
-    // Age NDEntry (cache_)
-    for (auto it = cache_.begin(); it != cache_.end(); ) {
-        // ... (Existing NDEntry aging logic as per previous file state, using current_time) ...
-        bool erased = false; NDEntry& entry = it->second;
-        auto time_since_last_update = std::chrono::duration_cast<std::chrono::seconds>(current_time - entry.timestamp);
-        switch (entry.state) {
-            case NDCacheState::INCOMPLETE:
-                if (time_since_last_update.count() >= (RETRANS_TIMER / 1000)) {
-                    if (entry.probe_count >= MAX_MULTICAST_SOLICIT) {
-                        if (!entry.backup_macs.empty()) { entry.mac = entry.backup_macs.front(); entry.backup_macs.erase(entry.backup_macs.begin()); entry.state = NDCacheState::REACHABLE; entry.timestamp = current_time; entry.probe_count = 0;}
-                        else { while(!entry.pending_packets.empty()) entry.pending_packets.pop(); it = cache_.erase(it); erased = true; }
-                    } else { send_neighbor_solicitation(it->first, link_local_address_, &device_mac_, false); entry.probe_count++; entry.timestamp = current_time; }
-                } break;
-            case NDCacheState::REACHABLE:
-                if (time_since_last_update >= entry.reachable_time) { entry.state = NDCacheState::STALE; entry.timestamp = current_time; } break;
-            case NDCacheState::STALE: break;
-            case NDCacheState::DELAY:
-                if (time_since_last_update.count() >= DELAY_FIRST_PROBE_TIME) { entry.state = NDCacheState::PROBE; entry.timestamp = current_time; entry.probe_count = 0; send_neighbor_solicitation(it->first, link_local_address_, &device_mac_, false); } break;
-            case NDCacheState::PROBE:
-                if (time_since_last_update.count() >= (RETRANS_TIMER / 1000)) {
-                    if (entry.probe_count >= MAX_UNICAST_SOLICIT) {
-                        if (!entry.backup_macs.empty()) { mac_addr_t old_primary_mac = entry.mac; entry.mac = entry.backup_macs.front(); entry.backup_macs.erase(entry.backup_macs.begin()); bool old_mac_is_zero = true; for(uint8_t val : old_primary_mac) if(val != 0) old_mac_is_zero = false; if(!old_mac_is_zero && std::find(entry.backup_macs.begin(), entry.backup_macs.end(), old_primary_mac) == entry.backup_macs.end()){ entry.backup_macs.push_back(old_primary_mac); } entry.state = NDCacheState::REACHABLE; entry.timestamp = current_time; entry.probe_count = 0; }
-                        else { it = cache_.erase(it); erased = true; }
-                    } else { send_neighbor_solicitation(it->first, link_local_address_, &device_mac_, false); entry.probe_count++; entry.timestamp = current_time; }
-                } break;
-            case NDCacheState::PERMANENT: break;
+    // Age NDEntry (cache_): only entries whose timer fired, unless a full scan is needed
+    bool advanced = aging_.advance(current_time, [&](const ipv6_addr_t& ip, uint32_t ticket) {
+        auto it = cache_.find(ip);
+        if (it != cache_.end() && aging_.claim(it->second.aging, ticket)) { age_entry(it, current_time); }
+    });
+    if (!advanced) {
+        aging_.reset(current_time);
+        for (auto it = cache_.begin(); it != cache_.end(); ) {
+            auto next = std::next(it);
+            it->second.aging = cpp_utils::AgingHandle{};
+            age_entry(it, current_time);
+            it = next;
         }
-        if (!erased) { ++it; }
     }
     // Age RouterList and PrefixList
     default_routers_.erase(std::remove_if(default_routers_.begin(), default_routers_.end(), [&](const RouterEntry& r){ return std::chrono::duration_cast<std::chrono::seconds>(current_time - r.last_seen) > r.lifetime; }), default_routers_.end());
@@ -362,7 +433,7 @@ void NDCache::process_router_advertisement(const RAInfo& ra_info) {
         if (!new_prefix_info.on_link && !new_prefix_info.autonomous) continue;
         auto it = std::find_if(prefix_list_.begin(), prefix_list_.end(), [&](const PrefixEntry& p) { return p.prefix == new_prefix_info.prefix && p.prefix_length == new_prefix_info.prefix_length; });
         if (new_prefix_info.valid_lifetime == std::chrono::seconds(0)) {
-            if (it != prefix_list_.end()) { if (it->generated_address != ipv6_addr_t{} ) { cache_.erase(it->generated_address); } prefix_list_.erase(it); } continue;
+            if (it != prefix_list_.end()) { if (it->generated_address != ipv6_addr_t{} ) { remove_entry(it->generated_address); } prefix_list_.erase(it); } continue;
         }
         if (it != prefix_list_.end()) {
             it->valid_lifetime = new_prefix_info.valid_lifetime; it->preferred_lifetime = new_prefix_info.preferred_lifetime;
@@ -426,6 +497,7 @@ void NDCache::process_neighbor_advertisement(const NAInfo& na_info) {
     auto it = cache_.find(na_info.target_ip);
     if (it != cache_.end()) {
         NDEntry& entry = it->second; bool mac_changed = (entry.mac != na_info.tllao);
+        const bool was_incomplete = (entry.state == NDCacheState::INCOMPLETE);
         if (entry.state == NDCacheState::INCOMPLETE) {
             entry.mac = na_info.tllao; entry.state = na_info.solicited ? NDCacheState::REACHABLE : NDCacheState::STALE;
             entry.timestamp = std::chrono::steady_clock::now(); entry.is_router = na_info.is_router;
@@ -440,6 +512,9 @@ void NDCache::process_neighbor_advertisement(const NAInfo& na_info) {
             }
         }
         if (entry.is_router != na_info.is_router) { entry.is_router = na_info.is_router; }
+        schedule_aging(it->first, entry);
+        // RFC 4861 7.2.5: queued packets go out once the link-layer address is known, REACHABLE or STALE.
+        if (was_incomplete || entry.state == NDCacheState::REACHABLE) { hand_off_pending(it->first, entry); }
     } else {
         if (na_info.tllao != mac_addr_t{} ) {
              add_entry(na_info.target_ip, na_info.tllao, NDCacheState::STALE, DEFAULT_REACHABLE_TIME, na_info.is_router);
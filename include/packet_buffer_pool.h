@@ -0,0 +1,251 @@
+#ifndef PACKET_BUFFER_POOL_HPP
+#define PACKET_BUFFER_POOL_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace cpp_utils {
+
+class PacketBufferPool;
+
+// A FIFO of packets held in PacketBufferPool buffers, e.g. the packets waiting
+// for one neighbor to resolve. Buffers are chained through the pool, so the
+// queue itself is four words and moving it hands every queued packet over in
+// O(1). Packets still queued when the queue is cleared or destroyed go back
+// to the pool and count as discarded. A queue must not outlive its pool while
+// it holds packets; once empty it is tied to no pool and may be used with any.
+class PacketQueue {
+public:
+    PacketQueue() = default;
+    PacketQueue(PacketQueue&& other) noexcept { steal(other); }
+    PacketQueue& operator=(PacketQueue&& other) noexcept {
+        if (this != &other) {
+            clear();
+            steal(other);
+        }
+        return *this;
+    }
+    PacketQueue(const PacketQueue&) = delete;
+    PacketQueue& operator=(const PacketQueue&) = delete;
+    ~PacketQueue() { clear(); }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    // The oldest packet. The queue must not be empty.
+    std::span<const uint8_t> front() const;
+
+    // Removes the oldest packet, counting it as delivered. The queue must not be empty.
+    void pop();
+
+    // Calls fn(std::span<const uint8_t>) for each packet, oldest first, then
+    // returns the buffers to the pool, counting the packets as delivered.
+    template <typename Fn>
+    void drain(Fn&& fn);
+
+    // Returns every buffer to the pool, counting the packets as discarded.
+    void clear();
+
+private:
+    friend class PacketBufferPool;
+    static constexpr uint32_t NIL = UINT32_MAX;
+
+    void steal(PacketQueue& other) {
+        pool_ = std::exchange(other.pool_, nullptr);
+        head_ = std::exchange(other.head_, NIL);
+        tail_ = std::exchange(other.tail_, NIL);
+        size_ = std::exchange(other.size_, 0);
+    }
+
+    PacketBufferPool* pool_ = nullptr;
+    uint32_t head_ = NIL;
+    uint32_t tail_ = NIL;
+    uint32_t size_ = 0;
+};
+
+// A fixed set of equally sized packet buffers shared by any number of
+// PacketQueues, e.g. the pending-packet queues of an ARPCache and an NDCache.
+// Memory is bounded by buffer_count * buffer_size no matter how many
+// neighbors are resolving, and queuing a packet never allocates once the
+// pool's arena exists (it is allocated on first use).
+//
+// Each queue holds at most per_queue_limit packets. A packet arriving at a
+// full queue, or when every buffer is in use, replaces the oldest packet of
+// its own queue; with nothing to replace it is dropped. Every outcome is
+// counted in stats(). The pool is internally locked, so caches owned by
+// different threads may share one.
+class PacketBufferPool {
+public:
+    struct Stats {
+        uint64_t enqueued = 0;               // Packets accepted by enqueue()
+        uint64_t delivered = 0;              // Handed out through pop()/drain()
+        uint64_t discarded = 0;              // Released unsent (entry failed or was removed)
+        uint64_t dropped_queue_full = 0;     // Oldest packet dropped for the per-queue limit
+        uint64_t dropped_pool_exhausted = 0; // Oldest (or the new) packet dropped: no free buffer
+        uint64_t dropped_oversize = 0;       // New packet larger than buffer_size
+        size_t buffers_in_use = 0;
+    };
+
+    explicit PacketBufferPool(size_t buffer_count = 256, size_t buffer_size = 2048, size_t per_queue_limit = 8)
+        : buffer_count_(buffer_count), buffer_size_(buffer_size), per_queue_limit_(per_queue_limit) {
+        if (buffer_count == 0 || buffer_count >= PacketQueue::NIL) {
+            throw std::invalid_argument("PacketBufferPool buffer_count must be in [1, 2^32 - 1).");
+        }
+        if (buffer_size == 0 || per_queue_limit == 0) {
+            throw std::invalid_argument("PacketBufferPool buffer_size and per_queue_limit must be greater than 0.");
+        }
+    }
+
+    PacketBufferPool(const PacketBufferPool&) = delete;
+    PacketBufferPool& operator=(const PacketBufferPool&) = delete;
+
+    // Copies `packet` to the tail of `queue`. Returns false if the new packet
+    // itself was dropped (oversize, or no buffer and nothing of its own to replace).
+    bool enqueue(PacketQueue& queue, std::span<const uint8_t> packet) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (queue.pool_ != nullptr && queue.pool_ != this) {
+            throw std::logic_error("PacketQueue belongs to a different PacketBufferPool.");
+        }
+        if (packet.size() > buffer_size_) {
+            ++stats_.dropped_oversize;
+            return false;
+        }
+        if (!arena_) {
+            allocateArena();
+        }
+        uint32_t buffer;
+        if (queue.size_ >= per_queue_limit_) {
+            buffer = popHead(queue);
+            ++stats_.dropped_queue_full;
+        } else if (free_head_ != PacketQueue::NIL) {
+            buffer = free_head_;
+            free_head_ = next_[buffer];
+            ++stats_.buffers_in_use;
+        } else if (!queue.empty()) {
+            buffer = popHead(queue);
+            ++stats_.dropped_pool_exhausted;
+        } else {
+            ++stats_.dropped_pool_exhausted;
+            return false;
+        }
+        if (!packet.empty()) {
+            std::memcpy(&arena_[static_cast<size_t>(buffer) * buffer_size_], packet.data(), packet.size());
+        }
+        length_[buffer] = static_cast<uint32_t>(packet.size());
+        next_[buffer] = PacketQueue::NIL;
+        if (queue.tail_ == PacketQueue::NIL) {
+            queue.head_ = buffer;
+        } else {
+            next_[queue.tail_] = buffer;
+        }
+        queue.tail_ = buffer;
+        queue.pool_ = this;
+        ++queue.size_;
+        ++stats_.enqueued;
+        return true;
+    }
+
+    Stats stats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stats_;
+    }
+
+    size_t buffer_count() const { return buffer_count_; }
+    size_t buffer_size() const { return buffer_size_; }
+    size_t per_queue_limit() const { return per_queue_limit_; }
+
+private:
+    friend class PacketQueue;
+
+    void allocateArena() {
+        arena_ = std::make_unique<uint8_t[]>(buffer_count_ * buffer_size_);
+        next_.resize(buffer_count_);
+        length_.resize(buffer_count_);
+        for (size_t i = 0; i + 1 < buffer_count_; ++i) {
+            next_[i] = static_cast<uint32_t>(i + 1);
+        }
+        next_[buffer_count_ - 1] = PacketQueue::NIL;
+        free_head_ = 0;
+    }
+
+    // Unlinks the queue's oldest buffer without freeing it. Caller holds the lock.
+    uint32_t popHead(PacketQueue& queue) {
+        const uint32_t buffer = queue.head_;
+        queue.head_ = next_[buffer];
+        if (queue.head_ == PacketQueue::NIL) {
+            queue.tail_ = PacketQueue::NIL;
+        }
+        --queue.size_;
+        return buffer;
+    }
+
+    // Returns the queue's first `count` buffers to the free list; O(1) for
+    // one buffer or the whole queue. Caller does not hold the lock.
+    void release(PacketQueue& queue, uint32_t count, uint64_t Stats::*counter) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        uint32_t last = count == queue.size_ ? queue.tail_ : queue.head_;
+        for (uint32_t i = 1; i < count && last != queue.tail_; ++i) {
+            last = next_[last];
+        }
+        const uint32_t rest = next_[last];
+        next_[last] = free_head_;
+        free_head_ = queue.head_;
+        queue.head_ = rest;
+        queue.size_ -= count;
+        if (rest == PacketQueue::NIL) {
+            queue.tail_ = PacketQueue::NIL;
+            queue.pool_ = nullptr; // Empty: no longer tied to this pool
+        }
+        stats_.buffers_in_use -= count;
+        stats_.*counter += count;
+    }
+
+    std::span<const uint8_t> packet(uint32_t buffer) const {
+        return {&arena_[static_cast<size_t>(buffer) * buffer_size_], length_[buffer]};
+    }
+
+    const size_t buffer_count_;
+    const size_t buffer_size_;
+    const size_t per_queue_limit_;
+    mutable std::mutex mutex_;
+    std::unique_ptr<uint8_t[]> arena_;
+    std::vector<uint32_t> next_;   // Free-list or queue link per buffer
+    std::vector<uint32_t> length_; // Bytes used per buffer
+    uint32_t free_head_ = PacketQueue::NIL;
+    Stats stats_;
+};
+
+// The queue's own buffers are only linked and read by the queue's owner, so
+// reading them does not need the pool lock; only the free list does.
+inline std::span<const uint8_t> PacketQueue::front() const {
+    return pool_->packet(head_);
+}
+
+inline void PacketQueue::pop() {
+    pool_->release(*this, 1, &PacketBufferPool::Stats::delivered);
+}
+
+template <typename Fn>
+void PacketQueue::drain(Fn&& fn) {
+    if (empty()) return;
+    for (uint32_t b = head_; b != NIL; b = pool_->next_[b]) {
+        fn(pool_->packet(b));
+    }
+    pool_->release(*this, size_, &PacketBufferPool::Stats::delivered);
+}
+
+inline void PacketQueue::clear() {
+    if (!empty()) {
+        pool_->release(*this, size_, &PacketBufferPool::Stats::discarded);
+    }
+}
+
+} // namespace cpp_utils
+
+#endif // PACKET_BUFFER_POOL_HPP
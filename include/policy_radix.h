@@ -13,6 +13,7 @@
 #include <optional>   // For std::optional
 #include <iomanip>    // For std::setw
 #include <stdexcept>  // For std::runtime_error
+#include "epoch_rcu.h"
 
 // Forward declaration (if needed by types below, but PolicyRoutingTree itself is now defined earlier)
 // class PolicyRoutingTree;
@@ -69,6 +70,12 @@ struct PacketInfo {
                    protocol(0), tos(0), flowLabel(0) {}
 };
 
+// A packet tagged with the VRF it is to be routed in (batched VRF lookups)
+struct VrfPacketInfo {
+    uint32_t vrfId = 0;
+    PacketInfo packet;
+};
+
 class PolicyRadixNode {
 public:
     std::unique_ptr<PolicyRadixNode> left;   // 0 bit
@@ -77,8 +84,11 @@ public:
     uint32_t prefix;
     uint8_t prefixLen;
     bool isValid;
+    bool hasPolicies;       // Some route here only applies to a subset of the prefix's packets
+    uint32_t fibId;         // Route-set id in the compiled FIB (0 = not installed)
+    uint32_t ecmpWidth;     // Leading active equal-cost routes (the ECMP group when !hasPolicies)
     
-    PolicyRadixNode() : prefix(0), prefixLen(0), isValid(false) {}
+    PolicyRadixNode() : prefix(0), prefixLen(0), isValid(false), hasPolicies(false), fibId(0), ecmpWidth(0) {}
 };
 
 class PolicyRoutingTree {
@@ -86,6 +96,17 @@ private:
     std::unique_ptr<PolicyRadixNode> root;
     // std::unordered_map<uint32_t, std::string> routeTable;  // Removed, not used per new design focus
 
+    // Compiled LPM table: a 16-8-8 multi-bit trie with leaf pushing. Every entry
+    // either names the most specific route set covering that address range
+    // (index + 1 into fibNodes, 0 = no route) or, with FIB_EXT set, the next
+    // 256-entry chunk in fibTbl8. A lookup is one to three table reads.
+    static constexpr uint32_t FIB_EXT = 0x80000000u;
+    static constexpr uint32_t FIB_ROOT_BITS = 16;
+    static constexpr uint32_t FIB_CHUNK = 256;
+    std::vector<uint32_t> fibRoot;                // 2^16 entries, allocated with the first route
+    std::vector<uint32_t> fibTbl8;                // Level 2 and level 3 chunks
+    std::vector<const PolicyRadixNode*> fibNodes; // Route set id - 1 -> trie node
+
     // Enhanced hash function for PacketInfo
     size_t generateFlowHash(const PacketInfo& packet) const {
         size_t seed = 0;
@@ -103,7 +124,22 @@ private:
     }
 
 public:
+    static constexpr size_t BATCH_SIZE = 32; // Packets whose table reads are overlapped in a burst
+
     PolicyRoutingTree() : root(std::make_unique<PolicyRadixNode>()) {}
+
+    // Deep copy: routes are re-added in their stored order, which preserves
+    // tie order, and the compiled table is rebuilt for the copy.
+    PolicyRoutingTree(const PolicyRoutingTree& other) : root(std::make_unique<PolicyRadixNode>()) {
+        forEachValidNode(other.root.get(), [this](const PolicyRadixNode& node) {
+            for (const auto& [policy, attrs] : node.routes) {
+                insertRoute(root.get(), node.prefix, node.prefixLen, 0, policy, attrs);
+            }
+        });
+    }
+    PolicyRoutingTree(PolicyRoutingTree&&) noexcept = default;
+    PolicyRoutingTree& operator=(PolicyRoutingTree&&) noexcept = default;
+    PolicyRoutingTree& operator=(const PolicyRoutingTree&) = delete;
     
     // Convert IP string to uint32_t
     static uint32_t ipStringToInt(const std::string& ip) { // Made static
@@ -141,81 +177,146 @@ public:
         //           << " (priority: " << policy.priority << ")" << '\n'; // Removed cout
     }
     
-    // Lookup with policy-based routing (refined for LPM and policy application)
+    // Lookup with policy-based routing: LPM on the compiled table, then the
+    // policy filter only for prefixes that carry conditional policies. Route
+    // lists are kept in preference order at insert time, so no sort is needed.
     std::vector<std::pair<PolicyRule, RouteAttributes>>
     lookup(const PacketInfo& packet) const { // Made const
-        PolicyRadixNode* currentNode = root.get();
-        PolicyRadixNode* bestMatchNode = nullptr;
+        const PolicyRadixNode* bestMatchNode = longestPrefixMatch(packet.dstIP);
+        if (!bestMatchNode) return {};
+        if (!bestMatchNode->hasPolicies) return bestMatchNode->routes;
+
+        std::vector<std::pair<PolicyRule, RouteAttributes>> validRoutes;
+        for (const auto& route_pair : bestMatchNode->routes) {
+            if (matchesPolicy(packet, route_pair.first)) {
+                validRoutes.push_back(route_pair);
+            }
+        }
+        return validRoutes;
+    }
 
-        // Check root for 0.0.0.0/0 default route if it's valid
-        if (root->isValid && root->prefixLen == 0) {
-            bestMatchNode = root.get();
+    // Most specific node holding routes for dstIP, or nullptr. Allocation-free.
+    const PolicyRadixNode* longestPrefixMatch(uint32_t dstIP) const {
+        if (fibRoot.empty()) return nullptr;
+        uint32_t entry = fibRoot[dstIP >> FIB_ROOT_BITS];
+        if (entry & FIB_EXT) {
+            entry = fibTbl8[fibLevel2Slot(entry, dstIP)];
+            if (entry & FIB_EXT) {
+                entry = fibTbl8[fibLevel3Slot(entry, dstIP)];
+            }
         }
+        return entry ? fibNodes[entry - 1] : nullptr;
+    }
 
-        for (uint8_t depth = 0; depth < 32 && currentNode != nullptr; ++depth) {
-            bool bit = (packet.dstIP >> (31 - depth)) & 1;
-            PolicyRadixNode* nextNode = bit ? currentNode->right.get() : currentNode->left.get();
+    // Bytes held by the compiled LPM table.
+    size_t fibMemoryBytes() const {
+        return (fibRoot.size() + fibTbl8.size()) * sizeof(uint32_t) + fibNodes.size() * sizeof(const PolicyRadixNode*);
+    }
+    
+    // Forwarding fast path. The returned pointers refer to routes stored in the
+    // table and stay valid until the next addRoute on this tree. No allocation.
+    const RouteAttributes* bestRoute(const PacketInfo& packet) const {
+        const PolicyRadixNode* node = longestPrefixMatch(packet.dstIP);
+        if (!node) return nullptr;
+        const size_t first = firstMatchingRoute(*node, packet);
+        return first < node->routes.size() ? &node->routes[first].second : nullptr;
+    }
 
-            if (nextNode == nullptr) break; // Path ends
-            currentNode = nextNode;
+    // Flow-hash pick among the equal-cost best routes (same result as
+    // selectEcmpPathUsingFlowHash), or nullptr if there is none.
+    const RouteAttributes* selectEcmpRoute(const PacketInfo& packet) const {
+        const PolicyRadixNode* node = longestPrefixMatch(packet.dstIP);
+        return node ? selectEcmpRouteAt(node, packet) : nullptr;
+    }
 
-            if (currentNode->isValid) {
-                // Check if this node's prefix matches the packet's destination IP
-                uint32_t mask = (currentNode->prefixLen == 0) ? 0 : (0xFFFFFFFF << (32 - currentNode->prefixLen));
-                if ((packet.dstIP & mask) == (currentNode->prefix & mask)) {
-                    // If this node's prefix is more specific, it becomes the new bestMatchNode
-                    if (bestMatchNode == nullptr || currentNode->prefixLen > bestMatchNode->prefixLen) {
-                        bestMatchNode = currentNode;
-                    }
-                }
-            }
+    // Burst form of selectEcmpRoute: results[i] is the route for *packets[i].
+    // Each table level is read for all packets of a burst before the next,
+    // with the following level prefetched, so the cache misses overlap.
+    void selectEcmpRouteBatch(const PacketInfo* const* packets, size_t count, const RouteAttributes** results) const {
+        if (fibRoot.empty()) {
+            std::fill(results, results + count, nullptr);
+            return;
         }
-        
-        std::vector<std::pair<PolicyRule, RouteAttributes>> lpmRouteCandidates;
-        if (bestMatchNode) {
-            for (const auto& route_pair : bestMatchNode->routes) {
-                lpmRouteCandidates.push_back(route_pair);
+        uint32_t entries[BATCH_SIZE];
+        for (size_t base = 0; base < count; base += BATCH_SIZE) {
+            const size_t n = std::min(BATCH_SIZE, count - base);
+            const PacketInfo* const* burst = packets + base;
+            for (size_t i = 0; i < n; ++i) {
+                prefetchRead(&fibRoot[burst[i]->dstIP >> FIB_ROOT_BITS]);
             }
-        }
-
-        std::vector<std::pair<PolicyRule, RouteAttributes>> validRoutes;
-        if (!lpmRouteCandidates.empty()) {
-            for (const auto& route_pair : lpmRouteCandidates) {
-                if (matchesPolicy(packet, route_pair.first)) {
-                    validRoutes.push_back(route_pair);
-                }
+            for (size_t i = 0; i < n; ++i) {
+                entries[i] = fibRoot[burst[i]->dstIP >> FIB_ROOT_BITS];
+                if (entries[i] & FIB_EXT) prefetchRead(&fibTbl8[fibLevel2Slot(entries[i], burst[i]->dstIP)]);
+            }
+            for (size_t i = 0; i < n; ++i) {
+                if (!(entries[i] & FIB_EXT)) continue;
+                entries[i] = fibTbl8[fibLevel2Slot(entries[i], burst[i]->dstIP)];
+                if (entries[i] & FIB_EXT) prefetchRead(&fibTbl8[fibLevel3Slot(entries[i], burst[i]->dstIP)]);
+            }
+            for (size_t i = 0; i < n; ++i) {
+                if (entries[i] & FIB_EXT) entries[i] = fibTbl8[fibLevel3Slot(entries[i], burst[i]->dstIP)];
+                if (entries[i]) prefetchRead(fibNodes[entries[i] - 1]);
+            }
+            for (size_t i = 0; i < n; ++i) {
+                results[base + i] = entries[i] ? selectEcmpRouteAt(fibNodes[entries[i] - 1], *burst[i]) : nullptr;
             }
         }
+    }
 
-        std::sort(validRoutes.begin(), validRoutes.end(),
-            [](const auto& a, const auto& b) {
-                if (a.first.priority != b.first.priority) {
-                    return a.first.priority < b.first.priority;
-                }
-                const auto& attrsA = a.second;
-                const auto& attrsB = b.second;
-                if (attrsA.adminDistance != attrsB.adminDistance) {
-                    return attrsA.adminDistance < attrsB.adminDistance;
-                }
-                if (attrsA.localPref != attrsB.localPref) {
-                    return attrsA.localPref > attrsB.localPref;
-                }
-                return attrsA.med < attrsB.med;
-            });
-        return validRoutes;
+    // Same as bestRoute; kept for existing callers.
+    const RouteAttributes* findBestRoute(const PacketInfo& packet) const {
+        return bestRoute(packet);
     }
-    
-    RouteAttributes* findBestRoute(const PacketInfo& packet) { // Not const due to static thread_local
-        auto routes = lookup(packet); // lookup is const
-        if (routes.empty()) {
-            return nullptr;
+
+private:
+    const RouteAttributes* selectEcmpRouteAt(const PolicyRadixNode* node, const PacketInfo& packet) const {
+        if (!node->hasPolicies) {
+            // The group is the precomputed leading run of the route list.
+            if (node->ecmpWidth == 0) return nullptr;
+            const size_t pick = node->ecmpWidth == 1 ? 0 : generateFlowHash(packet) % node->ecmpWidth;
+            return &node->routes[pick].second;
         }
-        // The lookup method already sorts routes correctly. The first one is the best.
-        static thread_local RouteAttributes bestRouteCopy;
-        bestRouteCopy = routes[0].second;
-        return &bestRouteCopy;
+        const size_t first = firstMatchingRoute(*node, packet);
+        if (first == node->routes.size()) return nullptr;
+        size_t width = 0;
+        visitEqualCostMembers(*node, first, packet, [&](size_t) { ++width; return true; });
+        if (width == 0) return nullptr;
+        size_t remaining = width == 1 ? 0 : generateFlowHash(packet) % width;
+        const RouteAttributes* selected = nullptr;
+        visitEqualCostMembers(*node, first, packet, [&](size_t i) {
+            if (remaining-- != 0) return true;
+            selected = &node->routes[i].second;
+            return false;
+        });
+        return selected;
+    }
+
+    static size_t fibLevel2Slot(uint32_t entry, uint32_t dstIP) {
+        return (entry & ~FIB_EXT) * FIB_CHUNK + ((dstIP >> 8) & 0xFF);
+    }
+
+    static size_t fibLevel3Slot(uint32_t entry, uint32_t dstIP) {
+        return (entry & ~FIB_EXT) * FIB_CHUNK + (dstIP & 0xFF);
+    }
+
+    static void prefetchRead(const void* addr) {
+#if defined(__GNUC__) || defined(__clang__)
+        __builtin_prefetch(addr, 0, 3);
+#else
+        (void)addr;
+#endif
+    }
+
+    template <typename Visit>
+    static void forEachValidNode(const PolicyRadixNode* node, Visit&& visit) {
+        if (!node) return;
+        if (node->isValid) visit(*node);
+        forEachValidNode(node->left.get(), visit);
+        forEachValidNode(node->right.get(), visit);
     }
 
+public:
+
     void displayRoutes() const { // Made const
         std::cout << "\n=== Policy-Based Routing Table ===" << '\n';
         std::cout << std::left
@@ -319,37 +420,23 @@ public:
     }
     
     std::vector<RouteAttributes> getEqualCostPaths(const PacketInfo& packet) const { // Made const
-        auto sortedValidRoutes = lookup(packet); // lookup is already sorted
         std::vector<RouteAttributes> ecmp;
-
-        if (sortedValidRoutes.empty()) return ecmp;
-
-        const auto& bestRoutePairCriteria = sortedValidRoutes[0];
-
-        for (const auto& currentRoutePair : sortedValidRoutes) {
-            if (currentRoutePair.first.priority == bestRoutePairCriteria.first.priority &&
-                currentRoutePair.second.adminDistance == bestRoutePairCriteria.second.adminDistance &&
-                currentRoutePair.second.localPref == bestRoutePairCriteria.second.localPref &&
-                currentRoutePair.second.med == bestRoutePairCriteria.second.med &&
-                currentRoutePair.second.isActive) {
-                ecmp.push_back(currentRoutePair.second);
-            } else {
-                break;
-            }
-        }
+        const PolicyRadixNode* node = longestPrefixMatch(packet.dstIP);
+        if (!node) return ecmp;
+        const size_t first = firstMatchingRoute(*node, packet);
+        if (first == node->routes.size()) return ecmp;
+        visitEqualCostMembers(*node, first, packet, [&](size_t i) {
+            ecmp.push_back(node->routes[i].second);
+            return true;
+        });
         return ecmp;
     }
 
     // New method as per subtask
     std::optional<RouteAttributes> selectEcmpPathUsingFlowHash(const PacketInfo& packet) const { // Made const
-        std::vector<RouteAttributes> ecmpCandidates = getEqualCostPaths(packet);
-
-        if (ecmpCandidates.empty()) return std::nullopt;
-        if (ecmpCandidates.size() == 1) return ecmpCandidates[0];
-
-        size_t hashVal = generateFlowHash(packet);
-        int selectedIndex = hashVal % ecmpCandidates.size();
-        return ecmpCandidates[selectedIndex];
+        const RouteAttributes* selected = selectEcmpRoute(packet);
+        if (!selected) return std::nullopt;
+        return *selected;
     }
 
 private:
@@ -366,7 +453,22 @@ private:
                 policy.dstPrefix = targetPrefix;
                 policy.dstPrefixLen = targetPrefixLen;
             }
-            node->routes.push_back({policy, attrs});
+            std::pair<PolicyRule, RouteAttributes> entry{policy, attrs};
+            // upper_bound keeps equal-preference routes in insertion order.
+            node->routes.insert(std::upper_bound(node->routes.begin(), node->routes.end(), entry, routePreferred),
+                                std::move(entry));
+            if (!isUnconditional(policy, targetPrefix, targetPrefixLen)) {
+                node->hasPolicies = true;
+            }
+            node->ecmpWidth = 0;
+            while (node->ecmpWidth < node->routes.size() &&
+                   sameCost(node->routes[node->ecmpWidth], node->routes.front()) &&
+                   node->routes[node->ecmpWidth].second.isActive) {
+                ++node->ecmpWidth;
+            }
+            if (node->fibId == 0) {
+                installInFib(node);
+            }
             return;
         }
         
@@ -386,6 +488,119 @@ private:
     }
     
     // Removed findMatchingRoutes as its logic is incorporated into the new lookup method.
+
+    // Route preference: policy priority, then admin distance, local preference (higher wins), MED.
+    static bool routePreferred(const std::pair<PolicyRule, RouteAttributes>& a,
+                               const std::pair<PolicyRule, RouteAttributes>& b) {
+        if (a.first.priority != b.first.priority) {
+            return a.first.priority < b.first.priority;
+        }
+        const auto& attrsA = a.second;
+        const auto& attrsB = b.second;
+        if (attrsA.adminDistance != attrsB.adminDistance) {
+            return attrsA.adminDistance < attrsB.adminDistance;
+        }
+        if (attrsA.localPref != attrsB.localPref) {
+            return attrsA.localPref > attrsB.localPref;
+        }
+        return attrsA.med < attrsB.med;
+    }
+
+    static bool sameCost(const std::pair<PolicyRule, RouteAttributes>& a,
+                         const std::pair<PolicyRule, RouteAttributes>& b) {
+        return a.first.priority == b.first.priority &&
+               a.second.adminDistance == b.second.adminDistance &&
+               a.second.localPref == b.second.localPref &&
+               a.second.med == b.second.med;
+    }
+
+    // Index of the first (best) route whose policy accepts the packet, or routes.size().
+    size_t firstMatchingRoute(const PolicyRadixNode& node, const PacketInfo& packet) const {
+        if (!node.hasPolicies) return 0;
+        for (size_t i = 0; i < node.routes.size(); ++i) {
+            if (matchesPolicy(packet, node.routes[i].first)) return i;
+        }
+        return node.routes.size();
+    }
+
+    // Calls visit(index) for each member of the best equal-cost group, starting
+    // at the best matching route `first`. Routes the packet's policy rejects are
+    // skipped; the group ends at the first cheaper-ranked or inactive route.
+    // visit returns false to stop early.
+    template <typename Visit>
+    void visitEqualCostMembers(const PolicyRadixNode& node, size_t first, const PacketInfo& packet, Visit&& visit) const {
+        const auto& best = node.routes[first];
+        for (size_t i = first; i < node.routes.size(); ++i) {
+            const auto& route = node.routes[i];
+            if (!sameCost(route, best)) break;
+            if (node.hasPolicies && !matchesPolicy(packet, route.first)) continue;
+            if (!route.second.isActive) break;
+            if (!visit(i)) break;
+        }
+    }
+
+    // True if the policy accepts every packet whose destination falls in prefix/prefixLen.
+    static bool isUnconditional(const PolicyRule& policy, uint32_t prefix, uint8_t prefixLen) {
+        if (policy.srcPrefixLen > 0 || policy.srcPort != 0 || policy.dstPort != 0 ||
+            policy.protocol != 0 || policy.tos != 0 || policy.flowLabel != 0) {
+            return false;
+        }
+        if (policy.dstPrefixLen == 0) return true;
+        if (policy.dstPrefixLen > prefixLen) return false;
+        uint32_t mask = (policy.dstPrefixLen >= 32) ? 0xFFFFFFFF : (0xFFFFFFFF << (32 - policy.dstPrefixLen));
+        return (policy.dstPrefix & mask) == (prefix & mask);
+    }
+
+    uint8_t fibDepth(uint32_t entry) const {
+        return fibNodes[entry - 1]->prefixLen;
+    }
+
+    // Points entries [first, first + count) of the root table (inRoot) or of the
+    // chunk at chunkBase at route set `id`, unless a longer prefix already owns
+    // them. Child chunks are descended into so leaf-pushed copies stay in sync.
+    void fillFib(size_t chunkBase, size_t first, size_t count, uint32_t id, uint8_t prefixLen, bool inRoot) {
+        for (size_t i = first; i < first + count; ++i) {
+            uint32_t entry = inRoot ? fibRoot[i] : fibTbl8[chunkBase + i];
+            if (entry & FIB_EXT) {
+                fillFib((entry & ~FIB_EXT) * FIB_CHUNK, 0, FIB_CHUNK, id, prefixLen, false);
+            } else if (entry == 0 || fibDepth(entry) <= prefixLen) {
+                (inRoot ? fibRoot[i] : fibTbl8[chunkBase + i]) = id;
+            }
+        }
+    }
+
+    // Returns `entry` as a chunk reference, allocating a chunk pre-filled with
+    // the route set it used to name if it was a leaf.
+    uint32_t expandFibEntry(uint32_t entry) {
+        if (entry & FIB_EXT) return entry;
+        uint32_t chunk = static_cast<uint32_t>(fibTbl8.size() / FIB_CHUNK);
+        fibTbl8.resize(fibTbl8.size() + FIB_CHUNK, entry);
+        return FIB_EXT | chunk;
+    }
+
+    void installInFib(PolicyRadixNode* node) {
+        if (fibRoot.empty()) fibRoot.assign(size_t{1} << FIB_ROOT_BITS, 0);
+        fibNodes.push_back(node);
+        node->fibId = static_cast<uint32_t>(fibNodes.size());
+
+        const uint32_t prefix = node->prefix;
+        const uint8_t len = node->prefixLen;
+        if (len <= 16) {
+            fillFib(0, prefix >> 16, size_t{1} << (16 - len), node->fibId, len, true);
+            return;
+        }
+        const size_t rootSlot = prefix >> 16;
+        fibRoot[rootSlot] = expandFibEntry(fibRoot[rootSlot]);
+        const size_t level2 = (fibRoot[rootSlot] & ~FIB_EXT) * FIB_CHUNK;
+        if (len <= 24) {
+            fillFib(level2, (prefix >> 8) & 0xFF, size_t{1} << (24 - len), node->fibId, len, false);
+            return;
+        }
+        const size_t level2Slot = level2 + ((prefix >> 8) & 0xFF);
+        const uint32_t level3Entry = expandFibEntry(fibTbl8[level2Slot]);
+        fibTbl8[level2Slot] = level3Entry;
+        fillFib((level3Entry & ~FIB_EXT) * FIB_CHUNK, prefix & 0xFF, size_t{1} << (32 - len), node->fibId, len, false);
+    }
     
     bool matchesPolicy(const PacketInfo& packet, const PolicyRule& policy) const { // Made const
         // Source Prefix Check
@@ -489,10 +704,52 @@ private:
     }
 };
 
+class ConcurrentVrfRoutingTableManager;
+
 class VrfRoutingTableManager {
+    friend class ConcurrentVrfRoutingTableManager;
+
 private:
     std::unordered_map<uint32_t, std::unique_ptr<PolicyRoutingTree>> vrfTables;
 
+    // Splits a burst into per-VRF groups (each VRF's table is resolved once per
+    // burst) and runs each group through PolicyRoutingTree::selectEcmpRouteBatch.
+    // resolveTable(vrfId) returns the VRF's tree or nullptr.
+    template <typename ResolveTable>
+    static void lookupBurst(const VrfPacketInfo* packets, size_t count, ResolveTable&& resolveTable,
+                            const RouteAttributes** results) {
+        constexpr size_t kBurst = PolicyRoutingTree::BATCH_SIZE;
+        const PacketInfo* group[kBurst];
+        size_t groupIndex[kBurst];
+        const RouteAttributes* groupResults[kBurst];
+        bool grouped[kBurst];
+        for (size_t base = 0; base < count; base += kBurst) {
+            const size_t n = std::min(kBurst, count - base);
+            std::fill(grouped, grouped + n, false);
+            for (size_t i = 0; i < n; ++i) {
+                if (grouped[i]) continue;
+                const uint32_t vrfId = packets[base + i].vrfId;
+                size_t groupSize = 0;
+                for (size_t j = i; j < n; ++j) {
+                    if (!grouped[j] && packets[base + j].vrfId == vrfId) {
+                        grouped[j] = true;
+                        groupIndex[groupSize] = base + j;
+                        group[groupSize++] = &packets[base + j].packet;
+                    }
+                }
+                const PolicyRoutingTree* table = resolveTable(vrfId);
+                if (table) {
+                    table->selectEcmpRouteBatch(group, groupSize, groupResults);
+                } else {
+                    std::fill(groupResults, groupResults + groupSize, nullptr);
+                }
+                for (size_t k = 0; k < groupSize; ++k) {
+                    results[groupIndex[k]] = groupResults[k];
+                }
+            }
+        }
+    }
+
     PolicyRoutingTree* getVrfTable(uint32_t vrfId, bool createIfNotFound = true) {
         auto it = vrfTables.find(vrfId);
         if (it != vrfTables.end()) {
@@ -537,6 +794,13 @@ public:
         return std::nullopt;
     }
 
+    // Batched flow-hash ECMP selection for packets from any mix of VRFs.
+    // results[i] points at the route stored for packets[i] (nullptr if the VRF
+    // or a matching route is missing) and stays valid until routes change.
+    void lookupBatch(const VrfPacketInfo* packets, size_t count, const RouteAttributes** results) const {
+        lookupBurst(packets, count, [this](uint32_t vrfId) { return getVrfTable(vrfId, false); }, results);
+    }
+
     void displayRoutes(uint32_t vrfId) const {
         const PolicyRoutingTree* table = getVrfTable(vrfId, false);
         if (table) {
@@ -576,5 +840,94 @@ public:
     }
 };
 
-// This content is now moved to the top of the file.
-// Ensure VrfRoutingTableManager is defined AFTER PolicyRoutingTree and other necessary types.
+// VRF routing tables that worker threads can query while routes change.
+//
+// Each published generation maps VRF ids to immutable trees and is held in a
+// concurrent::rcu_ptr (see epoch_rcu.h). Readers pin a generation for the
+// duration of one call; writers copy only the trees they modify, share the
+// rest with the previous generation, and publish the new map. Route updates
+// are serialized and wait for a grace period, so batch them with updateRoutes.
+class ConcurrentVrfRoutingTableManager {
+public:
+    using Reader = concurrent::epoch_domain::reader;
+    using VrfTables = std::unordered_map<uint32_t, std::shared_ptr<const PolicyRoutingTree>>;
+
+    struct RouteUpdate {
+        uint32_t vrfId = 0;
+        std::string prefix;
+        uint8_t prefixLen = 0;
+        PolicyRule policy;
+        RouteAttributes attrs;
+    };
+
+    explicit ConcurrentVrfRoutingTableManager(size_t maxReaders = concurrent::epoch_domain::default_max_readers)
+        : current_(std::make_unique<VrfTables>(), maxReaders) {}
+
+    // One per reader thread; throws std::runtime_error once maxReaders are registered.
+    Reader registerReader() { return current_.register_reader(); }
+
+    std::optional<RouteAttributes> selectEcmpPathUsingFlowHash(Reader& reader, uint32_t vrfId,
+                                                               const PacketInfo& packet) const {
+        auto snapshot = current_.read(reader);
+        const PolicyRoutingTree* table = findTable(*snapshot, vrfId);
+        const RouteAttributes* selected = table ? table->selectEcmpRoute(packet) : nullptr;
+        if (!selected) return std::nullopt;
+        return *selected;
+    }
+
+    // Batched lookup against one pinned generation. consume(i, route) is called
+    // for every packet in order, with route == nullptr when nothing matches; the
+    // route pointer must not be kept after consume returns.
+    template <typename Consume>
+    void lookupBatch(Reader& reader, const VrfPacketInfo* packets, size_t count, Consume&& consume) const {
+        auto snapshot = current_.read(reader);
+        const VrfTables& tables = *snapshot;
+        const RouteAttributes* results[PolicyRoutingTree::BATCH_SIZE];
+        for (size_t base = 0; base < count; base += PolicyRoutingTree::BATCH_SIZE) {
+            const size_t n = std::min(PolicyRoutingTree::BATCH_SIZE, count - base);
+            VrfRoutingTableManager::lookupBurst(
+                packets + base, n, [&tables](uint32_t vrfId) { return findTable(tables, vrfId); }, results);
+            for (size_t i = 0; i < n; ++i) {
+                consume(base + i, results[i]);
+            }
+        }
+    }
+
+    void addRoute(uint32_t vrfId, const std::string& prefixStr, uint8_t prefixLen,
+                  PolicyRule policy, const RouteAttributes& attrs) {
+        updateRoutes({RouteUpdate{vrfId, prefixStr, prefixLen, policy, attrs}});
+    }
+
+    // Applies all updates and publishes them as one generation. If a prefix
+    // string is invalid, std::runtime_error propagates and nothing is published.
+    // Must not be called from a thread that holds a pinned reader.
+    void updateRoutes(const std::vector<RouteUpdate>& updates) {
+        current_.update([&updates](const VrfTables* current) {
+            auto next = current ? std::make_unique<VrfTables>(*current) : std::make_unique<VrfTables>();
+            std::unordered_map<uint32_t, std::unique_ptr<PolicyRoutingTree>> modified;
+            for (const auto& update : updates) {
+                auto& table = modified[update.vrfId];
+                if (!table) {
+                    auto it = next->find(update.vrfId);
+                    table = (it != next->end()) ? std::make_unique<PolicyRoutingTree>(*it->second)
+                                                : std::make_unique<PolicyRoutingTree>();
+                }
+                table->addRoute(update.prefix, update.prefixLen, update.policy, update.attrs);
+            }
+            for (auto& [vrfId, table] : modified) {
+                (*next)[vrfId] = std::move(table);
+            }
+            return next;
+        });
+    }
+
+    uint64_t generation() const { return current_.generation(); }
+
+private:
+    static const PolicyRoutingTree* findTable(const VrfTables& tables, uint32_t vrfId) {
+        auto it = tables.find(vrfId);
+        return it != tables.end() ? it->second.get() : nullptr;
+    }
+
+    concurrent::rcu_ptr<VrfTables> current_;
+};
@@ -0,0 +1,634 @@
+#ifndef REGEX_DFA_HPP
+#define REGEX_DFA_HPP
+
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace cpp_utils {
+
+// A deterministic automaton compiled from a set of simple ECMAScript regular
+// expressions, matched in one pass over the input whatever the number of
+// patterns: one table lookup per byte.
+//
+// parse() accepts the regular subset of ECMAScript: literals and escapes,
+// '.', bracket classes, \d \w \s (and negations), groups, '|', and the
+// quantifiers * + ? {n} {n,} {n,m} (lazy or not; it makes no difference to
+// whether something matches). '^' and '$' are accepted at the start and end
+// of a top-level alternative. Anything else (backreferences, lookaround, \b,
+// POSIX classes, ...) makes parse() return nullopt, so the caller can keep
+// std::regex for that pattern. Bytes are matched as the "C" locale would:
+// icase folds ASCII letters only.
+//
+// A MATCH pattern must match the whole input (std::regex_match); a SEARCH
+// pattern may match anywhere in it (std::regex_search).
+class RegexDfa {
+public:
+    static constexpr size_t DEFAULT_MAX_STATES = 4096;
+
+    // A parsed pattern, ready for compile(). `id` is reported by for_each_match().
+    struct Pattern {
+        struct Node {
+            enum class Kind : uint8_t { Empty, Set, Concat, Alt, Repeat };
+            Kind kind = Kind::Empty;
+            std::bitset<256> set;       // Kind::Set
+            std::vector<Node> children; // Concat/Alt: operands; Repeat: one child
+            uint32_t min = 0, max = 0;  // Kind::Repeat; max == UNBOUNDED for * and +
+        };
+        struct Branch {
+            Node root;
+            bool anchored_start = false;
+            bool anchored_end = false;
+        };
+        static constexpr uint32_t UNBOUNDED = UINT32_MAX;
+
+        std::vector<Branch> branches; // Top-level alternatives
+        bool search = false;
+        uint32_t id = 0;
+    };
+
+    // Parses `pattern`, or returns nullopt if it uses a construct outside the supported subset.
+    static std::optional<Pattern> parse(std::string_view pattern, bool search, bool icase = false, uint32_t id = 0) {
+        Parser parser{pattern, icase};
+        std::optional<Pattern> result = parser.parsePattern();
+        if (result) {
+            result->search = search;
+            result->id = id;
+        }
+        return result;
+    }
+
+    // Builds one automaton for all `patterns`. Returns nullopt if it would need
+    // more than `max_states` states; splitting the set usually helps.
+    //
+    // With report_all false the automaton only answers matches(): it stops as
+    // soon as a SEARCH pattern has matched, and is correspondingly smaller.
+    // With report_all true, for_each_match() reports every matching id.
+    static std::optional<RegexDfa> compile(std::span<const Pattern> patterns, size_t max_states = DEFAULT_MAX_STATES,
+                                           bool report_all = false) {
+        Nfa nfa;
+        for (const Pattern& pattern : patterns) {
+            nfa.add(pattern, report_all);
+        }
+        if (nfa.states.size() > MAX_NFA_STATES) {
+            return std::nullopt;
+        }
+        return determinize(nfa, max_states, report_all);
+    }
+
+    // True if any pattern matches `text`.
+    bool matches(std::string_view text) const noexcept {
+        uint32_t s = start_;
+        if (flags_[s] & STICKY) return true;
+        for (const char ch : text) {
+            s = next_[s * class_count_ + classes_[static_cast<uint8_t>(ch)]];
+            if (flags_[s] & (STICKY | DEAD)) return (flags_[s] & STICKY) != 0;
+        }
+        return (flags_[s] & ACCEPT) != 0;
+    }
+
+    // Calls fn(id) once for each pattern that matches `text`. Requires report_all.
+    template <typename Fn>
+    void for_each_match(std::string_view text, Fn&& fn) const {
+        uint32_t s = start_;
+        for (const char ch : text) {
+            s = next_[s * class_count_ + classes_[static_cast<uint8_t>(ch)]];
+            if (flags_[s] & DEAD) return;
+        }
+        for (uint32_t i = accept_begin_[s]; i < accept_begin_[s + 1]; ++i) {
+            fn(accept_ids_[i]);
+        }
+    }
+
+    size_t state_count() const noexcept { return flags_.size(); }
+    size_t class_count() const noexcept { return class_count_; }
+
+private:
+    static constexpr size_t MAX_NFA_STATES = 1u << 20;
+    static constexpr size_t MAX_PATTERN_SIZE = 10000; // Byte-consuming states of one pattern, after expanding {n,m}
+    static constexpr uint32_t MAX_REPEAT = 1000;
+    static constexpr uint8_t ACCEPT = 1; // Some pattern matches if the input ends here
+    static constexpr uint8_t STICKY = 2; // A SEARCH pattern has matched; the rest of the input is irrelevant
+    static constexpr uint8_t DEAD = 4;   // Nothing can match any more
+
+    using Node = Pattern::Node;
+
+    class Parser {
+    public:
+        Parser(std::string_view p, bool icase) : p_(p), icase_(icase) {}
+
+        std::optional<Pattern> parsePattern() {
+            Pattern pattern;
+            do {
+                Pattern::Branch branch;
+                if (peek('^')) {
+                    ++i_;
+                    branch.anchored_start = true;
+                }
+                branch.root = parseConcat();
+                if (peek('$')) {
+                    ++i_;
+                    branch.anchored_end = true;
+                    if (!atEnd() && !peek('|')) ok_ = false;
+                }
+                pattern.branches.push_back(std::move(branch));
+            } while (ok_ && accept('|'));
+            if (!ok_ || !atEnd() || size_ > MAX_PATTERN_SIZE) {
+                return std::nullopt;
+            }
+            return pattern;
+        }
+
+    private:
+        bool atEnd() const { return i_ >= p_.size(); }
+        bool peek(char c) const { return !atEnd() && p_[i_] == c; }
+        bool accept(char c) {
+            if (!peek(c)) return false;
+            ++i_;
+            return true;
+        }
+
+        Node parseAlt() {
+            Node alt;
+            alt.kind = Node::Kind::Alt;
+            do {
+                alt.children.push_back(parseConcat());
+            } while (ok_ && accept('|'));
+            return alt.children.size() == 1 ? std::move(alt.children.front()) : std::move(alt);
+        }
+
+        Node parseConcat() {
+            Node concat;
+            concat.kind = Node::Kind::Concat;
+            while (ok_ && !atEnd() && !peek('|') && !peek(')') && !peek('$')) {
+                Node atom = parseAtom();
+                if (ok_ && !atEnd() && isQuantifier(p_[i_])) {
+                    atom = parseQuantifier(std::move(atom));
+                    if (ok_ && !atEnd() && isQuantifier(p_[i_])) ok_ = false;
+                }
+                concat.children.push_back(std::move(atom));
+            }
+            if (concat.children.empty()) return Node{};
+            return concat.children.size() == 1 ? std::move(concat.children.front()) : std::move(concat);
+        }
+
+        static bool isQuantifier(char c) { return c == '*' || c == '+' || c == '?' || c == '{'; }
+
+        Node parseAtom() {
+            const char c = p_[i_++];
+            switch (c) {
+            case '(': {
+                if (accept('?') && !accept(':')) break; // Lookahead
+                if (++depth_ > 256) break;
+                Node inner = parseAlt();
+                --depth_;
+                if (!accept(')')) break;
+                return inner;
+            }
+            case '[':
+                return parseClass();
+            case '.': {
+                std::bitset<256> any;
+                any.set();
+                any.reset('\n');
+                any.reset('\r');
+                return setNode(any);
+            }
+            case '\\': {
+                std::bitset<256> set;
+                if (!parseEscape(set)) break;
+                return setNode(fold(set));
+            }
+            case '^': case '*': case '+': case '?': case '{': case '}': case ']': case ')':
+                break;
+            default: {
+                std::bitset<256> set;
+                set.set(static_cast<uint8_t>(c));
+                return setNode(fold(set));
+            }
+            }
+            ok_ = false;
+            return Node{};
+        }
+
+        Node parseQuantifier(Node atom) {
+            uint32_t min = 0;
+            uint32_t max = Pattern::UNBOUNDED;
+            const char c = p_[i_++];
+            if (c == '+') {
+                min = 1;
+            } else if (c == '?') {
+                max = 1;
+            } else if (c == '{') {
+                if (!parseCount(min)) return atom;
+                if (accept(',')) {
+                    if (!peek('}') && !parseCount(max)) return atom;
+                } else {
+                    max = min;
+                }
+                if (!accept('}') || min > max) {
+                    ok_ = false;
+                    return atom;
+                }
+            }
+            accept('?'); // Lazy: same language
+            Node repeat;
+            repeat.kind = Node::Kind::Repeat;
+            repeat.min = min;
+            repeat.max = max;
+            const size_t copies = max == Pattern::UNBOUNDED ? size_t{min} + 1 : size_t{max};
+            size_ += (copies == 0 ? 0 : copies - 1) * count(atom);
+            repeat.children.push_back(std::move(atom));
+            return repeat;
+        }
+
+        bool parseCount(uint32_t& out) {
+            size_t digits = 0;
+            uint32_t value = 0;
+            while (!atEnd() && p_[i_] >= '0' && p_[i_] <= '9' && value <= MAX_REPEAT) {
+                value = value * 10 + static_cast<uint32_t>(p_[i_++] - '0');
+                ++digits;
+            }
+            if (digits == 0 || value > MAX_REPEAT) {
+                ok_ = false;
+                return false;
+            }
+            out = value;
+            return true;
+        }
+
+        Node parseClass() {
+            const bool negate = accept('^');
+            std::bitset<256> set;
+            if (peek(']')) { // "[]" and "[^]" are special in ECMAScript
+                ok_ = false;
+                return Node{};
+            }
+            while (ok_ && !atEnd() && !peek(']')) {
+                std::bitset<256> item;
+                int lo = classChar(item);
+                if (lo >= 0 && peek('-') && i_ + 1 < p_.size() && p_[i_ + 1] != ']') {
+                    ++i_;
+                    std::bitset<256> ignored;
+                    const int hi = classChar(ignored);
+                    if (hi < lo) {
+                        ok_ = false;
+                        break;
+                    }
+                    for (int b = lo; b <= hi; ++b) item.set(static_cast<size_t>(b));
+                }
+                set |= item;
+            }
+            if (!accept(']')) ok_ = false;
+            set = fold(set);
+            if (negate) set.flip();
+            return setNode(set);
+        }
+
+        // One class item into `set`. Returns its byte, or -1 for a multi-byte class like \d.
+        int classChar(std::bitset<256>& set) {
+            const char c = p_[i_++];
+            if (c == '\\') {
+                if (!parseEscape(set)) return -1;
+                return set.count() == 1 ? static_cast<int>(firstByte(set)) : -1;
+            }
+            if (c == '[' && !atEnd() && (p_[i_] == ':' || p_[i_] == '.' || p_[i_] == '=')) {
+                ok_ = false; // POSIX class, collating element or equivalence class
+                return -1;
+            }
+            set.set(static_cast<uint8_t>(c));
+            return static_cast<uint8_t>(c);
+        }
+
+        bool parseEscape(std::bitset<256>& set) {
+            if (atEnd()) return ok_ = false;
+            const char c = p_[i_++];
+            auto range = [&](char lo, char hi) {
+                for (int b = static_cast<uint8_t>(lo); b <= static_cast<uint8_t>(hi); ++b) set.set(static_cast<size_t>(b));
+            };
+            switch (c) {
+            case 'd': case 'D':
+                range('0', '9');
+                break;
+            case 'w': case 'W':
+                range('0', '9');
+                range('A', 'Z');
+                range('a', 'z');
+                set.set('_');
+                break;
+            case 's': case 'S':
+                range('\t', '\r');
+                set.set(' ');
+                break;
+            case 't': set.set('\t'); return true;
+            case 'n': set.set('\n'); return true;
+            case 'r': set.set('\r'); return true;
+            case 'f': set.set('\f'); return true;
+            case 'v': set.set('\v'); return true;
+            case '0':
+                if (!atEnd() && p_[i_] >= '0' && p_[i_] <= '9') return ok_ = false;
+                set.set(0);
+                return true;
+            case 'x': {
+                int value = 0;
+                for (int k = 0; k < 2; ++k) {
+                    const int digit = atEnd() ? -1 : hexDigit(p_[i_]);
+                    if (digit < 0) return ok_ = false;
+                    value = value * 16 + digit;
+                    ++i_;
+                }
+                set.set(static_cast<size_t>(value));
+                return true;
+            }
+            default:
+                // Identity escapes of punctuation; \b, backreferences, \c, \u, ... are not supported
+                if ((c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z')) return ok_ = false;
+                set.set(static_cast<uint8_t>(c));
+                return true;
+            }
+            if (c >= 'A' && c <= 'Z') set.flip(); // \D, \W, \S
+            return true;
+        }
+
+        static int hexDigit(char c) {
+            if (c >= '0' && c <= '9') return c - '0';
+            if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+            if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+            return -1;
+        }
+
+        static size_t firstByte(const std::bitset<256>& set) {
+            size_t b = 0;
+            while (!set.test(b)) ++b;
+            return b;
+        }
+
+        std::bitset<256> fold(std::bitset<256> set) const {
+            if (!icase_) return set;
+            for (size_t c = 'a'; c <= 'z'; ++c) {
+                if (set.test(c) || set.test(c - 32)) {
+                    set.set(c);
+                    set.set(c - 32);
+                }
+            }
+            return set;
+        }
+
+        Node setNode(const std::bitset<256>& set) {
+            ++size_;
+            Node node;
+            node.kind = Node::Kind::Set;
+            node.set = set;
+            return node;
+        }
+
+        static size_t count(const Node& node) {
+            if (node.kind == Node::Kind::Set) return 1;
+            size_t total = 0;
+            for (const Node& child : node.children) total += count(child);
+            if (node.kind == Node::Kind::Repeat) {
+                const size_t copies = node.max == Pattern::UNBOUNDED ? size_t{node.min} + 1 : size_t{node.max};
+                total *= std::max<size_t>(copies, 1);
+            }
+            return std::min(total, MAX_PATTERN_SIZE + 1);
+        }
+
+        std::string_view p_;
+        bool icase_;
+        size_t i_ = 0;
+        size_t depth_ = 0;
+        size_t size_ = 0; // Byte-consuming NFA states the pattern expands to
+        bool ok_ = true;
+    };
+
+    // Thompson NFA. A state either consumes one byte of `set` and moves to
+    // `out`, or has only epsilon moves.
+    struct Nfa {
+        static constexpr uint32_t NONE = UINT32_MAX;
+        struct State {
+            std::bitset<256> set;
+            uint32_t out = NONE;
+            std::vector<uint32_t> eps;
+            bool accept = false;
+            bool sticky = false;
+            uint32_t id = 0;
+        };
+
+        std::vector<State> states{State{}}; // states[0] is the start
+
+        uint32_t newState() {
+            states.emplace_back();
+            return static_cast<uint32_t>(states.size() - 1);
+        }
+
+        void add(const Pattern& pattern, bool report_all) {
+            for (const Pattern::Branch& branch : pattern.branches) {
+                uint32_t from = newState();
+                states[0].eps.push_back(from);
+                if (pattern.search && !branch.anchored_start) {
+                    from = anyLoop(from);
+                }
+                const uint32_t to = build(branch.root, from);
+                if (states.size() > MAX_NFA_STATES) return;
+                uint32_t accept_state = to;
+                if (pattern.search && !branch.anchored_end) {
+                    accept_state = newState();
+                    states[to].eps.push_back(accept_state);
+                    states[accept_state].sticky = true;
+                    if (report_all) { // Stay accepted through the rest of the input
+                        const uint32_t any = newState();
+                        states[accept_state].eps.push_back(any);
+                        states[any].set.set();
+                        states[any].out = accept_state;
+                    }
+                }
+                states[accept_state].accept = true;
+                states[accept_state].id = pattern.id;
+            }
+        }
+
+        // A state that loops on every byte. Returns it.
+        uint32_t anyLoop(uint32_t from) {
+            const uint32_t loop = newState();
+            const uint32_t any = newState();
+            states[from].eps.push_back(loop);
+            states[loop].eps.push_back(any);
+            states[any].set.set();
+            states[any].out = loop;
+            return loop;
+        }
+
+        // Appends `node` after state `from`; returns the state reached after it.
+        uint32_t build(const Node& node, uint32_t from) {
+            if (states.size() > MAX_NFA_STATES) return from;
+            switch (node.kind) {
+            case Node::Kind::Empty:
+                return from;
+            case Node::Kind::Set: {
+                const uint32_t s = newState();
+                const uint32_t t = newState();
+                states[from].eps.push_back(s);
+                states[s].set = node.set;
+                states[s].out = t;
+                return t;
+            }
+            case Node::Kind::Concat:
+                for (const Node& child : node.children) from = build(child, from);
+                return from;
+            case Node::Kind::Alt: {
+                const uint32_t join = newState();
+                for (const Node& child : node.children) {
+                    const uint32_t end = build(child, from);
+                    states[end].eps.push_back(join);
+                }
+                return join;
+            }
+            case Node::Kind::Repeat: {
+                const Node& child = node.children.front();
+                for (uint32_t k = 0; k < node.min; ++k) from = build(child, from);
+                if (node.max == Pattern::UNBOUNDED) {
+                    const uint32_t loop = newState();
+                    states[from].eps.push_back(loop);
+                    const uint32_t end = build(child, loop);
+                    states[end].eps.push_back(loop);
+                    return loop;
+                }
+                for (uint32_t k = node.min; k < node.max; ++k) {
+                    const uint32_t end = build(child, from);
+                    const uint32_t join = newState();
+                    states[from].eps.push_back(join);
+                    states[end].eps.push_back(join);
+                    from = join;
+                }
+                return from;
+            }
+            }
+            return from;
+        }
+    };
+
+    // Subset construction over byte classes: bytes that every NFA set treats
+    // alike share a column of the transition table.
+    static std::optional<RegexDfa> determinize(const Nfa& nfa, size_t max_states, bool report_all) {
+        RegexDfa dfa;
+        dfa.class_count_ = computeClasses(nfa, dfa.classes_);
+        std::vector<uint8_t> representative(dfa.class_count_);
+        for (size_t b = 256; b-- > 0;) representative[dfa.classes_[b]] = static_cast<uint8_t>(b);
+
+        std::vector<uint32_t> mark(nfa.states.size(), 0);
+        uint32_t stamp = 0;
+        std::vector<uint32_t> stack;
+        auto closure = [&](std::vector<uint32_t>& set) {
+            ++stamp;
+            stack = set;
+            set.clear();
+            while (!stack.empty()) {
+                const uint32_t s = stack.back();
+                stack.pop_back();
+                if (mark[s] == stamp) continue;
+                mark[s] = stamp;
+                set.push_back(s);
+                for (uint32_t e : nfa.states[s].eps) {
+                    if (mark[e] != stamp) stack.push_back(e);
+                }
+            }
+            std::sort(set.begin(), set.end());
+        };
+
+        std::map<std::vector<uint32_t>, uint32_t> ids;
+        std::vector<std::vector<uint32_t>> sets;
+        auto intern = [&](std::vector<uint32_t>&& set) -> std::optional<uint32_t> {
+            auto it = ids.find(set);
+            if (it != ids.end()) return it->second;
+            if (sets.size() >= max_states) return std::nullopt;
+            const uint32_t id = static_cast<uint32_t>(sets.size());
+            ids.emplace(set, id);
+            sets.push_back(std::move(set));
+            dfa.next_.resize(sets.size() * dfa.class_count_, 0);
+            return id;
+        };
+
+        intern({}); // State 0: dead
+        std::vector<uint32_t> start{0};
+        closure(start);
+        dfa.start_ = *intern(std::move(start));
+
+        dfa.accept_begin_.push_back(0);
+        std::vector<uint32_t> targets;
+        for (uint32_t d = 0; d < sets.size(); ++d) {
+            uint8_t flags = d == 0 ? DEAD : 0;
+            const size_t accepts_before = dfa.accept_ids_.size();
+            for (uint32_t s : sets[d]) {
+                const Nfa::State& state = nfa.states[s];
+                if (state.accept) {
+                    flags |= state.sticky ? STICKY | ACCEPT : ACCEPT;
+                    dfa.accept_ids_.push_back(state.id);
+                }
+            }
+            std::sort(dfa.accept_ids_.begin() + static_cast<std::ptrdiff_t>(accepts_before), dfa.accept_ids_.end());
+            dfa.accept_ids_.erase(std::unique(dfa.accept_ids_.begin() + static_cast<std::ptrdiff_t>(accepts_before),
+                                              dfa.accept_ids_.end()),
+                                  dfa.accept_ids_.end());
+            dfa.accept_begin_.push_back(static_cast<uint32_t>(dfa.accept_ids_.size()));
+            if (report_all) flags &= static_cast<uint8_t>(~STICKY); // Keep walking to collect every id
+            dfa.flags_.push_back(flags);
+            if (d == 0 || (flags & STICKY)) continue; // Terminal: the matcher stops here
+
+            for (size_t c = 0; c < dfa.class_count_; ++c) {
+                targets.clear();
+                for (uint32_t s : sets[d]) {
+                    const Nfa::State& state = nfa.states[s];
+                    if (state.out != Nfa::NONE && state.set.test(representative[c])) targets.push_back(state.out);
+                }
+                closure(targets);
+                const std::optional<uint32_t> to = intern(std::move(targets));
+                if (!to) return std::nullopt;
+                dfa.next_[d * dfa.class_count_ + c] = *to;
+                targets = {};
+            }
+        }
+        return dfa;
+    }
+
+    // Partitions the byte values so that every NFA set is a union of classes.
+    static size_t computeClasses(const Nfa& nfa, std::array<uint16_t, 256>& classes) {
+        classes.fill(0);
+        size_t count = 1;
+        std::unordered_set<std::bitset<256>> seen;
+        for (const Nfa::State& state : nfa.states) {
+            if (state.out == Nfa::NONE || state.set.all() || !seen.insert(state.set).second) continue;
+            // Split every class into its members inside and outside the set.
+            std::array<int, 512> remap;
+            remap.fill(-1);
+            size_t next = 0;
+            for (size_t b = 0; b < 256; ++b) {
+                const size_t key = classes[b] * 2 + (state.set.test(b) ? 1 : 0);
+                if (remap[key] < 0) remap[key] = static_cast<int>(next++);
+                classes[b] = static_cast<uint16_t>(remap[key]);
+            }
+            count = next;
+            if (count == 256) break;
+        }
+        return count;
+    }
+
+    std::array<uint16_t, 256> classes_{};
+    size_t class_count_ = 1;
+    uint32_t start_ = 0;
+    std::vector<uint32_t> next_;         // state * class_count_ + class -> state
+    std::vector<uint8_t> flags_;         // ACCEPT / STICKY / DEAD per state
+    std::vector<uint32_t> accept_begin_; // accept_ids_[accept_begin_[s], accept_begin_[s + 1]) for state s
+    std::vector<uint32_t> accept_ids_;
+};
+
+} // namespace cpp_utils
+
+#endif // REGEX_DFA_HPP
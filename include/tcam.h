@@ -6,7 +6,9 @@
 #include <cctype>  // For std::isspace
 #include <sstream> // For std::stringstream
 #include <unordered_map>
-#include <bitset>
+#include <new>         // For std::align_val_t (cache-line aligned bitmap rows)
+#include <cstddef>     // For std::byte (rule arena storage)
+#include <cstring>     // For std::memcpy, std::memmove
 #include <memory>
 #include <algorithm>
 #include <immintrin.h> // For SIMD operations
@@ -20,10 +22,26 @@
 #include <cmath>       // For std::log2, std::round
 #include <numeric>     // For std::iota, already present but good to note for specificity parts
 #include <optional>    // For std::optional
+#include <bit>         // For std::popcount, std::countr_zero
+#include <span>        // For std::span (zero-copy packet views)
+#include "epoch_rcu.h"  // For ConcurrentTCAM generation publishing
 // <chrono> is already included higher up, but ensure it's there for this change.
 // #include <chrono> // Not strictly needed here if already present globally
 
+// The batch classifier compiles AVX2/AVX-512 kernels with per-function target
+// attributes and picks one at runtime via CPUID, so the header does not need to
+// be built with -mavx2. Other compilers/architectures use the scalar kernel.
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define TCAM_X86_BATCH_DISPATCH 1
+#else
+#define TCAM_X86_BATCH_DISPATCH 0
+#endif
+
+class ConcurrentTCAM;
+
 class OptimizedTCAM {
+    friend class ConcurrentTCAM;
+
 public: // For RuleStats and RuleUtilizationMetrics
     struct RuleStats {
         uint64_t rule_id;
@@ -106,8 +124,16 @@ public: // For RuleOperation and RuleUpdateBatch
 
     using RuleUpdateBatch = std::vector<RuleOperation>;
 
+public: // Batch classifier kernel selection
+    enum class BatchKernel {
+        SCALAR,
+        AVX2,   // 8 packets per compare
+        AVX512  // 16 packets per compare
+    };
+
 public:
     // Note: This method is not thread-safe if other operations modify rules or port_ranges concurrently.
+    // Use ConcurrentTCAM when lookups must keep running during updates.
     bool update_rules_atomic(const RuleUpdateBatch& batch) {
         std::vector<Rule> temp_rules = this->rules;
         std::vector<RangeEntry> temp_port_ranges = this->port_ranges;
@@ -241,7 +267,16 @@ public:
     }
 
 public:
+    // Indices (as get_all_rule_stats lists rules) of active rules that an
+    // earlier rule with the same action fully covers.
     std::vector<size_t> detect_redundant_rules() const {
+        std::vector<size_t> indices = redundant_rule_slots();
+        for (size_t& idx : indices) idx = rule_index_of_slot(idx);
+        return indices;
+    }
+
+private:
+    std::vector<size_t> redundant_rule_slots() const {
         std::vector<size_t> redundant_rule_indices;
         // Assumes rules are sorted by priority/specificity.
         // And also that is_active flags are current.
@@ -266,8 +301,9 @@ public:
         return redundant_rule_indices;
     }
 
+public:
     void compact_redundant_rules(bool trigger_rebuild = false) {
-        std::vector<size_t> redundant_indices = detect_redundant_rules();
+        std::vector<size_t> redundant_indices = redundant_rule_slots();
 
         if (redundant_indices.empty()) {
             return;
@@ -275,7 +311,7 @@ public:
 
         for (size_t idx : redundant_indices) {
             if (idx < rules.size()) { // Boundary check, though indices should be valid
-                rules[idx].is_active = false;
+                deactivate_rule_at(idx);
             }
         }
 
@@ -289,6 +325,7 @@ public:
         size_t total_rules_in_vector = 0;
         size_t active_rules_count = 0;
         size_t inactive_rules_count = 0;
+        size_t vacant_slots = 0; // Spare positions in the vector, not counted above
 
         size_t rules_vector_capacity_bytes = 0;
         size_t rules_vector_size_bytes = 0; // Memory for the Rule objects themselves in the vector
@@ -302,12 +339,16 @@ public:
         size_t decision_tree_nodes_count = 0;
         size_t decision_tree_approx_bytes = 0;
 
+        size_t rule_arena_bytes = 0; // Match-time copy of keys, masks, ports, priorities, actions
+        size_t frozen_tree_bytes = 0; // Flat node array and rule pool, when frozen
+
         size_t total_approx_bytes = 0;
     };
 
     MemoryUsageStats get_memory_usage_stats() const {
         MemoryUsageStats stats;
-        stats.total_rules_in_vector = rules.size();
+        stats.total_rules_in_vector = rules.size() - maintenance.vacant_slots;
+        stats.vacant_slots = maintenance.vacant_slots;
         for(const auto& rule : rules) {
             if (rule.is_active) {
                 stats.active_rules_count++;
@@ -316,33 +357,73 @@ public:
         stats.inactive_rules_count = stats.total_rules_in_vector - stats.active_rules_count;
 
         stats.rules_vector_capacity_bytes = rules.capacity() * sizeof(Rule);
-        stats.rules_vector_size_bytes = rules.size() * sizeof(Rule); // Does not include heap data per rule (like vectors in Rule)
+        stats.rules_vector_size_bytes = rules.size() * sizeof(Rule); // Keys and masks are stored inline in Rule
 
         stats.port_ranges_capacity_bytes = port_ranges.capacity() * sizeof(RangeEntry);
         stats.port_ranges_size_bytes = port_ranges.size() * sizeof(RangeEntry);
 
         stats.field_bitmaps_count = field_bitmaps.size();
-        // field_bitmaps stores BitmapTCAM objects directly.
         stats.field_bitmaps_approx_bytes = field_bitmaps.size() * sizeof(BitmapTCAM);
+        for (const auto& bitmap : field_bitmaps) {
+            stats.field_bitmaps_approx_bytes += bitmap.memory_bytes();
+        }
 
         stats.decision_tree_nodes_count = count_decision_tree_nodes_recursive(decision_tree.get());
         // decision_tree_nodes are heap allocated via unique_ptr.
         stats.decision_tree_approx_bytes = stats.decision_tree_nodes_count * sizeof(DecisionNode);
 
-        // Note: sizeof(Rule) doesn't account for std::vector<uint8_t> value and mask data if stored on heap.
+        stats.rule_arena_bytes = rule_arena.memory_bytes();
+        stats.frozen_tree_bytes = flat_tree.capacity() * sizeof(FlatDecisionNode) +
+                                  flat_tree_rules.capacity() * sizeof(int32_t);
+
         // This calculation is an approximation of the main structures.
         stats.total_approx_bytes = stats.rules_vector_size_bytes +
                                    stats.port_ranges_size_bytes +
                                    stats.field_bitmaps_approx_bytes +
-                                   stats.decision_tree_approx_bytes;
+                                   stats.decision_tree_approx_bytes +
+                                   stats.rule_arena_bytes +
+                                   stats.frozen_tree_bytes;
         return stats;
     }
 
+    // Bookkeeping for incremental maintenance. Counters other than full_rebuilds
+    // reset whenever the structures are rebuilt from scratch.
+    struct MaintenanceStats {
+        size_t incremental_inserts = 0; // rules patched into the structures in place
+        size_t subtree_rebuilds = 0;    // overfull decision-tree leaves re-split locally
+        size_t inactive_rules = 0;      // soft-deleted rules still occupying a position
+        size_t vacant_slots = 0;        // spare positions left for inserts
+        size_t shifted_rules = 0;       // rules moved one position to make room for inserts
+        size_t full_rebuilds = 0;
+    };
+
 private:
     // --- Struct Definitions ---
+    // Key or mask bytes stored inline in the Rule: no heap allocation per rule,
+    // with the small vector-style interface the rule-building code relies on.
+    struct RuleKeyBytes {
+        static constexpr size_t CAPACITY = 16;
+        std::array<uint8_t, CAPACITY> bytes{};
+        uint8_t length = 0;
+
+        void resize(size_t n) {
+            n = std::min(n, CAPACITY);
+            if (n > length) std::fill(bytes.begin() + length, bytes.begin() + n, uint8_t{0});
+            length = static_cast<uint8_t>(n);
+        }
+        size_t size() const { return length; }
+        bool empty() const { return length == 0; }
+        uint8_t* data() { return bytes.data(); }
+        const uint8_t* data() const { return bytes.data(); }
+        uint8_t& operator[](size_t i) { return bytes[i]; }
+        const uint8_t& operator[](size_t i) const { return bytes[i]; }
+        const uint8_t* begin() const { return bytes.data(); }
+        const uint8_t* end() const { return bytes.data() + length; }
+    };
+
     struct Rule {
-        std::vector<uint8_t> value;
-        std::vector<uint8_t> mask;
+        RuleKeyBytes value;
+        RuleKeyBytes mask;
         int priority;
         int action;
         uint32_t src_port_range_id;
@@ -365,54 +446,438 @@ private:
         uint8_t mask;       // Mask to use for test (if field_offset != -1)
         std::unique_ptr<DecisionNode> left, right;
         std::vector<int> rule_indices; // Rules stored at this node (leaf or wildcarded rules)
+        uint32_t flat_index = UINT32_MAX; // This node's slot in flat_tree, while frozen
+    };
+
+    // Decision tree compiled by freeze(): nodes in breadth-first order in one
+    // array, 16 bytes each (four per cache line). Children are allocated as an
+    // adjacent pair at first_child / first_child + 1, and each node's rule
+    // indices are a [rules_begin, rules_begin + rules_count) slice of one shared
+    // pool, so a lookup walks two flat arrays without chasing pointers. Updates
+    // while frozen patch nodes in place and append new nodes and slices.
+    struct FlatDecisionNode {
+        static constexpr uint8_t HAS_LEFT = 0x1;
+        static constexpr uint8_t HAS_RIGHT = 0x2;
+        int8_t field_offset;   // -1 for leaf
+        uint8_t test_value;
+        uint8_t mask;
+        uint8_t child_flags;
+        uint32_t first_child;
+        uint32_t rules_begin;
+        uint32_t rules_count;
     };
+    static_assert(sizeof(FlatDecisionNode) == 16, "FlatDecisionNode should pack four to a cache line");
     
+    // Bit-vector engine for one key byte. Row b (0..255) has bit i set iff rule i
+    // accepts packet byte b in this field; WILDCARD_ROW has bit i set iff rule i
+    // does not care about the field (used when the packet is too short). Rows are
+    // sized to the rule count and padded to whole cache lines. Each row also has
+    // a summary with one bit per 64-bit word, set iff that word is non-zero, so a
+    // lookup can AND the summaries and skip words that cannot hold a match.
     struct BitmapTCAM {
-        static constexpr size_t MAX_RULES = 1024;
-        std::array<std::bitset<MAX_RULES>, 256> value_bitmaps;
-        std::array<std::bitset<MAX_RULES>, 256> mask_bitmaps;
+        static constexpr size_t ROWS = 257;
+        static constexpr size_t WILDCARD_ROW = 256;
+        static constexpr size_t WORDS_PER_CACHE_LINE = 8;
+
         size_t num_rules = 0;
-        
+        size_t word_count = 0;    // 64-bit words holding rule bits, per row
+        size_t word_stride = 0;   // word_count rounded up to whole cache lines
+        size_t summary_count = 0; // 64-bit summary words, per row
+
+        void reset(size_t rule_count) {
+            num_rules = rule_count;
+            word_count = (rule_count + 63) / 64;
+            word_stride = (word_count + WORDS_PER_CACHE_LINE - 1) / WORDS_PER_CACHE_LINE * WORDS_PER_CACHE_LINE;
+            summary_count = (word_count + 63) / 64;
+            const size_t total_words = ROWS * word_stride;
+            if (total_words == 0) {
+                words.reset();
+            } else {
+                words.reset(static_cast<uint64_t*>(::operator new[](total_words * sizeof(uint64_t), std::align_val_t{64})));
+                std::fill(words.get(), words.get() + total_words, uint64_t{0});
+            }
+            summary.assign(ROWS * summary_count, 0);
+        }
+
+        // Sets rule_idx in every row whose byte satisfies (b & mask) == (value & mask),
+        // enumerating the don't-care bits instead of all 256 rows.
         void add_rule(size_t rule_idx, uint8_t value_byte, uint8_t mask_byte) {
-            if (rule_idx < MAX_RULES) {
-                value_bitmaps[value_byte].set(rule_idx);
-                mask_bitmaps[mask_byte].set(rule_idx);
-                num_rules = std::max(num_rules, rule_idx + 1);
+            if (rule_idx >= num_rules) return;
+            const uint64_t bit = uint64_t{1} << (rule_idx % 64);
+            const size_t word_idx = rule_idx / 64;
+            const unsigned base = value_byte & mask_byte;
+            const unsigned free_bits = static_cast<uint8_t>(~mask_byte);
+            unsigned sub = free_bits;
+            while (true) {
+                words[(base | sub) * word_stride + word_idx] |= bit;
+                if (sub == 0) break;
+                sub = (sub - 1) & free_bits;
+            }
+            if (mask_byte == 0x00) {
+                words[WILDCARD_ROW * word_stride + word_idx] |= bit;
             }
         }
-        
-        std::bitset<MAX_RULES> lookup(uint8_t packet_byte) const {
-            std::bitset<MAX_RULES> result_matches;
-            for (int val_int = 0; val_int < 256; ++val_int) {
-                for (int mask_int = 0; mask_int < 256; ++mask_int) {
-                    uint8_t rule_field_value = static_cast<uint8_t>(val_int);
-                    uint8_t rule_field_mask = static_cast<uint8_t>(mask_int);
-                    std::bitset<MAX_RULES> rules_with_this_val_mask = value_bitmaps[rule_field_value] & mask_bitmaps[rule_field_mask];
-                    if (rules_with_this_val_mask.any()) {
-                        if ((packet_byte & rule_field_mask) == (rule_field_value & rule_field_mask)) {
-                            result_matches |= rules_with_this_val_mask;
-                        }
-                    }
+
+        // Recomputes the summary rows; call after the last add_rule.
+        void finalize() { refresh_summary(0); }
+
+        // Sets rule_idx's bits in a built bitmap; the slot must be clear.
+        void set_rule(size_t rule_idx, uint8_t value_byte, uint8_t mask_byte) {
+            add_rule(rule_idx, value_byte, mask_byte);
+            refresh_summary(rule_idx / 64, rule_idx / 64 + 1);
+        }
+
+        // Adds an empty column at the end; rows grow when the padding runs out.
+        void append_slot() {
+            const size_t new_word_count = (num_rules + 1 + 63) / 64;
+            if (new_word_count > word_stride) {
+                grow(new_word_count);
+            }
+            num_rules++;
+            word_count = new_word_count;
+            refresh_summary(word_count - 1);
+        }
+
+        // Moves the columns of rules [first, last) up one position into the
+        // clear slot `last`, leaving `first` clear. Only the words spanning the
+        // range, and their summary bits, are rewritten.
+        void shift_up(size_t first, size_t last) {
+            if (first >= last || last >= num_rules) return;
+            const size_t first_word = first / 64;
+            const size_t last_word = last / 64;
+            for (size_t r = 0; r < ROWS; ++r) {
+                uint64_t* w = words.get() + r * word_stride;
+                for (size_t i = last_word + 1; i-- > first_word;) {
+                    const uint64_t moved = (w[i] << 1) | (i > first_word ? w[i - 1] >> 63 : 0);
+                    const uint64_t m = range_mask(i, first + 1, last + 1);
+                    w[i] = (w[i] & ~m) | (moved & m);
+                }
+                w[first_word] &= ~(uint64_t{1} << (first % 64));
+            }
+            refresh_summary(first_word, last_word + 1);
+        }
+
+        // Moves the columns of rules [first, last) down one position into the
+        // clear slot first - 1, leaving last - 1 clear.
+        void shift_down(size_t first, size_t last) {
+            if (first == 0 || first >= last || last > num_rules) return;
+            const size_t first_word = (first - 1) / 64;
+            const size_t last_word = (last - 1) / 64;
+            for (size_t r = 0; r < ROWS; ++r) {
+                uint64_t* w = words.get() + r * word_stride;
+                for (size_t i = first_word; i <= last_word; ++i) {
+                    const uint64_t moved = (w[i] >> 1) | (i < last_word ? w[i + 1] << 63 : 0);
+                    const uint64_t m = range_mask(i, first - 1, last - 1);
+                    w[i] = (w[i] & ~m) | (moved & m);
                 }
+                w[last_word] &= ~(uint64_t{1} << ((last - 1) % 64));
             }
-            std::bitset<MAX_RULES> final_valid_matches;
-            if (num_rules > 0) {
-                for (size_t i = 0; i < num_rules; ++i) {
-                    if (i < MAX_RULES && result_matches[i]) {
-                        final_valid_matches.set(i);
+            refresh_summary(first_word, last_word + 1);
+        }
+
+        // Clears rule_idx from every row so lookups stop visiting it.
+        void clear_rule(size_t rule_idx) {
+            if (rule_idx >= num_rules) return;
+            const size_t word_idx = rule_idx / 64;
+            const uint64_t keep = ~(uint64_t{1} << (rule_idx % 64));
+            for (size_t r = 0; r < ROWS; ++r) {
+                words[r * word_stride + word_idx] &= keep;
+            }
+            refresh_summary(word_idx, word_idx + 1);
+        }
+
+        const uint64_t* row(size_t r) const { return words.get() + r * word_stride; }
+        const uint64_t* summary_row(size_t r) const { return summary.data() + r * summary_count; }
+
+        size_t row_popcount(size_t r) const {
+            size_t count = 0;
+            for (size_t w = 0; w < word_count; ++w) count += static_cast<size_t>(std::popcount(row(r)[w]));
+            return count;
+        }
+
+        size_t memory_bytes() const {
+            return ROWS * word_stride * sizeof(uint64_t) + summary.capacity() * sizeof(uint64_t);
+        }
+
+    private:
+        // Bits of word w whose rule index lies in [begin, end).
+        static uint64_t range_mask(size_t w, size_t begin, size_t end) {
+            const size_t lo = std::max(begin, w * 64);
+            const size_t hi = std::min(end, w * 64 + 64);
+            if (lo >= hi) return 0;
+            const uint64_t upto = hi - w * 64 == 64 ? ~uint64_t{0} : (uint64_t{1} << (hi - w * 64)) - 1;
+            return upto & ~((uint64_t{1} << (lo - w * 64)) - 1);
+        }
+
+        // Re-derives summary bits for words [first_word, last_word).
+        void refresh_summary(size_t first_word, size_t last_word = std::numeric_limits<size_t>::max()) {
+            const size_t needed = (word_count + 63) / 64;
+            if (needed != summary_count || summary.size() != ROWS * needed) {
+                summary_count = needed;
+                summary.assign(ROWS * summary_count, 0);
+                first_word = 0;
+                last_word = word_count;
+            }
+            last_word = std::min(last_word, word_count);
+            for (size_t r = 0; r < ROWS; ++r) {
+                const uint64_t* row_words = row(r);
+                uint64_t* row_summary = summary.data() + r * summary_count;
+                for (size_t w = first_word; w < last_word; ++w) {
+                    const uint64_t bit = uint64_t{1} << (w % 64);
+                    if (row_words[w] != 0) {
+                        row_summary[w / 64] |= bit;
+                    } else {
+                        row_summary[w / 64] &= ~bit;
                     }
                 }
             }
-            return final_valid_matches;
         }
+
+        // Doubles the row stride (at least to min_words, in whole cache lines),
+        // keeping existing bits and zeroing the new padding.
+        void grow(size_t min_words) {
+            size_t new_stride = std::max(word_stride * 2, min_words);
+            new_stride = (new_stride + WORDS_PER_CACHE_LINE - 1) / WORDS_PER_CACHE_LINE * WORDS_PER_CACHE_LINE;
+            const size_t total_words = ROWS * new_stride;
+            std::unique_ptr<uint64_t[], AlignedWordsDeleter> grown(
+                static_cast<uint64_t*>(::operator new[](total_words * sizeof(uint64_t), std::align_val_t{64})));
+            std::fill(grown.get(), grown.get() + total_words, uint64_t{0});
+            for (size_t r = 0; r < ROWS && words; ++r) {
+                std::copy(words.get() + r * word_stride, words.get() + r * word_stride + word_count,
+                          grown.get() + r * new_stride);
+            }
+            words = std::move(grown);
+            word_stride = new_stride;
+        }
+
+        struct AlignedWordsDeleter {
+            void operator()(uint64_t* p) const { ::operator delete[](p, std::align_val_t{64}); }
+        };
+        std::unique_ptr<uint64_t[], AlignedWordsDeleter> words;
+        std::vector<uint64_t> summary;
     };
-    
+    static constexpr size_t MAX_BITMAP_FIELDS = 16;
+
+    // One bit per position in `rules`, kept the same length as it.
+    struct SlotBits {
+        static constexpr size_t NONE = std::numeric_limits<size_t>::max();
+        std::vector<uint64_t> words;
+        size_t size = 0;
+
+        void assign(size_t n) {
+            words.assign((n + 63) / 64, 0);
+            size = n;
+        }
+        void push_back(bool bit) {
+            if (size % 64 == 0) words.push_back(0);
+            size++;
+            if (bit) set(size - 1);
+        }
+        void set(size_t i) { words[i / 64] |= uint64_t{1} << (i % 64); }
+        void reset(size_t i) { words[i / 64] &= ~(uint64_t{1} << (i % 64)); }
+
+        // First set bit at or after i, or NONE.
+        size_t next_set(size_t i) const {
+            for (size_t w = i / 64; i < size; w++, i = w * 64) {
+                const uint64_t bits = words[w] >> (i % 64);
+                if (bits != 0) return i + static_cast<size_t>(std::countr_zero(bits));
+            }
+            return NONE;
+        }
+
+        // Last set bit before i, or NONE.
+        size_t prev_set(size_t i) const {
+            i = std::min(i, size);
+            while (i > 0) {
+                const size_t w = (i - 1) / 64;
+                const size_t bits_in_word = i - w * 64;
+                uint64_t bits = words[w];
+                if (bits_in_word < 64) bits &= (uint64_t{1} << bits_in_word) - 1;
+                if (bits != 0) return w * 64 + 63 - static_cast<size_t>(std::countl_zero(bits));
+                i = w * 64;
+            }
+            return NONE;
+        }
+
+        // Number of set bits before i.
+        size_t count_before(size_t i) const {
+            i = std::min(i, size);
+            size_t count = 0;
+            for (size_t w = 0; w < i / 64; ++w) count += static_cast<size_t>(std::popcount(words[w]));
+            if (i % 64 != 0) count += static_cast<size_t>(std::popcount(words[i / 64] & ((uint64_t{1} << (i % 64)) - 1)));
+            return count;
+        }
+    };
+
+    // Match-time view of every rule in one cache-line-aligned allocation, kept
+    // parallel to `rules` (index i here is always index i in `rules`). Each
+    // column is a fixed-stride array starting on a cache line:
+    //   values/masks - the 15 key bytes as four big-endian words (values pre-masked)
+    //   ports        - inclusive port bounds (0..0xFFFF when the rule has no range)
+    //   priorities, actions, active
+    // Linear scans, bitmap verification and the batch kernels stream through
+    // these columns instead of touching the Rule objects.
+    class RuleArena {
+    public:
+        static constexpr size_t KEY_WORDS = 4;
+        struct KeyWords { uint32_t w[KEY_WORDS]; };
+        struct PortBounds { int32_t src_min, src_max, dst_min, dst_max; };
+
+        RuleArena() = default;
+        RuleArena(RuleArena&& other) noexcept
+            : block_(std::move(other.block_)),
+              count_(std::exchange(other.count_, 0)),
+              capacity_(std::exchange(other.capacity_, 0)) {}
+        RuleArena& operator=(RuleArena&& other) noexcept {
+            block_ = std::move(other.block_);
+            count_ = std::exchange(other.count_, 0);
+            capacity_ = std::exchange(other.capacity_, 0);
+            return *this;
+        }
+
+        size_t size() const { return count_; }
+        size_t memory_bytes() const { return capacity_ * BYTES_PER_ENTRY; }
+
+        void clear() { count_ = 0; }
+
+        // New entries are zeroed (inactive).
+        void resize(size_t n) {
+            reserve(n);
+            if (n > count_) {
+                for_each_column([&](std::byte* col, size_t stride) {
+                    std::fill(col + count_ * stride, col + n * stride, std::byte{0});
+                });
+            }
+            count_ = n;
+        }
+
+        // Moves entries [from, from + count) to [to, to + count); the ranges may overlap.
+        void move_entries(size_t from, size_t to, size_t count) {
+            if (count == 0 || std::max(from, to) + count > count_) return;
+            for_each_column([&](std::byte* col, size_t stride) {
+                std::memmove(col + to * stride, col + from * stride, count * stride);
+            });
+        }
+
+        KeyWords* values() { return column<KeyWords>(VALUES_OFFSET); }
+        KeyWords* masks() { return column<KeyWords>(MASKS_OFFSET); }
+        PortBounds* ports() { return column<PortBounds>(PORTS_OFFSET); }
+        int32_t* priorities() { return column<int32_t>(PRIORITIES_OFFSET); }
+        int32_t* actions() { return column<int32_t>(ACTIONS_OFFSET); }
+        uint8_t* active() { return column<uint8_t>(ACTIVE_OFFSET); }
+        const KeyWords* values() const { return column<KeyWords>(VALUES_OFFSET); }
+        const KeyWords* masks() const { return column<KeyWords>(MASKS_OFFSET); }
+        const PortBounds* ports() const { return column<PortBounds>(PORTS_OFFSET); }
+        const int32_t* priorities() const { return column<int32_t>(PRIORITIES_OFFSET); }
+        const int32_t* actions() const { return column<int32_t>(ACTIONS_OFFSET); }
+        const uint8_t* active() const { return column<uint8_t>(ACTIVE_OFFSET); }
+
+    private:
+        // Column offsets, in bytes per entry of capacity. Capacity is a multiple
+        // of CAPACITY_GRANULE entries, so every column starts on a cache line.
+        static constexpr size_t VALUES_OFFSET = 0;
+        static constexpr size_t MASKS_OFFSET = VALUES_OFFSET + sizeof(KeyWords);
+        static constexpr size_t PORTS_OFFSET = MASKS_OFFSET + sizeof(KeyWords);
+        static constexpr size_t PRIORITIES_OFFSET = PORTS_OFFSET + sizeof(PortBounds);
+        static constexpr size_t ACTIONS_OFFSET = PRIORITIES_OFFSET + sizeof(int32_t);
+        static constexpr size_t ACTIVE_OFFSET = ACTIONS_OFFSET + sizeof(int32_t);
+        static constexpr size_t BYTES_PER_ENTRY = ACTIVE_OFFSET + sizeof(uint8_t);
+        static constexpr size_t CAPACITY_GRANULE = 64;
+
+        template <typename T>
+        T* column(size_t offset_per_entry) const {
+            return reinterpret_cast<T*>(block_.get() + offset_per_entry * capacity_);
+        }
+
+        // Calls fn(column_start, element_size) for every column.
+        template <typename Fn>
+        void for_each_column(Fn&& fn) {
+            fn(block_.get() + VALUES_OFFSET * capacity_, sizeof(KeyWords));
+            fn(block_.get() + MASKS_OFFSET * capacity_, sizeof(KeyWords));
+            fn(block_.get() + PORTS_OFFSET * capacity_, sizeof(PortBounds));
+            fn(block_.get() + PRIORITIES_OFFSET * capacity_, sizeof(int32_t));
+            fn(block_.get() + ACTIONS_OFFSET * capacity_, sizeof(int32_t));
+            fn(block_.get() + ACTIVE_OFFSET * capacity_, sizeof(uint8_t));
+        }
+
+        void reserve(size_t n) {
+            if (n <= capacity_) return;
+            size_t new_capacity = std::max(capacity_ * 2, n);
+            new_capacity = (new_capacity + CAPACITY_GRANULE - 1) / CAPACITY_GRANULE * CAPACITY_GRANULE;
+            std::unique_ptr<std::byte[], AlignedBlockDeleter> grown(static_cast<std::byte*>(
+                ::operator new[](new_capacity * BYTES_PER_ENTRY, std::align_val_t{64})));
+            if (block_) {
+                const size_t offsets[] = {VALUES_OFFSET, MASKS_OFFSET, PORTS_OFFSET,
+                                          PRIORITIES_OFFSET, ACTIONS_OFFSET, ACTIVE_OFFSET};
+                const size_t next[] = {MASKS_OFFSET, PORTS_OFFSET, PRIORITIES_OFFSET,
+                                       ACTIONS_OFFSET, ACTIVE_OFFSET, BYTES_PER_ENTRY};
+                for (size_t c = 0; c < 6; ++c) {
+                    const size_t stride = next[c] - offsets[c];
+                    std::memcpy(grown.get() + offsets[c] * new_capacity,
+                                block_.get() + offsets[c] * capacity_, count_ * stride);
+                }
+            }
+            block_ = std::move(grown);
+            capacity_ = new_capacity;
+        }
+
+        struct AlignedBlockDeleter {
+            void operator()(std::byte* p) const { ::operator delete[](p, std::align_val_t{64}); }
+        };
+        std::unique_ptr<std::byte[], AlignedBlockDeleter> block_;
+        size_t count_ = 0;
+        size_t capacity_ = 0;
+    };
+
+    // A packet's key in RuleArena layout; only built for packets that cover the
+    // whole 15-byte key.
+    struct PacketKey {
+        uint32_t w[RuleArena::KEY_WORDS];
+        int32_t src_port, dst_port;
+    };
+
+    // A block of up to BATCH_LANES packets transposed into field-major order:
+    // words[w][lane] holds key word w of packet `lane`.
+    static constexpr size_t BATCH_LANES = 16;
+    static constexpr size_t BATCH_KEY_BYTES = 15;
+    struct alignas(64) PacketBlock {
+        uint32_t words[RuleArena::KEY_WORDS][BATCH_LANES];
+    };
+
     // --- Member Variable Declarations ---
     std::vector<Rule> rules;
     std::vector<RangeEntry> port_ranges;
     std::unique_ptr<DecisionNode> decision_tree;
+    std::vector<FlatDecisionNode> flat_tree;   // Only maintained while frozen
+    std::vector<int32_t> flat_tree_rules;
+    size_t flat_tree_garbage = 0;              // Pool entries left behind by patched slices
+    bool frozen = false;
     std::vector<BitmapTCAM> field_bitmaps;
+    RuleArena rule_arena;
+    BatchKernel batch_kernel = best_supported_batch_kernel();
     uint64_t next_rule_id = 0;
+    MaintenanceStats maintenance;
+    bool auto_rebalance = true;
+
+    // Positions in `rules` an insert may take: free_slots marks vacant slots and
+    // soft-deleted rules, vacant_slots only the vacant ones. A vacant slot is a
+    // placeholder that repeats its predecessor's sort key (so `rules` stays
+    // sorted) and never shows up in the public API.
+    SlotBits free_slots;
+    SlotBits vacant_slots;
+    static constexpr uint64_t VACANT_RULE_ID = std::numeric_limits<uint64_t>::max();
+    // Full rebuilds leave one vacant slot after every RULE_SLACK_INTERVAL rules,
+    // so an insert only moves the rules between its position and the nearest
+    // free slot.
+    static constexpr size_t RULE_SLACK_INTERVAL = 16;
+
+    // Decision tree shape. Leaves that grow past TREE_LEAF_SPLIT_THRESHOLD through
+    // incremental inserts are re-split in place (retried each time they double).
+    static constexpr int TREE_LEAF_RULE_THRESHOLD = 4;
+    static constexpr int TREE_MAX_DEPTH = 8;
+    static constexpr size_t TREE_LEAF_SPLIT_THRESHOLD = 16;
+    // Incremental updates tolerated before needs_rebalance() asks for a full rebuild.
+    static constexpr size_t REBALANCE_MIN_UPDATES = 64;
 
     // --- Helper Methods that depend on struct definitions and member variables ---
     static void normalize_rule_fields(Rule& rule) {
@@ -495,9 +960,9 @@ private:
                 const auto& r = rules[rule_idx];
                 if (r.mask.size() <= static_cast<size_t>(field_off) || r.value.size() <= static_cast<size_t>(field_off)) continue;
 
-                if (r.mask[field_off] == 0x00) {
+                if (r.mask[field_off] != 0xFF) {
                     current_node_rules_test.push_back(rule_idx);
-                } else if (r.mask[field_off] == 0xFF && r.value[field_off] == current_test_val) {
+                } else if (r.value[field_off] == current_test_val) {
                     left_children_rules.push_back(rule_idx);
                 } else {
                     right_children_rules.push_back(rule_idx);
@@ -547,9 +1012,11 @@ private:
             const auto& r = rules[rule_idx];
             if (r.mask.size() <= static_cast<size_t>(best_field_offset) || r.value.size() <= static_cast<size_t>(best_field_offset)) continue;
 
-            if (r.mask[best_field_offset] == 0x00) {
+            // Only exact bytes can be routed by an equality test; anything the rule
+            // leaves (partly) unspecified may match on either side, so it stays here.
+            if (r.mask[best_field_offset] != best_mask_for_split) {
                 node->rule_indices.push_back(rule_idx);
-            } else if (r.mask[best_field_offset] == best_mask_for_split && r.value[best_field_offset] == best_test_value) {
+            } else if (r.value[best_field_offset] == best_test_value) {
                 final_left_indices.push_back(rule_idx);
             } else {
                 final_right_indices.push_back(rule_idx);
@@ -628,10 +1095,7 @@ public: // This public keyword is just to mark where the next section starts in
 
         normalize_rule_fields(rule_obj); // Normalize before insertion logic
 
-        // 1. Remove inactive rules first
-        rules.erase(std::remove_if(rules.begin(), rules.end(), [](const Rule& r){ return !r.is_active; }), rules.end());
-
-        // 2. Define comparator
+        // 1. Define comparator
         auto rule_comparator = [this](const Rule& a, const Rule& b) {
             if (a.priority != b.priority) {
                 return a.priority > b.priority; // Higher priority comes first
@@ -641,38 +1105,114 @@ public: // This public keyword is just to mark where the next section starts in
                    this->calculate_specificity(b, this->port_ranges);
         };
 
-        // 3. Find insertion point in the now active and sorted (or soon to be fully sorted) list
+        // 2. Find the insertion point. Soft-deleted rules and vacant slots keep
+        //    sort keys that fit their positions, so the search can run over them.
         auto it = std::lower_bound(rules.begin(), rules.end(), rule_obj, rule_comparator);
+        const size_t pos = static_cast<size_t>(it - rules.begin());
 
-        // 4. Insert the new rule
-        rules.insert(it, rule_obj);
+        // 3. Place the new rule and patch the lookup structures around it; the
+        //    first rule (or one added to stale structures) triggers a full build.
+        if (field_bitmaps.empty() || !rule_arena_in_sync()) {
+            rules.insert(it, rule_obj);
+            rebuild_optimized_structures_from_sorted_rules();
+        } else {
+            insert_rule_into_optimized_structures(pos, std::move(rule_obj));
+        }
 
-        // 5. Rebuild structures from (now active and sorted) rules
-        // No need to call the full rebuild_optimized_structures, as rules are already active and sorted.
-        // However, the full rebuild_optimized_structures first filters and sorts, which is what we've manually done.
-        // So we call a new method that skips filtering and sorting.
-        rebuild_optimized_structures_from_sorted_rules();
+        // 4. Compact and rebuild once the incremental patches have degraded the structures enough
+        if (auto_rebalance && needs_rebalance()) {
+            rebuild_optimized_structures();
+        }
     }
     
+    // Classifies packets in blocks of BATCH_LANES using the selected batch kernel.
+    // Results (actions, -1 for no match) and per-rule hit stats are identical to
+    // calling lookup_single on each packet. Packets shorter than the 15-byte key
+    // are classified individually via lookup_single.
     void lookup_batch(const std::vector<std::vector<uint8_t>>& packets, std::vector<int>& results) {
         results.resize(packets.size());
-        #ifdef __AVX2__
-        size_t num_batches = packets.size() / 8;
-        for (size_t batch_idx = 0; batch_idx < num_batches; ++batch_idx) {
-            lookup_simd_avx2(&packets[batch_idx * 8], &results[batch_idx * 8]);
-        }
-        for (size_t i = num_batches * 8; i < packets.size(); ++i) {
-            results[i] = lookup_single(packets[i]);
-        }
-        #else
-        for (size_t i = 0; i < packets.size(); ++i) {
-            results[i] = lookup_single(packets[i]);
+        lookup_batch_impl<true>(packets.size(),
+                          [&packets](size_t i) { return std::span<const uint8_t>(packets[i]); },
+                          results.data());
+    }
+
+    // Zero-copy batch lookup over packet headers that live elsewhere (e.g. a DMA
+    // receive ring). headers[i] must point at header_len readable bytes; results
+    // must hold `count` entries. Nothing is allocated per packet.
+    void lookup_batch(const uint8_t* const* headers, size_t count, size_t header_len, int* results) {
+        lookup_batch_impl<true>(count,
+                          [headers, header_len](size_t i) { return std::span<const uint8_t>(headers[i], header_len); },
+                          results);
+    }
+
+    // As above, for headers laid out at a fixed stride from `base` (slot i starts
+    // at base + i * stride).
+    void lookup_batch_strided(const uint8_t* base, size_t stride, size_t count, size_t header_len, int* results) {
+        lookup_batch_impl<true>(count,
+                          [base, stride, header_len](size_t i) { return std::span<const uint8_t>(base + i * stride, header_len); },
+                          results);
+    }
+
+    // Side-effect-free lookups: same result as lookup_single / lookup_batch, but
+    // no hit counts, timestamps or latency statistics are recorded. Any number
+    // of threads may call these concurrently as long as nobody modifies the
+    // TCAM (see ConcurrentTCAM).
+    int classify(std::span<const uint8_t> packet) const {
+        int idx;
+        if (frozen && !flat_tree.empty()) {
+            idx = lookup_frozen_slot(packet);
+        } else if (rules.size() < 16 || field_bitmaps.empty()) {
+            idx = lookup_linear_slot(packet);
+        } else {
+            idx = lookup_bitmap_slot(packet);
         }
-        #endif
+        return idx == -1 ? -1 : rules[static_cast<size_t>(idx)].action;
+    }
+
+    void classify_batch(const uint8_t* const* headers, size_t count, size_t header_len, int* results) const {
+        lookup_batch_impl<false>(count,
+                                 [headers, header_len](size_t i) { return std::span<const uint8_t>(headers[i], header_len); },
+                                 results);
+    }
+
+    BatchKernel get_batch_kernel() const { return batch_kernel; }
+
+    // Selects the kernel used by lookup_batch. Requests for an instruction set the
+    // CPU does not support fall back to the best supported one; the kernel that
+    // was actually selected is returned.
+    BatchKernel set_batch_kernel(BatchKernel requested) {
+        const BatchKernel best = best_supported_batch_kernel();
+        batch_kernel = (static_cast<int>(requested) <= static_cast<int>(best)) ? requested : best;
+        return batch_kernel;
+    }
+
+    static BatchKernel best_supported_batch_kernel() {
+#if TCAM_X86_BATCH_DISPATCH
+        if (__builtin_cpu_supports("avx512f")) return BatchKernel::AVX512;
+        if (__builtin_cpu_supports("avx2")) return BatchKernel::AVX2;
+#endif
+        return BatchKernel::SCALAR;
     }
 
-    // Returns rule index or -1 if no match
-    int lookup_decision_tree_idx(const std::vector<uint8_t>& packet, std::vector<std::string>* debug_trace_log = nullptr) const {
+    // Rule-index lookups through one engine each, for tests and diagnostics.
+    // Indices count rules as get_all_rule_stats lists them. Each returns -1 if
+    // no rule matches; lookup_frozen_idx also returns -1 if not frozen.
+    int lookup_decision_tree_idx(std::span<const uint8_t> packet, std::vector<std::string>* debug_trace_log = nullptr) const {
+        return rule_index_of_slot(lookup_decision_tree_slot(packet, debug_trace_log));
+    }
+    int lookup_frozen_idx(std::span<const uint8_t> packet, std::vector<std::string>* debug_trace_log = nullptr) const {
+        return rule_index_of_slot(lookup_frozen_slot(packet, debug_trace_log));
+    }
+    int lookup_bitmap_idx(std::span<const uint8_t> packet, std::vector<std::string>* debug_trace_log = nullptr) const {
+        return rule_index_of_slot(lookup_bitmap_slot(packet, debug_trace_log));
+    }
+    int lookup_linear_idx(std::span<const uint8_t> packet, std::vector<std::string>* debug_trace_log = nullptr) const {
+        return rule_index_of_slot(lookup_linear_slot(packet, debug_trace_log));
+    }
+
+private:
+    // Returns the matching position in `rules` or -1 if no match
+    int lookup_decision_tree_slot(std::span<const uint8_t> packet, std::vector<std::string>* debug_trace_log = nullptr) const {
         if (debug_trace_log) debug_trace_log->push_back("lookup_decision_tree_idx: Starting tree traversal.");
         if (!decision_tree) {
             if (debug_trace_log) debug_trace_log->push_back("lookup_decision_tree_idx: Decision tree is null. Returning -1.");
@@ -681,8 +1221,51 @@ public: // This public keyword is just to mark where the next section starts in
         return traverse_decision_tree(decision_tree.get(), packet, debug_trace_log);
     }
     
-    // Returns rule index or -1 if no match
-    int lookup_bitmap_idx(const std::vector<uint8_t>& packet, std::vector<std::string>* debug_trace_log = nullptr) const {
+    // Same result as lookup_decision_tree_slot, walking the tree compiled by
+    // freeze(). Returns -1 if the TCAM is not frozen.
+    int lookup_frozen_slot(std::span<const uint8_t> packet, std::vector<std::string>* debug_trace_log = nullptr) const {
+        if (flat_tree.empty()) {
+            if (debug_trace_log) debug_trace_log->push_back("lookup_frozen_idx: No frozen tree. Returning -1.");
+            return -1;
+        }
+        const bool use_arena = !debug_trace_log && packet.size() >= BATCH_KEY_BYTES && rule_arena_in_sync();
+        const PacketKey key = use_arena ? make_packet_key(packet.data()) : PacketKey{};
+
+        // A match at a node only bounds the search: deeper rules can still win,
+        // and any deeper match is necessarily below the bound.
+        int best = -1;
+        int bound = std::numeric_limits<int>::max();
+        uint32_t node_idx = 0;
+        while (true) {
+            const FlatDecisionNode& node = flat_tree[node_idx];
+            const int32_t* node_rules = flat_tree_rules.data() + node.rules_begin;
+            for (uint32_t k = 0; k < node.rules_count; ++k) {
+                const int rule_idx = node_rules[k];
+                if (rule_idx >= bound) break;
+                const bool hit = use_arena ? arena_matches(static_cast<size_t>(rule_idx), key)
+                                           : matches_rule(packet, rules[static_cast<size_t>(rule_idx)], debug_trace_log);
+                if (hit) {
+                    best = rule_idx;
+                    bound = rule_idx;
+                    break;
+                }
+            }
+            if (node.field_offset < 0 || static_cast<size_t>(node.field_offset) >= packet.size()) {
+                break;
+            }
+            const bool go_left = (packet[static_cast<size_t>(node.field_offset)] & node.mask) == (node.test_value & node.mask);
+            const uint8_t needed = go_left ? FlatDecisionNode::HAS_LEFT : FlatDecisionNode::HAS_RIGHT;
+            if (!(node.child_flags & needed)) {
+                break;
+            }
+            node_idx = node.first_child + (go_left ? 0u : 1u);
+        }
+        if (debug_trace_log) debug_trace_log->push_back("lookup_frozen_idx: Returning " + std::to_string(best) + ".");
+        return best;
+    }
+
+    // Returns the matching position in `rules` or -1 if no match
+    int lookup_bitmap_slot(std::span<const uint8_t> packet, std::vector<std::string>* debug_trace_log = nullptr) const {
         if (debug_trace_log) debug_trace_log->push_back("lookup_bitmap_idx: Starting bitmap lookup.");
         if (field_bitmaps.empty() || packet.empty() || rules.empty()) { // Ensure rules is not empty
             if (debug_trace_log) {
@@ -693,110 +1276,66 @@ public: // This public keyword is just to mark where the next section starts in
             }
             return -1;
         }
-        
-        std::bitset<BitmapTCAM::MAX_RULES> matches_bs;
-        matches_bs.set(); // Initialize to all ones
-        
-        for (size_t field_idx = 0; field_idx < field_bitmaps.size(); ++field_idx) {
-            if (field_idx < packet.size()) {
-                auto field_matches = field_bitmaps[field_idx].lookup(packet[field_idx]);
-                if (debug_trace_log) debug_trace_log->push_back("lookup_bitmap_idx: Field " + std::to_string(field_idx) + " PktByte=" + std::to_string(packet[field_idx]) + " -> Initial field_matches_count=" + std::to_string(field_matches.count()));
-                matches_bs &= field_matches;
-            } else { // Packet is shorter than the number of fields in field_bitmaps
-                std::bitset<BitmapTCAM::MAX_RULES> rules_wildcarded_for_this_field;
-                // This logic assumes rules might be shorter than num_fields_for_bitmap,
-                // or that field_idx check is for fields beyond packet length.
-                // A rule matches if its mask for this field_idx is 0x00 (wildcard).
-                for(size_t rule_idx = 0; rule_idx < rules.size() && rule_idx < BitmapTCAM::MAX_RULES; ++rule_idx) {
-                    // This check is crucial: only consider rules active in the bitmap for this field
-                    if (rules[rule_idx].mask.size() > field_idx && rules[rule_idx].mask[field_idx] == 0x00) {
-                        rules_wildcarded_for_this_field.set(rule_idx);
-                    }
-                }
-                if (debug_trace_log) debug_trace_log->push_back("lookup_bitmap_idx: Field " + std::to_string(field_idx) + " (packet short) -> Wildcarded_rules_count=" + std::to_string(rules_wildcarded_for_this_field.count()));
-                matches_bs &= rules_wildcarded_for_this_field;
-            }
-            if (debug_trace_log) debug_trace_log->push_back("lookup_bitmap_idx: After field " + std::to_string(field_idx) + ", combined matches_bs_count=" + std::to_string(matches_bs.count()));
-            if (!matches_bs.any()) {
-                if (debug_trace_log) debug_trace_log->push_back("lookup_bitmap_idx: No matches after field " + std::to_string(field_idx) + ". Breaking.");
-                break;
+
+        // Pick one row per field: the row for the packet byte, or the wildcard
+        // row for fields past the end of the packet.
+        const size_t num_fields = field_bitmaps.size();
+        std::array<const uint64_t*, MAX_BITMAP_FIELDS> field_rows;
+        std::array<const uint64_t*, MAX_BITMAP_FIELDS> field_summaries;
+        for (size_t field_idx = 0; field_idx < num_fields; ++field_idx) {
+            const size_t row = field_idx < packet.size() ? packet[field_idx] : BitmapTCAM::WILDCARD_ROW;
+            field_rows[field_idx] = field_bitmaps[field_idx].row(row);
+            field_summaries[field_idx] = field_bitmaps[field_idx].summary_row(row);
+            if (debug_trace_log) {
+                debug_trace_log->push_back("lookup_bitmap_idx: Field " + std::to_string(field_idx) +
+                                           (field_idx < packet.size() ? " PktByte=" + std::to_string(packet[field_idx]) : std::string(" (packet short)")) +
+                                           " -> field_matches_count=" + std::to_string(field_bitmaps[field_idx].row_popcount(row)));
             }
         }
 
-        if (debug_trace_log) debug_trace_log->push_back("lookup_bitmap_idx: Iterating over " + std::to_string(matches_bs.count()) + " potential matches from bitmap.");
-        for (size_t i = 0; i < rules.size(); ++i) { // Iterate up to actual rules.size()
-            if (i < BitmapTCAM::MAX_RULES && matches_bs[i]) { // Check if bit is set AND within MAX_RULES
-                if (debug_trace_log) debug_trace_log->push_back("lookup_bitmap_idx: Checking rule index " + std::to_string(i) + " (ID: " + std::to_string(rules[i].id) + ") from bitmap result.");
-                const auto& r = rules[i];
-                if (!r.is_active) {
-                     if (debug_trace_log) debug_trace_log->push_back("lookup_bitmap_idx: Rule " + std::to_string(r.id) + " is inactive, skipping.");
-                    continue;
-                }
+        // AND the summaries first so only words that are non-zero in every field
+        // are visited; candidates come out in rule order, so the first one that
+        // passes the port checks is the answer.
+        const size_t summary_count = field_bitmaps[0].summary_count;
+        for (size_t s_idx = 0; s_idx < summary_count; ++s_idx) {
+            uint64_t candidate_words = ~uint64_t{0};
+            for (size_t field_idx = 0; field_idx < num_fields && candidate_words != 0; ++field_idx) {
+                candidate_words &= field_summaries[field_idx][s_idx];
+            }
+            while (candidate_words != 0) {
+                const size_t word_idx = s_idx * 64 + static_cast<size_t>(std::countr_zero(candidate_words));
+                candidate_words &= candidate_words - 1;
 
-                // Instead of repeating port logic, call matches_rule for the port checks and final validation
-                // This requires matches_rule to be suitable, or a subset of its logic to be used here.
-                // For now, the detailed port check logic is duplicated here as per the original plan.
-                // A better refactor would be to have a `check_ports_match(packet, rule, log)` helper.
-
-                bool port_ranges_match = true;
-                // Source Port Check
-                if (r.src_port_range_id != std::numeric_limits<uint32_t>::max()) {
-                    std::string src_port_log = "SrcPort Check (RuleID " + std::to_string(r.id) + "): ";
-                    if (packet.size() < 10) {
-                        port_ranges_match = false;
-                        if (debug_trace_log) src_port_log += "Packet too short.";
-                    } else if (r.src_port_range_id >= port_ranges.size()) {
-                        port_ranges_match = false;
-                        if (debug_trace_log) src_port_log += "Invalid range_id " + std::to_string(r.src_port_range_id) + ". Max is " + std::to_string(port_ranges.size()-1);
-                    } else {
-                        uint16_t packet_src_port = (static_cast<uint16_t>(packet[8]) << 8) | packet[9];
-                        const auto& range_entry = port_ranges[r.src_port_range_id];
-                        if (packet_src_port < range_entry.min_port || packet_src_port > range_entry.max_port) {
-                            port_ranges_match = false;
-                        }
-                        if (debug_trace_log) src_port_log += "PktPort=" + std::to_string(packet_src_port) + " Range=" + std::to_string(range_entry.min_port) + "-" + std::to_string(range_entry.max_port);
-                    }
-                    if (debug_trace_log) debug_trace_log->push_back(src_port_log + " -> " + (port_ranges_match ? "Match" : "Mismatch"));
+                uint64_t matches = ~uint64_t{0};
+                for (size_t field_idx = 0; field_idx < num_fields && matches != 0; ++field_idx) {
+                    matches &= field_rows[field_idx][word_idx];
                 }
-
-                // Destination Port Check
-                if (port_ranges_match && r.dst_port_range_id != std::numeric_limits<uint32_t>::max()) {
-                    std::string dst_port_log = "DstPort Check (RuleID " + std::to_string(r.id) + "): ";
-                    if (packet.size() < 12) {
-                        port_ranges_match = false;
-                        if (debug_trace_log) dst_port_log += "Packet too short.";
-                    } else if (r.dst_port_range_id >= port_ranges.size()) {
-                        port_ranges_match = false;
-                        if (debug_trace_log) dst_port_log += "Invalid range_id " + std::to_string(r.dst_port_range_id) + ". Max is " + std::to_string(port_ranges.size()-1);
-                    } else {
-                        uint16_t packet_dst_port = (static_cast<uint16_t>(packet[10]) << 8) | packet[11];
-                        const auto& range_entry = port_ranges[r.dst_port_range_id];
-                        if (packet_dst_port < range_entry.min_port || packet_dst_port > range_entry.max_port) {
-                            port_ranges_match = false;
-                        }
-                        if (debug_trace_log) dst_port_log += "PktPort=" + std::to_string(packet_dst_port) + " Range=" + std::to_string(range_entry.min_port) + "-" + std::to_string(range_entry.max_port);
+                while (matches != 0) {
+                    const size_t i = word_idx * 64 + static_cast<size_t>(std::countr_zero(matches));
+                    matches &= matches - 1;
+                    if (i >= rules.size()) break;
+                    if (bitmap_candidate_matches(packet, i, debug_trace_log)) {
+                        return static_cast<int>(i);
                     }
-                     if (debug_trace_log) debug_trace_log->push_back(dst_port_log + " -> " + (port_ranges_match ? "Match" : "Mismatch"));
-                }
-                // The original `matches_rule` also checks all other fields.
-                // The bitmap lookup pre-filters based on those fields. So if we reach here,
-                // non-port fields are assumed to match based on bitmap logic.
-                // Thus, only port_ranges_match determines the final outcome here.
-                if (port_ranges_match) {
-                    if (debug_trace_log) debug_trace_log->push_back("lookup_bitmap_idx: Rule " + std::to_string(r.id) + " (index " + std::to_string(i) + ") fully matched (ports OK). Returning index.");
-                    return static_cast<int>(i);
-                } else {
-                    if (debug_trace_log) debug_trace_log->push_back("lookup_bitmap_idx: Rule " + std::to_string(r.id) + " (index " + std::to_string(i) + ") failed port match.");
                 }
             }
         }
         if (debug_trace_log) debug_trace_log->push_back("lookup_bitmap_idx: No rule from bitmap fully matched. Returning -1.");
         return -1;
     }
-    
-    // Returns rule index or -1 if no match
-    int lookup_linear_idx(const std::vector<uint8_t>& packet, std::vector<std::string>* debug_trace_log = nullptr) const {
+
+    // Returns the matching position in `rules` or -1 if no match
+    int lookup_linear_slot(std::span<const uint8_t> packet, std::vector<std::string>* debug_trace_log = nullptr) const {
         if (debug_trace_log) debug_trace_log->push_back("lookup_linear_idx: Starting linear search.");
+        if (!debug_trace_log && packet.size() >= BATCH_KEY_BYTES && rule_arena_in_sync()) {
+            const PacketKey key = make_packet_key(packet.data());
+            for (size_t i = 0; i < rule_arena.size(); ++i) {
+                if (arena_matches(i, key)) {
+                    return static_cast<int>(i);
+                }
+            }
+            return -1;
+        }
         for (size_t i = 0; i < rules.size(); ++i) {
             if (debug_trace_log) debug_trace_log->push_back("lookup_linear_idx: Iterating rule index " + std::to_string(i) + " (ID: " + std::to_string(rules[i].id) + ")");
             if (matches_rule(packet, rules[i], debug_trace_log)) {
@@ -807,6 +1346,18 @@ public: // This public keyword is just to mark where the next section starts in
         if (debug_trace_log) debug_trace_log->push_back("lookup_linear_idx: No match found after iterating all rules. Returning -1.");
         return -1;
     }
+
+    // Position of rules[slot] among the rules get_all_rule_stats lists, i.e.
+    // with the spare slots before it skipped. -1 stays -1.
+    int rule_index_of_slot(int slot) const {
+        if (slot < 0) return -1;
+        return slot - static_cast<int>(vacant_slots.count_before(static_cast<size_t>(slot)));
+    }
+    size_t rule_index_of_slot(size_t slot) const {
+        return slot - vacant_slots.count_before(slot);
+    }
+
+public:
     
     struct LookupStats {
         size_t linear_lookups = 0;
@@ -826,15 +1377,15 @@ public: // This public keyword is just to mark where the next section starts in
     
     void optimize_for_traffic_pattern(const std::vector<std::vector<uint8_t>>& sample_traffic) {
         auto t_start = std::chrono::high_resolution_clock::now();
-        for (const auto& packet : sample_traffic) lookup_linear_idx(packet); // Call _idx version
+        for (const auto& packet : sample_traffic) lookup_linear_slot(packet); // Call _slot version
         auto t_linear_time = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - t_start);
         
         t_start = std::chrono::high_resolution_clock::now();
-        for (const auto& packet : sample_traffic) lookup_decision_tree_idx(packet); // Call _idx version
+        for (const auto& packet : sample_traffic) lookup_decision_tree_slot(packet); // Call _slot version
         auto t_tree_time = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - t_start);
         
         t_start = std::chrono::high_resolution_clock::now();
-        for (const auto& packet : sample_traffic) lookup_bitmap_idx(packet); // Call _idx version
+        for (const auto& packet : sample_traffic) lookup_bitmap_slot(packet); // Call _slot version
         auto t_bitmap_time = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - t_start);
         
         if (!sample_traffic.empty()) {
@@ -868,7 +1419,70 @@ private:
         mask_arr[offset + 2] = 0xFF; mask_arr[offset + 3] = 0xFF;
     }
     
-    bool matches_rule(const std::vector<uint8_t>& packet, const Rule& r, std::vector<std::string>* debug_trace_log = nullptr) const {
+    // Bitmap candidates already match every key byte; only activity and port
+    // ranges remain to be checked.
+    bool bitmap_candidate_matches(std::span<const uint8_t> packet, size_t i, std::vector<std::string>* debug_trace_log) const {
+        if (!debug_trace_log && packet.size() >= BATCH_KEY_BYTES && rule_arena_in_sync()) {
+            return rule_arena.active()[i] && arena_ports_match(i, make_packet_key(packet.data()));
+        }
+        if (debug_trace_log) debug_trace_log->push_back("lookup_bitmap_idx: Checking rule index " + std::to_string(i) + " (ID: " + std::to_string(rules[i].id) + ") from bitmap result.");
+        const auto& r = rules[i];
+        if (!r.is_active) {
+            if (debug_trace_log) debug_trace_log->push_back("lookup_bitmap_idx: Rule " + std::to_string(r.id) + " is inactive, skipping.");
+            return false;
+        }
+
+        bool port_ranges_match = true;
+        // Source Port Check
+        if (r.src_port_range_id != std::numeric_limits<uint32_t>::max()) {
+            std::string src_port_log;
+            if (debug_trace_log) src_port_log = "SrcPort Check (RuleID " + std::to_string(r.id) + "): ";
+            if (packet.size() < 10) {
+                port_ranges_match = false;
+                if (debug_trace_log) src_port_log += "Packet too short.";
+            } else if (r.src_port_range_id >= port_ranges.size()) {
+                port_ranges_match = false;
+                if (debug_trace_log) src_port_log += "Invalid range_id " + std::to_string(r.src_port_range_id) + ". Max is " + std::to_string(port_ranges.size()-1);
+            } else {
+                uint16_t packet_src_port = (static_cast<uint16_t>(packet[8]) << 8) | packet[9];
+                const auto& range_entry = port_ranges[r.src_port_range_id];
+                if (packet_src_port < range_entry.min_port || packet_src_port > range_entry.max_port) {
+                    port_ranges_match = false;
+                }
+                if (debug_trace_log) src_port_log += "PktPort=" + std::to_string(packet_src_port) + " Range=" + std::to_string(range_entry.min_port) + "-" + std::to_string(range_entry.max_port);
+            }
+            if (debug_trace_log) debug_trace_log->push_back(src_port_log + " -> " + (port_ranges_match ? "Match" : "Mismatch"));
+        }
+
+        // Destination Port Check
+        if (port_ranges_match && r.dst_port_range_id != std::numeric_limits<uint32_t>::max()) {
+            std::string dst_port_log;
+            if (debug_trace_log) dst_port_log = "DstPort Check (RuleID " + std::to_string(r.id) + "): ";
+            if (packet.size() < 12) {
+                port_ranges_match = false;
+                if (debug_trace_log) dst_port_log += "Packet too short.";
+            } else if (r.dst_port_range_id >= port_ranges.size()) {
+                port_ranges_match = false;
+                if (debug_trace_log) dst_port_log += "Invalid range_id " + std::to_string(r.dst_port_range_id) + ". Max is " + std::to_string(port_ranges.size()-1);
+            } else {
+                uint16_t packet_dst_port = (static_cast<uint16_t>(packet[10]) << 8) | packet[11];
+                const auto& range_entry = port_ranges[r.dst_port_range_id];
+                if (packet_dst_port < range_entry.min_port || packet_dst_port > range_entry.max_port) {
+                    port_ranges_match = false;
+                }
+                if (debug_trace_log) dst_port_log += "PktPort=" + std::to_string(packet_dst_port) + " Range=" + std::to_string(range_entry.min_port) + "-" + std::to_string(range_entry.max_port);
+            }
+            if (debug_trace_log) debug_trace_log->push_back(dst_port_log + " -> " + (port_ranges_match ? "Match" : "Mismatch"));
+        }
+        if (port_ranges_match) {
+            if (debug_trace_log) debug_trace_log->push_back("lookup_bitmap_idx: Rule " + std::to_string(r.id) + " (index " + std::to_string(i) + ") fully matched (ports OK). Returning index.");
+        } else {
+            if (debug_trace_log) debug_trace_log->push_back("lookup_bitmap_idx: Rule " + std::to_string(r.id) + " (index " + std::to_string(i) + ") failed port match.");
+        }
+        return port_ranges_match;
+    }
+
+    bool matches_rule(std::span<const uint8_t> packet, const Rule& r, std::vector<std::string>* debug_trace_log = nullptr) const {
         if (!r.is_active) {
             if (debug_trace_log) debug_trace_log->push_back("matches_rule (RuleID " + std::to_string(r.id) + "): Rule not active.");
             return false;
@@ -943,10 +1557,10 @@ private:
     
 public: // Ensure lookup_single and dependent methods are public
     // The public API for single packet lookup
-    int lookup_single(const std::vector<uint8_t>& packet, std::vector<std::string>* debug_trace_log = nullptr) const {
+    int lookup_single(std::span<const uint8_t> packet, std::vector<std::string>* debug_trace_log = nullptr) const {
         auto tcam_lookup_start_time = std::chrono::high_resolution_clock::now();
         int action_to_return = -1;
-        std::string chosen_strategy_log;
+        const char* chosen_strategy_log = ""; // Not a std::string: keeps the non-debug path allocation-free
 
         if (debug_trace_log) debug_trace_log->push_back("lookup_single: Starting lookup.");
 
@@ -967,38 +1581,42 @@ public: // Ensure lookup_single and dependent methods are public
 
         // Determine lookup strategy (this logic is from the original code)
         // Now passing debug_trace_log to the chosen _idx function
-        if (stats.avg_linear_time > 0 && stats.avg_bitmap_time > 0 && !field_bitmaps.empty()) {
+        if (frozen && !flat_tree.empty()) {
+            stats.decision_tree_lookups++;
+            chosen_strategy_log = "Frozen tree";
+            matched_rule_idx = lookup_frozen_slot(packet, debug_trace_log);
+        } else if (stats.avg_linear_time > 0 && stats.avg_bitmap_time > 0 && !field_bitmaps.empty()) {
             if (stats.avg_bitmap_time < stats.avg_linear_time && (stats.avg_tree_time == 0 || stats.avg_bitmap_time < stats.avg_tree_time) ) {
                 stats.bitmap_lookups++;
                 chosen_strategy_log = "Bitmap";
-                matched_rule_idx = lookup_bitmap_idx(packet, debug_trace_log);
+                matched_rule_idx = lookup_bitmap_slot(packet, debug_trace_log);
             } else if (stats.avg_tree_time > 0 && decision_tree && (stats.avg_tree_time < stats.avg_linear_time) ){
                 stats.decision_tree_lookups++;
                 chosen_strategy_log = "Tree";
-                matched_rule_idx = lookup_decision_tree_idx(packet, debug_trace_log);
+                matched_rule_idx = lookup_decision_tree_slot(packet, debug_trace_log);
             } else {
                 stats.linear_lookups++;
                 chosen_strategy_log = "Linear (fallback from preferred)";
-                matched_rule_idx = lookup_linear_idx(packet, debug_trace_log);
+                matched_rule_idx = lookup_linear_slot(packet, debug_trace_log);
             }
         } else if (rules.size() < 16 || (!decision_tree && field_bitmaps.empty())) {
              stats.linear_lookups++;
              chosen_strategy_log = "Linear (small rule set or no optimized structures)";
-             matched_rule_idx = lookup_linear_idx(packet, debug_trace_log);
+             matched_rule_idx = lookup_linear_slot(packet, debug_trace_log);
         } else if (!field_bitmaps.empty()) {
              stats.bitmap_lookups++;
              chosen_strategy_log = "Bitmap (default)";
-             matched_rule_idx = lookup_bitmap_idx(packet, debug_trace_log);
+             matched_rule_idx = lookup_bitmap_slot(packet, debug_trace_log);
         } else if (decision_tree) {
              stats.decision_tree_lookups++;
              chosen_strategy_log = "Tree (default, no bitmap)";
-             matched_rule_idx = lookup_decision_tree_idx(packet, debug_trace_log);
+             matched_rule_idx = lookup_decision_tree_slot(packet, debug_trace_log);
         } else {
             stats.linear_lookups++;
             chosen_strategy_log = "Linear (final fallback)";
-            matched_rule_idx = lookup_linear_idx(packet, debug_trace_log);
+            matched_rule_idx = lookup_linear_slot(packet, debug_trace_log);
         }
-        if (debug_trace_log) debug_trace_log->push_back("lookup_single: Chosen strategy: " + chosen_strategy_log);
+        if (debug_trace_log) debug_trace_log->push_back(std::string("lookup_single: Chosen strategy: ") + chosen_strategy_log);
 
         if (matched_rule_idx != -1 && static_cast<size_t>(matched_rule_idx) < rules.size()) {
             rules[matched_rule_idx].hit_count++;
@@ -1022,23 +1640,369 @@ public: // Ensure lookup_single and dependent methods are public
         return action_to_return;
     }
     
-    #ifdef __AVX2__
-    void lookup_simd_avx2(const std::vector<uint8_t>* packets_ptr, int* results_ptr) {
-        for (int i = 0; i < 8; ++i) {
-            // Assuming lookup_single is now public or accessible.
-            // If it remains private, this call would be invalid from a different class context,
-            // but it's fine if lookup_simd_avx2 is a member of OptimizedTCAM.
-            // The main point is that lookup_single itself handles the debug_trace_log if needed.
-            // For batch lookups, detailed tracing per packet might be too verbose unless specifically requested.
-            // Thus, passing nullptr for debug_trace_log here is reasonable for typical batch operation.
-            results_ptr[i] = lookup_single(packets_ptr[i], nullptr);
+private: // Batch classifier
+    // RecordStats selects between lookup_batch (hit counts and batch counters
+    // are updated, exactly as lookup_single would) and classify_batch (no
+    // writes at all, safe for concurrent readers of an unchanging TCAM).
+    template <bool RecordStats, typename PacketAt>
+    void lookup_batch_impl(size_t count, PacketAt&& packet_at, int* results) const {
+        if (rules.empty() || !rule_arena_in_sync()) {
+            for (size_t i = 0; i < count; ++i) {
+                results[i] = RecordStats ? lookup_single(packet_at(i)) : classify(packet_at(i));
+            }
+            return;
         }
+
+        PacketBlock block;
+        int32_t block_rule_idx[BATCH_LANES];
+        for (size_t base = 0; base < count; base += BATCH_LANES) {
+            const size_t lanes = std::min(BATCH_LANES, count - base);
+            uint32_t lane_mask = 0;
+            for (size_t lane = 0; lane < BATCH_LANES; ++lane) {
+                if (lane < lanes) {
+                    const std::span<const uint8_t> pkt = packet_at(base + lane);
+                    if (pkt.size() >= BATCH_KEY_BYTES) {
+                        pack_packet_into_block(pkt.data(), block, lane);
+                        lane_mask |= (1u << lane);
+                        continue;
+                    }
+                }
+                pack_packet_into_block(nullptr, block, lane);
+            }
+
+            classify_block(block, lane_mask, block_rule_idx);
+
+            for (size_t lane = 0; lane < lanes; ++lane) {
+                if (lane_mask & (1u << lane)) {
+                    const int32_t idx = block_rule_idx[lane];
+                    if constexpr (RecordStats) {
+                        results[base + lane] = record_batch_hit(idx);
+                    } else {
+                        results[base + lane] = idx < 0 ? -1 : rule_arena.actions()[idx];
+                    }
+                } else {
+                    results[base + lane] = RecordStats ? lookup_single(packet_at(base + lane))
+                                                       : classify(packet_at(base + lane));
+                }
+            }
+            if constexpr (RecordStats) {
+                stats.simd_lookups += static_cast<size_t>(std::popcount(lane_mask));
+            }
+        }
+    }
+
+    static uint32_t load_be32(const uint8_t* p) {
+        return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+               (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+    }
+
+    // Transposes one 15-byte key into lane `lane` of the block; a null packet
+    // zeroes the lane (the caller keeps it out of the lane mask).
+    static void pack_packet_into_block(const uint8_t* packet, PacketBlock& block, size_t lane) {
+        if (!packet) {
+            for (size_t w = 0; w < RuleArena::KEY_WORDS; ++w) block.words[w][lane] = 0;
+            return;
+        }
+        block.words[0][lane] = load_be32(packet);
+        block.words[1][lane] = load_be32(packet + 4);
+        block.words[2][lane] = load_be32(packet + 8);
+        block.words[3][lane] = (static_cast<uint32_t>(packet[12]) << 24) |
+                               (static_cast<uint32_t>(packet[13]) << 16) |
+                               (static_cast<uint32_t>(packet[14]) << 8);
+    }
+
+    void build_rule_arena() {
+        rule_arena.clear();
+        rule_arena.resize(rules.size());
+        for (size_t i = 0; i < rules.size(); ++i) {
+            pack_rule_at(i);
+        }
+    }
+
+    void pack_rule_at(size_t i) {
+        const Rule& r = rules[i];
+        uint8_t value[16] = {0};
+        uint8_t mask[16] = {0};
+        const size_t key_bytes = std::min({r.value.size(), r.mask.size(), BATCH_KEY_BYTES});
+        for (size_t k = 0; k < key_bytes; ++k) {
+            value[k] = r.value[k] & r.mask[k];
+            mask[k] = r.mask[k];
+        }
+        for (size_t w = 0; w < RuleArena::KEY_WORDS; ++w) {
+            rule_arena.values()[i].w[w] = load_be32(value + 4 * w);
+            rule_arena.masks()[i].w[w] = load_be32(mask + 4 * w);
+        }
+
+        // An invalid range id never matches in matches_rule; encode it as an empty range.
+        auto resolve_range = [this](uint32_t range_id, int32_t& lo, int32_t& hi) {
+            if (range_id == std::numeric_limits<uint32_t>::max()) {
+                lo = 0; hi = 0xFFFF;
+            } else if (range_id < port_ranges.size()) {
+                lo = port_ranges[range_id].min_port; hi = port_ranges[range_id].max_port;
+            } else {
+                lo = 1; hi = 0;
+            }
+        };
+        RuleArena::PortBounds& ports = rule_arena.ports()[i];
+        resolve_range(r.src_port_range_id, ports.src_min, ports.src_max);
+        resolve_range(r.dst_port_range_id, ports.dst_min, ports.dst_max);
+        rule_arena.priorities()[i] = r.priority;
+        rule_arena.actions()[i] = r.action;
+        rule_arena.active()[i] = r.is_active ? 1 : 0;
+    }
+
+    bool rule_arena_in_sync() const { return rule_arena.size() == rules.size(); }
+
+    static PacketKey make_packet_key(const uint8_t* packet) {
+        PacketKey key;
+        key.w[0] = load_be32(packet);
+        key.w[1] = load_be32(packet + 4);
+        key.w[2] = load_be32(packet + 8);
+        key.w[3] = (static_cast<uint32_t>(packet[12]) << 24) |
+                   (static_cast<uint32_t>(packet[13]) << 16) |
+                   (static_cast<uint32_t>(packet[14]) << 8);
+        key.src_port = static_cast<int32_t>(key.w[2] >> 16);
+        key.dst_port = static_cast<int32_t>(key.w[2] & 0xFFFF);
+        return key;
+    }
+
+    // Same result as matches_rule(packet, rules[i]) for a full-length packet.
+    bool arena_matches(size_t i, const PacketKey& key) const {
+        if (!rule_arena.active()[i]) return false;
+        const RuleArena::KeyWords& v = rule_arena.values()[i];
+        const RuleArena::KeyWords& m = rule_arena.masks()[i];
+        const uint32_t diff = ((key.w[0] ^ v.w[0]) & m.w[0]) | ((key.w[1] ^ v.w[1]) & m.w[1]) |
+                              ((key.w[2] ^ v.w[2]) & m.w[2]) | ((key.w[3] ^ v.w[3]) & m.w[3]);
+        return diff == 0 && arena_ports_match(i, key);
+    }
+
+    bool arena_ports_match(size_t i, const PacketKey& key) const {
+        const RuleArena::PortBounds& p = rule_arena.ports()[i];
+        return key.src_port >= p.src_min && key.src_port <= p.src_max &&
+               key.dst_port >= p.dst_min && key.dst_port <= p.dst_max;
+    }
+
+    // matches_rule for rules[i], through the arena when no trace is requested.
+    bool matches_rule_at(std::span<const uint8_t> packet, size_t i, std::vector<std::string>* debug_trace_log) const {
+        if (!debug_trace_log && packet.size() >= BATCH_KEY_BYTES && rule_arena_in_sync()) {
+            return arena_matches(i, make_packet_key(packet.data()));
+        }
+        return matches_rule(packet, rules[i], debug_trace_log);
+    }
+
+    // Copies the rule set only; the caller rebuilds the optimized structures
+    // (update_rules_atomic does so as part of applying a batch).
+    void copy_rule_state_from(const OptimizedTCAM& other) {
+        rules = other.rules;
+        port_ranges = other.port_ranges;
+        next_rule_id = other.next_rule_id;
+        batch_kernel = other.batch_kernel;
+        frozen = other.frozen;
+        free_slots = other.free_slots;
+        vacant_slots = other.vacant_slots;
+        maintenance.vacant_slots = other.maintenance.vacant_slots;
+    }
+
+    // Soft-deletes rules[idx] and unlinks it from the lookup structures; its
+    // position is reused by a nearby insert or reclaimed by the next full rebuild.
+    void deactivate_rule_at(size_t idx) {
+        if (!rules[idx].is_active) {
+            return;
+        }
+        rules[idx].is_active = false;
+        maintenance.inactive_rules++;
+        if (idx < free_slots.size) {
+            free_slots.set(idx);
+        }
+        if (!rule_arena_in_sync()) {
+            return; // Structures are stale; the pending rebuild drops the rule anyway
+        }
+        rule_arena.active()[idx] = 0;
+        for (auto& bitmap : field_bitmaps) {
+            bitmap.clear_rule(idx);
+        }
+        erase_from_decision_tree(static_cast<int>(idx));
     }
-    #endif
+
+    int record_batch_hit(int32_t rule_idx) const {
+        if (rule_idx < 0) {
+            return -1;
+        }
+        const Rule& r = rules[static_cast<size_t>(rule_idx)];
+        r.hit_count++;
+        r.last_hit_timestamp = std::chrono::steady_clock::now();
+        return r.action;
+    }
+
+    void classify_block(const PacketBlock& block, uint32_t lane_mask, int32_t* out_rule_idx) const {
+        switch (batch_kernel) {
+#if TCAM_X86_BATCH_DISPATCH
+            case BatchKernel::AVX512:
+                classify_block_avx512(rule_arena, block, lane_mask, out_rule_idx);
+                return;
+            case BatchKernel::AVX2:
+                classify_block_avx2(rule_arena, block, lane_mask, out_rule_idx);
+                return;
+#endif
+            default:
+                classify_block_scalar(rule_arena, block, lane_mask, out_rule_idx);
+                return;
+        }
+    }
+
+    // All kernels walk rules in table order (priority, then specificity), so the
+    // first rule to match a lane is that lane's winner. Lanes retire as they are
+    // resolved and the walk stops once every lane in lane_mask has a winner.
+    static void classify_block_scalar(const RuleArena& t, const PacketBlock& b,
+                                      uint32_t lane_mask, int32_t* out) {
+        for (size_t lane = 0; lane < BATCH_LANES; ++lane) out[lane] = -1;
+        uint32_t pending = lane_mask;
+        const size_t n = t.size();
+        const RuleArena::KeyWords* values = t.values();
+        const RuleArena::KeyWords* masks = t.masks();
+        const RuleArena::PortBounds* ports = t.ports();
+        const uint8_t* active = t.active();
+        for (size_t r = 0; r < n && pending != 0; ++r) {
+            if (!active[r]) continue;
+            uint32_t remaining = pending;
+            while (remaining != 0) {
+                const unsigned lane = static_cast<unsigned>(std::countr_zero(remaining));
+                remaining &= remaining - 1;
+                uint32_t diff = 0;
+                for (size_t w = 0; w < RuleArena::KEY_WORDS; ++w) {
+                    diff |= (b.words[w][lane] ^ values[r].w[w]) & masks[r].w[w];
+                }
+                if (diff != 0) continue;
+                const int32_t src_port = static_cast<int32_t>(b.words[2][lane] >> 16);
+                const int32_t dst_port = static_cast<int32_t>(b.words[2][lane] & 0xFFFF);
+                if (src_port < ports[r].src_min || src_port > ports[r].src_max ||
+                    dst_port < ports[r].dst_min || dst_port > ports[r].dst_max) {
+                    continue;
+                }
+                out[lane] = static_cast<int32_t>(r);
+                pending &= ~(1u << lane);
+            }
+        }
+    }
+
+#if TCAM_X86_BATCH_DISPATCH
+    __attribute__((target("avx2")))
+    static void classify_block_avx2(const RuleArena& t, const PacketBlock& b,
+                                    uint32_t lane_mask, int32_t* out) {
+        constexpr size_t HALVES = BATCH_LANES / 8;
+        __m256i pkt[HALVES][RuleArena::KEY_WORDS];
+        __m256i src_port[HALVES], dst_port[HALVES], result[HALVES], pending[HALVES];
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i low16 = _mm256_set1_epi32(0xFFFF);
+        const __m256i lane_bits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+
+        for (size_t h = 0; h < HALVES; ++h) {
+            for (size_t w = 0; w < RuleArena::KEY_WORDS; ++w) {
+                pkt[h][w] = _mm256_load_si256(reinterpret_cast<const __m256i*>(&b.words[w][h * 8]));
+            }
+            src_port[h] = _mm256_srli_epi32(pkt[h][2], 16);
+            dst_port[h] = _mm256_and_si256(pkt[h][2], low16);
+            result[h] = _mm256_set1_epi32(-1);
+            const __m256i half_bits = _mm256_set1_epi32(static_cast<int>((lane_mask >> (8 * h)) & 0xFF));
+            pending[h] = _mm256_cmpeq_epi32(_mm256_and_si256(half_bits, lane_bits), lane_bits);
+        }
+
+        uint32_t pending_bits = lane_mask;
+        const size_t n = t.size();
+        const RuleArena::KeyWords* values = t.values();
+        const RuleArena::KeyWords* masks = t.masks();
+        const RuleArena::PortBounds* ports = t.ports();
+        const uint8_t* active = t.active();
+        for (size_t r = 0; r < n && pending_bits != 0; ++r) {
+            if (!active[r]) continue;
+            const __m256i v0 = _mm256_set1_epi32(static_cast<int>(values[r].w[0]));
+            const __m256i v1 = _mm256_set1_epi32(static_cast<int>(values[r].w[1]));
+            const __m256i v2 = _mm256_set1_epi32(static_cast<int>(values[r].w[2]));
+            const __m256i v3 = _mm256_set1_epi32(static_cast<int>(values[r].w[3]));
+            const __m256i m0 = _mm256_set1_epi32(static_cast<int>(masks[r].w[0]));
+            const __m256i m1 = _mm256_set1_epi32(static_cast<int>(masks[r].w[1]));
+            const __m256i m2 = _mm256_set1_epi32(static_cast<int>(masks[r].w[2]));
+            const __m256i m3 = _mm256_set1_epi32(static_cast<int>(masks[r].w[3]));
+            const __m256i src_lo = _mm256_set1_epi32(ports[r].src_min);
+            const __m256i src_hi = _mm256_set1_epi32(ports[r].src_max);
+            const __m256i dst_lo = _mm256_set1_epi32(ports[r].dst_min);
+            const __m256i dst_hi = _mm256_set1_epi32(ports[r].dst_max);
+            const __m256i rule_idx = _mm256_set1_epi32(static_cast<int>(r));
+
+            for (size_t h = 0; h < HALVES; ++h) {
+                if (((pending_bits >> (8 * h)) & 0xFF) == 0) continue;
+                __m256i diff = _mm256_and_si256(_mm256_xor_si256(pkt[h][0], v0), m0);
+                diff = _mm256_or_si256(diff, _mm256_and_si256(_mm256_xor_si256(pkt[h][1], v1), m1));
+                diff = _mm256_or_si256(diff, _mm256_and_si256(_mm256_xor_si256(pkt[h][2], v2), m2));
+                diff = _mm256_or_si256(diff, _mm256_and_si256(_mm256_xor_si256(pkt[h][3], v3), m3));
+                const __m256i out_of_range = _mm256_or_si256(
+                    _mm256_or_si256(_mm256_cmpgt_epi32(src_lo, src_port[h]), _mm256_cmpgt_epi32(src_port[h], src_hi)),
+                    _mm256_or_si256(_mm256_cmpgt_epi32(dst_lo, dst_port[h]), _mm256_cmpgt_epi32(dst_port[h], dst_hi)));
+                __m256i hit = _mm256_andnot_si256(out_of_range, _mm256_cmpeq_epi32(diff, zero));
+                hit = _mm256_and_si256(hit, pending[h]);
+                if (_mm256_testz_si256(hit, hit)) continue;
+
+                result[h] = _mm256_blendv_epi8(result[h], rule_idx, hit);
+                pending[h] = _mm256_andnot_si256(hit, pending[h]);
+                const uint32_t half_pending = static_cast<uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(pending[h])));
+                pending_bits = (pending_bits & ~(0xFFu << (8 * h))) | (half_pending << (8 * h));
+            }
+        }
+
+        for (size_t h = 0; h < HALVES; ++h) {
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + h * 8), result[h]);
+        }
+    }
+
+    __attribute__((target("avx512f")))
+    static void classify_block_avx512(const RuleArena& t, const PacketBlock& b,
+                                      uint32_t lane_mask, int32_t* out) {
+        const __m512i p0 = _mm512_load_si512(b.words[0]);
+        const __m512i p1 = _mm512_load_si512(b.words[1]);
+        const __m512i p2 = _mm512_load_si512(b.words[2]);
+        const __m512i p3 = _mm512_load_si512(b.words[3]);
+        const __m512i src_port = _mm512_maskz_srli_epi32(static_cast<__mmask16>(0xFFFF), p2, 16);
+        const __m512i dst_port = _mm512_and_si512(p2, _mm512_set1_epi32(0xFFFF));
+        const __m512i zero = _mm512_setzero_si512();
+        __m512i result = _mm512_set1_epi32(-1);
+        __mmask16 pending = static_cast<__mmask16>(lane_mask);
+
+        const size_t n = t.size();
+        const RuleArena::KeyWords* values = t.values();
+        const RuleArena::KeyWords* masks = t.masks();
+        const RuleArena::PortBounds* ports = t.ports();
+        const uint8_t* active = t.active();
+        for (size_t r = 0; r < n && pending != 0; ++r) {
+            if (!active[r]) continue;
+            __m512i diff = _mm512_and_si512(_mm512_xor_si512(p0, _mm512_set1_epi32(static_cast<int>(values[r].w[0]))),
+                                            _mm512_set1_epi32(static_cast<int>(masks[r].w[0])));
+            diff = _mm512_or_si512(diff, _mm512_and_si512(_mm512_xor_si512(p1, _mm512_set1_epi32(static_cast<int>(values[r].w[1]))),
+                                                          _mm512_set1_epi32(static_cast<int>(masks[r].w[1]))));
+            diff = _mm512_or_si512(diff, _mm512_and_si512(_mm512_xor_si512(p2, _mm512_set1_epi32(static_cast<int>(values[r].w[2]))),
+                                                          _mm512_set1_epi32(static_cast<int>(masks[r].w[2]))));
+            diff = _mm512_or_si512(diff, _mm512_and_si512(_mm512_xor_si512(p3, _mm512_set1_epi32(static_cast<int>(values[r].w[3]))),
+                                                          _mm512_set1_epi32(static_cast<int>(masks[r].w[3]))));
+            __mmask16 hit = _mm512_mask_cmpeq_epi32_mask(pending, diff, zero);
+            hit = _mm512_mask_cmpge_epi32_mask(hit, src_port, _mm512_set1_epi32(ports[r].src_min));
+            hit = _mm512_mask_cmple_epi32_mask(hit, src_port, _mm512_set1_epi32(ports[r].src_max));
+            hit = _mm512_mask_cmpge_epi32_mask(hit, dst_port, _mm512_set1_epi32(ports[r].dst_min));
+            hit = _mm512_mask_cmple_epi32_mask(hit, dst_port, _mm512_set1_epi32(ports[r].dst_max));
+            if (hit == 0) continue;
+
+            result = _mm512_mask_mov_epi32(result, hit, _mm512_set1_epi32(static_cast<int>(r)));
+            pending = static_cast<__mmask16>(pending & ~hit);
+        }
+        _mm512_storeu_si512(out, result);
+    }
+#endif
+
 
 private: // Start of private section
-    // Returns rule index or -1 if no match
-    int traverse_decision_tree(const DecisionNode* current_node, const std::vector<uint8_t>& packet, std::vector<std::string>* debug_trace_log = nullptr) const {
+    // Returns the lowest (highest-priority) matching rule index below `bound`, or -1.
+    // Rules attached to a node may lose to a better rule deeper in the subtree, so
+    // a node match only narrows `bound` instead of ending the search.
+    int traverse_decision_tree(const DecisionNode* current_node, std::span<const uint8_t> packet, std::vector<std::string>* debug_trace_log = nullptr,
+                               int bound = std::numeric_limits<int>::max()) const {
         if (!current_node) {
             if (debug_trace_log) debug_trace_log->push_back("traverse_decision_tree: Current node is null. Returning -1.");
             return -1;
@@ -1049,22 +2013,27 @@ private: // Start of private section
                                        " NumRulesAtNode=" + std::to_string(current_node->rule_indices.size()));
         }
 
-        // Check rules directly attached to this node (wildcarded for this field or at max depth)
+        // Check rules directly attached to this node (wildcarded for this field or at max depth).
+        // rule_indices is kept in ascending order, so the first match is the best one here.
+        int best = -1;
         for (int rule_idx_val : current_node->rule_indices) {
+            if (rule_idx_val >= bound) break;
             if (debug_trace_log) debug_trace_log->push_back("traverse_decision_tree: Checking rule index " + std::to_string(rule_idx_val) + " (ID: " + (static_cast<size_t>(rule_idx_val) < rules.size() ? std::to_string(rules[rule_idx_val].id) : "OOB") + ") at current node.");
             // Pass this->port_ranges for matches_rule if it needs port_ranges context not implicitly available
             // However, matches_rule itself uses get_effective_port_range which uses this->port_ranges.
             // This is okay if traverse_decision_tree is only ever called on the main TCAM `rules` and `port_ranges`.
-            if (static_cast<size_t>(rule_idx_val) < rules.size() && matches_rule(packet, rules[rule_idx_val], debug_trace_log)) {
-                if (debug_trace_log) debug_trace_log->push_back("traverse_decision_tree: Matched rule index " + std::to_string(rule_idx_val) + " at current node. Returning index.");
-                return rule_idx_val; // Return rule index
+            if (static_cast<size_t>(rule_idx_val) < rules.size() && matches_rule_at(packet, static_cast<size_t>(rule_idx_val), debug_trace_log)) {
+                if (debug_trace_log) debug_trace_log->push_back("traverse_decision_tree: Matched rule index " + std::to_string(rule_idx_val) + " at current node.");
+                best = rule_idx_val;
+                bound = rule_idx_val;
+                break;
             }
         }
 
         // If it's a leaf node (field_offset == -1) or no children to explore further.
         if (current_node->field_offset == -1 || (!current_node->left && !current_node->right)) {
-            if (debug_trace_log) debug_trace_log->push_back("traverse_decision_tree: Leaf node or no children to explore further. No match from direct rules. Returning -1.");
-            return -1;
+            if (debug_trace_log) debug_trace_log->push_back("traverse_decision_tree: Leaf node or no children to explore further. Returning " + std::to_string(best) + ".");
+            return best;
         }
 
         // Check if packet is long enough for the field test
@@ -1077,7 +2046,7 @@ private: // Start of private section
             if (condition_met) {
                 if (debug_trace_log) debug_trace_log->push_back("traverse_decision_tree: Condition met. Going Left.");
                 if (current_node->left) {
-                    int result = traverse_decision_tree(current_node->left.get(), packet, debug_trace_log);
+                    int result = traverse_decision_tree(current_node->left.get(), packet, debug_trace_log, bound);
                     if (result != -1) return result;
                 } else {
                     if (debug_trace_log) debug_trace_log->push_back("traverse_decision_tree: Left child is null, no path.");
@@ -1085,12 +2054,12 @@ private: // Start of private section
             } else {
                 if (debug_trace_log) debug_trace_log->push_back("traverse_decision_tree: Condition NOT met. Going Right.");
                 if (current_node->right) {
-                    int result = traverse_decision_tree(current_node->right.get(), packet, debug_trace_log);
+                    int result = traverse_decision_tree(current_node->right.get(), packet, debug_trace_log, bound);
                     if (result != -1) return result;
                 }
             }
         }
-        return -1;
+        return best;
     }
 
 // Note: The SEARCH block above includes the start of the private section.
@@ -1195,16 +2164,18 @@ public:
     std::vector<Conflict> detect_conflicts() const {
         std::vector<Conflict> conflicts_list;
         for (size_t i = 0; i < rules.size(); ++i) {
+            if (is_vacant(rules[i])) continue;
             for (size_t j = i + 1; j < rules.size(); ++j) {
                 const auto& r1 = rules[i];
                 const auto& r2 = rules[j];
 
-                if (r1.action == r2.action) {
+                if (r1.action == r2.action || is_vacant(r2)) {
                     continue; // No conflict in outcome
                 }
                 // detect_conflicts always operates on the main this->rules and this->port_ranges
                 if (are_rules_overlapping(r1, r2, i, j, this->port_ranges)) {
-                    conflicts_list.push_back({i, j, "Conflicting actions for overlapping rules"});
+                    conflicts_list.push_back({rule_index_of_slot(i), rule_index_of_slot(j),
+                                              "Conflicting actions for overlapping rules"});
                 }
             }
         }
@@ -1221,7 +2192,8 @@ public:
         std::vector<uint64_t> aged_rule_ids;
         const auto current_time = std::chrono::steady_clock::now();
 
-        for (Rule& rule : rules) {
+        for (size_t idx = 0; idx < rules.size(); ++idx) {
+            const Rule& rule = rules[idx];
             if (!rule.is_active) {
                 continue;
             }
@@ -1240,7 +2212,7 @@ public:
             }
 
             if (should_age) {
-                rule.is_active = false;
+                deactivate_rule_at(idx);
                 aged_rule_ids.push_back(rule.id);
             }
         }
@@ -1249,7 +2221,7 @@ public:
     }
 
     std::vector<uint64_t> eliminate_shadowed_rules(bool dry_run) {
-        std::vector<size_t> shadowed_indices = detect_shadowed_rules();
+        std::vector<size_t> shadowed_indices = shadowed_rule_slots();
         std::vector<uint64_t> deactivated_rule_ids;
         deactivated_rule_ids.reserve(shadowed_indices.size());
 
@@ -1262,7 +2234,7 @@ public:
             if (idx < rules.size() && rules[idx].is_active) {
                 deactivated_rule_ids.push_back(rules[idx].id);
                 if (!dry_run) {
-                    rules[idx].is_active = false;
+                    deactivate_rule_at(idx);
                 }
             }
         }
@@ -1276,9 +2248,9 @@ public:
 
 public:
     bool delete_rule(uint64_t rule_id) {
-        for (auto& rule : rules) {
-            if (rule.id == rule_id) {
-                rule.is_active = false;
+        for (size_t idx = 0; idx < rules.size(); ++idx) {
+            if (rules[idx].id == rule_id && !is_vacant(rules[idx])) {
+                deactivate_rule_at(idx);
                 // Note: rebuild_optimized_structures() is NOT called here for "soft" delete
                 return true;
             }
@@ -1326,9 +2298,18 @@ private:
 
 public:
     std::vector<size_t> detect_shadowed_rules() const {
+        std::vector<size_t> indices = shadowed_rule_slots();
+        for (size_t& idx : indices) idx = rule_index_of_slot(idx);
+        return indices;
+    }
+
+private:
+    std::vector<size_t> shadowed_rule_slots() const {
         std::vector<size_t> shadowed_rule_indices;
         for (size_t i = 0; i < rules.size(); ++i) {
+            if (is_vacant(rules[i])) continue;
             for (size_t j = 0; j < i; ++j) {
+                if (is_vacant(rules[j])) continue;
                 // detect_shadowed_rules always operates on the main this->rules and this->port_ranges
                 if (rules[i].action != rules[j].action && is_subset(rules[i], rules[j], this->port_ranges)) {
                     shadowed_rule_indices.push_back(i);
@@ -1346,46 +2327,397 @@ public:
             return;
         }
         
-        std::vector<int> all_rule_indices(rules.size());
-        std::iota(all_rule_indices.begin(), all_rule_indices.end(), 0);
+        std::vector<int> all_rule_indices;
+        all_rule_indices.reserve(rules.size());
+        for (size_t i = 0; i < rules.size(); ++i) {
+            if (rules[i].is_active) {
+                all_rule_indices.push_back(static_cast<int>(i));
+            }
+        }
 
-        const int LEAF_NODE_RULE_THRESHOLD = 4;
-        const int MAX_TREE_DEPTH = 8;
+        decision_tree = build_tree_recursive(all_rule_indices, 0, TREE_LEAF_RULE_THRESHOLD, TREE_MAX_DEPTH);
+    }
 
-        decision_tree = build_tree_recursive(all_rule_indices, 0, LEAF_NODE_RULE_THRESHOLD, MAX_TREE_DEPTH);
+    // Frozen mode: compiles the decision tree into a flat node array that
+    // lookup_single and classify then walk instead of the pointer tree. Rule
+    // changes keep working; each one patches the compiled tree in place.
+    void freeze() {
+        frozen = true;
+        compile_flat_tree();
     }
 
+    void thaw() {
+        frozen = false;
+        flat_tree.clear();
+        flat_tree.shrink_to_fit();
+        flat_tree_rules.clear();
+        flat_tree_rules.shrink_to_fit();
+    }
+
+    bool is_frozen() const { return frozen; }
+
+    MaintenanceStats get_maintenance_stats() const { return maintenance; }
+
+    // True once incremental updates have drifted far enough from a fresh build
+    // that a full rebuild pays off: more in-place inserts than half the live
+    // rules (tree splits were chosen for the old rule mix), more than a quarter
+    // of positions held by soft-deleted rules, or inserts that together moved
+    // more rules than are live (the spare slots near them are used up).
+    bool needs_rebalance() const {
+        const size_t occupied = rules.size() - std::min(maintenance.vacant_slots, rules.size());
+        const size_t live = occupied - std::min(maintenance.inactive_rules, occupied);
+        const bool tree_drifted = maintenance.incremental_inserts > std::max(REBALANCE_MIN_UPDATES, live / 2);
+        const bool too_many_dead = maintenance.inactive_rules > std::max(REBALANCE_MIN_UPDATES, occupied / 4);
+        const bool slack_used_up = maintenance.shifted_rules > std::max(REBALANCE_MIN_UPDATES, live);
+        return tree_drifted || too_many_dead || slack_used_up;
+    }
+
+    // Compacts soft-deleted rules and rebuilds every lookup structure from scratch.
+    void rebalance() {
+        rebuild_optimized_structures();
+    }
+
+    // With auto rebalance on (the default), add_rule_with_ranges rebuilds inline
+    // as soon as needs_rebalance() is true. Turn it off to keep inserts cheap and
+    // call rebalance() from a maintenance path instead.
+    void set_auto_rebalance(bool enabled) { auto_rebalance = enabled; }
+    bool get_auto_rebalance() const { return auto_rebalance; }
+
 private:
     void rebuild_optimized_structures_from_sorted_rules() {
-        // This method assumes rules are already active and sorted.
+        // This method assumes rules are already sorted (soft-deleted rules may remain).
     // It rebuilds data structures like bitmaps and decision trees from the current `rules` vector.
+        layout_rule_slots();
         field_bitmaps.clear();
         if (!rules.empty()) {
-            size_t num_fields_for_bitmap = rules[0].value.size(); // Assuming all rules have same size
+            // Assuming all rules have same size
+            size_t num_fields_for_bitmap = std::min(rules[0].value.size(), MAX_BITMAP_FIELDS);
             if (num_fields_for_bitmap > 0) {
                 field_bitmaps.resize(num_fields_for_bitmap);
                 for (size_t field_idx = 0; field_idx < num_fields_for_bitmap; ++field_idx) {
-                    field_bitmaps[field_idx].num_rules = 0; // Reset rule count for this bitmap
+                    BitmapTCAM& bitmap = field_bitmaps[field_idx];
+                    bitmap.reset(rules.size());
                     for (size_t rule_idx = 0; rule_idx < rules.size(); ++rule_idx) {
-                         if (rule_idx < BitmapTCAM::MAX_RULES) {
-                            // Ensure rule has this field, though with fixed size rules this should be true
-                            if (rules[rule_idx].value.size() > field_idx && rules[rule_idx].mask.size() > field_idx) {
-                                field_bitmaps[field_idx].add_rule(rule_idx,
-                                                                 rules[rule_idx].value[field_idx],
-                                                                 rules[rule_idx].mask[field_idx]);
-                            } else {
-                                // This case implies inconsistent rule structure, handle defensively
-                                field_bitmaps[field_idx].add_rule(rule_idx, 0, 0);
-                            }
+                        // Free slots stay clear, so inserts can move rules into them
+                        if (!rules[rule_idx].is_active) {
+                            continue;
+                        }
+                        // Ensure rule has this field, though with fixed size rules this should be true
+                        if (rules[rule_idx].value.size() > field_idx && rules[rule_idx].mask.size() > field_idx) {
+                            bitmap.add_rule(rule_idx, rules[rule_idx].value[field_idx], rules[rule_idx].mask[field_idx]);
                         } else {
-                            break;
+                            // This case implies inconsistent rule structure, handle defensively
+                            bitmap.add_rule(rule_idx, 0, 0);
                         }
                     }
-                    field_bitmaps[field_idx].num_rules = std::min(rules.size(), BitmapTCAM::MAX_RULES);
+                    bitmap.finalize();
                 }
             }
         }
         build_decision_tree(); // build_decision_tree uses this->rules
+        build_rule_arena();
+        if (frozen) {
+            compile_flat_tree();
+        }
+
+        maintenance.incremental_inserts = 0;
+        maintenance.subtree_rebuilds = 0;
+        maintenance.shifted_rules = 0;
+        maintenance.inactive_rules = static_cast<size_t>(
+            std::count_if(rules.begin(), rules.end(), [](const Rule& r) { return !r.is_active && !is_vacant(r); }));
+        maintenance.full_rebuilds++;
+    }
+
+    static bool is_vacant(const Rule& r) { return r.id == VACANT_RULE_ID; }
+
+    // A vacant slot after `prev`: inactive, and with prev's sort key.
+    static Rule make_vacant_slot(const Rule& prev) {
+        Rule slot = prev;
+        slot.id = VACANT_RULE_ID;
+        slot.is_active = false;
+        slot.hit_count = 0;
+        slot.last_hit_timestamp = {};
+        return slot;
+    }
+
+    // Lays the sorted rules out again with one vacant slot after every
+    // RULE_SLACK_INTERVAL of them (none after the last), dropping old ones.
+    void layout_rule_slots() {
+        std::vector<Rule> laid_out;
+        laid_out.reserve(rules.size() + rules.size() / RULE_SLACK_INTERVAL);
+        size_t placed = 0;
+        for (Rule& r : rules) {
+            if (is_vacant(r)) {
+                continue;
+            }
+            if (placed > 0 && placed % RULE_SLACK_INTERVAL == 0) {
+                laid_out.push_back(make_vacant_slot(laid_out.back()));
+            }
+            laid_out.push_back(std::move(r));
+            placed++;
+        }
+        rules = std::move(laid_out);
+        free_slots.assign(rules.size());
+        vacant_slots.assign(rules.size());
+        for (size_t i = 0; i < rules.size(); ++i) {
+            if (!rules[i].is_active) free_slots.set(i);
+            if (is_vacant(rules[i])) vacant_slots.set(i);
+        }
+        maintenance.vacant_slots = rules.size() - placed;
+    }
+
+    // Nearest position to pos (in either direction) an insert may take, or
+    // SlotBits::NONE when every position holds a live rule.
+    size_t nearest_free_slot(size_t pos) const {
+        const size_t after = free_slots.next_set(pos);
+        const size_t before = free_slots.prev_set(pos);
+        if (before == SlotBits::NONE) return after;
+        if (after == SlotBits::NONE) return before;
+        return (after - pos <= pos - before) ? after : before;
+    }
+
+    // Adds a vacant slot at the end of `rules` and of every lookup structure.
+    void append_vacant_slot() {
+        rules.push_back(make_vacant_slot(rules.back()));
+        free_slots.push_back(true);
+        vacant_slots.push_back(true);
+        maintenance.vacant_slots++;
+        for (auto& bitmap : field_bitmaps) {
+            bitmap.append_slot();
+        }
+        rule_arena.resize(rules.size());
+    }
+
+    // Places `rule` at sorted position pos without renumbering the whole table.
+    // The rules between pos and the nearest free slot move one position towards
+    // it, and only they are renumbered in the bitmaps, arena and trees. A
+    // soft-deleted rule whose slot is taken is dropped for good.
+    void insert_rule_into_optimized_structures(size_t pos, Rule rule) {
+        size_t hole = nearest_free_slot(pos);
+        if (hole == SlotBits::NONE) {
+            append_vacant_slot();
+            hole = rules.size() - 1;
+        }
+        if (is_vacant(rules[hole])) {
+            vacant_slots.reset(hole);
+            maintenance.vacant_slots--;
+        } else {
+            maintenance.inactive_rules--;
+        }
+        free_slots.reset(hole);
+
+        // Every rule strictly between pos and the hole is live.
+        size_t target = pos;
+        if (hole >= pos) {
+            std::move_backward(rules.begin() + static_cast<std::ptrdiff_t>(pos),
+                               rules.begin() + static_cast<std::ptrdiff_t>(hole),
+                               rules.begin() + static_cast<std::ptrdiff_t>(hole + 1));
+            rule_arena.move_entries(pos, pos + 1, hole - pos);
+            for (auto& bitmap : field_bitmaps) {
+                bitmap.shift_up(pos, hole);
+            }
+            for (size_t i = hole; i > pos; --i) {
+                renumber_tree_rule(static_cast<int>(i - 1), static_cast<int>(i));
+            }
+            maintenance.shifted_rules += hole - pos;
+        } else {
+            target = pos - 1;
+            std::move(rules.begin() + static_cast<std::ptrdiff_t>(hole + 1),
+                      rules.begin() + static_cast<std::ptrdiff_t>(pos),
+                      rules.begin() + static_cast<std::ptrdiff_t>(hole));
+            rule_arena.move_entries(hole + 1, hole, target - hole);
+            for (auto& bitmap : field_bitmaps) {
+                bitmap.shift_down(hole + 1, pos);
+            }
+            for (size_t i = hole; i < target; ++i) {
+                renumber_tree_rule(static_cast<int>(i + 1), static_cast<int>(i));
+            }
+            maintenance.shifted_rules += target - hole;
+        }
+
+        rules[target] = std::move(rule);
+        const Rule& r = rules[target];
+        pack_rule_at(target);
+        for (size_t field_idx = 0; field_idx < field_bitmaps.size(); ++field_idx) {
+            if (r.value.size() > field_idx && r.mask.size() > field_idx) {
+                field_bitmaps[field_idx].set_rule(target, r.value[field_idx], r.mask[field_idx]);
+            }
+        }
+        insert_into_decision_tree(static_cast<int>(target));
+        maintenance.incremental_inserts++;
+    }
+
+    void compile_flat_tree() {
+        flat_tree.clear();
+        flat_tree_rules.clear();
+        flat_tree_garbage = 0;
+        if (!decision_tree) {
+            return;
+        }
+        flat_tree.push_back(FlatDecisionNode{});
+        compile_flat_subtree(decision_tree.get(), 0);
+    }
+
+    // Compiles the subtree rooted at `root` into flat_tree[at], breadth-first.
+    // Its descendants and rule slices are appended to the two arrays. A missing
+    // child still gets a placeholder slot so siblings stay adjacent.
+    void compile_flat_subtree(DecisionNode* root, uint32_t at) {
+        std::vector<std::pair<DecisionNode*, uint32_t>> pending{{root, at}};
+        for (size_t i = 0; i < pending.size(); ++i) {
+            DecisionNode* src = pending[i].first;
+            const uint32_t slot = pending[i].second;
+            FlatDecisionNode node{};
+            node.field_offset = -1;
+            node.rules_begin = static_cast<uint32_t>(flat_tree_rules.size());
+            if (src) {
+                src->flat_index = slot;
+                flat_tree_rules.insert(flat_tree_rules.end(), src->rule_indices.begin(), src->rule_indices.end());
+                node.rules_count = static_cast<uint32_t>(src->rule_indices.size());
+                if (src->field_offset >= 0 && (src->left || src->right)) {
+                    node.field_offset = static_cast<int8_t>(src->field_offset);
+                    node.test_value = src->test_value;
+                    node.mask = src->mask;
+                    node.child_flags = static_cast<uint8_t>((src->left ? FlatDecisionNode::HAS_LEFT : 0) |
+                                                            (src->right ? FlatDecisionNode::HAS_RIGHT : 0));
+                    node.first_child = static_cast<uint32_t>(flat_tree.size());
+                    pending.emplace_back(src->left.get(), node.first_child);
+                    pending.emplace_back(src->right.get(), node.first_child + 1);
+                    flat_tree.push_back(FlatDecisionNode{});
+                    flat_tree.push_back(FlatDecisionNode{});
+                }
+            }
+            flat_tree[slot] = node;
+        }
+    }
+
+    // Copies node's rule list into a fresh slice at the end of the pool (its
+    // old slice becomes garbage); the pool is recompiled once half of it is.
+    void reemit_flat_rules(const DecisionNode& node) {
+        FlatDecisionNode& flat = flat_tree[node.flat_index];
+        flat_tree_garbage += flat.rules_count;
+        flat.rules_begin = static_cast<uint32_t>(flat_tree_rules.size());
+        flat.rules_count = static_cast<uint32_t>(node.rule_indices.size());
+        flat_tree_rules.insert(flat_tree_rules.end(), node.rule_indices.begin(), node.rule_indices.end());
+        if (flat_tree_garbage > std::max<size_t>(REBALANCE_MIN_UPDATES, flat_tree_rules.size() / 2)) {
+            compile_flat_tree();
+        }
+    }
+
+    bool flat_node_in_sync(const DecisionNode* node) const {
+        return frozen && node && node->flat_index < flat_tree.size();
+    }
+
+    // Follows the path build_tree_recursive would give rules[rule_idx]: down the
+    // branch matching its byte while it pins the tested field exactly, stopping
+    // at the first node it does not (or at a leaf). Returns the owning slot and,
+    // through `parent`, the node that slot belongs to (null for the root).
+    std::unique_ptr<DecisionNode>* find_tree_slot(int rule_idx, int& depth, DecisionNode** parent = nullptr) {
+        const Rule& r = rules[static_cast<size_t>(rule_idx)];
+        std::unique_ptr<DecisionNode>* slot = &decision_tree;
+        depth = 0;
+        if (parent) *parent = nullptr;
+        while (*slot && (*slot)->field_offset != -1) {
+            DecisionNode& node = **slot;
+            const size_t f = static_cast<size_t>(node.field_offset);
+            if (f >= r.mask.size() || f >= r.value.size() || r.mask[f] != node.mask) {
+                break;
+            }
+            if (parent) *parent = &node;
+            slot = (r.value[f] == node.test_value) ? &node.left : &node.right;
+            depth++;
+        }
+        return slot;
+    }
+
+    // rules[new_idx] just moved there from the adjacent old_idx: updates its
+    // entry in the decision tree and, when frozen, in the flat tree. Callers
+    // move a run of rules from the far end first, so lists stay sorted.
+    void renumber_tree_rule(int old_idx, int new_idx) {
+        int depth = 0;
+        DecisionNode* node = find_tree_slot(new_idx, depth)->get();
+        if (!node) return;
+        auto it = std::lower_bound(node->rule_indices.begin(), node->rule_indices.end(), old_idx);
+        if (it == node->rule_indices.end() || *it != old_idx) return;
+        *it = new_idx;
+        if (flat_node_in_sync(node)) {
+            const FlatDecisionNode& flat = flat_tree[node->flat_index];
+            int32_t* begin = flat_tree_rules.data() + flat.rules_begin;
+            int32_t* slot = std::lower_bound(begin, begin + flat.rules_count, old_idx);
+            if (slot != begin + flat.rules_count && *slot == old_idx) {
+                *slot = new_idx;
+            }
+        }
+    }
+
+    void insert_into_decision_tree(int rule_idx) {
+        int depth = 0;
+        DecisionNode* parent = nullptr;
+        std::unique_ptr<DecisionNode>* slot = find_tree_slot(rule_idx, depth, &parent);
+        const bool created = !*slot;
+        if (created) {
+            *slot = std::make_unique<DecisionNode>();
+            (*slot)->field_offset = -1;
+            (*slot)->mask = 0;
+            (*slot)->test_value = 0;
+        }
+        std::vector<int>& indices = (*slot)->rule_indices;
+        indices.insert(std::upper_bound(indices.begin(), indices.end(), rule_idx), rule_idx);
+
+        // Re-split an overfull leaf where it stands; only this subtree is rebuilt.
+        // Leaves that cannot be split usefully are retried only when they double.
+        const uint32_t flat_index = (*slot)->flat_index;
+        bool resplit = false;
+        const size_t n = indices.size();
+        if ((*slot)->field_offset == -1 && depth < TREE_MAX_DEPTH &&
+            n >= TREE_LEAF_SPLIT_THRESHOLD && (n & (n - 1)) == 0) {
+            std::vector<int> leaf_rules = std::move(indices);
+            *slot = build_tree_recursive(leaf_rules, depth, TREE_LEAF_RULE_THRESHOLD, TREE_MAX_DEPTH);
+            maintenance.subtree_rebuilds++;
+            resplit = true;
+        }
+
+        // Patch the frozen tree around the one node that changed.
+        if (!frozen) {
+            return;
+        }
+        if (flat_tree.empty() || (created && !flat_node_in_sync(parent))) {
+            compile_flat_tree();
+        } else if (created) {
+            FlatDecisionNode& flat_parent = flat_tree[parent->flat_index];
+            if (flat_parent.child_flags == 0) {
+                compile_flat_tree(); // No placeholder pair to fill
+                return;
+            }
+            const bool is_left = slot == &parent->left;
+            flat_parent.child_flags |= is_left ? FlatDecisionNode::HAS_LEFT : FlatDecisionNode::HAS_RIGHT;
+            compile_flat_subtree(slot->get(), flat_parent.first_child + (is_left ? 0u : 1u));
+        } else if (resplit) {
+            flat_tree_garbage += flat_tree[flat_index].rules_count;
+            compile_flat_subtree(slot->get(), flat_index);
+        } else {
+            reemit_flat_rules(**slot);
+        }
+    }
+
+    void erase_from_decision_tree(int rule_idx) {
+        int depth = 0;
+        DecisionNode* node = find_tree_slot(rule_idx, depth)->get();
+        if (!node) return;
+        std::vector<int>& indices = node->rule_indices;
+        auto it = std::lower_bound(indices.begin(), indices.end(), rule_idx);
+        if (it == indices.end() || *it != rule_idx) return;
+        indices.erase(it);
+        if (flat_node_in_sync(node)) {
+            FlatDecisionNode& flat = flat_tree[node->flat_index];
+            int32_t* begin = flat_tree_rules.data() + flat.rules_begin;
+            int32_t* end = begin + flat.rules_count;
+            int32_t* slot = std::lower_bound(begin, end, rule_idx);
+            if (slot != end && *slot == rule_idx) {
+                std::move(slot + 1, end, slot);
+                flat.rules_count--;
+                flat_tree_garbage++;
+            }
+        }
     }
 
     void rebuild_optimized_structures() {
@@ -1393,8 +2725,10 @@ private:
         // 1. Filter to keep only active rules, effectively compacting the rules vector.
         rules.erase(std::remove_if(rules.begin(), rules.end(), [](const Rule& r){ return !r.is_active; }), rules.end());
 
-        // 2. Sort the active rules
-        std::sort(rules.begin(), rules.end(), [this](const Rule& a, const Rule& b) {
+        // 2. Sort the active rules. The sort is stable so rules that tie on priority
+        //    and specificity keep their current order and a rebalance never changes
+        //    which of them wins.
+        std::stable_sort(rules.begin(), rules.end(), [this](const Rule& a, const Rule& b) {
             if (a.priority != b.priority) {
                 return a.priority > b.priority;
             }
@@ -1409,7 +2743,7 @@ private:
 public: // Statistics methods
     std::optional<RuleStats> get_rule_stats(uint64_t rule_id) const {
         for (const auto& r : rules) {
-            if (r.id == rule_id) {
+            if (r.id == rule_id && !is_vacant(r)) {
                 RuleStats stats;
                 stats.rule_id = r.id;
                 stats.priority = r.priority;
@@ -1428,6 +2762,7 @@ public: // Statistics methods
         std::vector<RuleStats> all_stats;
         all_stats.reserve(rules.size());
         for (const auto& r : rules) {
+            if (is_vacant(r)) continue;
             RuleStats stats;
             stats.rule_id = r.id;
             stats.priority = r.priority;
@@ -1443,9 +2778,10 @@ public: // Statistics methods
 
     RuleUtilizationMetrics get_rule_utilization() const {
         RuleUtilizationMetrics metrics;
-        metrics.total_rules = rules.size();
+        metrics.total_rules = rules.size() - maintenance.vacant_slots;
 
         for (const auto& r : rules) {
+            if (is_vacant(r)) continue;
             if (r.is_active) {
                 metrics.active_rules++;
                 if (r.hit_count > 0) {
@@ -1545,14 +2881,9 @@ public: // Statistics methods
     // size_t count_active_rules_const() const { ... }
     // This can be removed or kept if used by other methods; for now, backup_rules doesn't need it.
 
+    // Parses the whole stream before touching the current rules: on a malformed
+    // line or I/O error it returns false and the TCAM is left as it was.
     bool restore_rules(std::istream& stream) {
-        rules.clear();
-        port_ranges.clear();
-        next_rule_id = 0;
-        decision_tree.reset();
-        field_bitmaps.clear();
-        // stats = {};
-
         std::vector<RuleOperation> batch;
         std::string line;
 
@@ -1579,7 +2910,6 @@ public: // Statistics methods
                   >> temp_proto_val >> temp_proto_mask_val
                   >> temp_eth_type_val >> temp_eth_type_mask_val
                   >> priority >> action)) {
-                rules.clear(); port_ranges.clear(); next_rule_id = 0; decision_tree.reset(); field_bitmaps.clear();
                 return false; // Malformed line
             }
 
@@ -1587,7 +2917,6 @@ public: // Statistics methods
             char trailing_char_check;
             if (ss >> trailing_char_check) {
                 // If we successfully read another character, it means there's unexpected data
-                rules.clear(); port_ranges.clear(); next_rule_id = 0; decision_tree.reset(); field_bitmaps.clear();
                 return false; // Trailing data found
             }
 
@@ -1601,22 +2930,115 @@ public: // Statistics methods
             if (src_port_mode == 'W') { fields.src_port_min = 0; fields.src_port_max = 0xFFFF; }
             else if (src_port_mode == 'E') { fields.src_port_min = p1; fields.src_port_max = p1; }
             else if (src_port_mode == 'R') { fields.src_port_min = p1; fields.src_port_max = p2; }
-            else { rules.clear(); port_ranges.clear(); next_rule_id = 0; decision_tree.reset(); field_bitmaps.clear(); return false; } // Invalid mode
+            else { return false; } // Invalid mode
 
             // Process Destination Port
             if (dst_port_mode == 'W') { fields.dst_port_min = 0; fields.dst_port_max = 0xFFFF; }
             else if (dst_port_mode == 'E') { fields.dst_port_min = p3; fields.dst_port_max = p3; }
             else if (dst_port_mode == 'R') { fields.dst_port_min = p3; fields.dst_port_max = p4; }
-            else { rules.clear(); port_ranges.clear(); next_rule_id = 0; decision_tree.reset(); field_bitmaps.clear(); return false; }
+            else { return false; }
 
             batch.push_back(RuleOperation::AddRule(fields, priority, action));
         }
 
         if (stream.bad()) { // IO error
-             rules.clear(); port_ranges.clear(); next_rule_id = 0; decision_tree.reset(); field_bitmaps.clear();
             return false;
         }
 
+        reset_rule_state();
         return update_rules_atomic(batch);
     }
+
+private:
+    // Drops every rule together with all structures indexed by rule position
+    // (bitmaps, decision tree, rule arena, flat tree), so none of them can
+    // refer past the end of an emptied `rules`. Frozen mode stays on.
+    void reset_rule_state() {
+        rules.clear();
+        port_ranges.clear();
+        next_rule_id = 0;
+        decision_tree.reset();
+        field_bitmaps.clear();
+        rule_arena.clear();
+        flat_tree.clear();
+        flat_tree_rules.clear();
+        flat_tree_garbage = 0;
+        free_slots.assign(0);
+        vacant_slots.assign(0);
+        maintenance.inactive_rules = 0;
+        maintenance.incremental_inserts = 0;
+        maintenance.vacant_slots = 0;
+        maintenance.shifted_rules = 0;
+    }
+};
+
+// Lock-free concurrent read side for OptimizedTCAM.
+//
+// Every published generation is an immutable OptimizedTCAM (rules, decision
+// tree, bitmaps and rule arena). Writers copy the current rule set,
+// apply a RuleUpdateBatch and rebuild off to the side, then swap the new
+// generation in with one atomic store; the previous generation is freed once
+// all readers that could still see it have finished. Readers take no locks:
+// each thread registers once and every lookup pins an epoch for its duration.
+//
+// Lookups go through OptimizedTCAM::classify / classify_batch, so per-rule hit
+// counts and latency statistics are not recorded on this path.
+class ConcurrentTCAM {
+public:
+    using Reader = concurrent::epoch_domain::reader;
+
+    explicit ConcurrentTCAM(size_t max_readers = concurrent::epoch_domain::default_max_readers)
+        : current_(std::make_unique<OptimizedTCAM>(), max_readers) {}
+
+    // One per reader thread; throws std::runtime_error once max_readers are registered.
+    Reader register_reader() { return current_.register_reader(); }
+
+    int lookup(Reader& reader, std::span<const uint8_t> packet) const {
+        auto snapshot = current_.read(reader);
+        return snapshot->classify(packet);
+    }
+
+    void lookup_batch(Reader& reader, const uint8_t* const* headers, size_t count, size_t header_len, int* results) const {
+        auto snapshot = current_.read(reader);
+        snapshot->classify_batch(headers, count, header_len, results);
+    }
+
+    // Runs fn(const OptimizedTCAM&) against the current generation while it is
+    // pinned, e.g. for detect_conflicts() or backup_rules(). The reference must
+    // not escape fn.
+    template <typename Fn>
+    decltype(auto) with_snapshot(Reader& reader, Fn&& fn) const {
+        auto snapshot = current_.read(reader);
+        return std::forward<Fn>(fn)(*snapshot);
+    }
+
+    // Builds and publishes the next generation. Returns false (and publishes
+    // nothing) if the batch is rejected, exactly like OptimizedTCAM::update_rules_atomic.
+    // Must not be called from a thread that is inside with_snapshot().
+    bool update_rules_atomic(const OptimizedTCAM::RuleUpdateBatch& batch) {
+        return current_.update([&batch](const OptimizedTCAM* current) -> std::unique_ptr<OptimizedTCAM> {
+            auto next = std::make_unique<OptimizedTCAM>();
+            if (current) {
+                next->copy_rule_state_from(*current);
+            }
+            if (!next->update_rules_atomic(batch)) {
+                return nullptr;
+            }
+            return next;
+        });
+    }
+
+    void add_rule_with_ranges(const OptimizedTCAM::WildcardFields& fields, int priority, int action) {
+        update_rules_atomic({OptimizedTCAM::RuleOperation::AddRule(fields, priority, action)});
+    }
+
+    bool delete_rule(uint64_t rule_id) {
+        return update_rules_atomic({OptimizedTCAM::RuleOperation::DeleteRule(rule_id)});
+    }
+
+    // Number of generations published so far.
+    uint64_t generation() const { return current_.generation(); }
+
+private:
+    concurrent::rcu_ptr<OptimizedTCAM> current_;
 };
@@ -1,6 +1,10 @@
 #ifndef THREAD_SAFE_CACHE_HPP
 #define THREAD_SAFE_CACHE_HPP
 
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <functional>
 #include <iostream> // TODO: remove this include, only for basic printing during development
 #include <list>
 #include <mutex>
@@ -8,15 +12,104 @@
 #include <queue>
 #include <stdexcept>
 #include <unordered_map>
+#include <vector>
 
 namespace cpp_collections {
 
 enum class EvictionPolicy {
     LRU,
     LFU,
-    FIFO
+    FIFO,
+    WTinyLFU, // Window LRU + segmented LRU main space, admission by a frequency sketch
+    ARC       // Adaptive Replacement Cache: recency/frequency lists with ghost history
 };
 
+namespace detail {
+
+// Count-min sketch of 4-bit counters, four per key, estimating how often a key
+// was requested recently. Counters saturate at 15 and are all halved once
+// `sample_size` increments have been recorded, so past popularity fades.
+template <typename Key, typename Hash = std::hash<Key>>
+class FrequencySketch {
+public:
+    explicit FrequencySketch(size_t capacity) {
+        size_t counters = 64;
+        while (counters < capacity * 4) {
+            counters <<= 1;
+        }
+        table_.assign(counters / 16, 0);
+        counter_mask_ = counters - 1;
+        sample_size_ = std::max<size_t>(10 * capacity, 64);
+    }
+
+    uint8_t frequency(const Key& key) const {
+        const uint64_t h = spread(key);
+        uint8_t f = 15;
+        for (size_t i = 0; i < 4; ++i) {
+            f = std::min(f, counter(index_of(h, i)));
+        }
+        return f;
+    }
+
+    void increment(const Key& key) {
+        const uint64_t h = spread(key);
+        bool added = false;
+        for (size_t i = 0; i < 4; ++i) {
+            added |= increment_at(index_of(h, i));
+        }
+        if (added && ++additions_ >= sample_size_) {
+            halve();
+        }
+    }
+
+    void clear() {
+        std::fill(table_.begin(), table_.end(), 0);
+        additions_ = 0;
+    }
+
+private:
+    static constexpr std::array<uint64_t, 4> kSeeds = {
+        0xc3a5c85c97cb3127ull, 0xb492b66fbe98f273ull, 0x9ae16a3b2f90404full, 0xcbf29ce484222325ull};
+
+    std::vector<uint64_t> table_; // 16 counters per word
+    size_t counter_mask_ = 0;
+    size_t sample_size_ = 0;
+    size_t additions_ = 0;
+
+    static uint64_t spread(const Key& key) {
+        uint64_t h = static_cast<uint64_t>(Hash{}(key)) * 0x9E3779B97F4A7C15ull;
+        return h ^ (h >> 29);
+    }
+
+    size_t index_of(uint64_t h, size_t i) const {
+        const uint64_t x = (h + kSeeds[i]) * kSeeds[i];
+        return static_cast<size_t>(x >> 32) & counter_mask_;
+    }
+
+    uint8_t counter(size_t index) const {
+        return static_cast<uint8_t>((table_[index / 16] >> ((index % 16) * 4)) & 0xF);
+    }
+
+    bool increment_at(size_t index) {
+        const unsigned shift = static_cast<unsigned>((index % 16) * 4);
+        uint64_t& word = table_[index / 16];
+        if (((word >> shift) & 0xF) == 0xF) {
+            return false;
+        }
+        word += uint64_t{1} << shift;
+        return true;
+    }
+
+    void halve() {
+        for (uint64_t& word : table_) {
+            word = (word >> 1) & 0x7777777777777777ull;
+        }
+        additions_ /= 2;
+    }
+};
+
+} // namespace detail
+
 template <typename Key, typename Value>
 class ThreadSafeCache {
 public:
@@ -35,8 +128,13 @@ private:
     EvictionPolicy policy_;
     mutable std::mutex mutex_;
 
-    // Data storage: map of keys to values
-    std::unordered_map<Key, Value> cache_data_;
+    // Data storage: map of keys to values. W-TinyLFU and ARC also keep each
+    // key's policy node index here, so a hit costs one hash lookup.
+    struct CacheEntry {
+        Value value;
+        uint32_t node; // Index into nodes_ (W-TinyLFU and ARC only)
+    };
+    std::unordered_map<Key, CacheEntry> cache_data_;
 
     // --- LRU specific members ---
     // List of keys, most recently used at front, least recently used at back
@@ -72,6 +170,45 @@ private:
         >
     > lfu_key_to_node_and_iter_;
 
+    // --- W-TinyLFU and ARC members ---
+    // Both keep their keys in one node array, linked by index into a few
+    // intrusive lists instead of node-per-key std::lists. Resident keys find
+    // their node through cache_data_; ARC's ghost lists hold keys whose values
+    // were evicted, found through ghost_index_.
+    static constexpr uint32_t kNil = UINT32_MAX;
+    // W-TinyLFU lists
+    static constexpr uint8_t kWindow = 0;
+    static constexpr uint8_t kProbation = 1;
+    static constexpr uint8_t kProtected = 2;
+    // ARC lists
+    static constexpr uint8_t kT1 = 0; // Resident, seen once recently
+    static constexpr uint8_t kT2 = 1; // Resident, seen at least twice
+    static constexpr uint8_t kB1 = 2; // Ghosts evicted from T1
+    static constexpr uint8_t kB2 = 3; // Ghosts evicted from T2
+
+    struct PolicyNode {
+        Key key;
+        uint32_t prev;
+        uint32_t next;
+        uint8_t list;
+    };
+
+    struct PolicyList {
+        uint32_t head = kNil; // Most recent
+        uint32_t tail = kNil; // Least recent
+        size_t size = 0;
+    };
+
+    std::vector<PolicyNode> nodes_;
+    std::vector<uint32_t> free_nodes_;
+    std::unordered_map<Key, uint32_t> ghost_index_; // ARC ghosts (B1 and B2)
+    std::array<PolicyList, 4> lists_{};
+
+    size_t window_capacity_ = 0;    // W-TinyLFU window size (about 1% of capacity)
+    size_t protected_capacity_ = 0; // W-TinyLFU protected size (80% of the main space)
+    std::optional<detail::FrequencySketch<Key>> sketch_;
+    size_t arc_target_t1_ = 0;      // ARC's adaptive target size p for T1
+
 
     // Private helper methods
     void evict();
@@ -90,6 +227,22 @@ private:
     void evict_lfu();
     void increment_frequency_lfu(const Key& key);
 
+    // Node list helpers (W-TinyLFU and ARC)
+    uint32_t node_insert(const Key& key, uint8_t list);
+    void node_remove(uint32_t index);
+    void list_unlink(uint32_t index);
+    void list_push_front(uint32_t index, uint8_t list);
+    void evict_node(uint32_t index);
+    void drop_ghost(uint32_t index);
+
+    // W-TinyLFU helpers
+    void insert_tinylfu(const Key& key, const Value& value);
+    void record_access_tinylfu(uint32_t index);
+
+    // ARC helpers
+    void insert_arc(const Key& key, const Value& value);
+    void arc_replace(bool ghost_hit_in_b2);
+
 };
 
 // Constructor
@@ -99,34 +252,60 @@ ThreadSafeCache<Key, Value>::ThreadSafeCache(size_t capacity, EvictionPolicy pol
     if (capacity == 0) {
         throw std::invalid_argument("Cache capacity must be greater than 0.");
     }
+    if (capacity >= kNil / 2) {
+        throw std::invalid_argument("Cache capacity is too large.");
+    }
+    if (policy_ == EvictionPolicy::WTinyLFU) {
+        window_capacity_ = std::max<size_t>(1, capacity / 100);
+        protected_capacity_ = (capacity - window_capacity_) * 8 / 10;
+        sketch_.emplace(capacity);
+    }
 }
 
 // Public methods
 template <typename Key, typename Value>
 void ThreadSafeCache<Key, Value>::put(const Key& key, const Value& value) {
     std::lock_guard<std::mutex> lock(mutex_);
+    if (sketch_) {
+        sketch_->increment(key);
+    }
 
     // If key already exists, update its value and handle policy-specific access recording
     auto it = cache_data_.find(key);
     if (it != cache_data_.end()) {
-        it->second = value;
+        it->second.value = value;
         if (policy_ == EvictionPolicy::LRU) {
             record_access_lru(key);
         } else if (policy_ == EvictionPolicy::LFU) {
             // LFU: Accessing an existing item increments its frequency
             increment_frequency_lfu(key);
+        } else if (policy_ == EvictionPolicy::WTinyLFU) {
+            record_access_tinylfu(it->second.node);
+        } else if (policy_ == EvictionPolicy::ARC) {
+            list_unlink(it->second.node);
+            list_push_front(it->second.node, kT2);
         }
         // FIFO: No special action on updating an existing item's value regarding its position
         return;
     }
 
+    // These two decide what to evict only after seeing the new key
+    if (policy_ == EvictionPolicy::WTinyLFU) {
+        insert_tinylfu(key, value);
+        return;
+    }
+    if (policy_ == EvictionPolicy::ARC) {
+        insert_arc(key, value);
+        return;
+    }
+
     // Key does not exist, check for capacity
     if (cache_data_.size() >= capacity_) {
         evict(); // Evict an item based on policy
     }
 
     // Insert the new item
-    cache_data_[key] = value;
+    cache_data_.emplace(key, CacheEntry{value, kNil});
     if (policy_ == EvictionPolicy::LRU) {
         lru_order_.push_front(key);
         lru_key_to_iter_[key] = lru_order_.begin();
@@ -140,6 +319,9 @@ void ThreadSafeCache<Key, Value>::put(const Key& key, const Value& value) {
 template <typename Key, typename Value>
 std::optional<Value> ThreadSafeCache<Key, Value>::get(const Key& key) {
     std::lock_guard<std::mutex> lock(mutex_);
+    if (sketch_) {
+        sketch_->increment(key); // Misses count too: they are what admission weighs
+    }
 
     auto it = cache_data_.find(key);
     if (it == cache_data_.end()) {
@@ -151,10 +333,15 @@ std::optional<Value> ThreadSafeCache<Key, Value>::get(const Key& key) {
         record_access_lru(key);
     } else if (policy_ == EvictionPolicy::LFU) {
         increment_frequency_lfu(key);
+    } else if (policy_ == EvictionPolicy::WTinyLFU) {
+        record_access_tinylfu(it->second.node);
+    } else if (policy_ == EvictionPolicy::ARC) {
+        list_unlink(it->second.node);
+        list_push_front(it->second.node, kT2);
     }
     // FIFO: No special action on get
 
-    return it->second;
+    return it->second.value;
 }
 
 template <typename Key, typename Value>
@@ -167,6 +354,7 @@ bool ThreadSafeCache<Key, Value>::erase(const Key& key) {
     }
 
     // Key found, remove it from main data and policy-specific structures
+    const uint32_t node = it->second.node;
     cache_data_.erase(it);
 
     if (policy_ == EvictionPolicy::LRU) {
@@ -204,6 +392,9 @@ bool ThreadSafeCache<Key, Value>::erase(const Key& key) {
             }
             lfu_key_to_node_and_iter_.erase(lfu_map_iter);
         }
+    } else if (policy_ == EvictionPolicy::WTinyLFU || policy_ == EvictionPolicy::ARC) {
+        // Erased, not evicted: ARC keeps no ghost for it
+        node_remove(node);
     }
     return true;
 }
@@ -222,6 +413,15 @@ void ThreadSafeCache<Key, Value>::clear() {
     } else if (policy_ == EvictionPolicy::LFU) {
         lfu_frequency_list_.clear();
         lfu_key_to_node_and_iter_.clear();
+    } else if (policy_ == EvictionPolicy::WTinyLFU || policy_ == EvictionPolicy::ARC) {
+        nodes_.clear();
+        free_nodes_.clear();
+        ghost_index_.clear();
+        lists_ = {};
+        arc_target_t1_ = 0;
+        if (sketch_) {
+            sketch_->clear();
+        }
     }
 }
 
@@ -437,6 +637,187 @@ void ThreadSafeCache<Key, Value>::evict_lfu() {
 }
 
 
+// --- Node list helpers (W-TinyLFU and ARC) ---
+template <typename Key, typename Value>
+uint32_t ThreadSafeCache<Key, Value>::node_insert(const Key& key, uint8_t list) {
+    uint32_t index;
+    if (!free_nodes_.empty()) {
+        index = free_nodes_.back();
+        free_nodes_.pop_back();
+        nodes_[index].key = key;
+    } else {
+        index = static_cast<uint32_t>(nodes_.size());
+        nodes_.push_back(PolicyNode{key, kNil, kNil, list});
+    }
+    list_push_front(index, list);
+    return index;
+}
+
+// Unlinks and frees a node; the caller drops the key from its map
+template <typename Key, typename Value>
+void ThreadSafeCache<Key, Value>::node_remove(uint32_t index) {
+    list_unlink(index);
+    free_nodes_.push_back(index);
+}
+
+template <typename Key, typename Value>
+void ThreadSafeCache<Key, Value>::list_unlink(uint32_t index) {
+    PolicyNode& node = nodes_[index];
+    PolicyList& list = lists_[node.list];
+    if (node.prev != kNil) {
+        nodes_[node.prev].next = node.next;
+    } else {
+        list.head = node.next;
+    }
+    if (node.next != kNil) {
+        nodes_[node.next].prev = node.prev;
+    } else {
+        list.tail = node.prev;
+    }
+    --list.size;
+}
+
+template <typename Key, typename Value>
+void ThreadSafeCache<Key, Value>::list_push_front(uint32_t index, uint8_t list_id) {
+    PolicyNode& node = nodes_[index];
+    PolicyList& list = lists_[list_id];
+    node.list = list_id;
+    node.prev = kNil;
+    node.next = list.head;
+    if (list.head != kNil) {
+        nodes_[list.head].prev = index;
+    } else {
+        list.tail = index;
+    }
+    list.head = index;
+    ++list.size;
+}
+
+// Drops a resident entry's value and its node
+template <typename Key, typename Value>
+void ThreadSafeCache<Key, Value>::evict_node(uint32_t index) {
+    cache_data_.erase(nodes_[index].key);
+    node_remove(index);
+}
+
+// Forgets an ARC ghost
+template <typename Key, typename Value>
+void ThreadSafeCache<Key, Value>::drop_ghost(uint32_t index) {
+    ghost_index_.erase(nodes_[index].key);
+    node_remove(index);
+}
+
+// --- W-TinyLFU helpers ---
+// New keys enter a small LRU window. The entry pushed out of the window is a
+// candidate for the main space (a segmented LRU of probation and protected
+// entries); when the main space is full, the candidate is admitted only if the
+// sketch has seen it more often than the probation victim it would replace.
+// A burst of one-off keys therefore cycles through the window without
+// displacing the frequently used entries in the main space.
+template <typename Key, typename Value>
+void ThreadSafeCache<Key, Value>::insert_tinylfu(const Key& key, const Value& value) {
+    cache_data_.emplace(key, CacheEntry{value, node_insert(key, kWindow)});
+    if (lists_[kWindow].size <= window_capacity_) {
+        return;
+    }
+    const uint32_t candidate = lists_[kWindow].tail;
+    if (lists_[kProbation].size + lists_[kProtected].size < capacity_ - window_capacity_) {
+        list_unlink(candidate);
+        list_push_front(candidate, kProbation);
+        return;
+    }
+    uint32_t victim = lists_[kProbation].tail;
+    if (victim == kNil) {
+        victim = lists_[kProtected].tail;
+    }
+    if (victim == kNil || sketch_->frequency(nodes_[candidate].key) <= sketch_->frequency(nodes_[victim].key)) {
+        evict_node(candidate);
+        return;
+    }
+    evict_node(victim);
+    list_unlink(candidate);
+    list_push_front(candidate, kProbation);
+}
+
+template <typename Key, typename Value>
+void ThreadSafeCache<Key, Value>::record_access_tinylfu(uint32_t index) {
+    const uint8_t list = nodes_[index].list;
+    list_unlink(index);
+    if (list == kWindow) {
+        list_push_front(index, kWindow);
+        return;
+    }
+    list_push_front(index, kProtected); // A probation hit is promoted
+    if (lists_[kProtected].size > protected_capacity_) {
+        const uint32_t demoted = lists_[kProtected].tail;
+        list_unlink(demoted);
+        list_push_front(demoted, kProbation);
+    }
+}
+
+// --- ARC helpers ---
+// Follows Megiddo and Modha's ARC. T1 holds keys seen once and T2 keys seen
+// at least twice; B1 and B2 remember keys recently evicted from each. A miss
+// that hits a ghost list grows the target size of the list it came from, so
+// the split between recency and frequency adapts to the workload. A one-off
+// scan only churns T1 and cannot displace T2.
+template <typename Key, typename Value>
+void ThreadSafeCache<Key, Value>::insert_arc(const Key& key, const Value& value) {
+    auto ghost = ghost_index_.find(key);
+    if (ghost != ghost_index_.end()) {
+        const uint32_t index = ghost->second;
+        ghost_index_.erase(ghost);
+        const size_t b1 = lists_[kB1].size;
+        const size_t b2 = lists_[kB2].size;
+        const bool in_b2 = nodes_[index].list == kB2;
+        if (!in_b2) {
+            arc_target_t1_ = std::min(capacity_, arc_target_t1_ + std::max<size_t>(1, b2 / b1));
+        } else {
+            const size_t delta = std::max<size_t>(1, b1 / b2);
+            arc_target_t1_ = arc_target_t1_ > delta ? arc_target_t1_ - delta : 0;
+        }
+        arc_replace(in_b2);
+        list_unlink(index);
+        list_push_front(index, kT2);
+        cache_data_.emplace(key, CacheEntry{value, index});
+        return;
+    }
+
+    const size_t l1 = lists_[kT1].size + lists_[kB1].size;
+    const size_t total = l1 + lists_[kT2].size + lists_[kB2].size;
+    if (l1 >= capacity_) {
+        if (lists_[kT1].size < capacity_) {
+            drop_ghost(lists_[kB1].tail);
+            arc_replace(false);
+        } else {
+            evict_node(lists_[kT1].tail);
+        }
+    } else if (total >= capacity_) {
+        if (total >= 2 * capacity_ && lists_[kB2].tail != kNil) {
+            drop_ghost(lists_[kB2].tail);
+        }
+        arc_replace(false);
+    }
+    cache_data_.emplace(key, CacheEntry{value, node_insert(key, kT1)});
+}
+
+// Makes room for one entry (if the cache is full) by moving the LRU entry of
+// T1 or T2 to its ghost list
+template <typename Key, typename Value>
+void ThreadSafeCache<Key, Value>::arc_replace(bool ghost_hit_in_b2) {
+    const size_t t1 = lists_[kT1].size;
+    if (t1 + lists_[kT2].size < capacity_) {
+        return;
+    }
+    const bool from_t1 = t1 > 0 &&
+        (t1 > arc_target_t1_ || (ghost_hit_in_b2 && t1 == arc_target_t1_) || lists_[kT2].size == 0);
+    const uint32_t index = from_t1 ? lists_[kT1].tail : lists_[kT2].tail;
+    cache_data_.erase(nodes_[index].key);
+    ghost_index_.emplace(nodes_[index].key, index);
+    list_unlink(index);
+    list_push_front(index, from_t1 ? kB1 : kB2);
+}
+
 } // namespace cpp_collections
 
 #endif // THREAD_SAFE_CACHE_HPP
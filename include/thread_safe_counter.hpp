@@ -10,6 +10,11 @@
 #include <type_traits>
 #include <mutex>
 #include <thread> // For std::this_thread::get_id in debugging, if needed
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <shared_mutex>
+#include <limits>
 
 // Helper to check if a type is std::pair (copied from counter.h)
 template<typename>
@@ -514,4 +519,235 @@ ThreadSafeCounter(
 template<typename T_Param> // Renamed T to T_Param to avoid conflict with class T
 ThreadSafeCounter(std::initializer_list<std::pair<T_Param, int>>) -> ThreadSafeCounter<T_Param>;
 
+/**
+ * @brief A frequency counter for write-heavy use from many threads.
+ *
+ * Each thread adds into one of several shards, picked round-robin on the
+ * thread's first use, so concurrent writers mostly take different, uncontended
+ * locks on different cache lines instead of one shared mutex. A shard holds
+ * only the deltas since the last merge; reads fold every shard's deltas into a
+ * shared totals map and answer from it. With a nonzero max_staleness, reads
+ * within that long of the last merge skip merging and may lag writes by up to
+ * that much; flush() merges immediately.
+ *
+ * @tparam T The type of elements to count (must be hashable)
+ * @tparam Hash Hash function for T (defaults to std::hash<T>)
+ * @tparam KeyEqual Equality comparison for T (defaults to std::equal_to<T>)
+ */
+template<typename T,
+         typename Hash = std::hash<T>,
+         typename KeyEqual = std::equal_to<T>>
+class ShardedThreadSafeCounter {
+public:
+    using key_type = T;
+    using mapped_type = int;
+    using size_type = std::size_t;
+    using Clock = std::chrono::steady_clock;
+
+private:
+    using container_type = std::unordered_map<T, int, Hash, KeyEqual>;
+
+    struct alignas(64) Shard {
+        std::mutex mutex;
+        container_type deltas;
+    };
+
+    std::vector<std::unique_ptr<Shard>> shards_;
+    size_type shard_mask_;
+    Clock::duration max_staleness_;
+    mutable std::shared_mutex totals_mutex_;
+    mutable container_type totals_;
+    mutable std::atomic<Clock::rep> next_merge_due_{std::numeric_limits<Clock::rep>::min()};
+
+    static size_type thread_slot() {
+        static std::atomic<size_type> next_slot{0};
+        thread_local const size_type slot = next_slot.fetch_add(1, std::memory_order_relaxed);
+        return slot;
+    }
+
+    Shard& local_shard() {
+        return *shards_[thread_slot() & shard_mask_];
+    }
+
+    // Assumes totals_mutex_ is held exclusively
+    void merge_locked() const {
+        const Clock::rep now = Clock::now().time_since_epoch().count();
+        container_type drained;
+        for (const auto& shard : shards_) {
+            {
+                std::lock_guard<std::mutex> lock(shard->mutex);
+                drained.swap(shard->deltas);
+            }
+            for (const auto& [key, delta] : drained) {
+                totals_[key] += delta;
+            }
+            drained.clear();
+        }
+        // Saturates, so Clock::duration::max() means "merge only on flush()"
+        const Clock::rep staleness = max_staleness_.count();
+        const Clock::rep due = staleness > 0 && now > std::numeric_limits<Clock::rep>::max() - staleness
+                                   ? std::numeric_limits<Clock::rep>::max()
+                                   : now + staleness;
+        next_merge_due_.store(due, std::memory_order_release);
+    }
+
+    // Runs read on the totals, merging first if they are older than max_staleness
+    template<typename Read>
+    auto read_totals(Read&& read) const {
+        if (Clock::now().time_since_epoch().count() >= next_merge_due_.load(std::memory_order_acquire)) {
+            std::unique_lock<std::shared_mutex> lock(totals_mutex_);
+            if (Clock::now().time_since_epoch().count() >= next_merge_due_.load(std::memory_order_relaxed)) {
+                merge_locked();
+            }
+            return read(totals_);
+        }
+        std::shared_lock<std::shared_mutex> lock(totals_mutex_);
+        return read(totals_);
+    }
+
+public:
+    /**
+     * @param max_staleness How old the merged totals may be before a read merges again (zero: every read merges)
+     * @param shard_count Number of shards, rounded up to a power of two (0: one per hardware thread)
+     */
+    explicit ShardedThreadSafeCounter(Clock::duration max_staleness = Clock::duration::zero(),
+                                      size_type shard_count = 0)
+        : max_staleness_(max_staleness) {
+        if (shard_count == 0) {
+            shard_count = std::max<size_type>(1, std::thread::hardware_concurrency());
+        }
+        size_type rounded = 1;
+        while (rounded < shard_count) {
+            rounded <<= 1;
+        }
+        shards_.reserve(rounded);
+        for (size_type i = 0; i < rounded; ++i) {
+            shards_.push_back(std::make_unique<Shard>());
+        }
+        shard_mask_ = rounded - 1;
+    }
+
+    ShardedThreadSafeCounter(const ShardedThreadSafeCounter&) = delete;
+    ShardedThreadSafeCounter& operator=(const ShardedThreadSafeCounter&) = delete;
+
+    // Writes only touch the calling thread's shard
+    void add(const T& value, int count_val = 1) {
+        if (count_val == 0) {
+            return;
+        }
+        Shard& shard = local_shard();
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.deltas[value] += count_val;
+    }
+
+    // Like ThreadSafeCounter::subtract, non-positive amounts are ignored
+    void subtract(const T& value, int count_val = 1) {
+        if (count_val <= 0) {
+            return;
+        }
+        add(value, -count_val);
+    }
+
+    // Merges all pending deltas now, regardless of max_staleness
+    void flush() {
+        std::unique_lock<std::shared_mutex> lock(totals_mutex_);
+        merge_locked();
+    }
+
+    void set_count(const T& key, int val) {
+        std::unique_lock<std::shared_mutex> lock(totals_mutex_);
+        merge_locked();
+        if (val > 0) {
+            totals_[key] = val;
+        } else {
+            totals_.erase(key);
+        }
+    }
+
+    size_type erase(const T& value) {
+        std::unique_lock<std::shared_mutex> lock(totals_mutex_);
+        merge_locked();
+        return totals_.erase(value);
+    }
+
+    void clear() {
+        std::unique_lock<std::shared_mutex> lock(totals_mutex_);
+        for (const auto& shard : shards_) {
+            std::lock_guard<std::mutex> shard_lock(shard->mutex);
+            shard->deltas.clear();
+        }
+        totals_.clear();
+    }
+
+    [[nodiscard]] int count(const T& value) const {
+        return read_totals([&](const container_type& totals) {
+            const auto it = totals.find(value);
+            return it != totals.end() ? it->second : 0;
+        });
+    }
+
+    [[nodiscard]] int operator[](const T& value) const {
+        return count(value);
+    }
+
+    [[nodiscard]] bool contains(const T& value) const {
+        return count(value) > 0;
+    }
+
+    [[nodiscard]] size_type size() const {
+        return read_totals([](const container_type& totals) {
+            return static_cast<size_type>(std::count_if(totals.begin(), totals.end(),
+                                                        [](const auto& pair) { return pair.second > 0; }));
+        });
+    }
+
+    [[nodiscard]] bool empty() const {
+        return read_totals([](const container_type& totals) { return totals.empty(); });
+    }
+
+    [[nodiscard]] int total() const {
+        return read_totals([](const container_type& totals) {
+            int sum = 0;
+            for (const auto& [key, count_val] : totals) {
+                sum += count_val;
+            }
+            return sum;
+        });
+    }
+
+    [[nodiscard]] std::vector<std::pair<T, int>> most_common(size_type n = 0) const {
+        std::vector<std::pair<T, int>> items = read_totals([](const container_type& totals) {
+            return std::vector<std::pair<T, int>>(totals.begin(), totals.end());
+        });
+        auto by_count = [](const auto& a, const auto& b) {
+            if (a.second != b.second) {
+                return a.second > b.second;
+            }
+            if constexpr (is_lt_comparable_v<T>) {
+                return a.first < b.first;
+            }
+            return false;
+        };
+        if (n > 0 && n < items.size()) {
+            std::partial_sort(items.begin(), items.begin() + n, items.end(), by_count);
+            items.resize(n);
+        } else {
+            std::sort(items.begin(), items.end(), by_count);
+        }
+        return items;
+    }
+
+    [[nodiscard]] std::unordered_map<T, int, Hash, KeyEqual> get_data_copy() const {
+        return read_totals([](const container_type& totals) { return totals; });
+    }
+
+    [[nodiscard]] size_type shard_count() const {
+        return shards_.size();
+    }
+
+    [[nodiscard]] Clock::duration max_staleness() const {
+        return max_staleness_;
+    }
+};
+
 // #pragma once // Redundant, but okay. // Moved is_lt_comparable_v to the top
@@ -2,16 +2,14 @@
 #define TIMER_WHEEL_HPP
 
 #include <vector>
-#include <list>
 #include <functional>
 #include <cstdint>
-#include <unordered_map>
-#include <memory>
+#include <optional>
 #include <stdexcept>
 #include <utility> // For std::move
-#include <algorithm> // For std::max, std::min etc.
-#include <cmath>     // For std::ceil
+#include <algorithm> // For std::min
 #include <any>       // For std::any
+#include <bit>       // For std::countr_zero
 
 namespace cpp_utils {
 
@@ -23,167 +21,412 @@ enum class TimerType {
 
 using TimerCallback = std::function<void(std::any cookie)>;
 
+// A hierarchical (Varghese/Lauck) timing wheel.
+//
+// Level 0 has `wheel_size` slots of one tick each. Each further level has 64
+// slots, each spanning a whole revolution of the level below, so level k
+// covers wheel_size * 64^k ticks; levels are added as long delays need them.
+// A timer sits in the lowest level that can hold its delay. When the level
+// below completes a revolution, the next slot up is cascaded: its timers move
+// down, each at most once per level. Every timer in a level-0 slot is
+// therefore due exactly when that slot is processed, and tick() touches only
+// those timers (no per-revolution round counting).
+//
+// Timers are intrusive nodes in a pooled array, linked into their slot by
+// index; adding and cancelling are O(1) and allocate nothing once the pool
+// has grown. A timer id packs its node index (low 24 bits) with the node's
+// generation (7 bits), bumped each time the node is freed, so a stale id is
+// rejected until its node has been reused 128 times.
+//
+// advance(n) moves n ticks at once, jumping straight to the next slot (or
+// cascade) that holds a timer, so an idle wheel costs nothing however many
+// timers it holds.
 class TimerWheel {
 public:
+    using TimerId = int; // Never negative: (generation << 24) | node index
+
     TimerWheel(size_t resolution_ms, size_t wheel_size)
         : resolution_ms_(resolution_ms),
-          wheel_size_(wheel_size),
-          current_tick_absolute_(0),
-          next_timer_id_(0) {
+          wheel_size_(wheel_size) {
         if (resolution_ms == 0) {
             throw std::invalid_argument("Timer resolution must be greater than 0.");
         }
         if (wheel_size == 0) {
             throw std::invalid_argument("Timer wheel size must be greater than 0.");
         }
-        wheel_.resize(wheel_size_);
+        heads_.assign(1 + wheel_size_, NIL);
+        level0_bits_.assign((wheel_size_ + 63) / 64, 0);
     }
 
-    int addTimer(uint64_t delay_ms, TimerCallback cb, std::any cookie, TimerType type = TimerType::OneShot) {
-        int timer_id = next_timer_id_++;
-
-        auto placement = calculatePlacement(delay_ms);
-        size_t target_slot_idx = placement.first;
-        size_t rounds = placement.second;
-
-        uint64_t interval = (type == TimerType::Periodic) ? delay_ms : 0;
-        if (type == TimerType::Periodic && interval == 0) {
-            interval = resolution_ms_;
-        }
-
-        auto timer = std::make_unique<Timer>(timer_id, std::move(cb), type, interval, rounds, std::move(cookie));
-        timer->slot_idx = target_slot_idx;
-
-        wheel_[target_slot_idx].push_front(timer_id);
-        timer->wheel_iterator = wheel_[target_slot_idx].begin();
-
-        timers_[timer_id] = std::move(timer);
-        return timer_id;
+    // Schedules `cb` to run on the ceil(delay_ms / resolution)-th tick from now
+    // (at least the next one); a periodic timer then repeats with that interval.
+    TimerId addTimer(uint64_t delay_ms, TimerCallback cb, std::any cookie, TimerType type = TimerType::OneShot) {
+        const uint32_t index = allocateNode();
+        Node& node = nodes_[index];
+        node.callback = std::move(cb);
+        node.cookie = std::move(cookie);
+        node.type = type;
+        node.interval_ticks = ticksFor(delay_ms);
+        node.active = true;
+        ++active_count_;
+        schedule(index, dueTick(node.interval_ticks));
+        return idOf(index);
     }
 
-    int addTimer(uint64_t delay_ms, TimerCallback cb, TimerType type = TimerType::OneShot) {
+    TimerId addTimer(uint64_t delay_ms, TimerCallback cb, TimerType type = TimerType::OneShot) {
         return addTimer(delay_ms, std::move(cb), std::any(), type);
     }
 
-    bool cancelTimer(int timer_id) {
-        auto map_iter = timers_.find(timer_id);
-        if (map_iter == timers_.end()) {
+    // Returns false if the timer already fired (one-shot) or was cancelled.
+    bool cancelTimer(TimerId timer_id) {
+        const std::optional<uint32_t> index = lookup(timer_id);
+        if (!index) {
             return false;
         }
-        Timer* timer_ptr = map_iter->second.get();
-        if (timer_ptr->slot_idx < wheel_.size()) {
-            if (!wheel_[timer_ptr->slot_idx].empty()) {
-                wheel_[timer_ptr->slot_idx].erase(timer_ptr->wheel_iterator);
-            }
+        if (nodes_[*index].slot != NO_SLOT) {
+            unlink(*index);
         }
-        timers_.erase(map_iter);
+        releaseNode(*index);
         return true;
     }
 
+    // Advances one tick, running the timers due on it.
     void tick() {
-        size_t current_processing_slot_idx = current_tick_absolute_ % wheel_size_;
-        std::list<int> ids_in_slot_copy = wheel_[current_processing_slot_idx];
+        processTick();
+        ++current_tick_;
+    }
 
-        for (int timer_id : ids_in_slot_copy) {
-            auto map_iter = timers_.find(timer_id);
-            if (map_iter == timers_.end()) {
-                continue;
-            }
-
-            Timer* timer_ptr = map_iter->second.get();
-            if (timer_ptr->slot_idx != current_processing_slot_idx) {
-                continue;
+    // Advances `ticks` ticks, running every timer due on them in order, and
+    // skipping over stretches with nothing to run or cascade. Returns the
+    // number of callbacks run.
+    size_t advance(uint64_t ticks) {
+        const size_t fired_before = fired_count_;
+        const uint64_t target = current_tick_ + ticks;
+        while (current_tick_ < target) {
+            const std::optional<uint64_t> next = nextEventTick();
+            if (!next || *next >= target) {
+                current_tick_ = target;
+                break;
             }
+            current_tick_ = *next;
+            tick();
+        }
+        return fired_count_ - fired_before;
+    }
 
-            if (timer_ptr->remaining_rounds == 0) {
-                TimerCallback callback_to_run = timer_ptr->callback;
-                TimerType current_timer_type = timer_ptr->type; // Use a different name from member 'type'
-                uint64_t periodic_interval = timer_ptr->interval_ms;
-                int current_timer_id = timer_ptr->id;
-                std::any current_cookie = timer_ptr->cookie;
-
-                wheel_[current_processing_slot_idx].erase(timer_ptr->wheel_iterator);
-
-                if (current_timer_type == TimerType::OneShot) {
-                    timers_.erase(map_iter);
-                }
-
-                if (callback_to_run) {
-                    callback_to_run(std::move(current_cookie));
-                }
-
-                if (current_timer_type == TimerType::Periodic) {
-                    auto post_callback_map_iter = timers_.find(current_timer_id);
-                    if (post_callback_map_iter != timers_.end()) {
-                        Timer* periodic_timer_to_reschedule = post_callback_map_iter->second.get();
-
-                        auto new_placement = calculatePlacement(periodic_interval);
-                        periodic_timer_to_reschedule->slot_idx = new_placement.first;
-                        periodic_timer_to_reschedule->remaining_rounds = new_placement.second;
-                        // Cookie for periodic timer remains the same (it's already in periodic_timer_to_reschedule->cookie)
-
-                        wheel_[periodic_timer_to_reschedule->slot_idx].push_front(current_timer_id);
-                        periodic_timer_to_reschedule->wheel_iterator = wheel_[periodic_timer_to_reschedule->slot_idx].begin();
-                    }
-                }
-            } else {
-                timer_ptr->remaining_rounds--;
-            }
+    // Ticks until the wheel next has work to do (a timer to run or a slot to
+    // cascade), or nullopt if no timer is pending. Timers never fire earlier.
+    std::optional<uint64_t> ticksToNextEvent() const {
+        const std::optional<uint64_t> next = nextEventTick();
+        if (!next) {
+            return std::nullopt;
         }
-        current_tick_absolute_++;
+        return *next - current_tick_;
     }
 
+    size_t size() const { return active_count_; }
+    bool empty() const { return active_count_ == 0; }
+    uint64_t currentTick() const { return current_tick_; }
+    size_t resolutionMs() const { return resolution_ms_; }
+
 private:
-    struct Timer {
-        int id;
+    static constexpr uint32_t NIL = UINT32_MAX;
+    static constexpr uint32_t NO_SLOT = UINT32_MAX;
+    static constexpr uint32_t RUNNING = 0; // heads_[0]: the slot being run
+    static constexpr size_t LEVEL_SLOTS = 64;
+    static constexpr int INDEX_BITS = 24;
+    static constexpr uint32_t INDEX_MASK = (uint32_t{1} << INDEX_BITS) - 1;
+    static constexpr uint8_t GENERATION_MASK = 0x7F; // 31 - INDEX_BITS bits
+
+    struct Node {
+        uint32_t next = NIL;
+        uint32_t prev = NIL;          // NIL when first in its slot
+        uint32_t slot = NO_SLOT;      // Index into heads_ while linked
+        uint8_t generation = 0;       // Bumped on release; stale ids carry an older one
+        bool active = false;
+        TimerType type = TimerType::OneShot;
+        uint64_t due = 0;             // Absolute tick
+        uint64_t interval_ticks = 0;
         TimerCallback callback;
-        TimerType type; // This now refers to the enum
-        uint64_t interval_ms;
-        size_t remaining_rounds;
-        std::list<int>::iterator wheel_iterator;
-        size_t slot_idx;
         std::any cookie;
-
-        Timer(int timer_id, TimerCallback cb, TimerType t, uint64_t interv, size_t rounds, std::any c)
-            : id(timer_id),
-              callback(std::move(cb)),
-              type(t),
-              interval_ms(interv),
-              remaining_rounds(rounds),
-              slot_idx(0),
-              cookie(std::move(c))
-              {}
     };
 
-    size_t resolution_ms_;
-    size_t wheel_size_;
-    uint64_t current_tick_absolute_;
-    int next_timer_id_;
-
-    std::vector<std::list<int>> wheel_;
-    std::unordered_map<int, std::unique_ptr<Timer>> timers_;
-
-    std::pair<size_t, size_t> calculatePlacement(uint64_t delay_ms) {
-        if (resolution_ms_ == 0) throw std::logic_error("Timer resolution cannot be zero.");
-        if (wheel_size_ == 0) throw std::logic_error("Timer wheel size cannot be zero.");
-        size_t num_total_ticks_to_wait;
-        if (delay_ms == 0) {
-            num_total_ticks_to_wait = 1;
+    uint64_t ticksFor(uint64_t delay_ms) const {
+        const uint64_t ticks = delay_ms / resolution_ms_ + (delay_ms % resolution_ms_ != 0 ? 1 : 0);
+        return std::max<uint64_t>(ticks, 1);
+    }
+
+    // A timer of n ticks runs on the n-th tick() from now; one added while a
+    // tick runs its callbacks (current_tick_ is then that tick) runs no earlier
+    // than the next tick.
+    uint64_t dueTick(uint64_t ticks) const {
+        const uint64_t due = current_tick_ + ticks - 1;
+        return running_ && due <= current_tick_ ? current_tick_ + 1 : due;
+    }
+
+    TimerId idOf(uint32_t index) const {
+        return static_cast<TimerId>((uint32_t{nodes_[index].generation} << INDEX_BITS) | index);
+    }
+
+    std::optional<uint32_t> lookup(TimerId timer_id) const {
+        if (timer_id < 0) {
+            return std::nullopt;
+        }
+        const uint32_t index = static_cast<uint32_t>(timer_id) & INDEX_MASK;
+        if (index >= nodes_.size()) {
+            return std::nullopt;
+        }
+        const Node& node = nodes_[index];
+        if (!node.active || node.generation != static_cast<uint32_t>(timer_id) >> INDEX_BITS) {
+            return std::nullopt;
+        }
+        return index;
+    }
+
+    uint32_t allocateNode() {
+        if (free_head_ != NIL) {
+            const uint32_t index = free_head_;
+            free_head_ = nodes_[index].next;
+            nodes_[index].next = NIL;
+            return index;
+        }
+        if (nodes_.size() > INDEX_MASK) {
+            throw std::length_error("TimerWheel: too many timers.");
+        }
+        nodes_.emplace_back();
+        return static_cast<uint32_t>(nodes_.size() - 1);
+    }
+
+    void releaseNode(uint32_t index) {
+        Node& node = nodes_[index];
+        node.active = false;
+        node.generation = (node.generation + 1) & GENERATION_MASK;
+        node.callback = nullptr;
+        node.cookie.reset();
+        node.slot = NO_SLOT;
+        node.prev = NIL;
+        node.next = free_head_;
+        free_head_ = index;
+        --active_count_;
+    }
+
+    // Granularity (ticks per slot) of level >= 1.
+    uint64_t granularity(size_t level) const {
+        uint64_t g = wheel_size_;
+        for (size_t k = 1; k < level; ++k) g *= LEVEL_SLOTS;
+        return g;
+    }
+
+    size_t levelCount() const { return 1 + upper_bits_.size(); }
+
+    uint32_t upperSlot(size_t level, size_t slot) const {
+        return static_cast<uint32_t>(1 + wheel_size_ + (level - 1) * LEVEL_SLOTS + slot);
+    }
+
+    // Links the timer into the slot for its due tick, relative to current_tick_.
+    void schedule(uint32_t index, uint64_t due) {
+        nodes_[index].due = due;
+        const uint64_t delta = due - current_tick_;
+        if (delta < wheel_size_) {
+            const size_t slot = due % wheel_size_;
+            link(index, static_cast<uint32_t>(1 + slot));
+            level0_bits_[slot / 64] |= uint64_t{1} << (slot % 64);
+            return;
+        }
+        for (size_t level = 1;; ++level) {
+            if (level == levelCount()) {
+                addLevel();
+            }
+            const uint64_t g = granularity(level);
+            // Past the top level only if the span overflows: such timers wait in its last reachable slot.
+            const bool fits = delta / g < LEVEL_SLOTS || g > UINT64_MAX / LEVEL_SLOTS;
+            if (fits) {
+                const size_t slot = (due / g) % LEVEL_SLOTS;
+                link(index, upperSlot(level, slot));
+                upper_bits_[level - 1] |= uint64_t{1} << slot;
+                return;
+            }
+        }
+    }
+
+    void addLevel() {
+        upper_bits_.push_back(0);
+        heads_.resize(heads_.size() + LEVEL_SLOTS, NIL);
+    }
+
+    void link(uint32_t index, uint32_t slot) {
+        Node& node = nodes_[index];
+        node.slot = slot;
+        node.prev = NIL;
+        node.next = heads_[slot];
+        if (node.next != NIL) {
+            nodes_[node.next].prev = index;
+        }
+        heads_[slot] = index;
+    }
+
+    void unlink(uint32_t index) {
+        Node& node = nodes_[index];
+        if (node.prev != NIL) {
+            nodes_[node.prev].next = node.next;
         } else {
-            num_total_ticks_to_wait = static_cast<size_t>(std::ceil(static_cast<double>(delay_ms) / resolution_ms_));
-            if (num_total_ticks_to_wait == 0 && delay_ms > 0) {
-                num_total_ticks_to_wait = 1;
+            heads_[node.slot] = node.next;
+            if (node.next == NIL) {
+                clearBit(node.slot);
             }
         }
-        if (num_total_ticks_to_wait == 0) {
-             num_total_ticks_to_wait = 1;
+        if (node.next != NIL) {
+            nodes_[node.next].prev = node.prev;
         }
-        size_t rounds = (num_total_ticks_to_wait - 1) / wheel_size_;
-        size_t slot_offset_from_current = (num_total_ticks_to_wait - 1) % wheel_size_;
-        size_t current_wheel_pos_for_calc = current_tick_absolute_ % wheel_size_;
-        size_t target_slot_idx = (current_wheel_pos_for_calc + slot_offset_from_current) % wheel_size_;
-        return {target_slot_idx, rounds};
+        node.slot = NO_SLOT;
+        node.prev = NIL;
+        node.next = NIL;
     }
+
+    void clearBit(uint32_t slot) {
+        if (slot == RUNNING) {
+            return;
+        }
+        if (slot <= wheel_size_) {
+            const size_t s = slot - 1;
+            level0_bits_[s / 64] &= ~(uint64_t{1} << (s % 64));
+        } else {
+            const size_t s = slot - 1 - wheel_size_;
+            upper_bits_[s / LEVEL_SLOTS] &= ~(uint64_t{1} << (s % LEVEL_SLOTS));
+        }
+    }
+
+    // Detaches a whole slot's list, clearing its occupancy bit. Returns the first node.
+    uint32_t takeSlot(uint32_t slot) {
+        const uint32_t head = heads_[slot];
+        heads_[slot] = NIL;
+        clearBit(slot);
+        return head;
+    }
+
+    void processTick() {
+        const uint64_t now = current_tick_;
+        // Cascade, lowest level first, each level whose lower levels just completed a
+        // revolution. A cascaded timer always lands in a slot not yet due this tick
+        // (or in the level-0 slot run below, if it is due now).
+        for (size_t level = 1; level < levelCount(); ++level) {
+            const uint64_t g = granularity(level);
+            if (now % g != 0) {
+                break;
+            }
+            const size_t slot = (now / g) % LEVEL_SLOTS;
+            for (uint32_t index = takeSlot(upperSlot(level, slot)); index != NIL;) {
+                const uint32_t next = nodes_[index].next;
+                schedule(index, nodes_[index].due);
+                index = next;
+            }
+            if (slot != 0) {
+                break;
+            }
+        }
+
+        // Move the due slot to the running list, so callbacks may add or cancel
+        // any timer, including ones about to run in this tick.
+        const size_t slot = now % wheel_size_;
+        uint32_t head = takeSlot(static_cast<uint32_t>(1 + slot));
+        heads_[RUNNING] = head;
+        for (uint32_t index = head; index != NIL; index = nodes_[index].next) {
+            nodes_[index].slot = RUNNING;
+        }
+        running_ = true;
+        while ((head = heads_[RUNNING]) != NIL) {
+            unlink(head);
+            run(head);
+        }
+        running_ = false;
+    }
+
+    void run(uint32_t index) {
+        ++fired_count_;
+        Node& node = nodes_[index];
+        if (node.type == TimerType::OneShot) {
+            TimerCallback callback = std::move(node.callback);
+            std::any cookie = std::move(node.cookie);
+            releaseNode(index);
+            if (callback) {
+                callback(std::move(cookie));
+            }
+            return;
+        }
+        // The callback may add timers (growing nodes_) or cancel this one, so it
+        // runs from a local and goes back only if the timer is still live.
+        const TimerId id = idOf(index);
+        TimerCallback callback = std::move(node.callback);
+        std::any cookie = node.cookie;
+        if (callback) {
+            callback(std::move(cookie));
+        }
+        if (lookup(id)) {
+            Node& live = nodes_[index];
+            live.callback = std::move(callback);
+            schedule(index, dueTick(live.interval_ticks));
+        }
+    }
+
+    // Next tick >= current_tick_ that has a level-0 slot to run or a slot to cascade.
+    std::optional<uint64_t> nextEventTick() const {
+        std::optional<uint64_t> best;
+        auto consider = [&best](uint64_t tick) {
+            if (!best || tick < *best) best = tick;
+        };
+        const size_t pos = current_tick_ % wheel_size_;
+        if (const std::optional<size_t> d = nextSetBit(level0_bits_, wheel_size_, pos)) {
+            consider(current_tick_ + *d);
+        }
+        for (size_t level = 1; level < levelCount(); ++level) {
+            const uint64_t bits = upper_bits_[level - 1];
+            if (bits == 0) {
+                continue;
+            }
+            // Slot s of this level is cascaded at the first multiple t of g at or
+            // after now with (t / g) % 64 == s.
+            const uint64_t g = granularity(level);
+            const uint64_t block = current_tick_ / g + (current_tick_ % g != 0 ? 1 : 0);
+            const size_t start = block % LEVEL_SLOTS;
+            const uint64_t rotated = start == 0 ? bits : (bits >> start) | (bits << (LEVEL_SLOTS - start));
+            const auto distance = static_cast<uint64_t>(std::countr_zero(rotated));
+            consider((block + distance) * g);
+        }
+        return best;
+    }
+
+    // Distance from `pos` to the next set bit among `size` bits, wrapping around.
+    static std::optional<size_t> nextSetBit(const std::vector<uint64_t>& bits, size_t size, size_t pos) {
+        for (size_t scanned = 0; scanned < size;) {
+            const size_t at = (pos + scanned) % size;
+            const size_t word = at / 64;
+            const size_t offset = at % 64;
+            uint64_t w = bits[word] >> offset;
+            const size_t span = std::min<size_t>(64 - offset, size - at);
+            if (span < 64) {
+                w &= (uint64_t{1} << span) - 1;
+            }
+            if (w != 0) {
+                const size_t d = scanned + static_cast<size_t>(std::countr_zero(w));
+                return d < size ? std::optional<size_t>(d) : std::nullopt;
+            }
+            scanned += span;
+        }
+        return std::nullopt;
+    }
+
+    size_t resolution_ms_;
+    size_t wheel_size_;
+    uint64_t current_tick_ = 0; // The next tick to process
+    bool running_ = false;      // Inside processTick()'s callbacks
+    size_t active_count_ = 0;
+    size_t fired_count_ = 0;
+
+    std::vector<Node> nodes_;        // Timer pool; free nodes chained through `next`
+    uint32_t free_head_ = NIL;
+    std::vector<uint32_t> heads_;    // [RUNNING, level 0 slots..., level 1 slots..., ...]
+    std::vector<uint64_t> level0_bits_; // Occupancy of level-0 slots
+    std::vector<uint64_t> upper_bits_;  // Occupancy of each upper level's 64 slots
 };
 
 } // namespace cpp_utils
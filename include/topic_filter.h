@@ -1,14 +1,23 @@
 #pragma once 
 
+#include "regex_dfa.h"
+
 #include <algorithm>
 #include <cassert>
 #include <charconv>
+#include <cstdint>
+#include <functional>
+#include <map>
 #include <memory>
+#include <numeric>
+#include <optional>
 #include <regex>
+#include <span>
 #include <stdexcept>
 #include <string>
 #include <string_view>
 #include <unordered_set>
+#include <utility>
 #include <vector>
 
 
@@ -77,23 +86,127 @@ struct RegexRule
       return *this;
    }
 
+   // The iterator overloads match the string_view in place, without copying it.
    bool matches(std::string_view key) const
    {
-      // std::regex currently doesn't have direct support for std::string_view,
-      // so conversion to std::string is necessary.
-      std::string key_str(key);
-      return std::regex_match(key_str, *regex, flags);
+      return std::regex_match(key.begin(), key.end(), *regex, flags);
    }
 
    bool search(std::string_view key) const
    {
-      // std::regex currently doesn't have direct support for std::string_view,
-      // so conversion to std::string is necessary.
-      std::string key_str(key);
-      return std::regex_search(key_str, *regex, flags);
+      return std::regex_search(key.begin(), key.end(), *regex, flags);
+   }
+
+   // Parses the rule for cpp_utils::RegexDfa, or returns nullopt if its pattern or
+   // options are outside what the DFA reproduces exactly.
+   std::optional<cpp_utils::RegexDfa::Pattern> lower(bool search_mode) const
+   {
+      using std::regex_constants::syntax_option_type;
+      const syntax_option_type grammar = std::regex_constants::basic | std::regex_constants::extended |
+                                         std::regex_constants::awk | std::regex_constants::grep |
+                                         std::regex_constants::egrep | std::regex_constants::collate |
+                                         std::regex_constants::multiline;
+      if ((regex->flags() & grammar) != syntax_option_type {} || flags != std::regex_constants::match_default)
+      {
+         return std::nullopt;
+      }
+      const bool icase = (regex->flags() & std::regex_constants::icase) != syntax_option_type {};
+      return cpp_utils::RegexDfa::parse(pattern_str, search_mode, icase);
+   }
+};
+
+// Compilation steps shared by TopicFilter and TopicSubscriptionIndex
+namespace topic_filter_detail
+{
+
+// Byte trie built with ordered child maps, then flattened breadth-first into
+// sorted edge arrays. Each node carries a Payload describing the rules ending there.
+template <typename Payload>
+class TrieBuilder
+{
+   public:
+   TrieBuilder() : m_nodes(1) {}
+
+   // Adds the path for `str` and returns the payload of its last node
+   Payload& insert(std::string_view str)
+   {
+      uint32_t node = 0;
+      for (char ch : str)
+      {
+         auto [it, inserted] = m_nodes[node].children.try_emplace(static_cast<uint8_t>(ch), static_cast<uint32_t>(m_nodes.size()));
+         const uint32_t next = it->second;
+         if (inserted)
+         {
+            m_nodes.emplace_back();
+         }
+         node = next;
+      }
+      return m_nodes[node].payload;
+   }
+
+   // Appends the compiled nodes to `nodes` in breadth-first order (position = compiled id).
+   // `make(payload, node)` fills everything but the edges and returns false to drop the
+   // node's children. Node needs edge_begin and edge_count members.
+   template <typename Node, typename Make>
+   void flatten(std::vector<Node>& nodes, std::vector<uint8_t>& edge_bytes, std::vector<uint32_t>& edge_targets, Make make)
+   {
+      std::vector<uint32_t> order {0};
+      for (size_t i = 0; i < order.size(); ++i)
+      {
+         BuildNode& from = m_nodes[order[i]];
+         Node node;
+         const bool keep_children = make(from.payload, node);
+         node.edge_begin = static_cast<uint32_t>(edge_bytes.size());
+         if (keep_children)
+         {
+            for (const auto& [byte, child] : from.children)
+            {
+               edge_bytes.push_back(byte);
+               edge_targets.push_back(static_cast<uint32_t>(order.size()));
+               order.push_back(child);
+            }
+         }
+         node.edge_count = static_cast<uint32_t>(edge_bytes.size()) - node.edge_begin;
+         nodes.push_back(node);
+      }
    }
+
+   private:
+   struct BuildNode
+   {
+      std::map<uint8_t, uint32_t> children;
+      Payload payload;
+   };
+   std::vector<BuildNode> m_nodes;
 };
 
+// Compiles `patterns` into as few DFAs as fit the state cap: one for the whole group
+// if it fits, otherwise the group is halved. Each DFA goes to `on_dfa`; the owner of
+// a single pattern that does not fit goes to `on_fallback` and keeps using std::regex.
+template <typename Owner, typename OnDfa, typename OnFallback>
+void compileRegexGroup(std::span<const cpp_utils::RegexDfa::Pattern> patterns,
+                       std::span<const Owner> owners,
+                       bool report_all,
+                       OnDfa&& on_dfa,
+                       OnFallback&& on_fallback)
+{
+   if (auto dfa = cpp_utils::RegexDfa::compile(patterns, cpp_utils::RegexDfa::DEFAULT_MAX_STATES, report_all))
+   {
+      on_dfa(std::move(*dfa), patterns.size());
+      return;
+   }
+   if (patterns.size() == 1)
+   {
+      on_fallback(owners[0]);
+      return;
+   }
+   const size_t half = patterns.size() / 2;
+   compileRegexGroup(patterns.first(half), owners.first(half), report_all, on_dfa, on_fallback);
+   compileRegexGroup(patterns.subspan(half), owners.subspan(half), report_all, on_dfa, on_fallback);
+}
+
+} // namespace topic_filter_detail
+
 class TopicFilter
 {
    public:
@@ -158,7 +271,10 @@ class TopicFilter
 
    /**
      * @brief Checks if a given key matches any of the defined filtering rules.
-     * Rules are checked in order of performance: exact -> prefix -> range -> regex.
+     * After optimize(), one walk of a trie answers exact, prefix and range rules and
+     * one DFA pass answers the regex rules it could lower, so the cost depends on
+     * the key's length rather than the number of rules. Otherwise (or for rules
+     * added since), rules are checked in order: exact -> prefix -> range -> regex.
      * @param key The key from the Redis notification.
      * @return True if the key matches any rule, false otherwise.
      */
@@ -181,11 +297,20 @@ class TopicFilter
    reserve(size_t exact_count, size_t prefix_count, size_t range_count, size_t regex_match_count = 0, size_t regex_search_count = 0);
 
    /**
-     * @brief Optimizes internal data structures after adding rules.
-     * Call this after adding all rules for better performance.
+     * @brief Compiles the rules into a matcher whose cost does not grow with the rule count.
+     * Exact, prefix and range rules are merged into one byte trie; regex rules in the
+     * regular subset of ECMAScript (see regex_dfa.h) are merged into as few DFAs as
+     * fit the state cap. Other regex rules keep using std::regex. Call this after
+     * adding all rules; adding a rule afterwards drops back to the rule-by-rule
+     * scan until the next call.
      */
    void optimize();
 
+   /**
+     * @brief True if the rules are compiled, i.e. no rule was added since optimize().
+     */
+   bool isCompiled() const noexcept { return m_compiled; }
+
    /**
      * @brief Returns statistics about the filter rules.
      */
@@ -197,17 +322,54 @@ class TopicFilter
       size_t regex_match_rules;
       size_t regex_search_rules;
       size_t total_rules;
+      size_t compiled_regex_rules; // Regex rules answered by a DFA after optimize()
+      size_t regex_dfa_states; // States across those DFAs
    };
 
    Statistics getStatistics() const noexcept;
 
    private:
-   std::unordered_set<std::string> m_exactMatches;
+   // Heterogeneous lookup, so probing the set with a string_view does not allocate
+   struct StringHash
+   {
+      using is_transparent = void;
+      size_t operator()(std::string_view str) const noexcept { return std::hash<std::string_view> {}(str); }
+   };
+
+   // Node of the compiled trie. Children are the sorted edge range
+   // [edge_begin, edge_begin + edge_count) of m_trieEdgeBytes/m_trieEdgeTargets.
+   struct TrieNode
+   {
+      uint32_t edge_begin = 0;
+      uint32_t edge_count = 0;
+      uint32_t range_begin = 0; // Merged, sorted intervals in m_trieRanges for range rules ending here
+      uint32_t range_count = 0;
+      bool exact = false; // An exact rule ends here
+      bool prefix = false; // A prefix rule ends here: every key reaching this node matches
+   };
+
+   std::unordered_set<std::string, StringHash, std::equal_to<>> m_exactMatches;
    std::vector<std::string> m_prefixMatches;
    std::vector<RangeRule> m_rangeMatches;
    std::vector<RegexRule> m_regexMatches; // Full string match patterns
    std::vector<RegexRule> m_regexSearches; // Search patterns
 
+   // Compiled form, valid while m_compiled
+   bool m_compiled = false;
+   std::vector<TrieNode> m_trieNodes;
+   std::vector<uint8_t> m_trieEdgeBytes;
+   std::vector<uint32_t> m_trieEdgeTargets;
+   std::vector<std::pair<long long, long long>> m_trieRanges;
+   std::vector<cpp_utils::RegexDfa> m_regexDfas;
+   std::vector<size_t> m_fallbackMatches; // Indices into m_regexMatches not lowered to a DFA
+   std::vector<size_t> m_fallbackSearches; // Indices into m_regexSearches not lowered to a DFA
+   size_t m_compiledRegexRules = 0;
+
+   void compileTrie();
+   void compileRegexes();
+   bool matchCompiled(std::string_view key) const;
+   bool rangeMatches(const TrieNode& node, std::string_view num_part) const noexcept;
+
    // Helper function to parse number from string_view
    static bool parseNumber(std::string_view str, long long& result) noexcept;
 
@@ -223,6 +385,7 @@ void TopicFilter::addExactMatch(const std::string& key_pattern)
    {
       throw std::invalid_argument("Empty key pattern not allowed");
    }
+   m_compiled = false;
    m_exactMatches.insert(key_pattern);
 }
 
@@ -232,6 +395,7 @@ void TopicFilter::addExactMatch(std::string&& key_pattern)
    {
       throw std::invalid_argument("Empty key pattern not allowed");
    }
+   m_compiled = false;
    m_exactMatches.insert(std::move(key_pattern));
 }
 
@@ -242,6 +406,7 @@ void TopicFilter::addPrefixMatch(const std::string& key_pattern)
       throw std::invalid_argument("Empty key pattern not allowed");
    }
 
+   m_compiled = false;
    if (key_pattern.back() == '*')
    {
       m_prefixMatches.emplace_back(key_pattern, 0, key_pattern.length() - 1);
@@ -259,6 +424,7 @@ void TopicFilter::addPrefixMatch(std::string&& key_pattern)
       throw std::invalid_argument("Empty key pattern not allowed");
    }
 
+   m_compiled = false;
    if (key_pattern.back() == '*')
    {
       // Remove trailing '*' before moving
@@ -281,6 +447,7 @@ void TopicFilter::addRangeMatch(const std::string& key_prefix, long long start,
       throw std::invalid_argument("Invalid range: start must be <= end");
    }
 
+   m_compiled = false;
    m_rangeMatches.emplace_back(key_prefix + "_", start, end);
 }
 
@@ -295,6 +462,7 @@ void TopicFilter::addRangeMatch(std::string&& key_prefix, long long start, long
       throw std::invalid_argument("Invalid range: start must be <= end");
    }
 
+   m_compiled = false;
    key_prefix += "_";
    m_rangeMatches.emplace_back(std::move(key_prefix), start, end);
 }
@@ -309,6 +477,7 @@ void TopicFilter::addRegexMatch(const std::string& pattern,
       throw std::invalid_argument("Empty regex pattern not allowed");
    }
 
+   m_compiled = false;
    try
    {
       if (mode == RegexMode::MATCH)
@@ -336,6 +505,7 @@ void TopicFilter::addRegexMatch(std::string&& pattern,
       throw std::invalid_argument("Empty regex pattern not allowed");
    }
 
+   m_compiled = false;
    try
    {
       if (mode == RegexMode::MATCH)
@@ -355,11 +525,13 @@ void TopicFilter::addRegexMatch(std::string&& pattern,
 
 bool TopicFilter::match(std::string_view key) const
 {
+   if (m_compiled)
+   {
+      return matchCompiled(key);
+   }
+
    // 1. Check for exact match (O(1) average case) - fastest
-   // Note: std::string(key) is necessary here because std::unordered_set
-   // doesn't support heterogeneous lookup with std::string_view directly
-   // for std::string keys until C++20 (with custom hashers).
-   if (m_exactMatches.count(std::string(key)))
+   if (m_exactMatches.find(key) != m_exactMatches.end())
    {
       return true;
    }
@@ -421,6 +593,15 @@ void TopicFilter::clear()
    m_rangeMatches.clear();
    m_regexMatches.clear();
    m_regexSearches.clear();
+   m_compiled = false;
+   m_trieNodes.clear();
+   m_trieEdgeBytes.clear();
+   m_trieEdgeTargets.clear();
+   m_trieRanges.clear();
+   m_regexDfas.clear();
+   m_fallbackMatches.clear();
+   m_fallbackSearches.clear();
+   m_compiledRegexRules = 0;
 }
 
 size_t TopicFilter::size() const noexcept
@@ -465,6 +646,177 @@ void TopicFilter::optimize()
 
    std::sort(m_regexMatches.begin(), m_regexMatches.end(), complexity_comparator);
    std::sort(m_regexSearches.begin(), m_regexSearches.end(), complexity_comparator);
+
+   compileTrie();
+   compileRegexes();
+   m_compiled = true;
+}
+
+void TopicFilter::compileTrie()
+{
+   struct Payload
+   {
+      bool exact = false;
+      bool prefix = false;
+      std::vector<std::pair<long long, long long>> ranges;
+   };
+   topic_filter_detail::TrieBuilder<Payload> build;
+   for (const auto& exact : m_exactMatches)
+   {
+      build.insert(exact).exact = true;
+   }
+   for (const auto& prefix : m_prefixMatches)
+   {
+      build.insert(prefix).prefix = true;
+   }
+   for (const auto& rule : m_rangeMatches)
+   {
+      build.insert(rule.prefix).ranges.emplace_back(rule.start, rule.end);
+   }
+
+   m_trieNodes.clear();
+   m_trieEdgeBytes.clear();
+   m_trieEdgeTargets.clear();
+   m_trieRanges.clear();
+   build.flatten(m_trieNodes, m_trieEdgeBytes, m_trieEdgeTargets, [this](Payload& from, TrieNode& node) {
+      node.exact = from.exact;
+      node.prefix = from.prefix;
+
+      auto& ranges = from.ranges;
+      std::sort(ranges.begin(), ranges.end());
+      node.range_begin = static_cast<uint32_t>(m_trieRanges.size());
+      for (const auto& range : ranges)
+      {
+         if (m_trieRanges.size() > node.range_begin && range.first <= m_trieRanges.back().second)
+         {
+            m_trieRanges.back().second = std::max(m_trieRanges.back().second, range.second);
+         }
+         else
+         {
+            m_trieRanges.push_back(range);
+         }
+      }
+      node.range_count = static_cast<uint32_t>(m_trieRanges.size()) - node.range_begin;
+
+      // Nothing below a prefix node can change the answer
+      return !node.prefix;
+   });
+}
+
+void TopicFilter::compileRegexes()
+{
+   m_regexDfas.clear();
+   m_fallbackMatches.clear();
+   m_fallbackSearches.clear();
+   m_compiledRegexRules = 0;
+
+   std::vector<cpp_utils::RegexDfa::Pattern> patterns;
+   std::vector<std::pair<bool, size_t>> owners; // (is search rule, index) per pattern
+   auto lower = [&](const std::vector<RegexRule>& rules, bool search_mode) {
+      for (size_t i = 0; i < rules.size(); ++i)
+      {
+         if (auto pattern = rules[i].lower(search_mode))
+         {
+            patterns.push_back(std::move(*pattern));
+            owners.emplace_back(search_mode, i);
+         }
+         else
+         {
+            (search_mode ? m_fallbackSearches : m_fallbackMatches).push_back(i);
+         }
+      }
+   };
+   lower(m_regexMatches, false);
+   lower(m_regexSearches, true);
+   if (!patterns.empty())
+   {
+      topic_filter_detail::compileRegexGroup(
+         std::span<const cpp_utils::RegexDfa::Pattern>(patterns),
+         std::span<const std::pair<bool, size_t>>(owners),
+         false,
+         [this](cpp_utils::RegexDfa&& dfa, size_t rules) {
+            m_regexDfas.push_back(std::move(dfa));
+            m_compiledRegexRules += rules;
+         },
+         [this](const std::pair<bool, size_t>& owner) {
+            (owner.first ? m_fallbackSearches : m_fallbackMatches).push_back(owner.second);
+         });
+   }
+}
+
+bool TopicFilter::matchCompiled(std::string_view key) const
+{
+   // 1. Exact, prefix and range rules: one walk down the trie
+   uint32_t n = 0;
+   for (size_t i = 0;; ++i)
+   {
+      const TrieNode& node = m_trieNodes[n];
+      if (node.prefix)
+      {
+         return true;
+      }
+      if (node.range_count != 0 && i < key.size() && rangeMatches(node, key.substr(i)))
+      {
+         return true;
+      }
+      if (i == key.size())
+      {
+         if (node.exact)
+         {
+            return true;
+         }
+         break;
+      }
+      const uint8_t* first = m_trieEdgeBytes.data() + node.edge_begin;
+      const uint8_t* last = first + node.edge_count;
+      const uint8_t* edge = std::lower_bound(first, last, static_cast<uint8_t>(key[i]));
+      if (edge == last || *edge != static_cast<uint8_t>(key[i]))
+      {
+         break;
+      }
+      n = m_trieEdgeTargets[static_cast<size_t>(edge - m_trieEdgeBytes.data())];
+   }
+
+   // 2. Lowered regex rules: one pass per DFA
+   for (const auto& dfa : m_regexDfas)
+   {
+      if (dfa.matches(key))
+      {
+         return true;
+      }
+   }
+
+   // 3. Regex rules outside the DFA subset
+   for (size_t i : m_fallbackMatches)
+   {
+      if (m_regexMatches[i].matches(key))
+      {
+         return true;
+      }
+   }
+   for (size_t i : m_fallbackSearches)
+   {
+      if (m_regexSearches[i].search(key))
+      {
+         return true;
+      }
+   }
+   return false;
+}
+
+bool TopicFilter::rangeMatches(const TrieNode& node, std::string_view num_part) const noexcept
+{
+   long long num_value;
+   if (!parseNumber(num_part, num_value))
+   {
+      return false;
+   }
+   // Intervals are disjoint and sorted: check the last one starting at or before the value
+   const auto* first = m_trieRanges.data() + node.range_begin;
+   const auto* last = first + node.range_count;
+   const auto* it = std::upper_bound(
+      first, last, num_value, [](long long value, const std::pair<long long, long long>& range) { return value < range.first; });
+   return it != first && num_value <= std::prev(it)->second;
 }
 
 TopicFilter::Statistics TopicFilter::getStatistics() const noexcept
@@ -474,7 +826,13 @@ TopicFilter::Statistics TopicFilter::getStatistics() const noexcept
            m_rangeMatches.size(),
            m_regexMatches.size(),
            m_regexSearches.size(),
-           size()};
+           size(),
+           m_compiled ? m_compiledRegexRules : 0,
+           m_compiled ? std::accumulate(m_regexDfas.begin(),
+                                        m_regexDfas.end(),
+                                        size_t {0},
+                                        [](size_t total, const cpp_utils::RegexDfa& dfa) { return total + dfa.state_count(); })
+                      : 0};
 }
 
 // Helper function implementations
@@ -0,0 +1,515 @@
+#pragma once
+
+#include "regex_dfa.h"
+#include "topic_filter.h"
+
+#include <algorithm>
+#include <charconv>
+#include <climits>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief A multi-subscriber TopicFilter: rules are registered per subscriber and
+ * match() returns every subscriber with a rule matching the key.
+ *
+ * Instead of one TopicFilter per subscriber (O(subscribers x rules) per message),
+ * optimize() compiles all subscriptions into one trie for exact, prefix and range
+ * rules and one reporting DFA for the regex rules (see TopicFilter::optimize()),
+ * so a key is answered in a single pass whatever the number of subscribers.
+ * Rule semantics and validation are those of TopicFilter. Regex rules outside
+ * the DFA subset keep using std::regex. As with TopicFilter, rules added after
+ * optimize() are honoured through a rule-by-rule scan until the next optimize().
+ *
+ * @tparam SubscriberId Hashable, equality-comparable subscriber identifier.
+ */
+template <typename SubscriberId = uint32_t>
+class TopicSubscriptionIndex
+{
+   public:
+   using RegexMode = TopicFilter::RegexMode;
+
+   /**
+     * @brief Matching subscribers of a batch of keys, stored contiguously.
+     * The subscribers of key i are ids[offsets[i], offsets[i + 1]).
+     */
+   struct BatchResult
+   {
+      std::vector<SubscriberId> ids;
+      std::vector<size_t> offsets {0};
+
+      size_t size() const noexcept { return offsets.size() - 1; }
+      std::span<const SubscriberId> operator[](size_t i) const
+      {
+         return std::span<const SubscriberId>(ids).subspan(offsets[i], offsets[i + 1] - offsets[i]);
+      }
+   };
+
+   void addExactMatch(const SubscriberId& subscriber, std::string key_pattern)
+   {
+      if (key_pattern.empty())
+      {
+         throw std::invalid_argument("Empty key pattern not allowed");
+      }
+      m_exactRules.push_back({std::move(key_pattern), subscriberIndex(subscriber)});
+      m_compiled = false;
+   }
+
+   /**
+     * @brief Adds a prefix rule; a trailing '*' is stripped, as in TopicFilter::addPrefixMatch.
+     */
+   void addPrefixMatch(const SubscriberId& subscriber, std::string key_pattern)
+   {
+      if (key_pattern.empty())
+      {
+         throw std::invalid_argument("Empty key pattern not allowed");
+      }
+      if (key_pattern.back() == '*')
+      {
+         key_pattern.pop_back();
+      }
+      m_prefixRules.push_back({std::move(key_pattern), subscriberIndex(subscriber)});
+      m_compiled = false;
+   }
+
+   /**
+     * @brief Adds a rule matching 'PREFIX_NUMBER' keys with start <= NUMBER <= end.
+     */
+   void addRangeMatch(const SubscriberId& subscriber, std::string key_prefix, long long start, long long end)
+   {
+      if (key_prefix.empty())
+      {
+         throw std::invalid_argument("Empty key prefix not allowed");
+      }
+      if (start > end)
+      {
+         throw std::invalid_argument("Invalid range: start must be <= end");
+      }
+      key_prefix += "_";
+      m_rangeRules.push_back({RangeRule(std::move(key_prefix), start, end), subscriberIndex(subscriber)});
+      m_compiled = false;
+   }
+
+   void addRegexMatch(const SubscriberId& subscriber,
+                      std::string pattern,
+                      RegexMode mode = RegexMode::MATCH,
+                      std::regex_constants::syntax_option_type syntax_opts = std::regex_constants::ECMAScript,
+                      std::regex_constants::match_flag_type match_flags = std::regex_constants::match_default)
+   {
+      if (pattern.empty())
+      {
+         throw std::invalid_argument("Empty regex pattern not allowed");
+      }
+      try
+      {
+         m_regexRules.push_back(
+            {RegexRule(std::move(pattern), syntax_opts, match_flags), mode == RegexMode::SEARCH, subscriberIndex(subscriber)});
+      }
+      catch (const std::regex_error& e)
+      {
+         throw std::invalid_argument("Invalid regex pattern: " + std::string(e.what()));
+      }
+      m_compiled = false;
+   }
+
+   /**
+     * @brief Removes every rule of `subscriber`. Returns false if it had none.
+     */
+   bool removeSubscriber(const SubscriberId& subscriber)
+   {
+      auto it = m_index.find(subscriber);
+      if (it == m_index.end())
+      {
+         return false;
+      }
+      const uint32_t index = it->second;
+      auto owned = [index](const auto& rule) { return rule.subscriber == index; };
+      std::erase_if(m_exactRules, owned);
+      std::erase_if(m_prefixRules, owned);
+      std::erase_if(m_rangeRules, owned);
+      std::erase_if(m_regexRules, owned);
+      m_index.erase(it);
+      m_freeIndices.push_back(index);
+      m_compiled = false;
+      return true;
+   }
+
+   /**
+     * @brief Compiles all subscriptions. Call after a batch of changes.
+     */
+   void optimize()
+   {
+      compileTrie();
+      compileRegexes();
+      m_compiled = true;
+   }
+
+   bool isCompiled() const noexcept { return m_compiled; }
+
+   /**
+     * @brief Returns each subscriber with a rule matching `key` once, in no particular order.
+     */
+   std::vector<SubscriberId> match(std::string_view key) const
+   {
+      std::vector<SubscriberId> out;
+      std::vector<uint32_t> scratch;
+      matchInto(key, scratch, out);
+      return out;
+   }
+
+   /**
+     * @brief Matches every key of `keys` (a range of string-like values), reusing `result`'s storage.
+     */
+   template <typename KeyRange>
+   void matchBatch(const KeyRange& keys, BatchResult& result) const
+   {
+      result.ids.clear();
+      result.offsets.assign(1, 0);
+      std::vector<uint32_t> scratch;
+      for (const auto& key : keys)
+      {
+         matchInto(std::string_view(key), scratch, result.ids);
+         result.offsets.push_back(result.ids.size());
+      }
+   }
+
+   template <typename KeyRange>
+   BatchResult matchBatch(const KeyRange& keys) const
+   {
+      BatchResult result;
+      matchBatch(keys, result);
+      return result;
+   }
+
+   /**
+     * @brief Number of subscribers with at least one rule.
+     */
+   size_t subscriberCount() const noexcept { return m_index.size(); }
+
+   /**
+     * @brief Total number of rules over all subscribers.
+     */
+   size_t size() const noexcept
+   {
+      return m_exactRules.size() + m_prefixRules.size() + m_rangeRules.size() + m_regexRules.size();
+   }
+
+   void clear()
+   {
+      *this = TopicSubscriptionIndex();
+   }
+
+   private:
+   struct StringRule
+   {
+      std::string pattern;
+      uint32_t subscriber;
+   };
+   struct RangeSubscription
+   {
+      RangeRule rule;
+      uint32_t subscriber;
+   };
+   struct RegexSubscription
+   {
+      RegexRule rule;
+      bool search;
+      uint32_t subscriber;
+   };
+
+   // Compiled trie node. Subscriber lists are ranges of m_lists; edges are a sorted
+   // range of m_edgeBytes/m_edgeTargets; range rules are elementary segments.
+   struct TrieNode
+   {
+      uint32_t edge_begin = 0, edge_count = 0;
+      uint32_t exact_begin = 0, exact_count = 0; // Subscribers with an exact rule ending here
+      uint32_t prefix_begin = 0, prefix_count = 0; // Subscribers with a prefix rule ending here
+      uint32_t segment_begin = 0, segment_count = 0;
+   };
+
+   // Numbers in [start, next segment's start) are matched by subscribers
+   // m_lists[list_begin, list_begin + list_count).
+   struct Segment
+   {
+      long long start;
+      uint32_t list_begin;
+      uint32_t list_count;
+   };
+
+   uint32_t subscriberIndex(const SubscriberId& subscriber)
+   {
+      auto it = m_index.find(subscriber);
+      if (it != m_index.end())
+      {
+         return it->second;
+      }
+      uint32_t index;
+      if (!m_freeIndices.empty())
+      {
+         index = m_freeIndices.back();
+         m_freeIndices.pop_back();
+         m_ids[index] = subscriber;
+      }
+      else
+      {
+         index = static_cast<uint32_t>(m_ids.size());
+         m_ids.push_back(subscriber);
+      }
+      m_index.emplace(subscriber, index);
+      return index;
+   }
+
+   static bool parseNumber(std::string_view str, long long& result) noexcept
+   {
+      auto [ptr, ec] = std::from_chars(str.data(), str.data() + str.size(), result);
+      return ec == std::errc {} && ptr == str.data() + str.size();
+   }
+
+   uint32_t appendList(std::vector<uint32_t> list)
+   {
+      std::sort(list.begin(), list.end());
+      list.erase(std::unique(list.begin(), list.end()), list.end());
+      const auto begin = static_cast<uint32_t>(m_lists.size());
+      m_lists.insert(m_lists.end(), list.begin(), list.end());
+      return begin;
+   }
+
+   void compileTrie()
+   {
+      struct Payload
+      {
+         std::vector<uint32_t> exact;
+         std::vector<uint32_t> prefix;
+         std::vector<const RangeSubscription*> ranges;
+      };
+      topic_filter_detail::TrieBuilder<Payload> build;
+      for (const auto& rule : m_exactRules)
+      {
+         build.insert(rule.pattern).exact.push_back(rule.subscriber);
+      }
+      for (const auto& rule : m_prefixRules)
+      {
+         build.insert(rule.pattern).prefix.push_back(rule.subscriber);
+      }
+      for (const auto& rule : m_rangeRules)
+      {
+         build.insert(rule.rule.prefix).ranges.push_back(&rule);
+      }
+
+      m_nodes.clear();
+      m_edgeBytes.clear();
+      m_edgeTargets.clear();
+      m_lists.clear();
+      m_segments.clear();
+      build.flatten(m_nodes, m_edgeBytes, m_edgeTargets, [this](Payload& from, TrieNode& node) {
+         node.exact_begin = appendList(std::move(from.exact));
+         node.exact_count = static_cast<uint32_t>(m_lists.size()) - node.exact_begin;
+         node.prefix_begin = appendList(std::move(from.prefix));
+         node.prefix_count = static_cast<uint32_t>(m_lists.size()) - node.prefix_begin;
+         node.segment_begin = static_cast<uint32_t>(m_segments.size());
+         compileSegments(from.ranges);
+         node.segment_count = static_cast<uint32_t>(m_segments.size()) - node.segment_begin;
+         return true; // Other subscribers' rules may continue below a prefix
+      });
+   }
+
+   // Splits the number line at every range boundary so that each value falls in
+   // exactly one segment, which lists every subscriber whose range covers it.
+   void compileSegments(const std::vector<const RangeSubscription*>& ranges)
+   {
+      std::vector<std::tuple<long long, int, uint32_t>> events; // (position, +1 enter / -1 leave, subscriber)
+      for (const auto* range : ranges)
+      {
+         events.emplace_back(range->rule.start, 1, range->subscriber);
+         if (range->rule.end != LLONG_MAX)
+         {
+            events.emplace_back(range->rule.end + 1, -1, range->subscriber);
+         }
+      }
+      std::sort(events.begin(), events.end());
+      std::map<uint32_t, int> active; // Subscriber -> number of its ranges covering the segment
+      for (size_t i = 0; i < events.size();)
+      {
+         const long long start = std::get<0>(events[i]);
+         for (; i < events.size() && std::get<0>(events[i]) == start; ++i)
+         {
+            const auto [position, delta, subscriber] = events[i];
+            if ((active[subscriber] += delta) == 0)
+            {
+               active.erase(subscriber);
+            }
+         }
+         const auto begin = static_cast<uint32_t>(m_lists.size());
+         for (const auto& entry : active)
+         {
+            m_lists.push_back(entry.first);
+         }
+         m_segments.push_back({start, begin, static_cast<uint32_t>(m_lists.size()) - begin});
+      }
+   }
+
+   void compileRegexes()
+   {
+      m_dfas.clear();
+      m_fallback.clear();
+      std::vector<cpp_utils::RegexDfa::Pattern> patterns;
+      std::vector<size_t> owners; // Index into m_regexRules per pattern
+      for (size_t i = 0; i < m_regexRules.size(); ++i)
+      {
+         const auto& regex = m_regexRules[i];
+         if (auto pattern = regex.rule.lower(regex.search))
+         {
+            pattern->id = regex.subscriber;
+            patterns.push_back(std::move(*pattern));
+            owners.push_back(i);
+         }
+         else
+         {
+            m_fallback.push_back(i);
+         }
+      }
+      if (!patterns.empty())
+      {
+         topic_filter_detail::compileRegexGroup(
+            std::span<const cpp_utils::RegexDfa::Pattern>(patterns),
+            std::span<const size_t>(owners),
+            true,
+            [this](cpp_utils::RegexDfa&& dfa, size_t) { m_dfas.push_back(std::move(dfa)); },
+            [this](size_t owner) { m_fallback.push_back(owner); });
+      }
+   }
+
+   // Appends the subscribers matching `key` to `out`, each once.
+   void matchInto(std::string_view key, std::vector<uint32_t>& scratch, std::vector<SubscriberId>& out) const
+   {
+      scratch.clear();
+      if (m_compiled)
+      {
+         collectCompiled(key, scratch);
+      }
+      else
+      {
+         collectScan(key, scratch);
+      }
+      std::sort(scratch.begin(), scratch.end());
+      scratch.erase(std::unique(scratch.begin(), scratch.end()), scratch.end());
+      for (uint32_t index : scratch)
+      {
+         out.push_back(m_ids[index]);
+      }
+   }
+
+   void collectCompiled(std::string_view key, std::vector<uint32_t>& found) const
+   {
+      auto append = [&](uint32_t begin, uint32_t count) {
+         found.insert(found.end(), m_lists.begin() + begin, m_lists.begin() + begin + count);
+      };
+      uint32_t n = 0;
+      for (size_t i = 0;; ++i)
+      {
+         const TrieNode& node = m_nodes[n];
+         append(node.prefix_begin, node.prefix_count);
+         long long number;
+         if (node.segment_count != 0 && i < key.size() && parseNumber(key.substr(i), number))
+         {
+            const Segment* first = m_segments.data() + node.segment_begin;
+            const Segment* last = first + node.segment_count;
+            const Segment* it = std::upper_bound(
+               first, last, number, [](long long value, const Segment& segment) { return value < segment.start; });
+            if (it != first)
+            {
+               append(std::prev(it)->list_begin, std::prev(it)->list_count);
+            }
+         }
+         if (i == key.size())
+         {
+            append(node.exact_begin, node.exact_count);
+            break;
+         }
+         const uint8_t* first = m_edgeBytes.data() + node.edge_begin;
+         const uint8_t* last = first + node.edge_count;
+         const uint8_t* edge = std::lower_bound(first, last, static_cast<uint8_t>(key[i]));
+         if (edge == last || *edge != static_cast<uint8_t>(key[i]))
+         {
+            break;
+         }
+         n = m_edgeTargets[static_cast<size_t>(edge - m_edgeBytes.data())];
+      }
+      for (const auto& dfa : m_dfas)
+      {
+         dfa.for_each_match(key, [&](uint32_t subscriber) { found.push_back(subscriber); });
+      }
+      for (size_t i : m_fallback)
+      {
+         const auto& regex = m_regexRules[i];
+         if (regex.search ? regex.rule.search(key) : regex.rule.matches(key))
+         {
+            found.push_back(regex.subscriber);
+         }
+      }
+   }
+
+   void collectScan(std::string_view key, std::vector<uint32_t>& found) const
+   {
+      for (const auto& rule : m_exactRules)
+      {
+         if (key == rule.pattern)
+         {
+            found.push_back(rule.subscriber);
+         }
+      }
+      for (const auto& rule : m_prefixRules)
+      {
+         if (key.starts_with(rule.pattern))
+         {
+            found.push_back(rule.subscriber);
+         }
+      }
+      for (const auto& range : m_rangeRules)
+      {
+         long long number;
+         if (key.size() > range.rule.prefix.size() && key.starts_with(range.rule.prefix) &&
+             parseNumber(key.substr(range.rule.prefix.size()), number) && number >= range.rule.start &&
+             number <= range.rule.end)
+         {
+            found.push_back(range.subscriber);
+         }
+      }
+      for (const auto& regex : m_regexRules)
+      {
+         if (regex.search ? regex.rule.search(key) : regex.rule.matches(key))
+         {
+            found.push_back(regex.subscriber);
+         }
+      }
+   }
+
+   // Subscribers are numbered densely; rules and compiled lists refer to the number
+   std::unordered_map<SubscriberId, uint32_t> m_index;
+   std::vector<SubscriberId> m_ids;
+   std::vector<uint32_t> m_freeIndices;
+
+   std::vector<StringRule> m_exactRules;
+   std::vector<StringRule> m_prefixRules;
+   std::vector<RangeSubscription> m_rangeRules;
+   std::vector<RegexSubscription> m_regexRules;
+
+   // Compiled form, valid while m_compiled
+   bool m_compiled = false;
+   std::vector<TrieNode> m_nodes;
+   std::vector<uint8_t> m_edgeBytes;
+   std::vector<uint32_t> m_edgeTargets;
+   std::vector<uint32_t> m_lists;
+   std::vector<Segment> m_segments;
+   std::vector<cpp_utils::RegexDfa> m_dfas; // Built with report_all; pattern id = subscriber number
+   std::vector<size_t> m_fallback; // Indices into m_regexRules not lowered to a DFA
+};
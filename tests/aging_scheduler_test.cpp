@@ -0,0 +1,96 @@
+#include "gtest/gtest.h"
+#include "aging_scheduler.h"
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace {
+
+struct Visit {
+    int key;
+    uint32_t ticket;
+};
+
+class AgingSchedulerTest : public ::testing::Test {
+protected:
+    using clock = std::chrono::steady_clock;
+    clock::time_point start_ = clock::now();
+    cpp_utils::AgingScheduler<int> scheduler_{100ms, 64, start_};
+
+    std::vector<Visit> advance(clock::duration offset) {
+        std::vector<Visit> visits;
+        EXPECT_TRUE(scheduler_.advance(start_ + offset, [&](int key, uint32_t ticket) { visits.push_back({key, ticket}); }));
+        return visits;
+    }
+};
+
+} // namespace
+
+TEST_F(AgingSchedulerTest, VisitsOnceTheDeadlinePasses) {
+    cpp_utils::AgingHandle handle;
+    scheduler_.schedule(7, handle, start_ + 250ms);
+    EXPECT_TRUE(advance(200ms).empty());
+
+    auto visits = advance(250ms); // The wheel rounds up to the next resolution step
+    ASSERT_EQ(visits.size(), 1u);
+    EXPECT_EQ(visits[0].key, 7);
+    EXPECT_TRUE(scheduler_.claim(handle, visits[0].ticket));
+    EXPECT_EQ(handle.ticket, 0u);
+    EXPECT_TRUE(advance(1s).empty());
+}
+
+TEST_F(AgingSchedulerTest, OnlyEarlierDeadlinesRearm) {
+    cpp_utils::AgingHandle handle;
+    scheduler_.schedule(1, handle, start_ + 1s);
+    const uint32_t first_ticket = handle.ticket;
+    scheduler_.schedule(1, handle, start_ + 2s); // Later: stays armed for 1s
+    EXPECT_EQ(handle.ticket, first_ticket);
+    EXPECT_EQ(handle.deadline, start_ + 1s);
+
+    scheduler_.schedule(1, handle, start_ + 500ms); // Earlier: re-armed, old timer cancelled
+    EXPECT_NE(handle.ticket, first_ticket);
+    auto visits = advance(500ms);
+    ASSERT_EQ(visits.size(), 1u);
+    EXPECT_TRUE(scheduler_.claim(handle, visits[0].ticket));
+    EXPECT_TRUE(advance(2s).empty());
+}
+
+TEST_F(AgingSchedulerTest, PastDeadlinesAreVisitedOnNextAdvance) {
+    cpp_utils::AgingHandle handle;
+    scheduler_.schedule(3, handle, start_ - 5s);
+    auto visits = advance(0ms);
+    ASSERT_EQ(visits.size(), 1u);
+    EXPECT_EQ(visits[0].key, 3);
+}
+
+TEST_F(AgingSchedulerTest, ClaimRejectsStaleTickets) {
+    cpp_utils::AgingHandle handle;
+    scheduler_.schedule(4, handle, start_ - 1s); // Goes to the overdue list
+    const uint32_t stale = handle.ticket;
+    scheduler_.cancel(handle);
+    scheduler_.schedule(4, handle, start_ + 300ms);
+
+    auto visits = advance(0ms);
+    ASSERT_EQ(visits.size(), 1u);
+    EXPECT_FALSE(scheduler_.claim(handle, visits[0].ticket));
+    EXPECT_EQ(visits[0].ticket, stale);
+    EXPECT_NE(handle.ticket, 0u);
+}
+
+TEST_F(AgingSchedulerTest, LongGapsAndInvalidationRequireReset) {
+    cpp_utils::AgingHandle handle;
+    scheduler_.schedule(5, handle, start_ + 1s);
+    // 64 slots of 100ms: anything beyond 6.4s is a full-scan case.
+    EXPECT_FALSE(scheduler_.advance(start_ + 10s, [](int, uint32_t) { FAIL(); }));
+
+    scheduler_.reset(start_ + 10s);
+    EXPECT_EQ(scheduler_.now(), start_ + 10s);
+    EXPECT_TRUE(scheduler_.advance(start_ + 11s, [](int, uint32_t) { FAIL(); }));
+
+    scheduler_.invalidate();
+    EXPECT_FALSE(scheduler_.advance(start_ + 11s, [](int, uint32_t) {}));
+    scheduler_.reset(start_ + 11s);
+    EXPECT_TRUE(scheduler_.advance(start_ + 11s, [](int, uint32_t) {}));
+}
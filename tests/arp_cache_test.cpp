@@ -3,6 +3,7 @@
 #include "../include/arp_cache.h" // Adjust path as needed
 #include <vector>
 #include <array>
+#include <atomic>
 #include <iostream> // For std::cerr for warnings, if not captured by test
 #include <thread> // For std::this_thread
 
@@ -43,23 +44,35 @@ public:
     // Mock for routing validation (can be overridden in specific tests)
     MOCK_METHOD(bool, is_ip_routable, (uint32_t ip_address), (override));
 
+    // Records handed-off packets by their first byte
+    void send_pending_packets(uint32_t ip, const mac_addr_t& mac, cpp_utils::PacketQueue packets) override {
+        packets.drain([&](std::span<const uint8_t> p) { sent_packets_for_test.push_back({ip, mac, p[0]}); });
+    }
+    struct SentPacket {
+        uint32_t ip;
+        mac_addr_t mac;
+        uint8_t tag;
+    };
+    std::vector<SentPacket> sent_packets_for_test;
+
     // Helper for tests to force an entry into a specific state
     void force_set_state_for_test(uint32_t ip, ARPState new_state, std::chrono::steady_clock::time_point timestamp) {
-        auto it = cache_.find(ip);
-        if (it == cache_.end()) { // If entry doesn't exist, create a dummy one to set state
-            mac_addr_t dummy_mac = {0};
-            cache_[ip] = {dummy_mac, new_state, timestamp, 0, {}, {}, 0, 0, std::chrono::steady_clock::time_point{}};
-        } else {
-            it->second.state = new_state;
-            it->second.timestamp = timestamp;
-            it->second.probe_count = 0;      // Explicitly reset
-            it->second.backoff_exponent = 0; // Explicitly reset
-        }
+        forceEntryState(ip, new_state, timestamp); // Creates a zero-MAC entry if needed
     }
 
-    // Allow access to protected members for test verification if needed
-    const std::unordered_map<uint32_t, ARPEntry>& get_cache_for_test() const { return cache_; }
+    // Snapshot of every entry, refreshed in place on each call
+    const std::unordered_map<uint32_t, ARPEntry>& get_cache_for_test() const {
+        for (auto it = snapshot_.begin(); it != snapshot_.end();) {
+            it = get_entry(it->first) ? std::next(it) : snapshot_.erase(it);
+        }
+        for_each_entry([this](uint32_t ip, const ARPEntry& entry) { snapshot_.insert_or_assign(ip, entry); });
+        return snapshot_;
+    }
     const std::unordered_map<uint32_t, std::chrono::steady_clock::time_point>& get_garp_last_seen_for_test() const { return gratuitous_arp_last_seen_; }
+    size_t cold_records_in_use_for_test() const { return cold_pool_.size() - cold_free_.size(); }
+
+private:
+    mutable std::unordered_map<uint32_t, ARPEntry> snapshot_;
 };
 
 // Helper function to create common MAC addresses for tests
@@ -1080,6 +1093,228 @@ TEST_F(ARPCacheTestFixture, BackgroundRefresh_ToFailedIfNoReply) { // Renamed to
     ASSERT_EQ(entry_ptr->second.backoff_exponent, 0); // Reset upon entering FAILED
 }
 
+TEST_F(ARPCacheTestFixture, ConcurrentLookup_FollowsEntryStates) {
+    auto reader = cache_->register_reader();
+    mac_addr_t mac_out;
+
+    EXPECT_CALL(*cache_, send_arp_request(testing::_)).Times(0); // Never starts resolution
+    EXPECT_FALSE(cache_->lookup_concurrent(reader, ip1_, mac_out));
+
+    cache_->add_entry(ip1_, mac1_);
+    ASSERT_TRUE(cache_->lookup_concurrent(reader, ip1_, mac_out));
+    EXPECT_EQ(mac_out, mac1_);
+
+    cache_->add_entry(ip1_, mac3_conflict_); // UPDATE_EXISTING publishes the new MAC
+    ASSERT_TRUE(cache_->lookup_concurrent(reader, ip1_, mac_out));
+    EXPECT_EQ(mac_out, mac3_conflict_);
+
+    auto now = std::chrono::steady_clock::now();
+    cache_->force_set_state_for_test(ip1_, ARPCache::ARPState::STALE, now);
+    ASSERT_TRUE(cache_->lookup_concurrent(reader, ip1_, mac_out)) << "STALE entries still resolve";
+    EXPECT_EQ(mac_out, mac3_conflict_);
+    testing::Mock::VerifyAndClearExpectations(&(*cache_));
+
+    EXPECT_CALL(*cache_, send_arp_request(ip1_)).Times(1);
+    cache_->age_entries(now + stale_time_ + std::chrono::milliseconds(100)); // STALE -> PROBE
+    EXPECT_FALSE(cache_->lookup_concurrent(reader, ip1_, mac_out)) << "PROBE needs the owner-thread lookup";
+
+    cache_->handle_link_down();
+    EXPECT_FALSE(cache_->lookup_concurrent(reader, ip1_, mac_out));
+}
+
+TEST_F(ARPCacheTestFixture, ClockEviction_SparesReferencedEntries) {
+    uint32_t ip3 = make_ip(3); mac_addr_t mac3 = make_mac(3);
+    uint32_t ip4 = make_ip(4); mac_addr_t mac4 = make_mac(4);
+    uint32_t ip5 = make_ip(5); mac_addr_t mac5 = make_mac(5);
+    cache_->set_max_cache_size(3);
+    cache_->add_entry(ip1_, mac1_);
+    cache_->add_entry(ip2_, mac2_);
+    cache_->add_entry(ip3, mac3);
+    cache_->add_entry(ip4, mac4); // Every entry is referenced once, so the oldest goes
+    EXPECT_EQ(cache_->get_cache_for_test().count(ip1_), 0u);
+
+    auto reader = cache_->register_reader();
+    mac_addr_t mac_out;
+    ASSERT_TRUE(cache_->lookup_concurrent(reader, ip2_, mac_out)); // Second chance for ip2
+    cache_->add_entry(ip5, mac5);
+
+    const auto& cache = cache_->get_cache_for_test();
+    EXPECT_EQ(cache.size(), 3u);
+    EXPECT_EQ(cache.count(ip2_), 1u);
+    EXPECT_EQ(cache.count(ip3), 0u);
+    EXPECT_EQ(cache.count(ip4), 1u);
+    EXPECT_EQ(cache.count(ip5), 1u);
+}
+
+TEST_F(ARPCacheTestFixture, TimerDrivenAging_FollowsEachEntrysDeadline) {
+    auto now = std::chrono::steady_clock::now();
+    // REACHABLE entries are refreshed at 90% of reachable_time (270s by default).
+    cache_->force_set_state_for_test(ip1_, ARPCache::ARPState::REACHABLE, now);
+    cache_->force_set_state_for_test(ip2_, ARPCache::ARPState::REACHABLE, now);
+    cache_->force_set_state_for_test(ip2_, ARPCache::ARPState::REACHABLE, now + std::chrono::seconds(30)); // Later deadline
+
+    EXPECT_CALL(*cache_, send_arp_request(testing::_)).Times(0);
+    cache_->age_entries(now + std::chrono::milliseconds(269900));
+    testing::Mock::VerifyAndClearExpectations(&(*cache_));
+
+    EXPECT_CALL(*cache_, send_arp_request(ip1_)).Times(1);
+    EXPECT_CALL(*cache_, send_arp_request(ip2_)).Times(0);
+    cache_->age_entries(now + std::chrono::milliseconds(270050));
+    testing::Mock::VerifyAndClearExpectations(&(*cache_));
+    EXPECT_EQ(cache_->get_cache_for_test().find(ip1_)->second.state, ARPCache::ARPState::PROBE);
+    EXPECT_EQ(cache_->get_cache_for_test().find(ip2_)->second.state, ARPCache::ARPState::REACHABLE);
+
+    EXPECT_CALL(*cache_, send_arp_request(ip1_)).Times(testing::AnyNumber()); // ip1 keeps probing
+    EXPECT_CALL(*cache_, send_arp_request(ip2_)).Times(1);
+    cache_->age_entries(now + std::chrono::milliseconds(299900));
+    cache_->age_entries(now + std::chrono::milliseconds(300050));
+    testing::Mock::VerifyAndClearExpectations(&(*cache_));
+    EXPECT_EQ(cache_->get_cache_for_test().find(ip2_)->second.state, ARPCache::ARPState::PROBE);
+}
+
+TEST_F(ARPCacheTestFixture, CompactLayout_ColdStateOnlyWhenUsed) {
+    for (uint8_t i = 1; i <= 200; ++i) {
+        cache_->add_entry(make_ip(i), make_mac(i));
+    }
+    EXPECT_EQ(cache_->size(), 200u);
+    EXPECT_EQ(cache_->cold_records_in_use_for_test(), 0u) << "Plain entries need no cold record";
+
+    cache_->add_backup_mac(ip1_, mac3_conflict_);
+    EXPECT_EQ(cache_->cold_records_in_use_for_test(), 1u);
+    auto entry = cache_->get_entry(ip1_);
+    ASSERT_TRUE(entry.has_value());
+    EXPECT_EQ(entry->mac, mac1_);
+    EXPECT_EQ(entry->state, ARPCache::ARPState::REACHABLE);
+    ASSERT_EQ(entry->backup_macs.size(), 1u);
+    EXPECT_EQ(entry->backup_macs[0], mac3_conflict_);
+
+    // Failover moves the old primary into the backup list, so the record stays.
+    cache_->force_set_state_for_test(ip1_, ARPCache::ARPState::STALE, std::chrono::steady_clock::now());
+    mac_addr_t mac_out;
+    ASSERT_TRUE(cache_->lookup(ip1_, mac_out));
+    EXPECT_EQ(mac_out, mac3_conflict_);
+    EXPECT_EQ(cache_->get_entry(ip1_)->backup_macs, std::vector<mac_addr_t>{mac1_});
+
+    EXPECT_CALL(*cache_, log_ip_conflict(ip2_, mac2_, mac3_conflict_)).Times(1);
+    cache_->add_entry(ip2_, mac3_conflict_); // MAC change: flap history needs a record
+    EXPECT_EQ(cache_->get_entry(ip2_)->flap_count, 1);
+    EXPECT_EQ(cache_->cold_records_in_use_for_test(), 2u);
+    cache_->add_entry(ip2_, mac3_conflict_); // Same MAC confirms it; the record is returned
+    EXPECT_EQ(cache_->get_entry(ip2_)->flap_count, 0);
+    EXPECT_EQ(cache_->cold_records_in_use_for_test(), 1u);
+
+    size_t visited = 0;
+    cache_->for_each_entry([&](uint32_t, const ARPCache::ARPEntry&) { ++visited; });
+    EXPECT_EQ(visited, 200u);
+    EXPECT_FALSE(cache_->get_entry(make_ip(201)).has_value());
+}
+
+TEST_F(ARPCacheTestFixture, PendingPackets_HandedOffOnResolution) {
+    auto pool = std::make_shared<cpp_utils::PacketBufferPool>(4, 128, 3);
+    cache_->set_packet_pool(pool);
+    std::vector<uint8_t> packet(100);
+    EXPECT_FALSE(cache_->queue_packet(ip1_, packet)) << "No entry to wait on";
+
+    mac_addr_t mac_out;
+    EXPECT_CALL(*cache_, send_arp_request(testing::_)).Times(2);
+    ASSERT_FALSE(cache_->lookup(ip1_, mac_out)); // INCOMPLETE
+    ASSERT_FALSE(cache_->lookup(ip2_, mac_out));
+    for (uint8_t tag = 1; tag <= 4; ++tag) {
+        packet[0] = tag;
+        EXPECT_TRUE(cache_->queue_packet(ip1_, packet));
+    }
+    EXPECT_EQ(cache_->get_entry(ip1_)->pending_packets, 3u);
+    EXPECT_EQ(pool->stats().dropped_queue_full, 1u);
+
+    packet[0] = 9;
+    EXPECT_TRUE(cache_->queue_packet(ip2_, packet)); // Last free buffer
+    EXPECT_FALSE(cache_->queue_packet(ip2_, std::vector<uint8_t>(129))) << "Oversize";
+
+    cache_->add_entry(ip1_, mac1_);
+    ASSERT_EQ(cache_->sent_packets_for_test.size(), 3u);
+    for (size_t i = 0; i < 3; ++i) {
+        EXPECT_EQ(cache_->sent_packets_for_test[i].ip, ip1_);
+        EXPECT_EQ(cache_->sent_packets_for_test[i].mac, mac1_);
+        EXPECT_EQ(cache_->sent_packets_for_test[i].tag, i + 2);
+    }
+    EXPECT_FALSE(cache_->queue_packet(ip1_, packet)) << "Resolved: send directly";
+
+    cache_->handle_link_down(); // ip2's packet is discarded
+    auto stats = pool->stats();
+    EXPECT_EQ(stats.delivered, 3u);
+    EXPECT_EQ(stats.discarded, 1u);
+    EXPECT_EQ(stats.dropped_oversize, 1u);
+    EXPECT_EQ(stats.buffers_in_use, 0u);
+}
+
+TEST_F(ARPCacheTestFixture, PendingPackets_QueueAgainAfterPoolSwap) {
+    mac_addr_t mac_out;
+    EXPECT_CALL(*cache_, send_arp_request(testing::_)).Times(1);
+    ASSERT_FALSE(cache_->lookup(ip1_, mac_out)); // INCOMPLETE
+    std::vector<uint8_t> packet(64);
+    ASSERT_TRUE(cache_->queue_packet(ip1_, packet));
+
+    auto pool = std::make_shared<cpp_utils::PacketBufferPool>(4, 128, 3);
+    cache_->set_packet_pool(pool); // Discards the packet queued in the old pool
+    EXPECT_EQ(cache_->get_entry(ip1_)->pending_packets, 0u);
+    packet[0] = 7;
+    EXPECT_TRUE(cache_->queue_packet(ip1_, packet));
+    EXPECT_EQ(pool->stats().buffers_in_use, 1u);
+
+    cache_->add_entry(ip1_, mac1_);
+    ASSERT_EQ(cache_->sent_packets_for_test.size(), 1u);
+    EXPECT_EQ(cache_->sent_packets_for_test[0].tag, 7u);
+    EXPECT_EQ(pool->stats().delivered, 1u);
+}
+
+TEST(ARPCacheConcurrencyTest, ReadersNeverSeeTornEntries) {
+    ARPCache cache({0x00, 0x01, 0x02, 0x03, 0x04, 0x05});
+    constexpr uint32_t kHosts = 2000; // Forces the read table through several resizes
+    // The MAC repeats the IP and the round, so a torn read cannot match its IP.
+    auto mac_for = [](uint32_t ip, uint8_t round) -> mac_addr_t {
+        return {static_cast<uint8_t>(ip >> 24), static_cast<uint8_t>(ip >> 16), static_cast<uint8_t>(ip >> 8),
+                static_cast<uint8_t>(ip), round, static_cast<uint8_t>(~ip)};
+    };
+
+    std::atomic<bool> stop{false};
+    std::atomic<int> bad_reads{0};
+    std::atomic<long> hits{0};
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; ++t) {
+        readers.emplace_back([&, t] {
+            auto reader = cache.register_reader();
+            uint32_t i = static_cast<uint32_t>(t);
+            while (!stop.load(std::memory_order_relaxed)) {
+                uint32_t ip = 0x0A000000u + (i++ % kHosts);
+                mac_addr_t mac;
+                if (cache.lookup_concurrent(reader, ip, mac)) {
+                    hits.fetch_add(1, std::memory_order_relaxed);
+                    mac_addr_t expected = mac_for(ip, mac[4]);
+                    if (mac != expected) bad_reads.fetch_add(1);
+                }
+            }
+        });
+    }
+
+    for (uint8_t round = 0; round < 20; ++round) {
+        for (uint32_t h = 0; h < kHosts; ++h) {
+            cache.add_entry(0x0A000000u + h, mac_for(0x0A000000u + h, round));
+        }
+        cache.handle_link_down(); // Avoids conflict logging and swaps in a fresh table
+    }
+    for (uint32_t h = 0; h < kHosts; ++h) {
+        cache.add_entry(0x0A000000u + h, mac_for(0x0A000000u + h, 20));
+    }
+    while (hits.load() == 0) std::this_thread::yield();
+    stop = true;
+    for (auto& t : readers) t.join();
+
+    EXPECT_EQ(bad_reads.load(), 0);
+    auto reader = cache.register_reader();
+    mac_addr_t mac;
+    ASSERT_TRUE(cache.lookup_concurrent(reader, 0x0A000000u + kHosts - 1, mac));
+    EXPECT_EQ(mac, mac_for(0x0A000000u + kHosts - 1, 20));
+}
 
 // Note: Some tests above are marked as conceptual or requiring ARPCache modifications
 // for full testability (e.g., forcing entry states, mocking non-virtual methods,
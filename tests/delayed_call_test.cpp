@@ -3,6 +3,8 @@
 #include <thread>
 #include <chrono>
 #include <atomic>
+#include <memory>
+#include <vector>
 
 using namespace std::chrono_literals;
 using namespace util;
@@ -268,3 +270,83 @@ TEST(DelayedCallTest, FactoryFunctionWithFuture) {
     ASSERT_EQ(future.wait_for(50ms), std::future_status::timeout);
     ASSERT_EQ(future.get(), "done");
 }
+
+TEST(DelayedCallTest, ManyCallsShareOneTimerThread) {
+    constexpr int kCalls = 10000;
+    std::atomic<int> fired = 0;
+    std::atomic<int> early = 0;
+    const size_t pending_before = TimerService::instance()->pending();
+
+    std::vector<DelayedCall> calls;
+    calls.reserve(kCalls);
+    for (int i = 0; i < kCalls; ++i) {
+        // Deadlines are not in creation order
+        const auto delay = std::chrono::milliseconds(300 + (kCalls - i) % 50);
+        const auto not_before = std::chrono::steady_clock::now() + delay;
+        calls.emplace_back([&, not_before]() {
+            fired++;
+            if (std::chrono::steady_clock::now() < not_before) {
+                early++;
+            }
+        }, delay);
+    }
+    ASSERT_EQ(TimerService::instance()->pending(), pending_before + kCalls);
+
+    // Cancel every tenth and push every fifth (that is not cancelled) back by 5s
+    for (int i = 0; i < kCalls; i += 5) {
+        if (i % 10 == 0) {
+            calls[i].cancel();
+        } else {
+            calls[i].reschedule(5s);
+        }
+    }
+
+    std::this_thread::sleep_for(700ms);
+    ASSERT_EQ(fired, kCalls - kCalls / 5);
+    ASSERT_EQ(early, 0);
+    calls.clear(); // Cancels the rescheduled ones
+    ASSERT_EQ(TimerService::instance()->pending(), pending_before);
+    ASSERT_EQ(fired, kCalls - kCalls / 5);
+}
+
+TEST(DelayedCallTest, RescheduleRevivesCancelledCall) {
+    std::atomic<bool> executed = false;
+    DelayedCall task([&executed]() { executed = true; }, 50ms);
+    task.cancel();
+    ASSERT_TRUE(task.expired());
+
+    task.reschedule(50ms);
+    ASSERT_TRUE(task.valid());
+    std::this_thread::sleep_for(150ms);
+    ASSERT_TRUE(executed);
+    ASSERT_TRUE(task.expired());
+
+    task.reschedule(50ms); // Already fired: no-op
+    ASSERT_TRUE(task.expired());
+}
+
+TEST(DelayedCallTest, CallCanDestroyItself) {
+    std::promise<void> done;
+    auto self = std::make_shared<std::unique_ptr<DelayedCall>>();
+    *self = std::make_unique<DelayedCall>([self, &done]() {
+        self->reset(); // Must not wait for itself
+        done.set_value();
+    }, 1h);
+    (*self)->reschedule(20ms); // Armed only once *self is set
+
+    ASSERT_EQ(done.get_future().wait_for(1s), std::future_status::ready);
+}
+
+TEST(DelayedCallTest, CallCanDropTheLastServiceOwner) {
+    std::promise<void> done;
+    auto owner = std::make_shared<std::shared_ptr<TimerService>>(std::make_shared<TimerService>());
+    auto entry = std::make_shared<TimerService::Entry>([owner, &done]() {
+        owner->reset(); // Destroys the service on its own worker thread
+        done.set_value();
+    });
+    (*owner)->schedule(entry, TimerService::Clock::now() + 10ms);
+    entry.reset();
+
+    ASSERT_EQ(done.get_future().wait_for(1s), std::future_status::ready);
+    std::this_thread::sleep_for(50ms); // Let the detached worker leave run()
+}
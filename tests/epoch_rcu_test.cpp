@@ -0,0 +1,143 @@
+#include "gtest/gtest.h"
+#include "epoch_rcu.h"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Records its own destruction so tests can observe when reclamation happens.
+struct Tracked {
+    int value;
+    std::atomic<int>* destroyed;
+    Tracked(int v, std::atomic<int>* d) : value(v), destroyed(d) {}
+    ~Tracked() { destroyed->fetch_add(1); }
+};
+
+} // namespace
+
+TEST(EpochDomainTest, RegisterAndReleaseSlots) {
+    concurrent::epoch_domain domain(2);
+    auto r1 = domain.register_reader();
+    auto r2 = domain.register_reader();
+    EXPECT_TRUE(r1.valid());
+    EXPECT_TRUE(r2.valid());
+    EXPECT_THROW(domain.register_reader(), std::runtime_error);
+
+    r1 = concurrent::epoch_domain::reader{}; // Releases the slot
+    auto r3 = domain.register_reader();
+    EXPECT_TRUE(r3.valid());
+}
+
+TEST(EpochDomainTest, ZeroReadersRejected) {
+    EXPECT_THROW(concurrent::epoch_domain(0), std::invalid_argument);
+}
+
+TEST(EpochDomainTest, SynchronizeWithoutReadersReturnsImmediately) {
+    concurrent::epoch_domain domain;
+    auto epoch_before = domain.current_epoch();
+    domain.synchronize();
+    EXPECT_EQ(domain.current_epoch(), epoch_before + 1);
+}
+
+TEST(EpochDomainTest, SynchronizeWaitsForPinnedReader) {
+    concurrent::epoch_domain domain;
+    auto reader = domain.register_reader();
+    std::atomic<bool> synchronized{false};
+
+    reader.lock();
+    reader.lock(); // Nested pins only release on the outermost unlock
+    std::thread writer([&] {
+        domain.synchronize();
+        synchronized = true;
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_FALSE(synchronized.load());
+    reader.unlock();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_FALSE(synchronized.load());
+    reader.unlock();
+    writer.join();
+    EXPECT_TRUE(synchronized.load());
+}
+
+TEST(RcuPtrTest, ReadSeesPublishedValue) {
+    std::atomic<int> destroyed{0};
+    concurrent::rcu_ptr<Tracked> ptr(std::make_unique<Tracked>(1, &destroyed));
+    auto reader = ptr.register_reader();
+    {
+        auto snapshot = ptr.read(reader);
+        ASSERT_TRUE(snapshot);
+        EXPECT_EQ(snapshot->value, 1);
+    }
+    EXPECT_EQ(ptr.publish(std::make_unique<Tracked>(2, &destroyed)), 1u);
+    EXPECT_EQ(destroyed.load(), 1);
+    EXPECT_EQ(ptr.read(reader)->value, 2);
+    EXPECT_EQ(ptr.generation(), 1u);
+}
+
+TEST(RcuPtrTest, OldValueOutlivesPublishWhileRead) {
+    std::atomic<int> destroyed{0};
+    concurrent::rcu_ptr<Tracked> ptr(std::make_unique<Tracked>(1, &destroyed));
+    auto reader = ptr.register_reader();
+    std::atomic<bool> published{false};
+
+    std::thread writer;
+    {
+        auto snapshot = ptr.read(reader);
+        writer = std::thread([&] {
+            ptr.publish(std::make_unique<Tracked>(2, &destroyed));
+            published = true;
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        // The writer is blocked in its grace period; our snapshot is still intact.
+        EXPECT_FALSE(published.load());
+        EXPECT_EQ(destroyed.load(), 0);
+        EXPECT_EQ(snapshot->value, 1);
+    }
+    writer.join();
+    EXPECT_TRUE(published.load());
+    EXPECT_EQ(destroyed.load(), 1);
+}
+
+TEST(RcuPtrTest, UpdateCanDeclineToPublish) {
+    std::atomic<int> destroyed{0};
+    concurrent::rcu_ptr<Tracked> ptr(std::make_unique<Tracked>(1, &destroyed));
+    EXPECT_FALSE(ptr.update([](const Tracked*) { return std::unique_ptr<Tracked>(); }));
+    EXPECT_EQ(ptr.generation(), 0u);
+    EXPECT_TRUE(ptr.update([&](const Tracked* cur) { return std::make_unique<Tracked>(cur->value + 1, &destroyed); }));
+    auto reader = ptr.register_reader();
+    EXPECT_EQ(ptr.read(reader)->value, 2);
+}
+
+TEST(RcuPtrTest, ConcurrentReadersNeverSeeFreedData) {
+    std::atomic<int> destroyed{0};
+    concurrent::rcu_ptr<Tracked> ptr(std::make_unique<Tracked>(0, &destroyed));
+    std::atomic<bool> stop{false};
+    std::atomic<int> bad_reads{0};
+
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; ++t) {
+        readers.emplace_back([&] {
+            auto reader = ptr.register_reader();
+            int last_seen = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                auto snapshot = ptr.read(reader);
+                // Values only grow; a freed object would typically break this.
+                if (snapshot->value < last_seen) bad_reads++;
+                last_seen = snapshot->value;
+            }
+        });
+    }
+    for (int i = 1; i <= 200; ++i) {
+        ptr.publish(std::make_unique<Tracked>(i, &destroyed));
+    }
+    stop = true;
+    for (auto& t : readers) t.join();
+    EXPECT_EQ(bad_reads.load(), 0);
+    EXPECT_EQ(destroyed.load(), 200);
+}
@@ -322,3 +322,60 @@ TEST_F(ExpiringDictTest, ExpireMethodDirectCall) {
     dict_.expire();   // Manually call expire
     ASSERT_TRUE(dict_.empty());
 }
+
+TEST(ExpiringDictBoundedTest, MaxSizeEvictsLeastRecentlyUsed) {
+    ExpiringDict<std::string, int> dict(1h, false, 3);
+    ASSERT_EQ(dict.get_max_size(), 3u);
+    dict.insert("a", 1);
+    dict.insert("b", 2);
+    dict.insert("c", 3);
+    ASSERT_NE(dict.find("a"), nullptr); // "b" is now least recently used
+
+    dict.insert("d", 4);
+    ASSERT_EQ(dict.size(), 3u);
+    ASSERT_FALSE(dict.contains("b"));
+    ASSERT_TRUE(dict.contains("a"));
+
+    dict.insert("c", 33); // Overwriting does not evict
+    ASSERT_EQ(dict.size(), 3u);
+    ASSERT_TRUE(dict.contains("d"));
+
+    ASSERT_TRUE(dict.erase("a"));
+    dict.insert("e", 5);
+    ASSERT_EQ(dict.size(), 3u);
+    ASSERT_TRUE(dict.contains("c"));
+    ASSERT_TRUE(dict.contains("d"));
+    ASSERT_TRUE(dict.contains("e"));
+}
+
+TEST(ExpiringDictBoundedTest, ExpiredEntriesAreDroppedBeforeLiveOnes) {
+    ExpiringDict<std::string, int> dict(50ms, false, 2);
+    dict.insert("old", 1);
+    sleep_for_ms(70);
+    dict.insert("a", 2);
+    ASSERT_NE(dict.find("a"), nullptr);
+    dict.insert("b", 3); // "old" has expired, so nothing live is evicted
+    ASSERT_TRUE(dict.contains("a"));
+    ASSERT_TRUE(dict.contains("b"));
+    ASSERT_EQ(dict.size(), 2u);
+}
+
+TEST(ExpiringDictBoundedTest, RenewalMovesEntryToBackOfExpiryOrder) {
+    ExpiringDict<std::string, int> dict(100ms, true);
+    dict.insert("a", 1);
+    dict.insert("b", 2);
+    dict.insert("c", 3);
+    sleep_for_ms(60);
+    ASSERT_NE(dict.find("a"), nullptr); // Renewed
+    dict.insert("b", 22);               // Overwrite renews too
+
+    std::vector<std::string> order;
+    dict.for_each([&](const std::string& k, const int&) { order.push_back(k); });
+    ASSERT_EQ(order, (std::vector<std::string>{"c", "a", "b"}));
+
+    sleep_for_ms(60); // Only "c" is past its TTL
+    dict.expire();
+    order.clear();
+    dict.for_each([&](const std::string& k, const int&) { order.push_back(k); });
+    ASSERT_EQ(order, (std::vector<std::string>{"a", "b"}));
+}
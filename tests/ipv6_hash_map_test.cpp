@@ -0,0 +1,136 @@
+#include "gtest/gtest.h"
+#include "ipv6_hash_map.h"
+#include <map>
+#include <memory>
+#include <random>
+#include <set>
+#include <string>
+
+using cpp_utils::ipv6_key_t;
+using cpp_utils::Ipv6HashMap;
+
+namespace {
+
+// 2001:db8:<subnet>::<host>: neighbors on one link share their top 64 bits.
+ipv6_key_t address(uint16_t subnet, uint64_t host) {
+    ipv6_key_t a{0x20, 0x01, 0x0d, 0xb8, static_cast<uint8_t>(subnet >> 8), static_cast<uint8_t>(subnet)};
+    for (int i = 0; i < 8; ++i) a[15 - i] = static_cast<uint8_t>(host >> (8 * i));
+    return a;
+}
+
+} // namespace
+
+TEST(Ipv6HashTest, SpreadsAddressesOfOneSubnet) {
+    // Sequential hosts in one /64 must not cluster in the low bits used for the home group.
+    constexpr size_t kBuckets = 1024;
+    std::vector<int> hits(kBuckets);
+    for (uint64_t host = 1; host <= 64 * kBuckets; ++host) {
+        ++hits[cpp_utils::ipv6_hash(address(1, host)) % kBuckets];
+    }
+    for (int h : hits) {
+        EXPECT_GT(h, 20);
+        EXPECT_LT(h, 110);
+    }
+    EXPECT_NE(cpp_utils::ipv6_hash(address(1, 5)), cpp_utils::ipv6_hash(address(2, 5)));
+}
+
+TEST(Ipv6HashMapTest, InsertFindErase) {
+    Ipv6HashMap<std::string> map;
+    EXPECT_TRUE(map.empty());
+    auto [it, inserted] = map.emplace(address(1, 1), "one");
+    EXPECT_TRUE(inserted);
+    EXPECT_EQ(it->second, "one");
+    EXPECT_FALSE(map.emplace(address(1, 1), "again").second);
+    EXPECT_EQ(map.find(address(1, 1))->second, "one");
+    EXPECT_EQ(map.find(address(1, 2)), map.end());
+
+    map[address(1, 2)] = "two";
+    EXPECT_EQ(map.size(), 2u);
+    EXPECT_EQ(map.erase(address(1, 1)), 1u);
+    EXPECT_EQ(map.erase(address(1, 1)), 0u);
+    EXPECT_EQ(map.count(address(1, 1)), 0u);
+    EXPECT_EQ(map.count(address(1, 2)), 1u);
+    EXPECT_EQ(map.size(), 1u);
+}
+
+TEST(Ipv6HashMapTest, MatchesStdMapUnderChurn) {
+    Ipv6HashMap<uint64_t> map;
+    std::map<ipv6_key_t, uint64_t> reference;
+    std::mt19937_64 rng(42);
+    for (int step = 0; step < 200000; ++step) {
+        const ipv6_key_t key = address(static_cast<uint16_t>(rng() % 4), rng() % 5000);
+        if (rng() % 3 == 0) {
+            EXPECT_EQ(map.erase(key), reference.erase(key));
+        } else {
+            const uint64_t value = rng();
+            map[key] = value;
+            reference[key] = value;
+        }
+    }
+    ASSERT_EQ(map.size(), reference.size());
+    size_t visited = 0;
+    for (const auto& [key, value] : map) {
+        auto it = reference.find(key);
+        ASSERT_NE(it, reference.end());
+        EXPECT_EQ(it->second, value);
+        ++visited;
+    }
+    EXPECT_EQ(visited, reference.size());
+    EXPECT_LE(map.capacity(), 4 * reference.size()) << "Tombstones are reclaimed on rehash";
+}
+
+TEST(Ipv6HashMapTest, EraseKeepsOtherIteratorsValid) {
+    Ipv6HashMap<std::unique_ptr<int>> map;
+    for (uint64_t host = 0; host < 1000; ++host) {
+        map.emplace(address(7, host), std::make_unique<int>(static_cast<int>(host)));
+    }
+    // Erase while walking, the way NDCache ages its entries.
+    std::set<int> kept;
+    for (auto it = map.begin(); it != map.end();) {
+        auto next = std::next(it);
+        if (*it->second % 2 == 0) map.erase(it);
+        else kept.insert(*it->second);
+        it = next;
+    }
+    EXPECT_EQ(map.size(), 500u);
+    EXPECT_EQ(kept.size(), 500u);
+    for (uint64_t host = 1; host < 1000; host += 2) {
+        ASSERT_NE(map.find(address(7, host)), map.end());
+    }
+    map.clear();
+    EXPECT_TRUE(map.empty());
+    EXPECT_EQ(map.begin(), map.end());
+}
+
+TEST(Ipv6HashMapTest, MovedFromMapIsEmptyAndUsable) {
+    Ipv6HashMap<int> source;
+    for (uint64_t host = 0; host < 100; ++host) {
+        source[address(1, host)] = static_cast<int>(host);
+    }
+    Ipv6HashMap<int> moved(std::move(source));
+    EXPECT_EQ(moved.size(), 100u);
+    EXPECT_EQ(moved.find(address(1, 42))->second, 42);
+
+    EXPECT_TRUE(source.empty());
+    EXPECT_EQ(source.capacity(), 0u);
+    EXPECT_EQ(source.begin(), source.end());
+    EXPECT_EQ(source.find(address(1, 42)), source.end());
+    EXPECT_EQ(source.erase(address(1, 42)), 0u);
+    source[address(2, 7)] = 7;
+    EXPECT_EQ(source.size(), 1u);
+    EXPECT_EQ(source.find(address(2, 7))->second, 7);
+
+    Ipv6HashMap<int> assigned;
+    assigned = std::move(moved);
+    EXPECT_EQ(assigned.size(), 100u);
+    EXPECT_TRUE(moved.empty());
+    EXPECT_EQ(moved.count(address(1, 42)), 0u);
+    moved.reserve(10);
+    moved[address(3, 3)] = 3;
+    EXPECT_EQ(moved.size(), 1u);
+
+    assigned.clear();
+    EXPECT_TRUE(assigned.empty());
+    assigned[address(1, 1)] = 1;
+    EXPECT_EQ(assigned.size(), 1u);
+}
@@ -0,0 +1,195 @@
+#include "local_id_allocator.h"
+#include "gtest/gtest.h"
+#include <algorithm>
+#include <atomic>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace {
+
+LocalIDAllocator::Config makeConfig(int min_id, int max_id) {
+    LocalIDAllocator::Config config;
+    config.min_id = min_id;
+    config.max_id = max_id;
+    return config;
+}
+
+} // namespace
+
+TEST(LocalIDAllocatorTest, AllocateFreeAndReserve) {
+    LocalIDAllocator allocator(makeConfig(100, 229)); // 130 IDs: spans three bitmap words
+    std::set<int> ids;
+    for (int i = 0; i < 130; ++i) {
+        auto id = allocator.allocate();
+        ASSERT_TRUE(id.has_value());
+        ASSERT_TRUE(ids.insert(*id).second);
+    }
+    EXPECT_EQ(*ids.begin(), 100);
+    EXPECT_EQ(*ids.rbegin(), 229);
+    EXPECT_FALSE(allocator.allocate().has_value());
+    EXPECT_EQ(allocator.getStats().allocated_count, 130);
+
+    EXPECT_TRUE(allocator.free(150));
+    EXPECT_FALSE(allocator.free(150));
+    EXPECT_FALSE(allocator.free(99));
+    EXPECT_FALSE(allocator.isAllocated(150));
+    EXPECT_EQ(allocator.allocate(), 150);
+
+    EXPECT_TRUE(allocator.freeRange(160, 199));
+    EXPECT_FALSE(allocator.freeRange(160, 161)); // Already free
+    EXPECT_TRUE(allocator.reserve(170));
+    EXPECT_FALSE(allocator.reserve(170));
+    EXPECT_FALSE(allocator.reserveRange(165, 175)); // 170 is taken: nothing is reserved
+    EXPECT_FALSE(allocator.isAllocated(165));
+    EXPECT_TRUE(allocator.reserveRange(171, 199));
+    EXPECT_EQ(allocator.allocateRange(10), 160);
+    EXPECT_FALSE(allocator.allocateRange(2).has_value());
+
+    auto all = allocator.getAllocatedIds();
+    EXPECT_EQ(all.size(), 130u);
+    EXPECT_TRUE(allocator.clearAll());
+    EXPECT_EQ(allocator.getStats().allocated_count, 0);
+    EXPECT_EQ(allocator.allocateRange(130), 100);
+
+    EXPECT_THROW(LocalIDAllocator(makeConfig(10, 5)), std::invalid_argument);
+}
+
+TEST(LocalIDAllocatorTest, ExpiredIdsAreCleanedUp) {
+    auto config = makeConfig(0, 63);
+    config.enable_auto_cleanup = false;
+    LocalIDAllocator allocator(config);
+    ASSERT_TRUE(allocator.reserve(1, -1)); // Already past its TTL
+    ASSERT_TRUE(allocator.reserve(2));
+    ASSERT_TRUE(allocator.reserve(3, -1));
+    ASSERT_TRUE(allocator.extendTTL(3, 3600));
+    EXPECT_FALSE(allocator.extendTTL(4, 10));
+
+    EXPECT_EQ(allocator.getStats().expired_count, 1);
+    EXPECT_EQ(allocator.cleanupExpired(), 1);
+    EXPECT_FALSE(allocator.isAllocated(1));
+    EXPECT_TRUE(allocator.isAllocated(2));
+    EXPECT_TRUE(allocator.isAllocated(3));
+    EXPECT_EQ(allocator.cleanupExpired(), 0);
+
+    // Auto cleanup runs on the allocation path once the interval has passed
+    config.cleanup_interval = 0;
+    config.enable_auto_cleanup = true;
+    LocalIDAllocator autoclean(config);
+    ASSERT_TRUE(autoclean.reserveRange(0, 63, -1));
+    EXPECT_TRUE(autoclean.allocate().has_value());
+}
+
+TEST(LocalIDAllocatorTest, ConcurrentAllocateAndFreeNeverDuplicate) {
+    LocalIDAllocator allocator(makeConfig(1, 4096));
+    constexpr int kThreads = 8;
+    std::vector<std::vector<int>> held(kThreads);
+    std::atomic<bool> duplicate{false};
+    std::vector<std::atomic<int>> owner(4097);
+    for (auto& o : owner) o = -1;
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([&, t]() {
+            for (int i = 0; i < 20000; ++i) {
+                if (held[t].size() < 400 && (i % 3 != 2)) {
+                    auto id = allocator.allocate();
+                    if (!id) continue;
+                    int expected = -1;
+                    if (!owner[*id].compare_exchange_strong(expected, t)) duplicate = true;
+                    held[t].push_back(*id);
+                } else if (!held[t].empty()) {
+                    const int id = held[t].back();
+                    held[t].pop_back();
+                    owner[id] = -1;
+                    if (!allocator.free(id)) duplicate = true;
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    EXPECT_FALSE(duplicate);
+    size_t total = 0;
+    for (const auto& h : held) total += h.size();
+    EXPECT_EQ(static_cast<size_t>(allocator.getStats().allocated_count), total);
+}
+
+TEST(IDLeaseCacheTest, LeasesBlocksAndReturnsSurplus) {
+    LocalIDAllocator backend(makeConfig(1, 1000));
+    IDLeaseCache<LocalIDAllocator>::Config config;
+    config.block_size = 32;
+    config.max_spare = 40;
+    std::vector<int> ids;
+    {
+        IDLeaseCache<LocalIDAllocator> cache(backend, config);
+        for (int i = 0; i < 100; ++i) {
+            auto id = cache.allocate();
+            ASSERT_TRUE(id.has_value());
+            ids.push_back(*id);
+        }
+        EXPECT_EQ(ids.front(), 1);
+        EXPECT_EQ(ids.back(), 100);
+        auto stats = cache.getStats();
+        EXPECT_EQ(stats.local_allocations, 100u);
+        EXPECT_EQ(stats.backend_calls, 4u); // Four blocks of 32
+        EXPECT_EQ(backend.getStats().allocated_count, 128);
+
+        // Another client sharing the backend gets IDs outside this lease
+        IDLeaseCache<LocalIDAllocator> other(backend, config);
+        EXPECT_EQ(other.allocate(), 129);
+        EXPECT_TRUE(cache.isAllocated(129));
+        EXPECT_FALSE(cache.isAllocated(101)); // Leased here, but spare
+
+        // Freeing goes to the local pool until it overflows max_spare (28 spare so far)
+        for (int i = 0; i < 12; ++i) {
+            EXPECT_TRUE(cache.free(ids[i]));
+        }
+        EXPECT_FALSE(cache.free(ids[0]));
+        EXPECT_EQ(cache.getStats().spare, 40u);
+        EXPECT_EQ(backend.getStats().allocated_count, 128 + 32);
+        EXPECT_TRUE(cache.free(ids[12])); // 41 spare: all but the newest 20 go back
+        EXPECT_EQ(cache.getStats().spare, 20u);
+        EXPECT_EQ(backend.getStats().allocated_count, 128 - 21 + 32);
+        for (int i = 13; i < 50; ++i) {
+            EXPECT_TRUE(cache.free(ids[i]));
+        }
+        stats = cache.getStats();
+        EXPECT_LE(stats.spare, 40u);
+        EXPECT_EQ(stats.leased, stats.spare + 50);
+        EXPECT_EQ(backend.getStats().allocated_count, static_cast<int>(stats.leased) + 32);
+
+        EXPECT_TRUE(cache.reserve(ids[0])); // Spare here or free in the backend
+        EXPECT_FALSE(cache.reserve(ids[0]));
+        EXPECT_FALSE(cache.reserve(129));   // Held by the other client
+        EXPECT_EQ(cache.renewLeases(60), static_cast<int>(cache.getStats().leased));
+    }
+    // Both caches returned their spare IDs; handed-out IDs stay allocated
+    EXPECT_EQ(backend.getStats().allocated_count, 50 + 1 + 1);
+    EXPECT_TRUE(backend.isAllocated(ids[0]));
+    EXPECT_TRUE(backend.isAllocated(129));
+}
+
+TEST(IDLeaseCacheTest, DropsSparesWhoseLeaseIsRunningOut) {
+    LocalIDAllocator backend(makeConfig(1, 1000));
+    IDLeaseCache<LocalIDAllocator>::Config config;
+    config.block_size = 8;
+    config.lease_ttl_seconds = 2;
+    IDLeaseCache<LocalIDAllocator> cache(backend, config);
+    EXPECT_EQ(cache.allocate(), 1);
+
+    // Less than half the TTL left: the 7 spares go back and a fresh block
+    // (the same lowest free run) is leased
+    std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+    EXPECT_EQ(cache.allocate(), 2);
+    auto stats = cache.getStats();
+    EXPECT_EQ(stats.stale_spares, 7u);
+    EXPECT_EQ(stats.leased, 2u + 7u);
+    EXPECT_EQ(backend.getStats().allocated_count, 1 + 8);
+
+    // Renewed leases are handed out again
+    std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+    EXPECT_EQ(cache.renewLeases(10), 9);
+    EXPECT_EQ(cache.allocate(), 3);
+    EXPECT_EQ(cache.getStats().stale_spares, 7u);
+    EXPECT_THROW((IDLeaseCache<LocalIDAllocator>(backend, {8, 16, 0})), std::invalid_argument);
+}
@@ -7,6 +7,10 @@
 #include <set>    // For checking evicted items
 #include <memory> // For std::unique_ptr in move semantics tests
 #include <functional> // For std::function in function caching utils
+#include <cstdint>
+#include <chrono>
+#include <future>
+#include <stdexcept>
 
 // Test fixture for LRUCache tests
 class LRUCacheTest : public ::testing::Test {
@@ -827,3 +831,237 @@ TEST_F(LRUCacheTest, CustomTypes) {
 //     ::testing::InitGoogleTest(&argc, argv);
 //     return RUN_ALL_TESTS();
 // }
+
+// ShardedLRUCache: the same operations, spread over shards
+TEST_F(LRUCacheTest, ShardedBasicOperations) {
+    ShardedLRUCache<std::string, int> cache(64, 4);
+    EXPECT_EQ(cache.shard_count(), 4u);
+    EXPECT_TRUE(cache.empty());
+    for (int i = 0; i < 40; ++i) {
+        cache.put("key" + std::to_string(i), i);
+    }
+    EXPECT_EQ(cache.size(), 40u);
+    for (int i = 0; i < 40; ++i) {
+        ASSERT_EQ(cache.get("key" + std::to_string(i)), i);
+    }
+    cache.put("key7", 700);
+    EXPECT_EQ(cache.get("key7"), 700);
+    EXPECT_EQ(cache.size(), 40u);
+    EXPECT_FALSE(cache.get("missing").has_value());
+    EXPECT_TRUE(cache.contains("key3"));
+    EXPECT_TRUE(cache.erase("key3"));
+    EXPECT_FALSE(cache.erase("key3"));
+    EXPECT_FALSE(cache.contains("key3"));
+
+    auto stats = cache.get_stats();
+    EXPECT_EQ(stats.hits, 41u);
+    EXPECT_EQ(stats.misses, 1u);
+    EXPECT_EQ(stats.evictions, 0u);
+    cache.reset_stats();
+    EXPECT_EQ(cache.get_stats().hits, 0u);
+
+    cache.clear();
+    EXPECT_TRUE(cache.empty());
+    cache.put("after_clear", 1);
+    EXPECT_EQ(cache.get("after_clear"), 1);
+
+    EXPECT_THROW((ShardedLRUCache<int, int>(0)), std::invalid_argument);
+    EXPECT_THROW((ShardedLRUCache<int, int>(10, 0)), std::invalid_argument);
+    EXPECT_EQ((ShardedLRUCache<int, int>(3, 16)).shard_count(), 3u); // No more shards than entries
+}
+
+// Within a shard, eviction is CLOCK: a recently read entry gets a second chance
+TEST_F(LRUCacheTest, ShardedEvictionSparesRecentlyUsed) {
+    std::vector<int> evicted;
+    ShardedLRUCache<int, int> cache(3, 1, [&](const int& key, const int&) { evicted.push_back(key); });
+    cache.put(1, 10);
+    cache.put(2, 20);
+    cache.put(3, 30);
+    ASSERT_TRUE(cache.get(1).has_value()); // 1 is referenced, 2 and 3 are not
+
+    cache.put(4, 40);
+    EXPECT_EQ(evicted, std::vector<int>{2});
+    EXPECT_TRUE(cache.contains(1));
+    cache.put(5, 50); // 1's bit was not set again, but 3 is next under the hand
+    EXPECT_EQ(evicted, (std::vector<int>{2, 3}));
+    cache.put(6, 60);
+    EXPECT_EQ(evicted, (std::vector<int>{2, 3, 1}));
+    EXPECT_EQ(cache.size(), 3u);
+    EXPECT_EQ(cache.get_stats().evictions, 3u);
+}
+
+TEST_F(LRUCacheTest, ShardedConcurrentReadersAndWriters) {
+    constexpr int kKeys = 512;
+    ShardedLRUCache<int, int> cache(256, 8);
+    std::vector<std::thread> threads;
+    std::atomic<int> wrong_values(0);
+    std::atomic<size_t> lookups(0);
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back([&, t]() {
+            uint32_t state = 12345u + static_cast<uint32_t>(t);
+            for (int j = 0; j < 20000; ++j) {
+                state = state * 1664525u + 1013904223u;
+                const int key = static_cast<int>((state >> 8) % kKeys);
+                if (t < 2 || j % 16 == 0) {
+                    cache.put(key, key * 3);
+                } else if (j % 97 == 0) {
+                    cache.erase(key);
+                } else {
+                    ++lookups;
+                    if (auto v = cache.get(key); v && *v != key * 3) {
+                        ++wrong_values;
+                    }
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(wrong_values, 0);
+    EXPECT_LE(cache.size(), 256u);
+    const auto stats = cache.get_stats();
+    EXPECT_EQ(stats.hits + stats.misses, lookups.load());
+}
+
+TEST_F(LRUCacheTest, CachedFunctionSingleFlight) {
+    std::atomic<int> calls(0);
+    CachedFunction<int, int> slow_square([&](int x) {
+        ++calls;
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        if (x < 0) {
+            throw std::runtime_error("negative");
+        }
+        return x * x;
+    });
+
+    std::vector<std::thread> threads;
+    std::atomic<int> wrong_values(0);
+    std::atomic<int> errors(0);
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back([&]() {
+            if (slow_square(7) != 49) {
+                ++wrong_values;
+            }
+            try {
+                slow_square(-1);
+            } catch (const std::runtime_error&) {
+                ++errors;
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(wrong_values, 0);
+    EXPECT_EQ(errors, 8); // Waiters see the loader's exception
+    EXPECT_LE(calls.load(), 4); // Overlapping misses share loads (ideally one per key)
+    EXPECT_EQ(slow_square.cache_size(), 1u); // Failures are not cached
+
+    const int before = calls.load();
+    EXPECT_THROW(slow_square(-1), std::runtime_error);
+    EXPECT_EQ(calls.load(), before + 1);
+}
+
+TEST_F(LRUCacheTest, CachedFunctionRefreshAheadAndExpiry) {
+    std::atomic<int> calls(0);
+    std::promise<void> gate;
+    std::shared_future<void> gate_open = gate.get_future().share();
+    std::atomic<bool> refreshing(false);
+
+    CachedFunction<int, int>::Config config;
+    config.refresh_after = std::chrono::milliseconds(20);
+    CachedFunction<int, int> versioned([&](int) {
+        const int version = ++calls;
+        if (version == 2) {
+            refreshing = true;
+            gate_open.wait();
+        }
+        return version;
+    }, config);
+
+    EXPECT_EQ(versioned(1), 1);
+    EXPECT_EQ(versioned(1), 1);
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+
+    // The first caller past refresh_after reloads; others keep the old value meanwhile
+    std::thread refresher([&]() { EXPECT_EQ(versioned(1), 2); });
+    while (!refreshing) {
+        std::this_thread::yield();
+    }
+    EXPECT_EQ(versioned(1), 1);
+    gate.set_value();
+    refresher.join();
+    EXPECT_EQ(versioned(1), 2);
+    EXPECT_EQ(calls.load(), 2);
+
+    CachedFunction<int, int>::Config expiring;
+    expiring.expire_after = std::chrono::milliseconds(20);
+    std::atomic<int> loads(0);
+    CachedFunction<int, int> short_lived([&](int x) { ++loads; return x; }, expiring);
+    EXPECT_EQ(short_lived(5), 5);
+    EXPECT_EQ(short_lived(5), 5);
+    EXPECT_EQ(loads.load(), 1);
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    EXPECT_EQ(short_lived(5), 5);
+    EXPECT_EQ(loads.load(), 2);
+}
+
+TEST_F(LRUCacheTest, CachedFunctionGetAllBatchesMisses) {
+    std::atomic<int> single_calls(0);
+    std::vector<std::vector<int>> batches;
+    CachedFunction<int, int>::Config config;
+    config.bulk_loader = [&](const std::vector<int>& keys) {
+        batches.push_back(keys);
+        std::unordered_map<int, int> values;
+        for (int key : keys) {
+            if (key != 13) { // Left out: loaded by the single-key function
+                values.emplace(key, key * 10);
+            }
+        }
+        return values;
+    };
+    CachedFunction<int, int> times_ten([&](int x) { ++single_calls; return x * 10; }, config);
+
+    EXPECT_EQ(times_ten(1), 10);
+    EXPECT_EQ(single_calls.load(), 1);
+
+    EXPECT_EQ(times_ten.get_all({1, 2, 3, 2, 13, 1}), (std::vector<int>{10, 20, 30, 20, 130, 10}));
+    ASSERT_EQ(batches.size(), 1u);
+    EXPECT_EQ(batches[0], (std::vector<int>{2, 3, 13}));
+    EXPECT_EQ(single_calls.load(), 2); // Only 13
+    EXPECT_EQ(times_ten.cache_size(), 4u);
+
+    EXPECT_EQ(times_ten.get_all({3, 2}), (std::vector<int>{30, 20}));
+    EXPECT_EQ(batches.size(), 1u); // All hits
+    EXPECT_TRUE(times_ten.get_all({}).empty());
+}
+
+TEST_F(LRUCacheTest, CachedFunctionGetAllKeepsStaleValuesWhenRefreshFails) {
+    bool failing = false;
+    CachedFunction<int, int>::Config config;
+    config.refresh_after = std::chrono::milliseconds(20);
+    config.bulk_loader = [&](const std::vector<int>& keys) {
+        if (failing) {
+            throw std::runtime_error("backend down");
+        }
+        std::unordered_map<int, int> values;
+        for (int key : keys) {
+            values.emplace(key, key * 10);
+        }
+        return values;
+    };
+    CachedFunction<int, int> times_ten([](int x) { return x * 10; }, config);
+
+    EXPECT_EQ(times_ten.get_all({1, 2}), (std::vector<int>{10, 20}));
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    failing = true;
+
+    // Both are due for refresh: the failed reload falls back to the old values
+    EXPECT_EQ(times_ten.get_all({1, 2, 1}), (std::vector<int>{10, 20, 10}));
+    // A key with nothing cached still fails the batch
+    EXPECT_THROW(times_ten.get_all({1, 3}), std::runtime_error);
+
+    failing = false;
+    EXPECT_EQ(times_ten.get_all({1, 3}), (std::vector<int>{10, 30}));
+}
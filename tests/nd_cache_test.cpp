@@ -12,6 +12,12 @@ public:
     MOCK_METHOD(void, send_router_solicitation, (const ipv6_addr_t& source_ip), (override));
     MOCK_METHOD(void, send_neighbor_solicitation, (const ipv6_addr_t& target_ip, const ipv6_addr_t& source_ip, const mac_addr_t* sllao, bool for_dad), (override));
     MOCK_METHOD(void, send_neighbor_advertisement, (const ipv6_addr_t& target_ip, const ipv6_addr_t& adv_source_ip, const mac_addr_t& tllao, bool is_router, bool solicited, bool override_flag), (override));
+
+    // Records handed-off packets by their first byte
+    void send_pending_packets(const ipv6_addr_t& ip, const mac_addr_t& mac, cpp_utils::PacketQueue packets) override {
+        packets.drain([&](std::span<const uint8_t> p) { sent_packets.push_back({mac, p[0]}); });
+    }
+    std::vector<std::pair<mac_addr_t, uint8_t>> sent_packets;
 };
 
 ipv6_addr_t generate_ll_from_mac_for_test(const mac_addr_t& mac) {
@@ -242,3 +248,48 @@ TEST(NDCacheTest, FailoverInAgeEntries) {
     GTEST_LOG_(INFO) << "ND FailoverInAgeEntries check relies on lookup after failover.";
     testing::Mock::VerifyAndClearExpectations(&cache);
 }
+
+TEST(NDCacheTest, PendingPacketsHandedOffOnAdvertisement) {
+    mac_addr_t device_mac = {0x00,0x00,0x00,0x11,0x22,0xEE}; MockNDCache cache(device_mac);
+    auto pool = std::make_shared<cpp_utils::PacketBufferPool>(16, 128, 2);
+    cache.set_packet_pool(pool);
+
+    ipv6_addr_t neighbor_ip = {{0x20,0x01,0x0d,0xb8,0x00,0x04,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x01}};
+    mac_addr_t neighbor_mac = {0x11,0x22,0x33,0x44,0x55,0x66};
+    std::vector<uint8_t> packet(64);
+    EXPECT_FALSE(cache.queue_packet(neighbor_ip, packet)) << "No entry to wait on";
+
+    cache.add_entry(neighbor_ip, {}, NDCacheState::INCOMPLETE);
+    for (uint8_t tag = 1; tag <= 3; ++tag) {
+        packet[0] = tag;
+        EXPECT_TRUE(cache.queue_packet(neighbor_ip, packet));
+    }
+    EXPECT_EQ(pool->stats().dropped_queue_full, 1u);
+
+    cache.process_neighbor_advertisement({neighbor_ip, neighbor_ip, neighbor_mac, false, true, true});
+    ASSERT_EQ(cache.sent_packets.size(), 2u);
+    EXPECT_EQ(cache.sent_packets[0], std::make_pair(neighbor_mac, uint8_t{2}));
+    EXPECT_EQ(cache.sent_packets[1], std::make_pair(neighbor_mac, uint8_t{3}));
+    EXPECT_EQ(pool->stats().buffers_in_use, 0u);
+    EXPECT_FALSE(cache.queue_packet(neighbor_ip, packet)) << "Resolved: send directly";
+}
+
+TEST(NDCacheTest, PendingPacketsQueueAgainAfterPoolSwap) {
+    mac_addr_t device_mac = {0x00,0x00,0x00,0x11,0x22,0xEE}; MockNDCache cache(device_mac);
+    ipv6_addr_t neighbor_ip = {{0x20,0x01,0x0d,0xb8,0x00,0x05,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x01}};
+    mac_addr_t neighbor_mac = {0x11,0x22,0x33,0x44,0x55,0x77};
+    std::vector<uint8_t> packet(64);
+    cache.add_entry(neighbor_ip, {}, NDCacheState::INCOMPLETE);
+    ASSERT_TRUE(cache.queue_packet(neighbor_ip, packet));
+
+    auto pool = std::make_shared<cpp_utils::PacketBufferPool>(16, 128, 2);
+    cache.set_packet_pool(pool); // Discards the packet queued in the old pool
+    packet[0] = 5;
+    EXPECT_TRUE(cache.queue_packet(neighbor_ip, packet));
+    EXPECT_EQ(pool->stats().buffers_in_use, 1u);
+
+    cache.process_neighbor_advertisement({neighbor_ip, neighbor_ip, neighbor_mac, false, true, true});
+    ASSERT_EQ(cache.sent_packets.size(), 1u);
+    EXPECT_EQ(cache.sent_packets[0], std::make_pair(neighbor_mac, uint8_t{5}));
+    EXPECT_EQ(pool->stats().buffers_in_use, 0u);
+}
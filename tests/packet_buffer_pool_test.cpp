@@ -0,0 +1,107 @@
+#include "gtest/gtest.h"
+#include "packet_buffer_pool.h"
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+using cpp_utils::PacketBufferPool;
+using cpp_utils::PacketQueue;
+
+namespace {
+
+std::vector<uint8_t> packet(uint8_t tag, size_t size = 4) {
+    return std::vector<uint8_t>(size, tag);
+}
+
+std::vector<uint8_t> tags(PacketQueue& queue) {
+    std::vector<uint8_t> out;
+    queue.drain([&](std::span<const uint8_t> p) { out.push_back(p.empty() ? 0 : p[0]); });
+    return out;
+}
+
+} // namespace
+
+TEST(PacketBufferPoolTest, QueuesAndDrainsInOrder) {
+    PacketBufferPool pool(8, 64, 4);
+    PacketQueue queue;
+    ASSERT_TRUE(pool.enqueue(queue, packet(1, 10)));
+    ASSERT_TRUE(pool.enqueue(queue, packet(2, 64)));
+    EXPECT_EQ(queue.size(), 2u);
+    EXPECT_EQ(queue.front().size(), 10u);
+    EXPECT_EQ(pool.stats().buffers_in_use, 2u);
+
+    EXPECT_EQ(tags(queue), (std::vector<uint8_t>{1, 2}));
+    EXPECT_TRUE(queue.empty());
+    auto stats = pool.stats();
+    EXPECT_EQ(stats.enqueued, 2u);
+    EXPECT_EQ(stats.delivered, 2u);
+    EXPECT_EQ(stats.buffers_in_use, 0u);
+}
+
+TEST(PacketBufferPoolTest, PerQueueLimitDropsOldest) {
+    PacketBufferPool pool(8, 64, 3);
+    PacketQueue queue;
+    for (uint8_t i = 1; i <= 5; ++i) {
+        EXPECT_TRUE(pool.enqueue(queue, packet(i)));
+    }
+    EXPECT_EQ(pool.stats().dropped_queue_full, 2u);
+    EXPECT_EQ(pool.stats().buffers_in_use, 3u);
+    EXPECT_EQ(tags(queue), (std::vector<uint8_t>{3, 4, 5}));
+}
+
+TEST(PacketBufferPoolTest, ExhaustedPoolRecyclesOwnOldestOrDropsNew) {
+    PacketBufferPool pool(3, 64, 8);
+    PacketQueue a;
+    PacketQueue b;
+    ASSERT_TRUE(pool.enqueue(a, packet(1)));
+    ASSERT_TRUE(pool.enqueue(a, packet(2)));
+    ASSERT_TRUE(pool.enqueue(a, packet(3)));
+
+    EXPECT_FALSE(pool.enqueue(b, packet(9))) << "Nothing of its own to replace";
+    EXPECT_TRUE(pool.enqueue(a, packet(4)));
+    auto stats = pool.stats();
+    EXPECT_EQ(stats.dropped_pool_exhausted, 2u);
+    EXPECT_EQ(stats.buffers_in_use, 3u);
+    EXPECT_EQ(tags(a), (std::vector<uint8_t>{2, 3, 4}));
+
+    EXPECT_TRUE(pool.enqueue(b, packet(9)));
+    EXPECT_FALSE(pool.enqueue(b, packet(10, 65)));
+    EXPECT_EQ(pool.stats().dropped_oversize, 1u);
+}
+
+TEST(PacketBufferPoolTest, MoveHandsOffAndDestructionDiscards) {
+    PacketBufferPool pool(8, 64, 8);
+    {
+        PacketQueue pending;
+        pool.enqueue(pending, packet(1));
+        pool.enqueue(pending, packet(2));
+        PacketQueue handed_off = std::move(pending);
+        EXPECT_TRUE(pending.empty());
+        EXPECT_EQ(handed_off.size(), 2u);
+
+        pool.enqueue(pending, packet(3)); // The moved-from queue is reusable
+        handed_off.pop();
+        EXPECT_EQ(handed_off.front()[0], 2);
+    }
+    auto stats = pool.stats();
+    EXPECT_EQ(stats.delivered, 1u);
+    EXPECT_EQ(stats.discarded, 2u);
+    EXPECT_EQ(stats.buffers_in_use, 0u);
+}
+
+TEST(PacketBufferPoolTest, RejectsQueuesOfAnotherPool) {
+    PacketBufferPool first(2, 16, 2);
+    PacketBufferPool second(2, 16, 2);
+    PacketQueue queue;
+    first.enqueue(queue, packet(1));
+    EXPECT_THROW(second.enqueue(queue, packet(2)), std::logic_error);
+    EXPECT_THROW(PacketBufferPool(0, 16, 2), std::invalid_argument);
+
+    // Once emptied, by clear(), pop() or a move, the queue may switch pools
+    queue.clear();
+    EXPECT_TRUE(second.enqueue(queue, packet(3)));
+    queue.pop();
+    EXPECT_TRUE(first.enqueue(queue, packet(4)));
+    PacketQueue moved_to(std::move(queue));
+    EXPECT_TRUE(second.enqueue(queue, packet(5)));
+}
@@ -4,6 +4,8 @@
 #include <string>
 #include <algorithm> // For std::sort
 #include <optional>
+#include <atomic>
+#include <thread>
 
 // Helper to convert IP string to uint32_t for tests, expecting no errors
 uint32_t MustIpStringToInt(const std::string& ip) {
@@ -369,3 +371,261 @@ TEST(PolicyRoutingTreeTest, TosAndFlowLabelPolicy) {
     ASSERT_NE(best_route_default, nullptr);
     EXPECT_EQ(best_route_default->nextHop, MustIpStringToInt("10.1.1.3"));
 }
+
+TEST(PolicyRoutingTreeTest, LongestPrefixMatchAcrossStrideBoundaries) {
+    PolicyRoutingTree tree;
+    PolicyRule rule_default;
+    const std::vector<std::pair<std::string, uint8_t>> prefixes = {
+        {"70.0.0.0", 8}, {"70.1.0.0", 16}, {"70.1.2.0", 23}, {"70.1.2.0", 24},
+        {"70.1.2.128", 25}, {"70.1.2.200", 32}, {"0.0.0.0", 0}};
+    // Insert most specific first so shorter prefixes must not overwrite them.
+    for (size_t i = prefixes.size(); i-- > 0;) {
+        RouteAttributes attrs;
+        attrs.nextHop = static_cast<uint32_t>(i + 1);
+        tree.addRoute(prefixes[i].first, prefixes[i].second, rule_default, attrs);
+    }
+
+    auto next_hop_for = [&](const std::string& dst) -> uint32_t {
+        PacketInfo packet;
+        packet.dstIP = MustIpStringToInt(dst);
+        auto best = tree.findBestRoute(packet);
+        return best ? best->nextHop : 0;
+    };
+    EXPECT_EQ(next_hop_for("70.9.9.9"), 1u);
+    EXPECT_EQ(next_hop_for("70.1.9.9"), 2u);
+    EXPECT_EQ(next_hop_for("70.1.3.1"), 3u);
+    EXPECT_EQ(next_hop_for("70.1.2.1"), 4u);
+    EXPECT_EQ(next_hop_for("70.1.2.129"), 5u);
+    EXPECT_EQ(next_hop_for("70.1.2.200"), 6u);
+    EXPECT_EQ(next_hop_for("70.1.2.201"), 5u);
+    EXPECT_EQ(next_hop_for("9.9.9.9"), 7u);
+    EXPECT_GT(tree.fibMemoryBytes(), 0u);
+}
+
+TEST(PolicyRoutingTreeTest, CompiledLpmMatchesReferenceScan) {
+    PolicyRoutingTree tree;
+    PolicyRule rule_default;
+    std::vector<std::pair<uint32_t, uint8_t>> prefixes;
+    uint32_t state = 12345;
+    auto next_rand = [&state]() {
+        state = state * 1664525u + 1013904223u;
+        return state;
+    };
+    for (int i = 0; i < 400; ++i) {
+        // Concentrate on one /8 so prefixes nest and share level 2/3 chunks.
+        uint32_t addr = 0x50000000u | (next_rand() & 0x00FFFFFFu);
+        uint8_t len = static_cast<uint8_t>(8 + next_rand() % 25);
+        uint32_t mask = 0xFFFFFFFFu << (32 - len);
+        prefixes.push_back({addr & mask, len});
+        RouteAttributes attrs;
+        attrs.nextHop = static_cast<uint32_t>(prefixes.size());
+        tree.addRoute(PolicyRoutingTree::ipIntToString(addr & mask), len, rule_default, attrs);
+    }
+
+    for (int i = 0; i < 5000; ++i) {
+        PacketInfo packet;
+        packet.dstIP = (i % 2 == 0) ? prefixes[next_rand() % prefixes.size()].first | (next_rand() & 0xFF)
+                                    : 0x50000000u | (next_rand() & 0x00FFFFFFu);
+        int best_len = -1;
+        uint32_t expected = 0;
+        for (size_t p = 0; p < prefixes.size(); ++p) {
+            uint32_t mask = 0xFFFFFFFFu << (32 - prefixes[p].second);
+            // The first route added for a prefix is the one findBestRoute returns.
+            if ((packet.dstIP & mask) == prefixes[p].first && prefixes[p].second > best_len) {
+                best_len = prefixes[p].second;
+                expected = static_cast<uint32_t>(p + 1);
+            }
+        }
+        auto best = tree.findBestRoute(packet);
+        ASSERT_EQ(best ? best->nextHop : 0u, expected) << PolicyRoutingTree::ipIntToString(packet.dstIP);
+    }
+}
+
+TEST(PolicyRoutingTreeTest, ForwardingApiReturnsTableEntries) {
+    PolicyRoutingTree tree;
+    PolicyRule rule_ecmp;
+    for (uint32_t i = 1; i <= 3; ++i) {
+        RouteAttributes attrs;
+        attrs.nextHop = i;
+        tree.addRoute("80.0.0.0", 8, rule_ecmp, attrs);
+    }
+    RouteAttributes attrs_backup;
+    attrs_backup.nextHop = 9;
+    attrs_backup.localPref = 50;
+    tree.addRoute("80.0.0.0", 8, rule_ecmp, attrs_backup);
+
+    PacketInfo packet;
+    packet.dstIP = MustIpStringToInt("80.1.2.3");
+    const RouteAttributes* best = tree.bestRoute(packet);
+    ASSERT_NE(best, nullptr);
+    EXPECT_EQ(best->nextHop, 1u);
+    EXPECT_EQ(tree.bestRoute(packet), best); // Same stored entry, no copy
+    EXPECT_EQ(tree.findBestRoute(packet), best);
+
+    std::vector<bool> seen(4, false);
+    for (uint16_t port = 1; port <= 200; ++port) {
+        PacketInfo flow = packet;
+        flow.srcPort = port;
+        const RouteAttributes* selected = tree.selectEcmpRoute(flow);
+        ASSERT_NE(selected, nullptr);
+        ASSERT_GE(selected->nextHop, 1u);
+        ASSERT_LE(selected->nextHop, 3u); // Backup is never part of the group
+        seen[selected->nextHop] = true;
+        auto copied = tree.selectEcmpPathUsingFlowHash(flow);
+        ASSERT_TRUE(copied.has_value());
+        EXPECT_EQ(copied->nextHop, selected->nextHop);
+    }
+    EXPECT_TRUE(seen[1] && seen[2] && seen[3]);
+
+    PacketInfo no_route;
+    no_route.dstIP = MustIpStringToInt("81.0.0.1");
+    EXPECT_EQ(tree.bestRoute(no_route), nullptr);
+    EXPECT_EQ(tree.selectEcmpRoute(no_route), nullptr);
+}
+
+TEST(PolicyRoutingTreeTest, ForwardingApiHonorsConditionalPolicies) {
+    PolicyRoutingTree tree;
+    PolicyRule rule_web;
+    rule_web.priority = 10;
+    rule_web.dstPort = 443;
+    PolicyRule rule_any;
+    rule_any.priority = 10;
+    RouteAttributes web_a, web_b, any_route, inactive;
+    web_a.nextHop = 1;
+    web_b.nextHop = 2;
+    any_route.nextHop = 3;
+    inactive.nextHop = 4;
+    inactive.isActive = false;
+    tree.addRoute("90.0.0.0", 8, rule_web, web_a);
+    tree.addRoute("90.0.0.0", 8, rule_any, any_route);
+    tree.addRoute("90.0.0.0", 8, rule_web, web_b);
+
+    PacketInfo web;
+    web.dstIP = MustIpStringToInt("90.0.0.1");
+    web.dstPort = 443;
+    PacketInfo other = web;
+    other.dstPort = 80;
+
+    EXPECT_EQ(tree.bestRoute(web)->nextHop, 1u);
+    EXPECT_EQ(tree.bestRoute(other)->nextHop, 3u);
+    EXPECT_EQ(tree.getEqualCostPaths(web).size(), 3u); // All three share one cost tier
+    EXPECT_EQ(tree.getEqualCostPaths(other).size(), 1u);
+    EXPECT_EQ(tree.selectEcmpRoute(other)->nextHop, 3u);
+    for (uint16_t port = 1; port <= 50; ++port) {
+        PacketInfo flow = web;
+        flow.srcPort = port;
+        EXPECT_EQ(tree.selectEcmpRoute(flow)->nextHop, tree.selectEcmpPathUsingFlowHash(flow)->nextHop);
+    }
+
+    // An inactive route ends the equal-cost group, as getEqualCostPaths always did.
+    PolicyRoutingTree tree_inactive;
+    tree_inactive.addRoute("90.0.0.0", 8, rule_any, inactive);
+    tree_inactive.addRoute("90.0.0.0", 8, rule_any, any_route);
+    EXPECT_EQ(tree_inactive.bestRoute(other)->nextHop, 4u);
+    EXPECT_EQ(tree_inactive.selectEcmpRoute(other), nullptr);
+    EXPECT_TRUE(tree_inactive.getEqualCostPaths(other).empty());
+}
+
+TEST(VrfRoutingTableManagerTest, BatchLookupMatchesPerPacketSelection) {
+    VrfRoutingTableManager manager;
+    PolicyRule rule_default;
+    PolicyRule rule_ssh;
+    rule_ssh.priority = 10;
+    rule_ssh.dstPort = 22;
+    for (uint32_t vrf = 1; vrf <= 3; ++vrf) {
+        for (uint32_t hop = 0; hop < 3; ++hop) {
+            RouteAttributes attrs;
+            attrs.nextHop = vrf * 100 + hop;
+            manager.addRoute(vrf, "10.0.0.0", 8, rule_default, attrs);
+        }
+        RouteAttributes attrs_host;
+        attrs_host.nextHop = vrf * 100 + 50;
+        manager.addRoute(vrf, "10.1.2.3", 32, rule_default, attrs_host);
+        RouteAttributes attrs_ssh;
+        attrs_ssh.nextHop = vrf * 100 + 60;
+        manager.addRoute(vrf, "10.2.0.0", 16, rule_ssh, attrs_ssh);
+    }
+
+    std::vector<VrfPacketInfo> burst;
+    for (uint32_t i = 0; i < 100; ++i) {
+        VrfPacketInfo p;
+        p.vrfId = 1 + i % 4; // VRF 4 does not exist
+        p.packet.srcIP = 0xC0000000u + i;
+        p.packet.srcPort = static_cast<uint16_t>(1000 + i);
+        p.packet.dstPort = (i % 3 == 0) ? 22 : 80;
+        const uint32_t destinations[] = {0x0A000001u, 0x0A010203u, 0x0A020005u, 0x0B000001u};
+        p.packet.dstIP = destinations[(i / 4) % 4];
+        burst.push_back(p);
+    }
+
+    std::vector<const RouteAttributes*> results(burst.size());
+    manager.lookupBatch(burst.data(), burst.size(), results.data());
+    size_t hits = 0;
+    for (size_t i = 0; i < burst.size(); ++i) {
+        auto expected = manager.selectEcmpPathUsingFlowHash(burst[i].vrfId, burst[i].packet);
+        ASSERT_EQ(results[i] != nullptr, expected.has_value()) << "packet " << i;
+        if (expected) {
+            EXPECT_EQ(results[i]->nextHop, expected->nextHop) << "packet " << i;
+            ++hits;
+        }
+    }
+    EXPECT_GT(hits, 30u);
+}
+
+TEST(ConcurrentVrfRoutingTableManagerTest, ReadersSeeConsistentTablesDuringUpdates) {
+    ConcurrentVrfRoutingTableManager manager;
+    PolicyRule rule_default;
+    RouteAttributes attrs_default;
+    attrs_default.nextHop = 1000;
+    manager.addRoute(7, "10.0.0.0", 8, rule_default, attrs_default);
+
+    constexpr uint32_t kSubnets = 64;
+    std::vector<VrfPacketInfo> burst(kSubnets);
+    for (uint32_t k = 0; k < kSubnets; ++k) {
+        burst[k].vrfId = 7;
+        burst[k].packet.dstIP = 0x0A000001u | (k << 8);
+    }
+
+    std::atomic<bool> stop{false};
+    std::atomic<int> bad_results{0};
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 3; ++t) {
+        readers.emplace_back([&] {
+            auto reader = manager.registerReader();
+            std::vector<bool> specific_seen(kSubnets, false);
+            while (!stop.load(std::memory_order_relaxed)) {
+                manager.lookupBatch(reader, burst.data(), burst.size(), [&](size_t i, const RouteAttributes* route) {
+                    // Each subnet resolves to the default or its own /24, and never
+                    // goes back to the default once its /24 has been seen.
+                    if (!route) { bad_results++; return; }
+                    if (route->nextHop == i + 1) specific_seen[i] = true;
+                    else if (route->nextHop != 1000 || specific_seen[i]) bad_results++;
+                });
+            }
+        });
+    }
+    for (uint32_t k = 0; k < kSubnets; ++k) {
+        RouteAttributes attrs;
+        attrs.nextHop = k + 1;
+        manager.addRoute(7, "10.0." + std::to_string(k) + ".0", 24, rule_default, attrs);
+    }
+    stop = true;
+    for (auto& t : readers) t.join();
+    EXPECT_EQ(bad_results.load(), 0);
+
+    // One batched update publishes a single generation.
+    const uint64_t before = manager.generation();
+    manager.updateRoutes({{8, "20.0.0.0", 8, rule_default, attrs_default},
+                          {8, "20.1.0.0", 16, rule_default, attrs_default}});
+    EXPECT_EQ(manager.generation(), before + 1);
+    EXPECT_THROW(manager.addRoute(8, "not.an.ip", 8, rule_default, attrs_default), std::runtime_error);
+    EXPECT_EQ(manager.generation(), before + 1);
+
+    auto reader = manager.registerReader();
+    for (uint32_t k = 0; k < kSubnets; ++k) {
+        auto route = manager.selectEcmpPathUsingFlowHash(reader, 7, burst[k].packet);
+        ASSERT_TRUE(route.has_value());
+        EXPECT_EQ(route->nextHop, k + 1);
+    }
+    EXPECT_FALSE(manager.selectEcmpPathUsingFlowHash(reader, 9, burst[0].packet).has_value());
+}
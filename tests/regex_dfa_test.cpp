@@ -0,0 +1,99 @@
+#include "gtest/gtest.h"
+#include "regex_dfa.h"
+#include <random>
+#include <regex>
+#include <string>
+#include <vector>
+
+using cpp_utils::RegexDfa;
+
+namespace {
+
+std::vector<std::string> randomKeys(size_t count, std::string_view alphabet, size_t max_length, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::vector<std::string> keys;
+    for (size_t i = 0; i < count; ++i) {
+        std::string key(rng() % (max_length + 1), ' ');
+        for (char& c : key) c = alphabet[rng() % alphabet.size()];
+        keys.push_back(std::move(key));
+    }
+    return keys;
+}
+
+} // namespace
+
+TEST(RegexDfaTest, AgreesWithStdRegex) {
+    const std::vector<std::string> patterns = {
+        "VLAN_[0-9]+",           "Eth[0-9]{1,2}/[0-9]",      "(ab|a)*b?",         "[^a-c_]x",
+        "a.c",                   "\\d\\d?_\\w+",             "(?:ab){2,}",        "^b(a|c)*$",
+        "x|^ab$|c$",             "[a\\-c]+\\.\\d",           "a\\x5f\\d",         "(a|b)?(c|)_",
+        "\\S\\s\\D",             "[\\w.]{3}",                "a{0}b",             "(a*)*c",
+    };
+    const auto keys = randomKeys(4000, "abcxAB_019./- \n", 8, 7);
+    for (const bool search : {false, true}) {
+        for (const bool icase : {false, true}) {
+            std::vector<RegexDfa::Pattern> all;
+            std::vector<std::regex> regexes;
+            for (const std::string& pattern : patterns) {
+                SCOPED_TRACE(pattern + (search ? " search" : " match") + (icase ? " icase" : ""));
+                auto parsed = RegexDfa::parse(pattern, search, icase);
+                ASSERT_TRUE(parsed.has_value());
+                auto dfa = RegexDfa::compile(std::span(&*parsed, 1));
+                ASSERT_TRUE(dfa.has_value());
+                const std::regex re(pattern, icase ? std::regex::ECMAScript | std::regex::icase : std::regex::ECMAScript);
+                for (const std::string& key : keys) {
+                    const bool expected = search ? std::regex_search(key, re) : std::regex_match(key, re);
+                    ASSERT_EQ(dfa->matches(key), expected) << '"' << key << '"';
+                }
+                all.push_back(std::move(*parsed));
+                regexes.push_back(re);
+            }
+            // All of them in one automaton
+            auto dfa = RegexDfa::compile(all, 1 << 16);
+            ASSERT_TRUE(dfa.has_value());
+            for (const std::string& key : keys) {
+                bool expected = false;
+                for (const std::regex& re : regexes) {
+                    expected = expected || (search ? std::regex_search(key, re) : std::regex_match(key, re));
+                }
+                ASSERT_EQ(dfa->matches(key), expected) << '"' << key << '"';
+            }
+        }
+    }
+}
+
+TEST(RegexDfaTest, UnionReportsEveryMatchingPattern) {
+    std::vector<RegexDfa::Pattern> patterns;
+    patterns.push_back(*RegexDfa::parse("VLAN_[0-9]+", false, false, 10));
+    patterns.push_back(*RegexDfa::parse("VLAN_1[0-9]*", false, false, 11));
+    patterns.push_back(*RegexDfa::parse("_1", true, false, 12));
+    patterns.push_back(*RegexDfa::parse("^VLAN", true, false, 13));
+
+    auto any = RegexDfa::compile(patterns);
+    auto all = RegexDfa::compile(patterns, RegexDfa::DEFAULT_MAX_STATES, true);
+    ASSERT_TRUE(any && all);
+    auto ids = [&](std::string_view key) {
+        std::vector<uint32_t> out;
+        all->for_each_match(key, [&](uint32_t id) { out.push_back(id); });
+        return out;
+    };
+    EXPECT_EQ(ids("VLAN_15"), (std::vector<uint32_t>{10, 11, 12, 13}));
+    EXPECT_EQ(ids("VLAN_2"), (std::vector<uint32_t>{10, 13}));
+    EXPECT_EQ(ids("x_1y"), (std::vector<uint32_t>{12}));
+    EXPECT_TRUE(ids("xVLAN").empty());
+    EXPECT_TRUE(any->matches("x_1y"));
+    EXPECT_FALSE(any->matches("xVLAN"));
+    EXPECT_LE(any->state_count(), all->state_count());
+}
+
+TEST(RegexDfaTest, RejectsNonRegularConstructs) {
+    for (const char* pattern : {"(a)\\1", "a(?=b)", "\\bword", "[[:alpha:]]", "a^b", "a$b", "[]a]", "\\u0041",
+                                "a{2000}"}) {
+        EXPECT_FALSE(RegexDfa::parse(pattern, false).has_value()) << pattern;
+    }
+    // Within the subset, but too many states for the cap
+    auto parsed = RegexDfa::parse("[ab]*a[ab]{12}", false);
+    ASSERT_TRUE(parsed.has_value());
+    EXPECT_FALSE(RegexDfa::compile(std::span(&*parsed, 1), 1024).has_value());
+    EXPECT_TRUE(RegexDfa::compile(std::span(&*parsed, 1), 16384).has_value());
+}
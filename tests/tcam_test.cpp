@@ -8,6 +8,8 @@
 #include <iomanip>       // For std::setprecision
 #include <numeric>       // For std::iota if needed, though probably not here.
 #include <algorithm>     // For std::find
+#include <random>        // For the randomized batch classifier tests
+#include <atomic>        // For ConcurrentTCAM reader threads
 
 // Helper function to create a packet (vector<uint8_t>)
 // Matches the 15-byte structure used in OptimizedTCAM:
@@ -1258,6 +1260,36 @@ TEST_F(TCAMBackupRestoreTest, RestoreCorruptedDataInvalidValue) {
     EXPECT_EQ(count_active_rules(), 0);
 }
 
+TEST_F(TCAMBackupRestoreTest, FailedRestoreKeepsFrozenTcamUsable) {
+    OptimizedTCAM::WildcardFields f1 = create_default_fields(0x0A000001);
+    OptimizedTCAM::WildcardFields f2 = create_default_fields(0x0A000002);
+    tcam.add_rule_with_ranges(f1, 100, 1);
+    tcam.add_rule_with_ranges(f2, 90, 2);
+    tcam.freeze();
+    auto p1 = make_packet(f1.src_ip, f1.dst_ip, f1.src_port_min, f1.dst_port_min, f1.protocol, f1.eth_type);
+    auto p2 = make_packet(f2.src_ip, f2.dst_ip, f2.src_port_min, f2.dst_port_min, f2.protocol, f2.eth_type);
+    ASSERT_EQ(tcam.classify(p1), 1);
+
+    std::stringstream bad("167772161 4294967295 3232235521 4294967295 X 1024 0 E 80 0 6 255 2048 65535 100 1");
+    EXPECT_FALSE(tcam.restore_rules(bad));
+    EXPECT_TRUE(tcam.is_frozen());
+    EXPECT_EQ(count_active_rules(), 2u); // Left as it was
+    EXPECT_EQ(tcam.classify(p1), 1);
+    EXPECT_EQ(tcam.classify(p2), 2);
+    EXPECT_EQ(tcam.lookup_single(p2), 2);
+
+    // A good restore replaces the rules and recompiles the frozen tree
+    std::stringstream good("167772162 4294967295 3232235521 4294967295 E 1024 0 E 80 0 6 255 2048 65535 50 7\n");
+    EXPECT_TRUE(tcam.restore_rules(good));
+    EXPECT_EQ(count_active_rules(), 1u);
+    EXPECT_EQ(tcam.classify(p1), -1);
+    EXPECT_EQ(tcam.classify(p2), 7);
+
+    std::stringstream empty("");
+    EXPECT_TRUE(tcam.restore_rules(empty));
+    EXPECT_EQ(tcam.classify(p2), -1);
+}
+
 TEST_F(TCAMBackupRestoreTest, BackupOriginalThenRestoreThenAdd) {
     // Add initial rule
     OptimizedTCAM::WildcardFields rule1_fields = create_default_fields(0x0A000001); // 10.0.0.1
@@ -1788,3 +1820,530 @@ TEST_F(TCAMRedundantRuleTest, CompactNoRedundantRules) {
     EXPECT_EQ(count_active_rules(), 2);
     EXPECT_EQ(get_total_rules_from_utilization(), 2);
 }
+
+// --- Tests for the SIMD batch classifier ---
+class TCAMBatchKernelTest : public ::testing::Test {
+protected:
+    OptimizedTCAM tcam;
+    std::mt19937 rng{12345};
+
+    // Rules drawn from a small value space so random packets hit them often.
+    OptimizedTCAM::WildcardFields random_fields() {
+        std::uniform_int_distribution<int> small(0, 3);
+        OptimizedTCAM::WildcardFields f{};
+        f.src_ip = 0x0A000000u | static_cast<uint32_t>(small(rng));
+        switch (small(rng)) {
+            case 0: f.src_ip_mask = 0xFFFFFF00u; break;
+            case 1: f.src_ip_mask = 0xFFFFFFFEu; break; // Partially masked last byte
+            default: f.src_ip_mask = 0xFFFFFFFFu; break;
+        }
+        f.dst_ip = 0xC0A80000u | static_cast<uint32_t>(small(rng));
+        f.dst_ip_mask = small(rng) == 0 ? 0x00000000u : 0xFFFFFFFFu;
+        switch (small(rng)) {
+            case 0: f.src_port_min = 0; f.src_port_max = 0xFFFF; break;
+            case 1: f.src_port_min = 1000; f.src_port_max = 2000; break;
+            default: f.src_port_min = f.src_port_max = static_cast<uint16_t>(1000 + small(rng)); break;
+        }
+        switch (small(rng)) {
+            case 0: f.dst_port_min = 0; f.dst_port_max = 0xFFFF; break;
+            case 1: f.dst_port_min = 80; f.dst_port_max = 443; break;
+            default: f.dst_port_min = f.dst_port_max = static_cast<uint16_t>(80 + small(rng)); break;
+        }
+        f.protocol = small(rng) == 0 ? 17 : 6;
+        f.protocol_mask = small(rng) == 0 ? 0x00 : 0xFF;
+        f.eth_type = 0x0800; f.eth_type_mask = 0xFFFF;
+        return f;
+    }
+
+    // Adds rules one at a time through add_rule_with_ranges.
+    void add_random_rules_incrementally(size_t count) {
+        std::uniform_int_distribution<int> small(0, 3);
+        for (size_t i = 0; i < count; ++i) {
+            tcam.add_rule_with_ranges(random_fields(), small(rng) * 10, static_cast<int>(i));
+        }
+    }
+
+    void add_random_rules(size_t count) {
+        std::uniform_int_distribution<int> small(0, 3);
+        OptimizedTCAM::RuleUpdateBatch batch;
+        for (size_t i = 0; i < count; ++i) {
+            OptimizedTCAM::WildcardFields f{};
+            f.src_ip = 0x0A000000u | static_cast<uint32_t>(small(rng));
+            f.src_ip_mask = small(rng) == 0 ? 0xFFFFFF00u : 0xFFFFFFFFu;
+            f.dst_ip = 0xC0A80000u | static_cast<uint32_t>(small(rng));
+            f.dst_ip_mask = small(rng) == 0 ? 0x00000000u : 0xFFFFFFFFu;
+            switch (small(rng)) {
+                case 0: f.src_port_min = 0; f.src_port_max = 0xFFFF; break;
+                case 1: f.src_port_min = 1000; f.src_port_max = 2000; break;
+                default: f.src_port_min = f.src_port_max = static_cast<uint16_t>(1000 + small(rng)); break;
+            }
+            switch (small(rng)) {
+                case 0: f.dst_port_min = 0; f.dst_port_max = 0xFFFF; break;
+                case 1: f.dst_port_min = 80; f.dst_port_max = 443; break;
+                default: f.dst_port_min = f.dst_port_max = static_cast<uint16_t>(80 + small(rng)); break;
+            }
+            f.protocol = small(rng) == 0 ? 17 : 6;
+            f.protocol_mask = small(rng) == 0 ? 0x00 : 0xFF;
+            f.eth_type = 0x0800; f.eth_type_mask = 0xFFFF;
+            batch.push_back(OptimizedTCAM::RuleOperation::AddRule(f, small(rng) * 10, static_cast<int>(i)));
+        }
+        ASSERT_TRUE(tcam.update_rules_atomic(batch));
+    }
+
+    std::vector<std::vector<uint8_t>> random_packets(size_t count) {
+        std::uniform_int_distribution<int> small(0, 3);
+        std::uniform_int_distribution<int> port_off(0, 1100);
+        std::vector<std::vector<uint8_t>> packets;
+        for (size_t i = 0; i < count; ++i) {
+            packets.push_back(make_packet(0x0A000000u | static_cast<uint32_t>(small(rng)),
+                                          0xC0A80000u | static_cast<uint32_t>(small(rng)),
+                                          static_cast<uint16_t>(999 + port_off(rng)),
+                                          static_cast<uint16_t>(80 + port_off(rng) % 400),
+                                          small(rng) == 0 ? 17 : 6, 0x0800));
+        }
+        return packets;
+    }
+
+    // Reference results from the linear scan (lookup_single would pick the much
+    // slower bitmap engine for these table sizes).
+    std::vector<int> expected_actions(const std::vector<std::vector<uint8_t>>& packets) {
+        auto all_stats = tcam.get_all_rule_stats();
+        std::vector<int> expected;
+        for (const auto& p : packets) {
+            int idx = tcam.lookup_linear_idx(p);
+            expected.push_back(idx == -1 ? -1 : all_stats[static_cast<size_t>(idx)].action);
+        }
+        return expected;
+    }
+};
+
+TEST_F(TCAMBatchKernelTest, SelectedKernelIsSupported) {
+    auto best = OptimizedTCAM::best_supported_batch_kernel();
+    EXPECT_EQ(tcam.get_batch_kernel(), best);
+    EXPECT_EQ(tcam.set_batch_kernel(OptimizedTCAM::BatchKernel::SCALAR), OptimizedTCAM::BatchKernel::SCALAR);
+    // Requesting AVX-512 on a CPU without it falls back to the best available kernel.
+    EXPECT_EQ(tcam.set_batch_kernel(OptimizedTCAM::BatchKernel::AVX512), best);
+}
+
+TEST_F(TCAMBatchKernelTest, AllKernelsMatchLinearLookup) {
+    add_random_rules(200);
+    auto packets = random_packets(517); // Not a multiple of any block size
+    auto expected = expected_actions(packets);
+    ASSERT_GT(std::count_if(expected.begin(), expected.end(), [](int a) { return a != -1; }), 100);
+
+    for (auto kernel : {OptimizedTCAM::BatchKernel::SCALAR, OptimizedTCAM::BatchKernel::AVX2,
+                        OptimizedTCAM::BatchKernel::AVX512}) {
+        if (tcam.set_batch_kernel(kernel) != kernel) continue; // Not supported on this CPU
+        std::vector<int> results;
+        tcam.lookup_batch(packets, results);
+        ASSERT_EQ(results.size(), packets.size());
+        for (size_t i = 0; i < packets.size(); ++i) {
+            EXPECT_EQ(results[i], expected[i]) << "kernel " << static_cast<int>(kernel) << " packet " << i;
+        }
+    }
+}
+
+TEST_F(TCAMBatchKernelTest, BatchUpdatesHitCounts) {
+    OptimizedTCAM::WildcardFields f{};
+    f.src_ip = 0x0A000001; f.src_ip_mask = 0xFFFFFFFF;
+    f.dst_ip = 0; f.dst_ip_mask = 0;
+    f.src_port_min = 0; f.src_port_max = 0xFFFF; f.dst_port_min = 0; f.dst_port_max = 0xFFFF;
+    f.protocol = 0; f.protocol_mask = 0; f.eth_type = 0; f.eth_type_mask = 0;
+    tcam.add_rule_with_ranges(f, 10, 7);
+
+    std::vector<std::vector<uint8_t>> packets(20, make_packet(0x0A000001, 0x01020304, 1, 2, 6, 0x0800));
+    packets.push_back(make_packet(0x0A000002, 0x01020304, 1, 2, 6, 0x0800));
+    std::vector<int> results;
+    tcam.lookup_batch(packets, results);
+
+    EXPECT_EQ(std::count(results.begin(), results.end(), 7), 20);
+    EXPECT_EQ(results.back(), -1);
+    auto stats = tcam.get_rule_stats(0);
+    ASSERT_TRUE(stats.has_value());
+    EXPECT_EQ(stats->hit_count, 20u);
+}
+
+TEST_F(TCAMBatchKernelTest, SoftDeletedAndShortPackets) {
+    add_random_rules(64);
+    auto packets = random_packets(100);
+    packets[3].resize(10);  // Too short for the packed key; classified individually
+    packets[40].resize(4);
+
+    // Soft-delete a few rules without a rebuild; the batch path must skip them.
+    for (uint64_t id : {0u, 5u, 17u, 33u}) {
+        ASSERT_TRUE(tcam.delete_rule(id));
+    }
+    auto expected = expected_actions(packets);
+
+    for (auto kernel : {OptimizedTCAM::BatchKernel::SCALAR, OptimizedTCAM::BatchKernel::AVX2,
+                        OptimizedTCAM::BatchKernel::AVX512}) {
+        if (tcam.set_batch_kernel(kernel) != kernel) continue;
+        std::vector<int> results;
+        tcam.lookup_batch(packets, results);
+        EXPECT_EQ(results, expected) << "kernel " << static_cast<int>(kernel);
+    }
+}
+
+// --- Tests for zero-copy packet views ---
+TEST_F(TCAMBatchKernelTest, SpanLookupsOnRawBuffer) {
+    add_random_rules(32);
+    auto packets = random_packets(40);
+    auto expected = expected_actions(packets);
+
+    // Headers embedded in a larger receive buffer, each preceded by 3 bytes of padding.
+    constexpr size_t kSlot = 64;
+    std::vector<uint8_t> ring(packets.size() * kSlot, 0xEE);
+    for (size_t i = 0; i < packets.size(); ++i) {
+        std::copy(packets[i].begin(), packets[i].end(), ring.begin() + i * kSlot + 3);
+    }
+
+    for (size_t i = 0; i < packets.size(); ++i) {
+        std::span<const uint8_t> view(ring.data() + i * kSlot + 3, 15);
+        int idx = tcam.lookup_linear_idx(view);
+        EXPECT_EQ(idx, tcam.lookup_linear_idx(packets[i]));
+        EXPECT_EQ(tcam.lookup_decision_tree_idx(view), tcam.lookup_decision_tree_idx(packets[i]));
+        EXPECT_EQ(tcam.lookup_single(view), expected[i]);
+    }
+
+    std::vector<const uint8_t*> headers;
+    for (size_t i = 0; i < packets.size(); ++i) headers.push_back(ring.data() + i * kSlot + 3);
+    std::vector<int> results(packets.size(), -2);
+    tcam.lookup_batch(headers.data(), headers.size(), 15, results.data());
+    EXPECT_EQ(results, expected);
+
+    std::vector<int> strided_results(packets.size(), -2);
+    tcam.lookup_batch_strided(ring.data() + 3, kSlot, packets.size(), 15, strided_results.data());
+    EXPECT_EQ(strided_results, expected);
+}
+
+TEST_F(TCAMTest, SpanLookupSingleShortHeader) {
+    tcam.add_rule_with_ranges(create_default_fields(), 100, 1);
+    auto packet = make_packet(0x0A000001, 0xC0A80001, 1024, 80, 6, 0x0800);
+    EXPECT_EQ(tcam.lookup_single(std::span<const uint8_t>(packet)), 1);
+    // A truncated view must not read past its end and cannot match a rule that masks the tail.
+    EXPECT_EQ(tcam.lookup_single(std::span<const uint8_t>(packet.data(), 12)), -1);
+}
+
+// --- Tests for the scalable bitmap engine ---
+TEST_F(TCAMBatchKernelTest, BitmapEngineBeyond1024Rules) {
+    add_random_rules(3000);
+
+    // A lowest-priority rule that only it can match lands far past index 1024.
+    OptimizedTCAM::WildcardFields tail{};
+    tail.src_ip = 0x7F000001; tail.src_ip_mask = 0xFFFFFFFF;
+    tail.dst_ip = 0; tail.dst_ip_mask = 0;
+    tail.src_port_min = 0; tail.src_port_max = 0xFFFF;
+    tail.dst_port_min = 7000; tail.dst_port_max = 8000;
+    tail.protocol = 0; tail.protocol_mask = 0;
+    tail.eth_type = 0; tail.eth_type_mask = 0;
+    ASSERT_TRUE(tcam.update_rules_atomic({OptimizedTCAM::RuleOperation::AddRule(tail, -100, 4242)}));
+
+    auto tail_packet = make_packet(0x7F000001, 0x01010101, 5, 7500, 17, 0x86DD);
+    int tail_idx = tcam.lookup_linear_idx(tail_packet);
+    ASSERT_GT(tail_idx, 1024);
+    EXPECT_EQ(tcam.lookup_bitmap_idx(tail_packet), tail_idx);
+    EXPECT_EQ(tcam.lookup_bitmap_idx(make_packet(0x7F000001, 0x01010101, 5, 9000, 17, 0x86DD)), -1);
+
+    for (const auto& p : random_packets(300)) {
+        EXPECT_EQ(tcam.lookup_bitmap_idx(p), tcam.lookup_linear_idx(p));
+    }
+
+    auto mem = tcam.get_memory_usage_stats();
+    EXPECT_GT(mem.field_bitmaps_approx_bytes, mem.field_bitmaps_count * 257 * (3001 / 8));
+}
+
+TEST_F(TCAMBatchKernelTest, BitmapEngineShortPacketUsesWildcardRow) {
+    add_random_rules(40);
+    OptimizedTCAM::WildcardFields any{};
+    any.src_ip = 0x0B000000; any.src_ip_mask = 0xFF000000;
+    any.src_port_min = 0; any.src_port_max = 0xFFFF;
+    any.dst_port_min = 0; any.dst_port_max = 0xFFFF;
+    ASSERT_TRUE(tcam.update_rules_atomic({OptimizedTCAM::RuleOperation::AddRule(any, 50, 99)}));
+
+    // Only the first four bytes are present; every other field must be a wildcard.
+    std::vector<uint8_t> short_packet = {0x0B, 0x01, 0x02, 0x03};
+    int idx = tcam.lookup_linear_idx(short_packet);
+    ASSERT_NE(idx, -1);
+    EXPECT_EQ(tcam.lookup_bitmap_idx(short_packet), idx);
+}
+
+// --- Tests for ConcurrentTCAM (RCU-published generations) ---
+TEST(ConcurrentTCAMTest, UpdatesPublishNewGenerations) {
+    ConcurrentTCAM ctcam;
+    auto reader = ctcam.register_reader();
+    auto packet = make_packet(0x0A000001, 0xC0A80001, 1024, 80, 6, 0x0800);
+    EXPECT_EQ(ctcam.lookup(reader, packet), -1);
+
+    OptimizedTCAM::WildcardFields f{};
+    f.src_ip = 0x0A000001; f.src_ip_mask = 0xFFFFFFFF;
+    f.src_port_min = 0; f.src_port_max = 0xFFFF; f.dst_port_min = 0; f.dst_port_max = 0xFFFF;
+    ctcam.add_rule_with_ranges(f, 10, 5);
+    EXPECT_EQ(ctcam.generation(), 1u);
+    EXPECT_EQ(ctcam.lookup(reader, packet), 5);
+
+    // A rejected batch publishes nothing.
+    EXPECT_FALSE(ctcam.delete_rule(999));
+    EXPECT_EQ(ctcam.generation(), 1u);
+    EXPECT_EQ(ctcam.lookup(reader, packet), 5);
+
+    const uint8_t* headers[] = {packet.data(), packet.data()};
+    int results[2] = {0, 0};
+    ctcam.lookup_batch(reader, headers, 2, packet.size(), results);
+    EXPECT_EQ(results[0], 5);
+    EXPECT_EQ(results[1], 5);
+
+    EXPECT_TRUE(ctcam.delete_rule(0));
+    EXPECT_EQ(ctcam.lookup(reader, packet), -1);
+    EXPECT_EQ(ctcam.with_snapshot(reader, [](const OptimizedTCAM& t) { return t.get_all_rule_stats().size(); }), 0u);
+}
+
+TEST(ConcurrentTCAMTest, ReadersClassifyDuringUpdates) {
+    ConcurrentTCAM ctcam;
+    // Rule A (action 1) is always present; rule B (action 2, higher priority)
+    // is added and removed repeatedly. Readers must only ever see 1 or 2.
+    OptimizedTCAM::WildcardFields a{};
+    a.src_ip = 0x0A000000; a.src_ip_mask = 0xFF000000;
+    a.src_port_min = 0; a.src_port_max = 0xFFFF; a.dst_port_min = 0; a.dst_port_max = 0xFFFF;
+    ctcam.add_rule_with_ranges(a, 10, 1);
+    OptimizedTCAM::WildcardFields b = a;
+    b.src_ip_mask = 0xFFFF0000;
+
+    auto packet = make_packet(0x0A000001, 0xC0A80001, 1024, 80, 6, 0x0800);
+    std::atomic<bool> stop{false};
+    std::atomic<int> unexpected{0};
+    std::atomic<long> lookups{0};
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; ++t) {
+        readers.emplace_back([&] {
+            auto reader = ctcam.register_reader();
+            const uint8_t* headers[16];
+            for (auto& h : headers) h = packet.data();
+            int results[16];
+            while (!stop.load(std::memory_order_relaxed)) {
+                int action = ctcam.lookup(reader, packet);
+                if (action != 1 && action != 2) unexpected++;
+                ctcam.lookup_batch(reader, headers, 16, packet.size(), results);
+                for (int r : results) {
+                    if (r != 1 && r != 2) unexpected++;
+                }
+                lookups++;
+            }
+        });
+    }
+
+    for (int i = 0; i < 100; ++i) {
+        ctcam.add_rule_with_ranges(b, 20, 2);
+        auto reader = ctcam.register_reader();
+        uint64_t b_id = ctcam.with_snapshot(reader, [](const OptimizedTCAM& t) {
+            for (const auto& st : t.get_all_rule_stats()) {
+                if (st.action == 2) return st.rule_id;
+            }
+            return uint64_t{0};
+        });
+        ASSERT_TRUE(ctcam.delete_rule(b_id));
+    }
+    stop = true;
+    for (auto& t : readers) t.join();
+    EXPECT_EQ(unexpected.load(), 0);
+    EXPECT_GT(lookups.load(), 0);
+    EXPECT_EQ(ctcam.generation(), 201u);
+}
+
+// Every index-based engine must agree with the linear scan, which is the
+// reference for first-match semantics.
+static void expect_engines_agree(const OptimizedTCAM& tcam, const std::vector<std::vector<uint8_t>>& packets) {
+    for (const auto& p : packets) {
+        const int expected = tcam.lookup_linear_idx(p);
+        ASSERT_EQ(tcam.lookup_bitmap_idx(p), expected);
+        ASSERT_EQ(tcam.lookup_decision_tree_idx(p), expected);
+    }
+}
+
+TEST_F(TCAMBatchKernelTest, IncrementalInsertsMatchFullRebuild) {
+    tcam.set_auto_rebalance(false);
+    add_random_rules_incrementally(400);
+    auto stats = tcam.get_maintenance_stats();
+    EXPECT_EQ(stats.full_rebuilds, 1u); // Only the first insert into an empty table
+    EXPECT_EQ(stats.incremental_inserts, 399u);
+    EXPECT_GT(stats.subtree_rebuilds, 0u);
+    EXPECT_TRUE(tcam.needs_rebalance());
+
+    auto packets = random_packets(600);
+    expect_engines_agree(tcam, packets);
+    std::vector<int> batch_results;
+    tcam.lookup_batch(packets, batch_results);
+    EXPECT_EQ(batch_results, expected_actions(packets));
+
+    auto before = expected_actions(packets);
+    tcam.rebalance();
+    EXPECT_EQ(expected_actions(packets), before);
+    EXPECT_EQ(tcam.get_maintenance_stats().incremental_inserts, 0u);
+    EXPECT_FALSE(tcam.needs_rebalance());
+}
+
+TEST_F(TCAMBatchKernelTest, IncrementalDeletesUnlinkRules) {
+    tcam.set_auto_rebalance(false);
+    add_random_rules_incrementally(300);
+    auto all_stats = tcam.get_all_rule_stats();
+    for (size_t i = 0; i < all_stats.size(); i += 3) {
+        ASSERT_TRUE(tcam.delete_rule(all_stats[i].rule_id));
+    }
+    EXPECT_EQ(tcam.get_maintenance_stats().inactive_rules, 100u);
+    add_random_rules_incrementally(50); // Inserted between soft-deleted positions
+
+    auto packets = random_packets(600);
+    expect_engines_agree(tcam, packets);
+    std::vector<int> batch_results;
+    tcam.lookup_batch(packets, batch_results);
+    EXPECT_EQ(batch_results, expected_actions(packets));
+}
+
+TEST_F(TCAMBatchKernelTest, AutoRebalanceCompactsSoftDeletes) {
+    add_random_rules_incrementally(200);
+    const size_t rebuilds = tcam.get_maintenance_stats().full_rebuilds;
+    auto all_stats = tcam.get_all_rule_stats();
+    for (size_t i = 0; i < 100; ++i) {
+        ASSERT_TRUE(tcam.delete_rule(all_stats[i].rule_id));
+    }
+    EXPECT_TRUE(tcam.needs_rebalance());
+
+    add_random_rules_incrementally(1);
+    auto stats = tcam.get_maintenance_stats();
+    EXPECT_EQ(stats.full_rebuilds, rebuilds + 1);
+    EXPECT_EQ(stats.inactive_rules, 0u);
+    EXPECT_EQ(tcam.get_rule_utilization().total_rules, 101u);
+    expect_engines_agree(tcam, random_packets(300));
+}
+
+TEST_F(TCAMBatchKernelTest, InsertsReuseNearbyFreeSlots) {
+    tcam.set_auto_rebalance(false);
+    add_random_rules_incrementally(320);
+    tcam.rebalance();
+    auto stats = tcam.get_maintenance_stats();
+    EXPECT_EQ(stats.vacant_slots, 19u); // One after every 16 rules
+    EXPECT_EQ(stats.shifted_rules, 0u);
+    EXPECT_EQ(tcam.get_memory_usage_stats().total_rules_in_vector, 320u);
+
+    auto all_stats = tcam.get_all_rule_stats();
+    ASSERT_EQ(all_stats.size(), 320u);
+    for (size_t i = 0; i < all_stats.size(); i += 4) {
+        ASSERT_TRUE(tcam.delete_rule(all_stats[i].rule_id));
+    }
+    EXPECT_EQ(tcam.get_maintenance_stats().inactive_rules, 80u);
+
+    // Interleave inserts and deletes, frozen and not.
+    auto packets = random_packets(400);
+    tcam.freeze();
+    for (int round = 0; round < 4; ++round) {
+        if (round == 2) {
+            tcam.thaw();
+        }
+        add_random_rules_incrementally(20);
+        all_stats = tcam.get_all_rule_stats();
+        ASSERT_TRUE(tcam.delete_rule(all_stats[all_stats.size() / 2].rule_id));
+        expect_engines_agree(tcam, packets);
+        if (tcam.is_frozen()) {
+            for (const auto& p : packets) {
+                ASSERT_EQ(tcam.lookup_frozen_idx(p), tcam.lookup_linear_idx(p));
+            }
+        }
+        std::vector<int> batch_results;
+        tcam.lookup_batch(packets, batch_results);
+        ASSERT_EQ(batch_results, expected_actions(packets));
+    }
+
+    // Each insert moved only the few rules between it and a free slot, and
+    // soft-deleted slots were taken over by inserts.
+    stats = tcam.get_maintenance_stats();
+    EXPECT_EQ(stats.incremental_inserts, 80u);
+    EXPECT_LT(stats.shifted_rules, 4 * stats.incremental_inserts);
+    EXPECT_LT(stats.inactive_rules, 84u);
+
+    auto before = expected_actions(packets);
+    tcam.rebalance();
+    EXPECT_EQ(expected_actions(packets), before);
+    EXPECT_EQ(tcam.get_maintenance_stats().inactive_rules, 0u);
+    EXPECT_EQ(tcam.get_maintenance_stats().shifted_rules, 0u);
+}
+
+TEST_F(TCAMBatchKernelTest, DecisionTreePrefersHigherPriorityDeeperRule) {
+    // A wildcard rule stays at the root; the higher-priority exact rule sits in
+    // a subtree below it, and must still win.
+    auto add = [&](uint32_t src_ip, uint32_t mask, int priority, int action) {
+        OptimizedTCAM::WildcardFields f{};
+        f.src_ip = src_ip; f.src_ip_mask = mask;
+        f.src_port_min = 0; f.src_port_max = 0xFFFF;
+        f.dst_port_min = 0; f.dst_port_max = 0xFFFF;
+        f.eth_type = 0x0800; f.eth_type_mask = 0xFFFF;
+        tcam.add_rule_with_ranges(f, priority, action);
+    };
+    add(0x0A000000u, 0x00000000u, 50, 1);
+    for (uint32_t i = 0; i < 20; ++i) {
+        add(0x0A000000u | i, 0xFFFFFFFFu, 100, 100 + static_cast<int>(i));
+    }
+    tcam.rebalance();
+    auto packet = make_packet(0x0A000007u, 0xC0A80001u, 1, 2, 6, 0x0800);
+    int idx = tcam.lookup_decision_tree_idx(packet);
+    ASSERT_NE(idx, -1);
+    EXPECT_EQ(tcam.get_all_rule_stats()[static_cast<size_t>(idx)].action, 107);
+}
+
+TEST_F(TCAMBatchKernelTest, RuleArenaMatchesTracedRuleScan) {
+    add_random_rules_incrementally(150);
+    auto all_stats = tcam.get_all_rule_stats();
+    for (size_t i = 0; i < all_stats.size(); i += 7) {
+        tcam.delete_rule(all_stats[i].rule_id);
+    }
+    // A trace log forces the byte-wise matches_rule path; without one the
+    // linear scan and bitmap verification read the rule arena.
+    for (const auto& p : random_packets(300)) {
+        std::vector<std::string> trace;
+        ASSERT_EQ(tcam.lookup_linear_idx(p), tcam.lookup_linear_idx(p, &trace));
+        trace.clear();
+        ASSERT_EQ(tcam.lookup_bitmap_idx(p), tcam.lookup_bitmap_idx(p, &trace));
+    }
+
+    auto mem = tcam.get_memory_usage_stats();
+    EXPECT_GE(mem.rule_arena_bytes, mem.total_rules_in_vector * 45);
+}
+
+TEST_F(TCAMBatchKernelTest, FrozenTreeMatchesPointerTree) {
+    add_random_rules_incrementally(500);
+    tcam.rebalance();
+    EXPECT_EQ(tcam.lookup_frozen_idx(make_packet(0x0A000001u, 0xC0A80001u, 1000, 80, 6, 0x0800)), -1);
+
+    tcam.freeze();
+    ASSERT_TRUE(tcam.is_frozen());
+    EXPECT_GT(tcam.get_memory_usage_stats().frozen_tree_bytes, 0u);
+    auto packets = random_packets(600);
+    for (const auto& p : packets) {
+        const int expected = tcam.lookup_linear_idx(p);
+        ASSERT_EQ(tcam.lookup_frozen_idx(p), expected);
+        ASSERT_EQ(tcam.lookup_decision_tree_idx(p), expected);
+        std::vector<std::string> trace;
+        ASSERT_EQ(tcam.lookup_frozen_idx(p, &trace), expected);
+    }
+    // Short packets stop at the first test on a missing byte.
+    std::vector<uint8_t> short_packet(packets[0].begin(), packets[0].begin() + 6);
+    EXPECT_EQ(tcam.lookup_frozen_idx(short_packet), tcam.lookup_linear_idx(short_packet));
+
+    // Updates while frozen refresh the compiled tree.
+    add_random_rules_incrementally(40);
+    auto all_stats = tcam.get_all_rule_stats();
+    for (size_t i = 0; i < all_stats.size(); i += 5) {
+        tcam.delete_rule(all_stats[i].rule_id);
+    }
+    std::vector<int> results;
+    tcam.lookup_batch(packets, results);
+    auto expected = expected_actions(packets);
+    EXPECT_EQ(results, expected);
+    for (size_t i = 0; i < packets.size(); ++i) {
+        ASSERT_EQ(tcam.classify(packets[i]), expected[i]);
+        ASSERT_EQ(tcam.lookup_single(packets[i]), expected[i]);
+    }
+
+    tcam.thaw();
+    EXPECT_FALSE(tcam.is_frozen());
+    EXPECT_EQ(tcam.get_memory_usage_stats().frozen_tree_bytes, 0u);
+    EXPECT_EQ(tcam.lookup_frozen_idx(packets[0]), -1);
+}
@@ -163,6 +163,98 @@ void test_put_get_lfu() {
 }
 
 
+void test_put_get_wtinylfu() {
+    cpp_collections::ThreadSafeCache<int, std::string> cache(3, cpp_collections::EvictionPolicy::WTinyLFU);
+    cache.put(1, "one");
+    cache.put(2, "two");
+    cache.put(3, "three");
+    assert(cache.size() == 3);
+    assert(cache.get(1).value_or("") == "one");
+    assert(cache.get(2).value_or("") == "two");
+
+    cache.put(1, "uno"); // Update in place
+    assert(cache.get(1).value_or("") == "uno");
+    assert(cache.size() == 3);
+
+    // 3 sits in the window; pushed out by 4, it loses admission against the
+    // more frequently used 1 and 2 and is evicted itself
+    cache.put(4, "four");
+    assert(cache.size() == 3);
+    assert(cache.get(3) == std::nullopt);
+    assert(cache.get(1).value_or("") == "uno");
+    assert(cache.get(2).value_or("") == "two");
+    assert(cache.get(4).value_or("") == "four");
+
+    assert(cache.erase(4));
+    assert(!cache.erase(4));
+    assert(cache.size() == 2);
+    cache.put(5, "five");
+    assert(cache.size() == 3);
+    assert(cache.get(5).value_or("") == "five");
+}
+
+void test_put_get_arc() {
+    cpp_collections::ThreadSafeCache<int, std::string> cache(3, cpp_collections::EvictionPolicy::ARC);
+    cache.put(1, "one");
+    cache.put(2, "two");
+    cache.put(3, "three");
+    assert(cache.get(1).value_or("") == "one"); // 1 moves to the frequency list
+
+    cache.put(4, "four"); // Evicts 2, the least recent of the keys seen once
+    assert(cache.size() == 3);
+    assert(cache.get(2) == std::nullopt);
+
+    // 2 is remembered as a ghost: bringing it back favours it over 3
+    cache.put(2, "two");
+    assert(cache.size() == 3);
+    assert(cache.get(3) == std::nullopt);
+    assert(cache.get(1).value_or("") == "one");
+    assert(cache.get(2).value_or("") == "two");
+    assert(cache.get(4).value_or("") == "four");
+
+    assert(cache.erase(1));
+    assert(cache.size() == 2);
+    cache.clear();
+    assert(cache.empty());
+    cache.put(1, "one");
+    assert(cache.get(1).value_or("") == "one");
+}
+
+// A hot set that was used repeatedly survives a long scan of one-off keys
+// under W-TinyLFU and ARC, while plain LRU loses all of it
+void test_scan_resistance() {
+    const int cache_capacity = 100;
+    const int hot_keys = 50;
+    for (auto policy : {cpp_collections::EvictionPolicy::LRU, cpp_collections::EvictionPolicy::WTinyLFU,
+                        cpp_collections::EvictionPolicy::ARC}) {
+        cpp_collections::ThreadSafeCache<int, int> cache(cache_capacity, policy);
+        for (int k = 0; k < hot_keys; ++k) {
+            cache.put(k, k);
+        }
+        for (int round = 0; round < 5; ++round) {
+            for (int k = 0; k < hot_keys; ++k) {
+                cache.get(k);
+            }
+        }
+        for (int k = 1000; k < 3000; ++k) {
+            cache.get(k); // Miss, then load
+            cache.put(k, k);
+        }
+        assert(cache.size() <= static_cast<size_t>(cache_capacity));
+        int survivors = 0;
+        for (int k = 0; k < hot_keys; ++k) {
+            survivors += cache.get(k).has_value() ? 1 : 0;
+        }
+        if (policy == cpp_collections::EvictionPolicy::LRU) {
+            assert(survivors == 0);
+        } else {
+            // W-TinyLFU's window still holds the last hot key when the scan starts;
+            // it never reached the protected segment and its count decays
+            assert(survivors >= hot_keys - 1);
+        }
+    }
+}
+
 void test_erase() {
     cpp_collections::ThreadSafeCache<int, std::string> cache(3, cpp_collections::EvictionPolicy::LRU);
     cache.put(1, "one");
@@ -289,6 +381,33 @@ void test_thread_safety_concurrent_put_get_erase() {
     std::cout << "Items found after mixed operations: " << found_items << std::endl;
 }
 
+void test_thread_safety_admission_policies() {
+    const int num_threads = 8;
+    const int operations_per_thread = 2000;
+    const int cache_capacity = 64;
+    for (auto policy : {cpp_collections::EvictionPolicy::WTinyLFU, cpp_collections::EvictionPolicy::ARC}) {
+        cpp_collections::ThreadSafeCache<int, int> cache(cache_capacity, policy);
+        std::vector<std::thread> threads;
+        for (int i = 0; i < num_threads; ++i) {
+            threads.emplace_back([&cache, i, operations_per_thread, cache_capacity]() {
+                for (int j = 0; j < operations_per_thread; ++j) {
+                    int key = (i * 7919 + j * 31) % (cache_capacity * 4);
+                    if (j % 5 == 0) {
+                        cache.erase(key);
+                    } else if (j % 2 == 0) {
+                        cache.put(key, j);
+                    } else {
+                        cache.get(key);
+                    }
+                }
+            });
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+        assert(cache.size() <= static_cast<size_t>(cache_capacity));
+    }
+}
 
 int main() {
     std::cout << "Starting ThreadSafeCache tests..." << std::endl;
@@ -297,10 +416,14 @@ int main() {
     RUN_TEST(test_put_get_lru);
     RUN_TEST(test_put_get_fifo);
     RUN_TEST(test_put_get_lfu);
+    RUN_TEST(test_put_get_wtinylfu);
+    RUN_TEST(test_put_get_arc);
+    RUN_TEST(test_scan_resistance);
     RUN_TEST(test_erase);
     RUN_TEST(test_clear);
     RUN_TEST(test_thread_safety_concurrent_put);
     RUN_TEST(test_thread_safety_concurrent_put_get_erase);
+    RUN_TEST(test_thread_safety_admission_policies);
 
     std::cout << "\nTests finished." << std::endl;
     std::cout << "Total tests run: " << tests_run << std::endl;
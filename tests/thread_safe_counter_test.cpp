@@ -1,6 +1,8 @@
 #include "gtest/gtest.h"
 #include "thread_safe_counter.hpp"
 #include <thread>
+#include <atomic>
+#include <chrono>
 #include <vector>
 #include <string>
 #include <numeric> // For std::iota
@@ -463,6 +465,104 @@ TEST(ThreadSafeCounterTest, DeductionGuides) {
     (void)c_from_pair_list;
 }
 
+TEST(ShardedThreadSafeCounterTest, BasicOperations) {
+    ShardedThreadSafeCounter<std::string> counter;
+    ASSERT_TRUE(counter.empty());
+    counter.add("apple");
+    counter.add("apple", 2);
+    counter.add("banana");
+    counter.subtract("cherry", 2);
+    ASSERT_EQ(counter.count("apple"), 3);
+    ASSERT_EQ(counter["banana"], 1);
+    ASSERT_EQ(counter.count("cherry"), -2);
+    ASSERT_FALSE(counter.contains("cherry"));
+    ASSERT_EQ(counter.size(), 2u); // Positive counts only
+    ASSERT_EQ(counter.total(), 2);
+
+    const auto top = counter.most_common(1);
+    ASSERT_EQ(top.size(), 1u);
+    ASSERT_EQ(top[0], std::make_pair("apple"s, 3));
+
+    counter.set_count("banana", 5);
+    ASSERT_EQ(counter.count("banana"), 5);
+    ASSERT_EQ(counter.erase("apple"), 1u);
+    ASSERT_EQ(counter.count("apple"), 0);
+    counter.clear();
+    ASSERT_TRUE(counter.empty());
+}
+
+TEST(ShardedThreadSafeCounterTest, ConcurrentAddsAreAllCounted) {
+    const int num_threads = 8;
+    const int adds_per_thread = 64 * 300;
+    const int num_keys = 64;
+    ShardedThreadSafeCounter<int> counter(std::chrono::milliseconds(1), 4);
+    ASSERT_EQ(counter.shard_count(), 4u);
+
+    std::atomic<bool> done(false);
+    std::thread reader([&]() {
+        while (!done) {
+            const auto top = counter.most_common(3);
+            ASSERT_LE(top.size(), 3u);
+        }
+    });
+    std::vector<std::thread> writers;
+    for (int t = 0; t < num_threads; ++t) {
+        writers.emplace_back([&counter, t]() {
+            for (int i = 0; i < adds_per_thread; ++i) {
+                counter.add((t * 7 + i) % num_keys);
+            }
+        });
+    }
+    for (auto& writer : writers) {
+        writer.join();
+    }
+    done = true;
+    reader.join();
+
+    counter.flush();
+    ASSERT_EQ(counter.total(), num_threads * adds_per_thread);
+    ASSERT_EQ(counter.size(), static_cast<size_t>(num_keys));
+    for (int key = 0; key < num_keys; ++key) {
+        ASSERT_EQ(counter.count(key), num_threads * adds_per_thread / num_keys) << key;
+    }
+}
+
+TEST(ShardedThreadSafeCounterTest, ReadsWithinStalenessSkipMerging) {
+    ShardedThreadSafeCounter<std::string> counter(std::chrono::hours(1));
+    counter.add("flow");
+    ASSERT_EQ(counter.count("flow"), 1); // The first read always merges
+    counter.add("flow", 4);
+    ASSERT_EQ(counter.count("flow"), 1); // Still within max_staleness
+    counter.flush();
+    ASSERT_EQ(counter.count("flow"), 5);
+
+    ShardedThreadSafeCounter<std::string> exact; // Zero staleness: every read merges
+    exact.add("flow");
+    ASSERT_EQ(exact.count("flow"), 1);
+    exact.add("flow");
+    ASSERT_EQ(exact.count("flow"), 2);
+}
+
+TEST(ShardedThreadSafeCounterTest, SubtractIgnoresNonPositiveAmounts) {
+    ShardedThreadSafeCounter<std::string> counter;
+    counter.add("apple", 3);
+    counter.subtract("apple", -5);
+    counter.subtract("apple", 0);
+    ASSERT_EQ(counter.count("apple"), 3);
+    counter.subtract("apple", 2);
+    ASSERT_EQ(counter.count("apple"), 1);
+}
+
+TEST(ShardedThreadSafeCounterTest, MaxStalenessMergesOnlyOnFlush) {
+    ShardedThreadSafeCounter<std::string> counter(ShardedThreadSafeCounter<std::string>::Clock::duration::max());
+    counter.add("flow");
+    ASSERT_EQ(counter.count("flow"), 1); // The first read always merges
+    counter.add("flow");
+    ASSERT_EQ(counter.count("flow"), 1);
+    counter.flush();
+    ASSERT_EQ(counter.count("flow"), 2);
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
@@ -200,6 +200,95 @@ void test_tick_under_load() {
     std::cout << "TestTickUnderLoad PASSED" << std::endl;
 }
 
+// Test 10: Delays spanning several levels fire on their exact tick, whether ticked or advanced
+void test_hierarchical_exact_fire_tick() {
+    printTestHeader("TestHierarchicalExactFireTick");
+    const std::vector<uint64_t> delays = {1, 7, 8, 9, 63, 64, 65, 511, 512, 513, 4095, 4096, 4097, 40000, 300000};
+    for (int mode = 0; mode < 2; ++mode) {
+        cpp_utils::TimerWheel tw(1, 8); // Level 1 spans 8 ticks a slot, level 2 512, level 3 32768
+        std::vector<uint64_t> fired_at(delays.size(), 0);
+        for (size_t i = 0; i < delays.size(); ++i) {
+            tw.addTimer(delays[i], [&, i](std::any /*c*/){ fired_at[i] = tw.currentTick() + 1; });
+        }
+        if (mode == 0) {
+            for (uint64_t t = 0; t < 300000; ++t) tw.tick();
+        } else {
+            assert(tw.advance(300000) == delays.size());
+        }
+        for (size_t i = 0; i < delays.size(); ++i) {
+            assert(fired_at[i] == delays[i]); // n ticks: fires on the n-th tick
+        }
+        assert(tw.empty());
+    }
+    std::cout << "TestHierarchicalExactFireTick PASSED" << std::endl;
+}
+
+// Test 11: advance() skips idle stretches and agrees with ticking one by one
+void test_advance_matches_ticking() {
+    printTestHeader("TestAdvanceMatchesTicking");
+    cpp_utils::TimerWheel ticked(1, 16);
+    cpp_utils::TimerWheel advanced(1, 16);
+    std::vector<uint64_t> ticked_log, advanced_log;
+    uint64_t seed = 12345;
+    auto next_random = [&seed]() { seed = seed * 6364136223846793005ULL + 1442695040888963407ULL; return seed >> 33; };
+    for (int i = 0; i < 300; ++i) {
+        const uint64_t delay = 1 + next_random() % 5000;
+        const auto type = i % 10 == 0 ? cpp_utils::TimerType::Periodic : cpp_utils::TimerType::OneShot;
+        ticked.addTimer(delay, [&, i](std::any /*c*/){ ticked_log.push_back(ticked.currentTick() * 1000 + i); }, type);
+        advanced.addTimer(delay, [&, i](std::any /*c*/){ advanced_log.push_back(advanced.currentTick() * 1000 + i); }, type);
+    }
+    size_t fired = 0;
+    for (uint64_t step : {1, 2, 100, 997, 4096, 1, 3000}) {
+        for (uint64_t t = 0; t < step; ++t) ticked.tick();
+        fired += advanced.advance(step);
+    }
+    assert(advanced.currentTick() == ticked.currentTick());
+    assert(fired == advanced_log.size());
+    assert(ticked_log == advanced_log);
+    assert(ticked.size() == advanced.size());
+
+    cpp_utils::TimerWheel idle(1, 256);
+    assert(!idle.ticksToNextEvent().has_value());
+    idle.addTimer(1000000, [](std::any /*c*/){});
+    assert(idle.ticksToNextEvent().has_value() && *idle.ticksToNextEvent() <= 1000000);
+    assert(idle.advance(999999) == 0);
+    assert(idle.advance(1) == 1);
+    std::cout << "TestAdvanceMatchesTicking PASSED (" << fired << " callbacks)" << std::endl;
+}
+
+// Test 12: A fired or cancelled timer's id stays dead after its node is reused
+void test_stale_id_after_reuse() {
+    printTestHeader("TestStaleIdAfterReuse");
+    cpp_utils::TimerWheel tw(10, 100);
+    std::atomic<int> fire_count(0);
+    int first = tw.addTimer(10, [&](std::any /*c*/){ fire_count++; });
+    assert(tw.cancelTimer(first));
+    assert(!tw.cancelTimer(first));
+    int second = tw.addTimer(10, [&](std::any /*c*/){ fire_count++; }); // Reuses the node
+    assert(second != first);
+    assert(!tw.cancelTimer(first));
+    tw.tick();
+    assert(fire_count == 1);
+    assert(!tw.cancelTimer(second)); // Already fired
+    assert(!tw.cancelTimer(-1));
+
+    // Ids stay flat ints; the stale id is rejected through 127 reuses of its node
+    for (int i = 0; i < 126; ++i) {
+        int reused = tw.addTimer(10, [&](std::any /*c*/){ fire_count++; });
+        assert(reused >= 0 && reused != first);
+        assert(!tw.cancelTimer(first));
+        assert(tw.cancelTimer(reused));
+    }
+
+    // A periodic timer cancelling itself from its callback
+    cpp_utils::TimerWheel::TimerId self = -1;
+    self = tw.addTimer(10, [&](std::any /*c*/){ fire_count++; assert(tw.cancelTimer(self)); }, cpp_utils::TimerType::Periodic);
+    for (int i = 0; i < 5; ++i) tw.tick();
+    assert(fire_count == 2);
+    assert(tw.empty());
+    std::cout << "TestStaleIdAfterReuse PASSED" << std::endl;
+}
+
 int main() {
     std::cout << "TimerWheel Tests (using Corrected Logic A expectations, with std::any cookie)" << std::endl;
     test_one_shot_timer_fires_once();
@@ -210,6 +299,9 @@ int main() {
     test_timer_added_from_callback();
     test_timer_delay_greater_than_wheel_cycle();
     test_tick_under_load();
+    test_hierarchical_exact_fire_tick();
+    test_advance_matches_ticking();
+    test_stale_id_after_reuse();
 
     std::cout << "\nAll TimerWheel tests completed." << std::endl;
     return 0;
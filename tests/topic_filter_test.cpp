@@ -4,6 +4,7 @@
 #include <vector>
 #include <string>
 #include <chrono> // For performance test
+#include <random>
 
 
 TEST(TopicFilterTest, BasicFunctionality)
@@ -207,3 +208,76 @@ TEST(TopicFilterTest, PerformanceTest)
         EXPECT_LT(matches, NUM_TESTS);
     }
 }
+
+TEST(TopicFilterTest, CompiledMatcherAgreesWithRuleScan)
+{
+    TopicFilter filter;
+    filter.addExactMatch("VLAN_1000");
+    filter.addExactMatch("Eth");
+    filter.addPrefixMatch("PortChannel*");
+    filter.addPrefixMatch("Loopback1");
+    filter.addRangeMatch("VLAN", 1, 100);
+    filter.addRangeMatch("VLAN", 50, 200); // Overlaps the rule above
+    filter.addRangeMatch("VLAN", 4000, 4094);
+    filter.addRangeMatch("VLAN_1", 0, 5); // "VLAN_1_3"
+    filter.addRegexMatch(R"(Ethernet[0-9]+/[0-9]+)");
+    filter.addRegexMatch(R"(user_[a-z]+)", TopicFilter::RegexMode::MATCH, std::regex_constants::icase);
+    filter.addRegexMatch(R"(_ERR[0-9]?$)", TopicFilter::RegexMode::SEARCH);
+    filter.addRegexMatch(R"((a)\1)", TopicFilter::RegexMode::SEARCH); // Backreference: stays on std::regex
+
+    const TopicFilter scan = filter; // Not optimized
+    filter.optimize();
+    ASSERT_TRUE(filter.isCompiled());
+    ASSERT_FALSE(scan.isCompiled());
+
+    const auto stats = filter.getStatistics();
+    EXPECT_EQ(stats.compiled_regex_rules, 3u);
+    EXPECT_GT(stats.regex_dfa_states, 0u);
+
+    std::vector<std::string> keys = {"", "VLAN_", "VLAN_0", "VLAN_1", "VLAN_150", "VLAN_201", "VLAN_4094",
+                                     "VLAN_-5", "VLAN_1_3", "VLAN_1_9", "VLAN_1000", "VLAN_10000", "Eth",
+                                     "Eth0", "PortChannel", "PortChanne", "Loopback10", "Ethernet1/2",
+                                     "Ethernet1/", "USER_Bob", "user_", "x_ERR", "x_ERR7", "x_ERR7y", "baab",
+                                     "bab"};
+    const char alphabet[] = "VLAN_0123456789EthPortChanelusr/ERab";
+    std::mt19937 rng(3);
+    for (int i = 0; i < 20000; ++i)
+    {
+        std::string key(rng() % 12, ' ');
+        for (char& c : key)
+        {
+            c = alphabet[rng() % (sizeof(alphabet) - 1)];
+        }
+        if (i % 2 == 0)
+        {
+            key.insert(0, i % 4 == 0 ? "VLAN_" : "Ethernet");
+        }
+        keys.push_back(std::move(key));
+    }
+    for (const auto& key : keys)
+    {
+        ASSERT_EQ(filter.match(key), scan.match(key)) << '"' << key << '"';
+    }
+}
+
+TEST(TopicFilterTest, AddingRulesAfterOptimizeFallsBackToScan)
+{
+    TopicFilter filter;
+    filter.addPrefixMatch("Ethernet*");
+    filter.optimize();
+    EXPECT_FALSE(filter.match("VLAN_7"));
+
+    filter.addRangeMatch("VLAN", 1, 10);
+    EXPECT_FALSE(filter.isCompiled());
+    EXPECT_TRUE(filter.match("VLAN_7"));
+    EXPECT_TRUE(filter.match("Ethernet0"));
+
+    filter.optimize();
+    EXPECT_TRUE(filter.match("VLAN_7"));
+
+    filter.clear();
+    EXPECT_FALSE(filter.match("Ethernet0"));
+    filter.optimize();
+    EXPECT_FALSE(filter.match("Ethernet0"));
+    EXPECT_FALSE(filter.match(""));
+}
@@ -0,0 +1,133 @@
+#include "gtest/gtest.h"
+#include "topic_subscription_index.h"
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+template <typename Id>
+std::vector<Id> sorted(std::vector<Id> ids)
+{
+    std::sort(ids.begin(), ids.end());
+    return ids;
+}
+
+} // namespace
+
+TEST(TopicSubscriptionIndexTest, ReturnsEverySubscriberOnce)
+{
+    TopicSubscriptionIndex<std::string> index;
+    index.addExactMatch("alice", "VLAN_1000");
+    index.addPrefixMatch("alice", "VLAN*"); // Also matches VLAN_1000: reported once
+    index.addRangeMatch("bob", "VLAN", 1, 2000);
+    index.addRangeMatch("carol", "VLAN", 500, 1500);
+    index.addRangeMatch("carol", "VLAN", 900, 1100); // Overlaps carol's own range
+    index.addRegexMatch("dave", R"(VLAN_[0-9]+)");
+    index.addRegexMatch("erin", R"(_10)", TopicSubscriptionIndex<std::string>::RegexMode::SEARCH);
+    index.addRegexMatch("frank", R"((V)\1?LAN_1000)"); // Backreference: stays on std::regex
+    index.addPrefixMatch("grace", "Ethernet*");
+
+    for (bool compiled : {false, true})
+    {
+        SCOPED_TRACE(compiled ? "compiled" : "scan");
+        if (compiled)
+        {
+            index.optimize();
+        }
+        EXPECT_EQ(index.isCompiled(), compiled);
+        EXPECT_EQ(sorted(index.match("VLAN_1000")),
+                  (std::vector<std::string>{"alice", "bob", "carol", "dave", "erin", "frank"}));
+        EXPECT_EQ(sorted(index.match("VLAN_2000")), (std::vector<std::string>{"alice", "bob", "dave"}));
+        EXPECT_EQ(sorted(index.match("Ethernet4")), (std::vector<std::string>{"grace"}));
+        EXPECT_TRUE(index.match("PortChannel1").empty());
+    }
+    EXPECT_EQ(index.subscriberCount(), 7u);
+    EXPECT_EQ(index.size(), 9u);
+}
+
+TEST(TopicSubscriptionIndexTest, BatchMatchesEachKey)
+{
+    TopicSubscriptionIndex<> index;
+    index.addRangeMatch(1, "VLAN", 1, 10);
+    index.addRangeMatch(2, "VLAN", 5, 20);
+    index.addExactMatch(3, "Loopback0");
+    index.optimize();
+
+    const std::vector<std::string> keys = {"VLAN_3", "VLAN_7", "VLAN_15", "VLAN_30", "Loopback0"};
+    TopicSubscriptionIndex<>::BatchResult result;
+    index.matchBatch(keys, result);
+    ASSERT_EQ(result.size(), keys.size());
+    auto at = [&](size_t i) { return sorted(std::vector<uint32_t>(result[i].begin(), result[i].end())); };
+    EXPECT_EQ(at(0), (std::vector<uint32_t>{1}));
+    EXPECT_EQ(at(1), (std::vector<uint32_t>{1, 2}));
+    EXPECT_EQ(at(2), (std::vector<uint32_t>{2}));
+    EXPECT_TRUE(at(3).empty());
+    EXPECT_EQ(at(4), (std::vector<uint32_t>{3}));
+
+    // The result's storage is reused by the next batch
+    const std::vector<std::string_view> more = {"VLAN_5"};
+    index.matchBatch(more, result);
+    ASSERT_EQ(result.size(), 1u);
+    EXPECT_EQ(result[0].size(), 2u);
+}
+
+TEST(TopicSubscriptionIndexTest, RemoveSubscriberAndAgreeWithPerSubscriberFilters)
+{
+    constexpr uint32_t kSubscribers = 200;
+    TopicSubscriptionIndex<> index;
+    std::vector<TopicFilter> filters(kSubscribers);
+    std::mt19937 rng(11);
+    for (uint32_t s = 0; s < kSubscribers; ++s)
+    {
+        const std::string n = std::to_string(rng() % 50);
+        switch (s % 4)
+        {
+        case 0:
+            index.addExactMatch(s, "VLAN_" + n);
+            filters[s].addExactMatch("VLAN_" + n);
+            break;
+        case 1:
+            index.addPrefixMatch(s, "Eth" + n + "*");
+            filters[s].addPrefixMatch("Eth" + n + "*");
+            break;
+        case 2:
+        {
+            const long long lo = rng() % 40;
+            const long long hi = lo + rng() % 20;
+            index.addRangeMatch(s, "VLAN", lo, hi);
+            filters[s].addRangeMatch("VLAN", lo, hi);
+            break;
+        }
+        case 3:
+            index.addRegexMatch(s, "Eth" + n + "/[0-9]+");
+            filters[s].addRegexMatch("Eth" + n + "/[0-9]+");
+            break;
+        }
+    }
+    // Unsubscribe every other range subscriber, then give subscriber 2 a new rule
+    for (uint32_t s = 2; s < kSubscribers; s += 8)
+    {
+        index.removeSubscriber(s);
+        filters[s] = TopicFilter();
+    }
+    EXPECT_FALSE(index.removeSubscriber(2));
+    index.addRangeMatch(2, "VLAN", 10, 30);
+    filters[2].addRangeMatch("VLAN", 10, 30);
+    index.optimize();
+
+    for (int i = 0; i < 2000; ++i)
+    {
+        const std::string key = (i % 2 ? "VLAN_" : "Eth") + std::to_string(rng() % 60) + (i % 3 ? "" : "/7");
+        std::vector<uint32_t> expected;
+        for (uint32_t s = 0; s < kSubscribers; ++s)
+        {
+            if (filters[s].match(key))
+            {
+                expected.push_back(s);
+            }
+        }
+        ASSERT_EQ(sorted(index.match(key)), expected) << key;
+    }
+}